@@ -0,0 +1,196 @@
+/* batch_abi_bench.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Compares calling the batch C interface once per item with
+ * handing it thousands of items per call, synchronously and through
+ * submitted batches. Linked against the shared library, so every call
+ * crosses the library boundary as an embedding caller's would.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "lib/batch_abi.h"
+
+
+namespace project_structure
+{
+
+/* Timed runs per case, the fastest one is reported. */
+constexpr int kBenchRepetitions = 5;
+
+/* How the items are handed to the library. */
+enum class CallForm
+{
+  /* One PsBatchRun per item. */
+  kSingle = 0,
+  /* One PsBatchRun per batch_size items. */
+  kBatch = 1,
+  /* One PsBatchSubmit per batch_size items, completions polled. */
+  kSubmit = 2
+};
+
+/* Items and the requests describing them, one request per item. */
+struct BenchData
+{
+  std::vector<std::int32_t> values;
+  std::vector<PsBatchRequest> requests;
+  std::vector<PsBatchCompletion> completions;
+};
+
+/* Runs every request in form once, returns the library calls made. */
+static std::uint64_t RunOnce(CallForm form, PsBatchContext *context,
+    BenchData &data, std::uint64_t batch_size)
+{
+  const std::uint64_t kCount = data.requests.size();
+  std::uint64_t batches = 0;
+  std::uint64_t calls = 0;
+  std::uint64_t polled = 0;
+  std::uint64_t size = 0;
+  for (std::uint64_t begin = 0; begin < kCount; begin += size)
+  {
+    size = form == CallForm::kSingle ? 1 : std::min(batch_size,
+        kCount - begin);
+    if (form == CallForm::kSubmit)
+    {
+      /* Everything fits in flight, see main. */
+      PsBatchSubmit(context, &data.requests[begin], size, begin);
+    }
+    else
+    {
+      PsBatchRun(&data.requests[begin], size, nullptr);
+    }
+    ++batches;
+  }
+  calls = batches;
+  if (form == CallForm::kSubmit)
+  {
+    PsBatchWait(context);
+    ++calls;
+    while (polled < batches)
+    {
+      polled += PsBatchPoll(context, data.completions.data(),
+          data.completions.size());
+      ++calls;
+    }
+  }
+  return calls;
+}
+
+/* Prints the best time per item of form and the calls it takes. */
+static void ReportForm(const char *name, CallForm form,
+    PsBatchContext *context, BenchData &data, std::uint64_t batch_size)
+{
+  std::chrono::steady_clock::time_point start;
+  std::chrono::duration<double> elapsed;
+  std::uint64_t calls = 0;
+  double best = 0.0;
+
+  /* Warm up, faults in the buffers and starts the workers. */
+  RunOnce(form, context, data, batch_size);
+  for (int i = 0; i < kBenchRepetitions; ++i)
+  {
+    start = std::chrono::steady_clock::now();
+    calls = RunOnce(form, context, data, batch_size);
+    elapsed = std::chrono::steady_clock::now() - start;
+    if (best == 0.0 || elapsed.count() < best)
+    {
+      best = elapsed.count();
+    }
+  }
+  std::printf("%-10s %12.2f %14llu\n", name,
+      best * 1e9 / static_cast<double>(data.requests.size()),
+      static_cast<unsigned long long>(calls));
+}
+
+} /* namespace project_structure */
+
+int main(int argc, char **argv)
+{
+  std::uint64_t item_count = std::uint64_t{1} << 20;
+  std::uint64_t batch_size = 4096;
+  std::uint32_t thread_count = 1;
+  PsBatchContextOptions options = {};
+  PsBatchContext *context = nullptr;
+  project_structure::BenchData data;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--items") == 0 && i + 1 < argc)
+    {
+      item_count = std::strtoull(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "--batch-size") == 0 && i + 1 < argc)
+    {
+      batch_size = std::strtoull(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+    {
+      thread_count = static_cast<std::uint32_t>(std::strtoul(argv[++i],
+          nullptr, 10));
+    }
+    else
+    {
+      std::fprintf(stderr, "usage: %s [--items N] [--batch-size N] "
+          "[--threads N]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (batch_size == 0)
+  {
+    batch_size = 1;
+  }
+  if (PsBatchAbiVersion() != kPsBatchAbiVersion)
+  {
+    std::fprintf(stderr, "shared library has interface version %u, built "
+        "against %d\n", PsBatchAbiVersion(), kPsBatchAbiVersion);
+    return EXIT_FAILURE;
+  }
+
+  /* Room for every batch of a run, so that submitting never fails. */
+  options.struct_size = sizeof(options);
+  options.thread_count = thread_count;
+  options.max_in_flight = static_cast<std::uint32_t>(
+      (item_count + batch_size - 1) / batch_size);
+  if (PsBatchContextCreate(&options, &context) != kPsBatchOk)
+  {
+    std::fprintf(stderr, "could not create the context\n");
+    return EXIT_FAILURE;
+  }
+
+  /* One DoSomethingElse of one value per item, the smallest request. */
+  data.values.resize(item_count, 0);
+  data.requests.resize(item_count, PsBatchRequest{});
+  data.completions.resize(options.max_in_flight, PsBatchCompletion{});
+  for (std::uint64_t i = 0; i < item_count; ++i)
+  {
+    data.values[i] = static_cast<std::int32_t>(i);
+    data.requests[i].operation = kPsBatchModuleADoSomethingElse;
+    data.requests[i].argument = kPsBatchEnumVarTwo;
+    data.requests[i].inputs = &data.values[i];
+    data.requests[i].outputs = &data.values[i];
+    data.requests[i].count = 1;
+  }
+
+  std::printf("%llu items, batches of %llu, %u threads\n%-10s %12s %14s\n",
+      static_cast<unsigned long long>(item_count),
+      static_cast<unsigned long long>(batch_size), thread_count, "form",
+      "ns/item", "library calls");
+  project_structure::ReportForm("single", project_structure::CallForm::kSingle,
+      context, data, batch_size);
+  project_structure::ReportForm("batch", project_structure::CallForm::kBatch,
+      context, data, batch_size);
+  project_structure::ReportForm("submit", project_structure::CallForm::kSubmit,
+      context, data, batch_size);
+  PsBatchContextDestroy(context);
+  return 0;
+}
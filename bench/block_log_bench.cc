@@ -0,0 +1,321 @@
+/* block_log_bench.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Compares replaying a SomeMessage archive from a block
+ * compressed log, on 1 to N threads, with reading the same messages from an
+ * uncompressed record stream.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lib/library.h"
+#include "module-b/b.h"
+#include "module-b/block_log.h"
+#include "module-b/generated/message.pb.h"
+#include "module-b/ingest.h"
+#include "module-b/record_stream.h"
+
+
+namespace project_structure
+{
+
+/* Timed runs per case, the fastest one is reported. */
+constexpr int kBenchRepetitions = 3;
+
+/* Command line options. */
+struct BlockLogBenchOptions
+{
+  std::size_t message_count = 1000000;
+  std::size_t max_threads = std::thread::hardware_concurrency();
+  /* Modeled storage bandwidth in MB/s, 0 to report CPU time only. */
+  double disk_mbps = 0.0;
+  /* Parse every message and run module_b on it, not just count bytes. */
+  bool parse = false;
+  std::string directory = "/tmp";
+};
+
+/*
+ * What module_b does with a replayed message, or with parse off only the
+ * bytes counted, which leaves the cost of the format itself.
+ */
+class ReplaySink : public module_b::RecordSink
+{
+ public:
+  explicit ReplaySink(bool parse) : parse_(parse)
+  {
+  }
+
+  void OnRecord(std::size_t source, std::span<const std::byte> record)
+      override
+  {
+    (void)source;
+    bytes_ += record.size();
+    if (parse_ && message_.ParseFromArray(record.data(),
+        static_cast<int>(record.size())))
+    {
+      sum_ += module_b::DoSomethingElse<module_b::SomeEnum::kEnumVarOne>(
+          module_b::SomeStruct{message_.struct_var()});
+    }
+  }
+
+  void OnSourceEnd(std::size_t source, module_b::RecordStatus status)
+      override
+  {
+    if (status != module_b::RecordStatus::kEnd)
+    {
+      std::fprintf(stderr, "source %zu ended with status %d\n", source,
+          static_cast<int>(status));
+    }
+  }
+
+  std::uint64_t Bytes() const
+  {
+    return bytes_;
+  }
+
+  void Reset()
+  {
+    bytes_ = 0;
+    sum_ = 0;
+  }
+
+ private:
+  module_b::SomeMessage message_;
+  bool parse_ = false;
+  std::uint64_t bytes_ = 0;
+  std::int64_t sum_ = 0;
+};
+
+/*
+ * Writes the dataset as a record stream with CRCs and as a block log.
+ * Messages look like an archive: ids counting up, small values and a
+ * payload of key=value text.
+ */
+static bool WriteDataset(const BlockLogBenchOptions &options,
+    const std::string &stream_path, const std::string &log_path)
+{
+  const char *kStates[] = {"active", "idle", "draining"};
+  module_b::RecordWriter stream_writer;
+  module_b::BlockLogWriter log_writer;
+  module_b::SomeMessage message;
+  char payload[128] = {};
+  int payload_size = 0;
+  if (!stream_writer.Open(stream_path.c_str()) ||
+      !log_writer.Open(log_path.c_str()))
+  {
+    return false;
+  }
+  message.set_class_const(module_b::kTempVar);
+  for (int i = 0; i < 8; ++i)
+  {
+    message.add_values(0);
+  }
+  for (std::size_t i = 0; i < options.message_count; ++i)
+  {
+    message.set_struct_var(static_cast<int>(i));
+    message.set_some_enum(static_cast<int>(i % 2 + 1));
+    for (int j = 0; j < message.values_size(); ++j)
+    {
+      message.set_values(j, static_cast<int>((i * 7 + j * 13) % 1000));
+    }
+    payload_size = std::snprintf(payload, sizeof(payload),
+        "client=%06zu;region=eu-north-%zu;state=%s;sequence=%zu",
+        i % 50000, i % 3, kStates[i % 3], i);
+    message.set_payload(payload, static_cast<std::size_t>(payload_size));
+    if (!stream_writer.WriteMessage(message) ||
+        !log_writer.WriteMessage(message))
+    {
+      return false;
+    }
+  }
+  return stream_writer.Close() && log_writer.Close();
+}
+
+static double FileMegabytes(const std::string &path)
+{
+  struct stat file_stat = {};
+  if (stat(path.c_str(), &file_stat) != 0)
+  {
+    return 0.0;
+  }
+  return static_cast<double>(file_stat.st_size) / 1e6;
+}
+
+/* Reads the record stream into sink, the uncompressed baseline. */
+static void ReadStream(const std::string &path, ReplaySink &sink)
+{
+  module_b::RecordReader reader;
+  std::span<const std::byte> record;
+  module_b::RecordStatus status = reader.Open(path.c_str());
+  while (status == module_b::RecordStatus::kOk)
+  {
+    status = reader.Next(record);
+    if (status == module_b::RecordStatus::kOk)
+    {
+      sink.OnRecord(0, record);
+    }
+  }
+  sink.OnSourceEnd(0, status);
+}
+
+/*
+ * Replays the block log into sink on thread_count threads, on the calling
+ * thread alone if thread_count is 0.
+ */
+static void ReplayLog(const std::string &path, std::size_t thread_count,
+    ReplaySink &sink)
+{
+  module_b::BlockLogReader reader;
+  if (reader.Open(path.c_str()) != module_b::RecordStatus::kOk)
+  {
+    sink.OnSourceEnd(0, module_b::RecordStatus::kCorrupt);
+    return;
+  }
+  if (thread_count == 0)
+  {
+    module_b::ReplayBlockLog(reader, nullptr,
+        module_b::BlockLogReplayOptions{}, sink);
+    return;
+  }
+  lib::ThreadPool pool(lib::ThreadPoolOptions{thread_count, false, 1024, {}});
+  module_b::ReplayBlockLog(reader, &pool, module_b::BlockLogReplayOptions{},
+      sink);
+}
+
+/*
+ * Prints the best of kBenchRepetitions runs of one case. thread_count is
+ * ignored for the record stream, file_megabytes is what it reads from
+ * storage.
+ */
+static void RunCase(const char *name, bool block_log, std::size_t thread_count,
+    const BlockLogBenchOptions &options, const std::string &path,
+    double file_megabytes)
+{
+  std::chrono::steady_clock::time_point start;
+  std::chrono::duration<double> elapsed;
+  double best = 0.0;
+  double payload_megabytes = 0.0;
+  double modeled = 0.0;
+  ReplaySink sink(options.parse);
+  for (int i = 0; i < kBenchRepetitions; ++i)
+  {
+    sink.Reset();
+    start = std::chrono::steady_clock::now();
+    if (block_log)
+    {
+      ReplayLog(path, thread_count, sink);
+    }
+    else
+    {
+      ReadStream(path, sink);
+    }
+    elapsed = std::chrono::steady_clock::now() - start;
+    if (best == 0.0 || elapsed.count() < best)
+    {
+      best = elapsed.count();
+    }
+    payload_megabytes = static_cast<double>(sink.Bytes()) / 1e6;
+  }
+  /* Reading from storage overlaps with decoding, the slower one bounds. */
+  modeled = options.disk_mbps > 0.0 ? std::max(best,
+      file_megabytes / options.disk_mbps) : best;
+  std::printf("%-14s %10.1f %10.1f %14.1f %14.1f\n", name, file_megabytes,
+      best * 1e3, payload_megabytes / best, payload_megabytes / modeled);
+}
+
+} /* namespace project_structure */
+
+int main(int argc, char **argv)
+{
+  project_structure::BlockLogBenchOptions options;
+  std::string stream_path;
+  std::string log_path;
+  double stream_megabytes = 0.0;
+  double log_megabytes = 0.0;
+  char name[32] = {};
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--messages") == 0 && i + 1 < argc)
+    {
+      options.message_count = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc)
+    {
+      options.max_threads = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "--disk-mbps") == 0 && i + 1 < argc)
+    {
+      options.disk_mbps = std::strtod(argv[++i], nullptr);
+    }
+    else if (std::strcmp(argv[i], "--directory") == 0 && i + 1 < argc)
+    {
+      options.directory = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--parse") == 0)
+    {
+      options.parse = true;
+    }
+    else
+    {
+      std::fprintf(stderr, "usage: %s [--messages N] [--max-threads N] "
+          "[--disk-mbps MB/s] [--directory DIR] [--parse]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (options.max_threads == 0)
+  {
+    options.max_threads = 1;
+  }
+
+  stream_path = options.directory + "/block_log_bench.psrs";
+  log_path = options.directory + "/block_log_bench.psbl";
+  if (!project_structure::WriteDataset(options, stream_path, log_path))
+  {
+    std::fprintf(stderr, "could not write the dataset to %s\n",
+        options.directory.c_str());
+    return EXIT_FAILURE;
+  }
+  stream_megabytes = project_structure::FileMegabytes(stream_path);
+  log_megabytes = project_structure::FileMegabytes(log_path);
+  std::printf("%zu messages, compression ratio %.2f, %s, storage %s\n"
+      "%-14s %10s %10s %14s %14s\n", options.message_count,
+      log_megabytes > 0.0 ? stream_megabytes / log_megabytes : 0.0,
+      options.parse ? "parsed" : "counted", options.disk_mbps > 0.0 ?
+          "modeled" : "not modeled", "form", "file MB", "ms",
+      "payload MB/s", "modeled MB/s");
+  project_structure::RunCase("framed", false, 0, options, stream_path,
+      stream_megabytes);
+  project_structure::RunCase("block/serial", true, 0, options, log_path,
+      log_megabytes);
+  /* Powers of two up to max_threads, and max_threads itself. */
+  for (std::size_t threads = 1; threads < options.max_threads; threads *= 2)
+  {
+    std::snprintf(name, sizeof(name), "block/%zu", threads);
+    project_structure::RunCase(name, true, threads, options, log_path,
+        log_megabytes);
+  }
+  std::snprintf(name, sizeof(name), "block/%zu", options.max_threads);
+  project_structure::RunCase(name, true, options.max_threads, options,
+      log_path, log_megabytes);
+  unlink(stream_path.c_str());
+  unlink(log_path.c_str());
+  return 0;
+}
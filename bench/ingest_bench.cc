@@ -0,0 +1,238 @@
+/* ingest_bench.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Compares the ingest backends on SomeMessage streams read from
+ * files and from sockets, in throughput and system calls per message.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "module-b/b.h"
+#include "module-b/generated/message.pb.h"
+#include "module-b/ingest.h"
+#include "module-b/record_stream.h"
+
+
+namespace project_structure
+{
+
+/* Where the streams come from. */
+enum class IngestSourceKind
+{
+  kFile = 0,
+  kSocket = 1
+};
+
+/* Command line options. */
+struct IngestBenchOptions
+{
+  std::size_t message_count = 200000;
+  std::size_t source_count = 4;
+  std::size_t buffer_size = std::size_t{64} << 10;
+};
+
+/* module_b's processing of every ingested message. */
+class ProcessingSink : public module_b::RecordSink
+{
+ public:
+  void OnRecord(std::size_t source, std::span<const std::byte> record)
+      override
+  {
+    (void)source;
+    if (message_.ParseFromArray(record.data(),
+        static_cast<int>(record.size())))
+    {
+      sum_ += module_b::DoSomethingElse<module_b::SomeEnum::kEnumVarOne>(
+          module_b::SomeStruct{message_.struct_var()});
+    }
+  }
+
+  void OnSourceEnd(std::size_t source, module_b::RecordStatus status)
+      override
+  {
+    if (status != module_b::RecordStatus::kEnd)
+    {
+      std::fprintf(stderr, "source %zu ended with status %d\n", source,
+          static_cast<int>(status));
+    }
+  }
+
+  std::int64_t Sum() const
+  {
+    return sum_;
+  }
+
+ private:
+  module_b::SomeMessage message_;
+  std::int64_t sum_ = 0;
+};
+
+/* Writes message_count messages as a record stream to fd. */
+static void WriteMessages(int fd, std::size_t message_count, bool close_fd)
+{
+  module_b::RecordWriter writer(module_b::RecordWriterOptions{
+      std::size_t{64} << 10, true});
+  module_b::SomeMessage message;
+  message.set_class_const(module_b::kTempVar);
+  message.set_some_enum(static_cast<int>(module_b::SomeEnum::kEnumVarOne));
+  message.set_payload(std::string(64, 'p'));
+  for (int i = 0; i < 4; ++i)
+  {
+    message.add_values(i);
+  }
+  writer.OpenDescriptor(fd);
+  for (std::size_t i = 0; i < message_count; ++i)
+  {
+    message.set_struct_var(static_cast<int>(i));
+    writer.WriteMessage(message);
+  }
+  writer.Close();
+  if (close_fd)
+  {
+    close(fd);
+  }
+}
+
+/* Runs one backend over one kind of source and prints a result row. */
+static void RunCase(IngestSourceKind kind, module_b::IngestBackend backend,
+    const IngestBenchOptions &options, std::span<const std::string> paths)
+{
+  const char *kBackendNames[] = {"auto", "io_uring", "epoll", "blocking"};
+  module_b::IngestLoop loop(module_b::IngestOptions{backend,
+      options.buffer_size, 64, 64, 4});
+  ProcessingSink sink;
+  std::vector<int> fds(options.source_count, -1);
+  std::vector<std::thread> writers;
+  int socket_fds[2] = {-1, -1};
+  std::chrono::steady_clock::time_point start;
+  std::chrono::duration<double> elapsed;
+  module_b::IngestStats stats = {};
+
+  for (std::size_t i = 0; i < options.source_count; ++i)
+  {
+    if (kind == IngestSourceKind::kFile)
+    {
+      fds[i] = open(paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    else if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0,
+        socket_fds) == 0)
+    {
+      fds[i] = socket_fds[0];
+      writers.emplace_back(WriteMessages, socket_fds[1],
+          options.message_count, true);
+    }
+    loop.AddSource(fds[i]);
+  }
+  start = std::chrono::steady_clock::now();
+  if (!loop.Run(sink))
+  {
+    std::printf("%-8s %-10s unavailable\n", kind == IngestSourceKind::kFile ?
+        "file" : "socket", kBackendNames[static_cast<int>(backend)]);
+  }
+  elapsed = std::chrono::steady_clock::now() - start;
+  for (std::thread &writer : writers)
+  {
+    writer.join();
+  }
+  for (int fd : fds)
+  {
+    close(fd);
+  }
+  stats = loop.Stats();
+  if (stats.records == 0)
+  {
+    return;
+  }
+  std::printf("%-8s %-10s %14.0f %10.1f %14.4f %12" PRId64 "\n",
+      kind == IngestSourceKind::kFile ? "file" : "socket",
+      kBackendNames[static_cast<int>(loop.Backend())],
+      static_cast<double>(stats.records) / elapsed.count(),
+      static_cast<double>(stats.bytes) / elapsed.count() / 1e6,
+      static_cast<double>(stats.syscalls) /
+          static_cast<double>(stats.records), sink.Sum());
+}
+
+} /* namespace project_structure */
+
+int main(int argc, char **argv)
+{
+  const project_structure::module_b::IngestBackend kBackends[] = {
+      project_structure::module_b::IngestBackend::kBlocking,
+      project_structure::module_b::IngestBackend::kEpoll,
+      project_structure::module_b::IngestBackend::kIoUring};
+  project_structure::IngestBenchOptions options;
+  std::vector<std::string> paths;
+  int fd = -1;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--messages") == 0 && i + 1 < argc)
+    {
+      options.message_count = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "--sources") == 0 && i + 1 < argc)
+    {
+      options.source_count = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "--buffer-size") == 0 && i + 1 < argc)
+    {
+      options.buffer_size = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else
+    {
+      std::fprintf(stderr, "usage: %s [--messages N] [--sources N] "
+          "[--buffer-size BYTES]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  /* The files are written once and read from the page cache. */
+  for (std::size_t i = 0; i < options.source_count; ++i)
+  {
+    paths.push_back("/tmp/ingest_bench_" + std::to_string(getpid()) + "_" +
+        std::to_string(i));
+    fd = open(paths.back().c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+        0644);
+    if (fd < 0)
+    {
+      std::perror(paths.back().c_str());
+      return EXIT_FAILURE;
+    }
+    project_structure::WriteMessages(fd, options.message_count, true);
+  }
+
+  std::printf("%-8s %-10s %14s %10s %14s %12s\n", "source", "backend",
+      "messages/s", "MB/s", "syscalls/msg", "checksum");
+  for (project_structure::IngestSourceKind kind :
+      {project_structure::IngestSourceKind::kFile,
+      project_structure::IngestSourceKind::kSocket})
+  {
+    for (project_structure::module_b::IngestBackend backend : kBackends)
+    {
+      project_structure::RunCase(kind, backend, options, paths);
+    }
+  }
+  for (const std::string &path : paths)
+  {
+    std::remove(path.c_str());
+  }
+  return 0;
+}
@@ -0,0 +1,360 @@
+/* load_client.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Sends SomeMessage requests at a fixed rate to a server started
+ * with main --serve and reports the latency percentiles.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <vector>
+
+#include "common/unix_server.h"
+#include "module-b/b.h"
+#include "module-b/generated/message.pb.h"
+
+
+namespace project_structure
+{
+
+/* How long to wait for outstanding responses after the last request. */
+constexpr std::chrono::seconds kDrainTimeout{5};
+
+/* Command line options. */
+struct LoadClientOptions
+{
+  const char *socket_path = nullptr;
+  /* Requests per second over all connections. */
+  double rate = 10000.0;
+  double duration_seconds = 5.0;
+  std::size_t connection_count = 4;
+  /* Elements in the values of every request. */
+  int value_count = 16;
+};
+
+/* One pipelined connection to the server. */
+struct ClientConnection
+{
+  int fd;
+  /* Requests not yet sent, starting at output_begin. */
+  std::vector<std::byte> output;
+  std::size_t output_begin;
+  /* Received bytes not yet parsed are [0, input_end). */
+  std::vector<std::byte> input;
+  std::size_t input_end;
+  /* Scheduled send time of every request without a response, in order. */
+  std::deque<std::chrono::steady_clock::time_point> scheduled;
+};
+
+/* Result of a run. */
+struct LoadResult
+{
+  std::uint64_t sent;
+  std::uint64_t bad_responses;
+  /* Latency of every response, in nanoseconds. */
+  std::vector<std::int64_t> latencies;
+};
+
+static int Connect(const char *path)
+{
+  sockaddr_un address = {};
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0 || std::strlen(path) >= sizeof(address.sun_path))
+  {
+    return -1;
+  }
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, path, std::strlen(path));
+  if (connect(fd, reinterpret_cast<const sockaddr *>(&address),
+      sizeof(address)) != 0)
+  {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/* Sends what connection has pending. Returns false on error. */
+static bool SendPending(ClientConnection &connection)
+{
+  ssize_t sent = 0;
+  while (connection.output_begin < connection.output.size())
+  {
+    sent = send(connection.fd, connection.output.data() +
+        connection.output_begin, connection.output.size() -
+            connection.output_begin, MSG_NOSIGNAL);
+    if (sent < 0)
+    {
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+    connection.output_begin += static_cast<std::size_t>(sent);
+  }
+  connection.output.clear();
+  connection.output_begin = 0;
+  return true;
+}
+
+/*
+ * Reads the responses connection has and records their latencies. Returns
+ * false on error or if the server closed the connection.
+ */
+static bool ReceiveResponses(ClientConnection &connection,
+    std::chrono::steady_clock::time_point now, int value_count,
+    module_b::SomeMessage &response, LoadResult &result)
+{
+  ssize_t received = 0;
+  std::size_t begin = 0;
+  std::uint32_t size = 0;
+  for (;;)
+  {
+    if (connection.input_end == connection.input.size())
+    {
+      connection.input.resize(connection.input.size() * 2);
+    }
+    received = read(connection.fd, connection.input.data() +
+        connection.input_end, connection.input.size() - connection.input_end);
+    if (received <= 0)
+    {
+      break;
+    }
+    connection.input_end += static_cast<std::size_t>(received);
+  }
+  if (received == 0 || (received < 0 && errno != EAGAIN &&
+      errno != EWOULDBLOCK && errno != EINTR))
+  {
+    return false;
+  }
+
+  while (connection.input_end - begin >= common::kFrameHeaderSize)
+  {
+    size = common::ReadFrameHeader(connection.input.data() + begin);
+    if (connection.input_end - begin < common::kFrameHeaderSize + size ||
+        connection.scheduled.empty())
+    {
+      break;
+    }
+    if (!response.ParseFromArray(connection.input.data() + begin +
+        common::kFrameHeaderSize, static_cast<int>(size)) ||
+        response.values_size() != value_count)
+    {
+      ++result.bad_responses;
+    }
+    result.latencies.push_back(std::chrono::duration_cast<
+        std::chrono::nanoseconds>(now - connection.scheduled.front()).count());
+    connection.scheduled.pop_front();
+    begin += common::kFrameHeaderSize + size;
+  }
+  std::memmove(connection.input.data(), connection.input.data() + begin,
+      connection.input_end - begin);
+  connection.input_end -= begin;
+  return true;
+}
+
+/*
+ * Sends requests round robin over connections at options.rate without
+ * waiting for responses, so that a slow response does not delay the requests
+ * after it. Latency is measured from when a request was due to be sent, not
+ * from when it was, which keeps client stalls from hiding server stalls.
+ */
+static LoadResult RunLoad(const LoadClientOptions &options,
+    std::vector<ClientConnection> &connections,
+    const std::vector<std::byte> &request)
+{
+  const std::chrono::steady_clock::duration kInterval =
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(1.0 / options.rate));
+  const std::chrono::steady_clock::time_point kStart =
+      std::chrono::steady_clock::now();
+  const std::chrono::steady_clock::time_point kEnd = kStart +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(options.duration_seconds));
+  std::vector<pollfd> poll_fds(connections.size());
+  std::chrono::steady_clock::time_point next_send = kStart;
+  std::chrono::steady_clock::time_point now = kStart;
+  std::chrono::nanoseconds wait{0};
+  timespec timeout = {};
+  module_b::SomeMessage response;
+  LoadResult result = {};
+  std::size_t outstanding = 0;
+  ClientConnection *connection = nullptr;
+  bool failed = false;
+
+  result.latencies.reserve(static_cast<std::size_t>(options.rate *
+      options.duration_seconds) + 1);
+  while (!failed && (next_send < kEnd || (outstanding > 0 &&
+      now < kEnd + kDrainTimeout)))
+  {
+    now = std::chrono::steady_clock::now();
+    for (; next_send <= now && next_send < kEnd; next_send += kInterval)
+    {
+      connection = &connections[result.sent % connections.size()];
+      connection->output.insert(connection->output.end(), request.begin(),
+          request.end());
+      connection->scheduled.push_back(next_send);
+      ++result.sent;
+    }
+    for (std::size_t i = 0; i < connections.size(); ++i)
+    {
+      failed = failed || !SendPending(connections[i]);
+      poll_fds[i].fd = connections[i].fd;
+      poll_fds[i].events = static_cast<short>(POLLIN |
+          (connections[i].output.empty() ? 0 : POLLOUT));
+      poll_fds[i].revents = 0;
+    }
+
+    /* Sleep until the next request is due or a response arrives. */
+    wait = next_send < kEnd ? std::chrono::duration_cast<
+        std::chrono::nanoseconds>(next_send - now) :
+        std::chrono::nanoseconds{std::chrono::milliseconds{10}};
+    wait = std::max(wait, std::chrono::nanoseconds{0});
+    timeout.tv_sec = static_cast<time_t>(wait.count() / 1000000000);
+    timeout.tv_nsec = static_cast<long>(wait.count() % 1000000000);
+    if (ppoll(poll_fds.data(), poll_fds.size(), &timeout, nullptr) < 0 &&
+        errno != EINTR)
+    {
+      failed = true;
+    }
+    now = std::chrono::steady_clock::now();
+    outstanding = 0;
+    for (std::size_t i = 0; i < connections.size(); ++i)
+    {
+      if ((poll_fds[i].revents & (POLLIN | POLLHUP | POLLERR)) != 0)
+      {
+        failed = failed || !ReceiveResponses(connections[i], now,
+            options.value_count, response, result);
+      }
+      outstanding += connections[i].scheduled.size();
+    }
+  }
+  if (failed)
+  {
+    std::fprintf(stderr, "connection to the server failed\n");
+  }
+  return result;
+}
+
+/* The q quantile of sorted latencies, in microseconds. */
+static double Percentile(const std::vector<std::int64_t> &latencies,
+    double q)
+{
+  std::size_t index = static_cast<std::size_t>(q *
+      static_cast<double>(latencies.size()));
+  if (latencies.empty())
+  {
+    return 0.0;
+  }
+  return static_cast<double>(latencies[std::min(index,
+      latencies.size() - 1)]) / 1e3;
+}
+
+} /* namespace project_structure */
+
+int main(int argc, char **argv)
+{
+  project_structure::LoadClientOptions options;
+  std::vector<project_structure::ClientConnection> connections;
+  project_structure::module_b::SomeMessage request;
+  std::vector<std::byte> frame;
+  project_structure::LoadResult result = {};
+  int fd = -1;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc)
+    {
+      options.socket_path = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+    {
+      options.rate = std::strtod(argv[++i], nullptr);
+    }
+    else if (std::strcmp(argv[i], "--duration") == 0 && i + 1 < argc)
+    {
+      options.duration_seconds = std::strtod(argv[++i], nullptr);
+    }
+    else if (std::strcmp(argv[i], "--connections") == 0 && i + 1 < argc)
+    {
+      options.connection_count = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "--values") == 0 && i + 1 < argc)
+    {
+      options.value_count = std::atoi(argv[++i]);
+    }
+    else
+    {
+      options.socket_path = nullptr;
+      break;
+    }
+  }
+  if (options.socket_path == nullptr || options.rate <= 0.0 ||
+      options.connection_count == 0 || options.value_count < 0)
+  {
+    std::fprintf(stderr, "usage: %s --socket PATH [--rate REQUESTS_PER_S] "
+        "[--duration S] [--connections N] [--values N]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  /* Every request is the same, the server does the same work for each. */
+  request.set_struct_var(7);
+  request.set_class_const(project_structure::module_b::kTempVar);
+  request.set_some_enum(static_cast<int>(
+      project_structure::module_b::SomeEnum::kEnumVarOne));
+  for (int i = 0; i < options.value_count; ++i)
+  {
+    request.add_values(i);
+  }
+  project_structure::common::AppendFrameHeader(frame,
+      static_cast<std::uint32_t>(request.ByteSizeLong()));
+  frame.resize(frame.size() + request.ByteSizeLong());
+  request.SerializeToArray(frame.data() +
+      project_structure::common::kFrameHeaderSize,
+      static_cast<int>(request.ByteSizeLong()));
+
+  for (std::size_t i = 0; i < options.connection_count; ++i)
+  {
+    fd = project_structure::Connect(options.socket_path);
+    if (fd < 0)
+    {
+      std::perror(options.socket_path);
+      return EXIT_FAILURE;
+    }
+    connections.push_back(project_structure::ClientConnection{fd, {}, 0,
+        std::vector<std::byte>(std::size_t{64} << 10), 0, {}});
+  }
+
+  result = project_structure::RunLoad(options, connections, frame);
+  for (project_structure::ClientConnection &connection : connections)
+  {
+    close(connection.fd);
+  }
+  std::sort(result.latencies.begin(), result.latencies.end());
+  std::printf("sent %" PRIu64 " requests at %.0f/s over %zu connections, "
+      "%zu responses, %" PRIu64 " bad\n", result.sent, options.rate,
+      options.connection_count, result.latencies.size(),
+      result.bad_responses);
+  std::printf("latency us: p50 %.1f  p99 %.1f  p999 %.1f  max %.1f\n",
+      project_structure::Percentile(result.latencies, 0.5),
+      project_structure::Percentile(result.latencies, 0.99),
+      project_structure::Percentile(result.latencies, 0.999),
+      project_structure::Percentile(result.latencies, 1.0));
+  return result.latencies.size() == result.sent && result.bad_responses == 0 ?
+      EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,846 @@
+/* micro_bench.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Microbenchmarks for the hot functions of module_a and module_b
+ * and for SomeMessage serialization. Reports ns/op, bytes/op and allocs/op,
+ * optionally as JSON so that two builds can be diffed.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "common/alloc_tracker.h"
+#include "common/object_pool.h"
+#include "common/stats.h"
+#include "common/trace.h"
+#include "include/include.h"
+#include "module-a/a.h"
+#include "module-b/b.h"
+#include "module-b/generated/message.pb.h"
+#include "module-b/message_pool.h"
+
+
+namespace project_structure
+{
+
+/* Elements per call in the batch benchmarks. */
+constexpr std::size_t kBenchBatchSize = 1024;
+
+/* Objects changed per iteration in the incremental DoSomething benchmarks. */
+constexpr std::size_t kBenchChangedPerBatch = 8;
+
+/* Number of repeated values and payload bytes in the benchmarked message. */
+constexpr int kBenchMessageValues = 64;
+constexpr std::size_t kBenchMessagePayloadSize = 64;
+
+/* Timer measured by the probe overhead benchmarks. */
+const common::StatId kBenchProbeStat = common::RegisterStat("bench::Probe",
+    common::StatKind::kTimer);
+
+/* Upper bound on the iterations of one benchmark. */
+constexpr std::uint64_t kMaxIterations = std::uint64_t{1} << 32;
+
+/*
+ * Sets count and bytes to the allocations of the calling thread so far, in
+ * every scope. The benchmarks are single threaded, so that is all of them.
+ */
+static void ThreadAllocationTotals(std::uint64_t &count, std::uint64_t &bytes)
+{
+  count = 0;
+  bytes = 0;
+  for (const common::AllocationCounts &counts :
+      common::thread_allocation_counts.scopes)
+  {
+    count += counts.allocations;
+    bytes += counts.bytes;
+  }
+}
+
+/*
+ * Makes the compiler assume value is read, so that the computation producing
+ * it is not optimized away.
+ */
+template <typename T>
+static void KeepValue(const T &value)
+{
+  asm volatile("" : : "m"(value) : "memory");
+}
+
+/*
+ * Passed to every benchmark. The benchmark does its setup, calls Start, runs
+ * its operation Iterations() times and calls Stop. Only what happens between
+ * Start and Stop is timed and counted.
+ *
+ * The class is copyable.
+ */
+class BenchmarkState
+{
+ public:
+  explicit BenchmarkState(std::uint64_t iterations) : iterations_(iterations)
+  {
+  }
+
+  std::uint64_t Iterations() const
+  {
+    return iterations_;
+  }
+
+  void Start()
+  {
+    ThreadAllocationTotals(allocation_count_, allocated_bytes_);
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  void Stop()
+  {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() -
+        start_;
+    std::uint64_t allocation_count = 0;
+    std::uint64_t allocated_bytes = 0;
+    seconds_ = elapsed.count();
+    ThreadAllocationTotals(allocation_count, allocated_bytes);
+    allocation_count_ = allocation_count - allocation_count_;
+    allocated_bytes_ = allocated_bytes - allocated_bytes_;
+  }
+
+  double Seconds() const
+  {
+    return seconds_;
+  }
+
+  std::uint64_t AllocationCount() const
+  {
+    return allocation_count_;
+  }
+
+  std::uint64_t AllocatedBytes() const
+  {
+    return allocated_bytes_;
+  }
+
+ private:
+  std::uint64_t iterations_ = 0;
+  std::chrono::steady_clock::time_point start_;
+  double seconds_ = 0.0;
+  std::uint64_t allocation_count_ = 0;
+  std::uint64_t allocated_bytes_ = 0;
+};
+
+/* A named benchmark. */
+struct Benchmark
+{
+  const char *name;
+  void (*run)(BenchmarkState &state);
+};
+
+/* Measurements of one benchmark, per operation. */
+struct BenchmarkResult
+{
+  const char *name;
+  std::uint64_t iterations;
+  double ns_per_op;
+  double bytes_per_op;
+  double allocs_per_op;
+};
+
+static void BenchModuleATempFunc(BenchmarkState &state)
+{
+  const int kSomeInput = module_a::kTempVar;
+  int some_input_output = 0;
+  module_a::SomeStruct some_output{0};
+  state.Start();
+  for (std::uint64_t i = 0; i < state.Iterations(); ++i)
+  {
+    module_a::TempFunc(static_cast<int>(i), &kSomeInput, &some_input_output,
+        &some_output);
+    KeepValue(some_input_output);
+  }
+  state.Stop();
+}
+
+/*
+ * TempFunc with memoization on and kMemoizedKeyCount distinct keys, all of
+ * which are cached before timing starts.
+ */
+static void BenchModuleATempFuncMemoized(BenchmarkState &state)
+{
+  const int kSomeInput = module_a::kTempVar;
+  const std::uint64_t kMemoizedKeyCount = 1024;
+  int some_input_output = 0;
+  module_a::SomeStruct some_output{0};
+  module_a::temp_func_memo.Enable();
+  for (std::uint64_t i = 0; i < kMemoizedKeyCount; ++i)
+  {
+    some_input_output = 0;
+    module_a::TempFunc(static_cast<int>(i), &kSomeInput, &some_input_output,
+        &some_output);
+  }
+  state.Start();
+  for (std::uint64_t i = 0; i < state.Iterations(); ++i)
+  {
+    some_input_output = 0;
+    module_a::TempFunc(static_cast<int>(i % kMemoizedKeyCount), &kSomeInput,
+        &some_input_output, &some_output);
+    KeepValue(some_input_output);
+  }
+  state.Stop();
+  module_a::temp_func_memo.Disable();
+}
+
+static void BenchModuleBTempFunc(BenchmarkState &state)
+{
+  const int kSomeInput = module_b::kTempVar;
+  int some_input_output = 0;
+  module_b::SomeStruct some_output{0};
+  state.Start();
+  for (std::uint64_t i = 0; i < state.Iterations(); ++i)
+  {
+    module_b::TempFunc(static_cast<int>(i), &kSomeInput, &some_input_output,
+        &some_output);
+    KeepValue(some_input_output);
+  }
+  state.Stop();
+}
+
+/* The forms of the TempFunc loop compared by RunTempFuncLoop. */
+enum class TempFuncLoopForm
+{
+  /* TempFuncLoop with trip count and multiplier hidden from the compiler. */
+  kRuntime = 0,
+  /* TempFuncStep in a loop over the constants, what TempFunc used to run. */
+  kConstant = 1,
+  kUnrolled = 2
+};
+
+/*
+ * The TempFunc loop on its own in the given form, always with the usual
+ * trip count and multiplier. Every call starts from the result of the one
+ * before, like TempFunc does.
+ */
+static void RunTempFuncLoop(BenchmarkState &state, TempFuncLoopForm form)
+{
+  int iterations = module_a::kTempFuncIterations;
+  int temp_var = module_a::kTempVar;
+  std::uint32_t value = 0;
+  state.Start();
+  for (std::uint64_t i = 0; i < state.Iterations(); ++i)
+  {
+    switch (form)
+    {
+      case TempFuncLoopForm::kRuntime:
+      {
+        asm volatile("" : "+r"(iterations), "+r"(temp_var));
+        value = module_a::TempFuncLoop(value, static_cast<std::uint32_t>(i),
+            std::uint32_t{module_a::kTempVar}, iterations, temp_var);
+        break;
+      }
+      case TempFuncLoopForm::kConstant:
+      {
+        for (int j = 0; j < module_a::kTempFuncIterations; ++j)
+        {
+          value = module_a::TempFuncStep(value, static_cast<std::uint32_t>(i),
+              std::uint32_t{module_a::kTempVar}, static_cast<std::uint32_t>(j));
+        }
+        break;
+      }
+      case TempFuncLoopForm::kUnrolled:
+      default:
+      {
+        value = module_a::TempFuncUnrolled(value,
+            static_cast<std::uint32_t>(i), std::uint32_t{module_a::kTempVar});
+        break;
+      }
+    }
+    KeepValue(value);
+  }
+  state.Stop();
+}
+
+static void BenchModuleATempFuncLoopRuntime(BenchmarkState &state)
+{
+  RunTempFuncLoop(state, TempFuncLoopForm::kRuntime);
+}
+
+static void BenchModuleATempFuncLoopConstant(BenchmarkState &state)
+{
+  RunTempFuncLoop(state, TempFuncLoopForm::kConstant);
+}
+
+static void BenchModuleATempFuncLoopUnrolled(BenchmarkState &state)
+{
+  RunTempFuncLoop(state, TempFuncLoopForm::kUnrolled);
+}
+
+static void BenchModuleATempFuncBatch(BenchmarkState &state)
+{
+  const int kSomeInput = module_a::kTempVar;
+  std::vector<int> inputs(kBenchBatchSize, 0);
+  std::vector<int> states(kBenchBatchSize, 0);
+  std::vector<module_a::SomeStruct> outputs(kBenchBatchSize,
+      module_a::SomeStruct{0});
+  for (std::size_t i = 0; i < inputs.size(); ++i)
+  {
+    inputs[i] = static_cast<int>(i);
+  }
+  state.Start();
+  for (std::uint64_t i = 0; i < state.Iterations(); ++i)
+  {
+    module_a::TempFuncBatch(inputs, &kSomeInput, states, outputs);
+    KeepValue(outputs[0]);
+  }
+  state.Stop();
+}
+
+static void BenchModuleADoSomething(BenchmarkState &state)
+{
+  module_a::SomeClass some_class(module_a::kTempVar, 'a');
+  int result = 0;
+  state.Start();
+  for (std::uint64_t i = 0; i < state.Iterations(); ++i)
+  {
+    result = module_a::DoSomething(some_class);
+    KeepValue(result);
+  }
+  state.Stop();
+}
+
+static void BenchModuleADoSomethingElse(BenchmarkState &state)
+{
+  const module_a::SomeEnum kEnums[2] = {module_a::SomeEnum::kEnumVarOne,
+      module_a::SomeEnum::kEnumVarTwo};
+  int result = 0;
+  state.Start();
+  for (std::uint64_t i = 0; i < state.Iterations(); ++i)
+  {
+    result = module_a::DoSomethingElse(kEnums[i & 1],
+        module_a::SomeStruct{static_cast<int>(i)});
+    KeepValue(result);
+  }
+  state.Stop();
+}
+
+static void BenchModuleBDoSomethingElse(BenchmarkState &state)
+{
+  const module_b::SomeEnum kEnums[2] = {module_b::SomeEnum::kEnumVarOne,
+      module_b::SomeEnum::kEnumVarTwo};
+  int result = 0;
+  state.Start();
+  for (std::uint64_t i = 0; i < state.Iterations(); ++i)
+  {
+    result = module_b::DoSomethingElse(kEnums[i & 1],
+        module_b::SomeStruct{static_cast<int>(i)});
+    KeepValue(result);
+  }
+  state.Stop();
+}
+
+/*
+ * DoSomethingElse over kBenchBatchSize structs, either element by element with
+ * the runtime SomeEnum overload or as one DoSomethingElseBatch call.
+ */
+static void RunDoSomethingElseLoop(BenchmarkState &state, bool batched)
+{
+  std::vector<module_a::SomeStruct> some_structs(kBenchBatchSize,
+      module_a::SomeStruct{0});
+  std::vector<int> results(kBenchBatchSize, 0);
+  module_a::SomeEnum some_enum = module_a::SomeEnum::kEnumVarTwo;
+  for (std::size_t i = 0; i < some_structs.size(); ++i)
+  {
+    some_structs[i].struct_var = static_cast<int>(i);
+  }
+  state.Start();
+  for (std::uint64_t i = 0; i < state.Iterations(); ++i)
+  {
+    /* Hides the value of some_enum from the optimizer. */
+    asm volatile("" : "+m"(some_enum));
+    if (batched)
+    {
+      module_a::DoSomethingElseBatch(some_enum, some_structs, results);
+    }
+    else
+    {
+      for (std::size_t j = 0; j < some_structs.size(); ++j)
+      {
+        results[j] = module_a::DoSomethingElse(some_enum, some_structs[j]);
+      }
+    }
+    KeepValue(results[0]);
+  }
+  state.Stop();
+}
+
+static void BenchModuleADoSomethingElseLoop(BenchmarkState &state)
+{
+  RunDoSomethingElseLoop(state, false);
+}
+
+static void BenchModuleADoSomethingElseBatch(BenchmarkState &state)
+{
+  RunDoSomethingElseLoop(state, true);
+}
+
+/* The public TempFunc batch, compare with module_a/TempFuncBatch/1024. */
+static void BenchApiModuleATempFunc(BenchmarkState &state)
+{
+  std::vector<int> inputs(kBenchBatchSize, 0);
+  std::vector<int> states(kBenchBatchSize, 0);
+  for (std::size_t i = 0; i < inputs.size(); ++i)
+  {
+    inputs[i] = static_cast<int>(i);
+  }
+  state.Start();
+  for (std::uint64_t i = 0; i < state.Iterations(); ++i)
+  {
+    api::ModuleATempFunc(inputs, module_a::kTempVar, states);
+    KeepValue(states[0]);
+  }
+  state.Stop();
+}
+
+/*
+ * The public DoSomethingElse batch in place, compare with
+ * module_a/DoSomethingElseBatch/1024.
+ */
+static void BenchApiModuleADoSomethingElse(BenchmarkState &state)
+{
+  std::vector<int> values(kBenchBatchSize, 0);
+  api::SomeEnum some_enum = api::SomeEnum::kEnumVarTwo;
+  for (std::size_t i = 0; i < values.size(); ++i)
+  {
+    values[i] = static_cast<int>(i);
+  }
+  state.Start();
+  for (std::uint64_t i = 0; i < state.Iterations(); ++i)
+  {
+    asm volatile("" : "+m"(some_enum));
+    api::ModuleADoSomethingElse(some_enum, values, values);
+    KeepValue(values[0]);
+  }
+  state.Stop();
+}
+
+/*
+ * DoSomething over kBenchBatchSize objects after a small update, changing
+ * kBenchChangedPerBatch of them per iteration. Either everything is
+ * recomputed or only the changed objects through DoSomethingCache.
+ */
+static void RunDoSomethingUpdates(BenchmarkState &state, bool incremental)
+{
+  std::vector<module_a::SomeClass> some_classes;
+  std::vector<module_a::DoSomethingCache> caches(kBenchBatchSize);
+  std::size_t changed = 0;
+  int sum = 0;
+  for (std::size_t i = 0; i < kBenchBatchSize; ++i)
+  {
+    some_classes.emplace_back(static_cast<int>(i), 'a');
+  }
+  state.Start();
+  for (std::uint64_t i = 0; i < state.Iterations(); ++i)
+  {
+    for (std::size_t j = 0; j < kBenchChangedPerBatch; ++j)
+    {
+      changed = (changed + 127) % kBenchBatchSize;
+      some_classes[changed].SetClassChar(static_cast<char>('a' + i % 26));
+    }
+    sum = 0;
+    for (std::size_t j = 0; j < kBenchBatchSize; ++j)
+    {
+      sum += incremental ? caches[j].Get(some_classes[j]) :
+          module_a::DoSomething(some_classes[j]);
+    }
+    KeepValue(sum);
+  }
+  state.Stop();
+}
+
+static void BenchModuleADoSomethingFull(BenchmarkState &state)
+{
+  RunDoSomethingUpdates(state, false);
+}
+
+static void BenchModuleADoSomethingIncremental(BenchmarkState &state)
+{
+  RunDoSomethingUpdates(state, true);
+}
+
+/*
+ * Creates a SomeClass with a payload of payload_size bytes and reads it back,
+ * with the payload either in SomeClass or in a heap block next to it.
+ */
+static void RunPayload(BenchmarkState &state, std::size_t payload_size,
+    bool in_some_class)
+{
+  const std::vector<std::byte> kPayload(payload_size, std::byte{7});
+  /* Holds the one object of an iteration, so that it is created anew. */
+  std::vector<module_a::SomeClass> some_classes;
+  std::byte *payload = nullptr;
+  std::span<const std::byte> data;
+  some_classes.reserve(1);
+  state.Start();
+  for (std::uint64_t i = 0; i < state.Iterations(); ++i)
+  {
+    some_classes.emplace_back(static_cast<int>(i), 'a');
+    if (in_some_class)
+    {
+      some_classes[0].SetPayload(kPayload);
+      data = some_classes[0].Payload();
+      KeepValue(data[data.size() - 1]);
+    }
+    else
+    {
+      payload = new std::byte[payload_size];
+      std::memcpy(payload, kPayload.data(), payload_size);
+      KeepValue(payload[payload_size - 1]);
+      delete[] payload;
+    }
+    some_classes.clear();
+  }
+  state.Stop();
+}
+
+static void BenchModuleAPayloadInline(BenchmarkState &state)
+{
+  RunPayload(state, 32, true);
+}
+
+static void BenchModuleAPayloadHeap(BenchmarkState &state)
+{
+  RunPayload(state, 128, true);
+}
+
+static void BenchModuleAPayloadSeparate(BenchmarkState &state)
+{
+  RunPayload(state, 32, false);
+}
+
+/* Fills message the way module_b sends them. */
+static void FillMessage(module_b::SomeMessage &message)
+{
+  message.set_struct_var(123456);
+  message.set_class_const(module_b::kTempVar);
+  message.set_some_enum(static_cast<int>(module_b::SomeEnum::kEnumVarOne));
+  for (int i = 0; i < kBenchMessageValues; ++i)
+  {
+    message.add_values(i * 1000);
+  }
+  message.set_payload(std::string(kBenchMessagePayloadSize, 'x'));
+}
+
+static void BenchSomeMessageEncode(BenchmarkState &state)
+{
+  module_b::SomeMessage message;
+  std::vector<char> buffer;
+  std::size_t size = 0;
+  FillMessage(message);
+  buffer.resize(message.ByteSizeLong());
+  state.Start();
+  for (std::uint64_t i = 0; i < state.Iterations(); ++i)
+  {
+    size = message.ByteSizeLong();
+    message.SerializeToArray(buffer.data(), static_cast<int>(size));
+    KeepValue(buffer[0]);
+  }
+  state.Stop();
+}
+
+static void BenchSomeMessageDecode(BenchmarkState &state)
+{
+  module_b::SomeMessage message;
+  module_b::SomeMessage decoded;
+  std::vector<char> buffer;
+  FillMessage(message);
+  buffer.resize(message.ByteSizeLong());
+  message.SerializeToArray(buffer.data(), static_cast<int>(buffer.size()));
+  /* Parse once so that decoded has grown its fields before timing. */
+  decoded.ParseFromArray(buffer.data(), static_cast<int>(buffer.size()));
+  state.Start();
+  for (std::uint64_t i = 0; i < state.Iterations(); ++i)
+  {
+    decoded.ParseFromArray(buffer.data(), static_cast<int>(buffer.size()));
+    KeepValue(decoded);
+  }
+  state.Stop();
+}
+
+/*
+ * Parses request from buffer and serializes a response built from it into
+ * output, what main's request handler does with its messages.
+ */
+static void RoundTripMessage(std::span<const char> buffer,
+    module_b::SomeMessage &request, module_b::SomeMessage &response,
+    std::vector<char> &output)
+{
+  request.ParseFromArray(buffer.data(), static_cast<int>(buffer.size()));
+  response.set_struct_var(request.struct_var());
+  response.set_class_const(request.class_const());
+  response.set_some_enum(request.some_enum());
+  *response.mutable_values() = request.values();
+  output.resize(response.ByteSizeLong());
+  response.SerializeToArray(output.data(), static_cast<int>(output.size()));
+}
+
+/*
+ * One request round trip per iteration with messages drawn from module_b's
+ * message pool, or constructed and destroyed for every request.
+ */
+static void RunMessageRoundTrip(BenchmarkState &state, bool pooled)
+{
+  module_b::SomeMessage message;
+  common::ObjectPool<module_b::SomeMessage>::Handle request;
+  common::ObjectPool<module_b::SomeMessage>::Handle response;
+  module_b::SomeMessage *fresh_request = nullptr;
+  module_b::SomeMessage *fresh_response = nullptr;
+  std::vector<char> buffer;
+  std::vector<char> output;
+  FillMessage(message);
+  buffer.resize(message.ByteSizeLong());
+  message.SerializeToArray(buffer.data(), static_cast<int>(buffer.size()));
+  /* Warms the pool and output up before timing. */
+  request = module_b::AcquireMessage();
+  response = module_b::AcquireMessage();
+  RoundTripMessage(buffer, *request, *response, output);
+  request.Reset();
+  response.Reset();
+  state.Start();
+  for (std::uint64_t i = 0; i < state.Iterations(); ++i)
+  {
+    if (pooled)
+    {
+      request = module_b::AcquireMessage();
+      response = module_b::AcquireMessage();
+      RoundTripMessage(buffer, *request, *response, output);
+      request.Reset();
+      response.Reset();
+    }
+    else
+    {
+      fresh_request = new module_b::SomeMessage();
+      fresh_response = new module_b::SomeMessage();
+      RoundTripMessage(buffer, *fresh_request, *fresh_response, output);
+      delete fresh_request;
+      delete fresh_response;
+    }
+    KeepValue(output[0]);
+  }
+  state.Stop();
+}
+
+static void BenchSomeMessageRoundTripPooled(BenchmarkState &state)
+{
+  RunMessageRoundTrip(state, true);
+}
+
+static void BenchSomeMessageRoundTripFresh(BenchmarkState &state)
+{
+  RunMessageRoundTrip(state, false);
+}
+
+/* Cost of one ScopedStatTimer, with the stats enabled or disabled. */
+static void RunProbe(BenchmarkState &state, bool enabled)
+{
+  common::SetStatsEnabled(enabled);
+  state.Start();
+  for (std::uint64_t i = 0; i < state.Iterations(); ++i)
+  {
+    common::ScopedStatTimer timer(kBenchProbeStat);
+    KeepValue(i);
+  }
+  state.Stop();
+  common::SetStatsEnabled(false);
+}
+
+static void BenchScopedStatTimerEnabled(BenchmarkState &state)
+{
+  RunProbe(state, true);
+}
+
+static void BenchScopedStatTimerDisabled(BenchmarkState &state)
+{
+  RunProbe(state, false);
+}
+
+/* Cost of one ScopedTrace, with its category enabled or disabled. */
+static void RunTracePoint(BenchmarkState &state, bool enabled)
+{
+  common::SetTraceCategories(enabled ? common::kAllTraceCategories : 0);
+  state.Start();
+  for (std::uint64_t i = 0; i < state.Iterations(); ++i)
+  {
+    common::ScopedTrace trace(common::TraceCategory::kModuleA, "bench::Trace");
+    KeepValue(i);
+  }
+  state.Stop();
+  common::SetTraceCategories(0);
+}
+
+static void BenchScopedTraceEnabled(BenchmarkState &state)
+{
+  RunTracePoint(state, true);
+}
+
+static void BenchScopedTraceDisabled(BenchmarkState &state)
+{
+  RunTracePoint(state, false);
+}
+
+/* Every benchmark, in the order they are run and reported. */
+const Benchmark kBenchmarks[] = {
+  {"module_a/TempFunc", &BenchModuleATempFunc},
+  {"module_a/TempFunc/Memoized", &BenchModuleATempFuncMemoized},
+  {"module_b/TempFunc", &BenchModuleBTempFunc},
+  {"module_a/TempFuncLoop/Runtime", &BenchModuleATempFuncLoopRuntime},
+  {"module_a/TempFuncLoop/Constant", &BenchModuleATempFuncLoopConstant},
+  {"module_a/TempFuncLoop/Unrolled", &BenchModuleATempFuncLoopUnrolled},
+  {"module_a/TempFuncBatch/1024", &BenchModuleATempFuncBatch},
+  {"module_a/DoSomething", &BenchModuleADoSomething},
+  {"module_a/DoSomething/Full/1024", &BenchModuleADoSomethingFull},
+  {"module_a/DoSomething/Incremental/1024",
+      &BenchModuleADoSomethingIncremental},
+  {"module_a/SomeClass/Payload/32", &BenchModuleAPayloadInline},
+  {"module_a/SomeClass/Payload/128", &BenchModuleAPayloadHeap},
+  {"module_a/SomeClass/SeparatePayload/32", &BenchModuleAPayloadSeparate},
+  {"module_a/DoSomethingElse", &BenchModuleADoSomethingElse},
+  {"module_b/DoSomethingElse", &BenchModuleBDoSomethingElse},
+  {"module_a/DoSomethingElse/Loop/1024", &BenchModuleADoSomethingElseLoop},
+  {"module_a/DoSomethingElseBatch/1024", &BenchModuleADoSomethingElseBatch},
+  {"api/ModuleATempFunc/1024", &BenchApiModuleATempFunc},
+  {"api/ModuleADoSomethingElse/1024", &BenchApiModuleADoSomethingElse},
+  {"module_b/SomeMessage/Encode", &BenchSomeMessageEncode},
+  {"module_b/SomeMessage/Decode", &BenchSomeMessageDecode},
+  {"module_b/SomeMessage/RoundTrip/Pooled", &BenchSomeMessageRoundTripPooled},
+  {"module_b/SomeMessage/RoundTrip/Fresh", &BenchSomeMessageRoundTripFresh},
+  {"common/ScopedStatTimer/Enabled", &BenchScopedStatTimerEnabled},
+  {"common/ScopedStatTimer/Disabled", &BenchScopedStatTimerDisabled},
+  {"common/ScopedTrace/Enabled", &BenchScopedTraceEnabled},
+  {"common/ScopedTrace/Disabled", &BenchScopedTraceDisabled}
+};
+
+/*
+ * Runs benchmark with a growing number of iterations until one run takes at
+ * least min_seconds, and returns the measurements of that run.
+ */
+static BenchmarkResult RunBenchmark(const Benchmark &benchmark,
+    double min_seconds)
+{
+  std::uint64_t iterations = 1;
+  std::uint64_t next = 0;
+  BenchmarkState state(iterations);
+  while (true)
+  {
+    state = BenchmarkState(iterations);
+    benchmark.run(state);
+    if (state.Seconds() >= min_seconds || iterations >= kMaxIterations)
+    {
+      break;
+    }
+    /* Aim 20% past the target, but grow by at least 2x and at most 100x. */
+    next = state.Seconds() > 0.0 ? static_cast<std::uint64_t>(
+        static_cast<double>(iterations) * 1.2 * min_seconds /
+        state.Seconds()) : iterations * 100;
+    next = next < iterations * 2 ? iterations * 2 : next;
+    next = next > iterations * 100 ? iterations * 100 : next;
+    iterations = next < kMaxIterations ? next : kMaxIterations;
+  }
+  return BenchmarkResult{benchmark.name, iterations,
+      state.Seconds() * 1e9 / static_cast<double>(iterations),
+      static_cast<double>(state.AllocatedBytes()) /
+          static_cast<double>(iterations),
+      static_cast<double>(state.AllocationCount()) /
+          static_cast<double>(iterations)};
+}
+
+static void PrintTable(std::span<const BenchmarkResult> results)
+{
+  std::printf("%-40s %12s %12s %10s %10s\n", "benchmark", "iterations",
+      "ns/op", "B/op", "allocs/op");
+  for (const BenchmarkResult &result : results)
+  {
+    std::printf("%-40s %12" PRIu64 " %12.2f %10.1f %10.2f\n", result.name,
+        result.iterations, result.ns_per_op, result.bytes_per_op,
+        result.allocs_per_op);
+  }
+}
+
+/*
+ * Prints one JSON object per benchmark. The names contain no characters which
+ * need escaping.
+ */
+static void PrintJson(std::span<const BenchmarkResult> results)
+{
+  std::printf("{\n  \"benchmarks\": [");
+  for (std::size_t i = 0; i < results.size(); ++i)
+  {
+    std::printf("%s\n    {\"name\": \"%s\", \"iterations\": %" PRIu64 ", "
+        "\"ns_per_op\": %.3f, \"bytes_per_op\": %.3f, "
+        "\"allocs_per_op\": %.3f}", i == 0 ? "" : ",", results[i].name,
+        results[i].iterations, results[i].ns_per_op, results[i].bytes_per_op,
+        results[i].allocs_per_op);
+  }
+  std::printf("\n  ]\n}\n");
+}
+
+} /* namespace project_structure */
+
+int main(int argc, char **argv)
+{
+  const char *filter = "";
+  double min_seconds = 0.2;
+  bool json = false;
+  std::vector<project_structure::BenchmarkResult> results;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+    {
+      filter = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+    {
+      min_seconds = std::strtod(argv[++i], nullptr);
+    }
+    else if (std::strcmp(argv[i], "--json") == 0)
+    {
+      json = true;
+    }
+    else
+    {
+      std::fprintf(stderr, "usage: %s [--filter SUBSTRING] "
+          "[--min-time SECONDS] [--json]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  for (const project_structure::Benchmark &benchmark :
+      project_structure::kBenchmarks)
+  {
+    if (std::strstr(benchmark.name, filter) != nullptr)
+    {
+      results.push_back(project_structure::RunBenchmark(benchmark,
+          min_seconds));
+    }
+  }
+  if (json)
+  {
+    project_structure::PrintJson(results);
+  }
+  else
+  {
+    project_structure::PrintTable(results);
+    /* Where the allocations of the whole run, setup included, came from. */
+    std::printf("\n");
+    project_structure::common::PrintAllocationReport(stdout);
+  }
+  return 0;
+}
@@ -0,0 +1,235 @@
+/* thread_pool_scaling_bench.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Measures how the throughput of module_a work on the work
+ * stealing thread pool scales from 1 to N threads, for fixed chunks and for
+ * the adaptive grain of BulkRunner.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "lib/library.h"
+#include "module-a/a.h"
+#include "module-a/bulk_runner.h"
+
+
+namespace project_structure
+{
+
+/* Elements handled by one TempFuncBatch task. */
+constexpr std::size_t kBenchChunkSize = 2048;
+
+/* Timed runs per thread count, the fastest one is reported. */
+constexpr int kBenchRepetitions = 5;
+
+/*
+ * BulkRunner::DoSomething runs on item_count / kBenchSomeClassDivisor
+ * objects, they are a cache line each.
+ */
+constexpr std::size_t kBenchSomeClassDivisor = 8;
+
+/* The work measured. */
+enum class Workload
+{
+  /* TempFuncBatch in chunks of kBenchChunkSize. */
+  kTempFuncBatch = 0,
+  kDoSomethingBulk = 1,
+  kDoSomethingElseBulk = 2
+};
+
+/* Inputs and outputs of every workload. */
+struct BenchData
+{
+  std::vector<int> inputs;
+  std::vector<int> states;
+  std::vector<module_a::SomeStruct> outputs;
+  std::vector<module_a::SomeClass> some_classes;
+  std::vector<int> results;
+};
+
+/* Runs TempFuncBatch over every chunk of inputs on pool once. */
+static void RunOnce(lib::ThreadPool &pool, std::span<const int> inputs,
+    std::span<int> states, std::span<module_a::SomeStruct> outputs)
+{
+  const int kSomeInput = module_a::kTempVar;
+  const std::size_t kChunkCount = (inputs.size() + kBenchChunkSize - 1) /
+      kBenchChunkSize;
+  lib::ParallelFor(pool, 0, kChunkCount, 1, [&](std::size_t chunk)
+  {
+    std::size_t begin = chunk * kBenchChunkSize;
+    std::size_t size = inputs.size() - begin < kBenchChunkSize ?
+        inputs.size() - begin : kBenchChunkSize;
+    module_a::TempFuncBatch(inputs.subspan(begin, size), &kSomeInput,
+        states.subspan(begin, size), outputs.subspan(begin, size));
+  });
+}
+
+/* Runs workload over data on pool once, returns the number of elements. */
+static std::size_t RunWorkload(lib::ThreadPool &pool,
+    module_a::BulkRunner &runner, Workload workload, BenchData &data)
+{
+  switch (workload)
+  {
+    case Workload::kTempFuncBatch:
+    {
+      RunOnce(pool, data.inputs, data.states, data.outputs);
+      return data.inputs.size();
+    }
+    case Workload::kDoSomethingBulk:
+    {
+      return runner.DoSomething(data.some_classes, std::span<int>(
+          data.results).subspan(0, data.some_classes.size()));
+    }
+    case Workload::kDoSomethingElseBulk:
+    {
+      return runner.DoSomethingElse(module_a::SomeEnum::kEnumVarTwo,
+          data.outputs, data.results);
+    }
+    default:
+    {
+      return 0;
+    }
+  }
+}
+
+/*
+ * Returns the best throughput, in elements per second, of workload on
+ * thread_count. grain is set to the last grain BulkRunner would pick.
+ */
+static double MeasureThroughput(std::size_t thread_count, Workload workload,
+    BenchData &data, std::size_t &grain)
+{
+  lib::ThreadPool pool(lib::ThreadPoolOptions{thread_count, true, 1024, {}});
+  module_a::BulkRunner runner(pool);
+  std::chrono::steady_clock::time_point start;
+  std::chrono::duration<double> elapsed;
+  std::size_t count = 0;
+  double best = 0.0;
+
+  /*
+   * Warm up, faults in the buffers, starts every worker and gives the runner
+   * its estimates.
+   */
+  RunWorkload(pool, runner, workload, data);
+  for (int i = 0; i < kBenchRepetitions; ++i)
+  {
+    start = std::chrono::steady_clock::now();
+    count = RunWorkload(pool, runner, workload, data);
+    elapsed = std::chrono::steady_clock::now() - start;
+    if (static_cast<double>(count) / elapsed.count() > best)
+    {
+      best = static_cast<double>(count) / elapsed.count();
+    }
+  }
+  if (workload == Workload::kTempFuncBatch)
+  {
+    grain = kBenchChunkSize;
+  }
+  else if (workload == Workload::kDoSomethingBulk)
+  {
+    grain = runner.DoSomethingGrain().Grain(count, thread_count);
+  }
+  else
+  {
+    grain = runner.DoSomethingElseGrain().Grain(count, thread_count);
+  }
+  return best;
+}
+
+/* Prints the scaling of workload over thread_counts. */
+static void ReportScaling(const char *name, Workload workload,
+    std::span<const std::size_t> thread_counts, BenchData &data)
+{
+  double baseline = 0.0;
+  double throughput = 0.0;
+  std::size_t grain = 0;
+  std::printf("%s\n%8s %16s %8s %10s %10s\n", name, "threads", "items/s",
+      "speedup", "efficiency", "grain");
+  for (std::size_t threads : thread_counts)
+  {
+    throughput = MeasureThroughput(threads, workload, data, grain);
+    if (baseline == 0.0)
+    {
+      baseline = throughput;
+    }
+    std::printf("%8zu %16.0f %8.2f %9.1f%% %10zu\n", threads, throughput,
+        throughput / baseline,
+        100.0 * throughput / baseline / static_cast<double>(threads), grain);
+  }
+}
+
+} /* namespace project_structure */
+
+int main(int argc, char **argv)
+{
+  std::size_t max_threads = std::thread::hardware_concurrency();
+  std::size_t item_count = std::size_t{1} << 22;
+  std::vector<std::size_t> thread_counts;
+  project_structure::BenchData data;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc)
+    {
+      max_threads = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "--items") == 0 && i + 1 < argc)
+    {
+      item_count = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else
+    {
+      std::fprintf(stderr, "usage: %s [--max-threads N] [--items N]\n",
+          argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (max_threads == 0)
+  {
+    max_threads = 1;
+  }
+
+  /* Powers of two up to max_threads, and max_threads itself. */
+  for (std::size_t threads = 1; threads < max_threads; threads *= 2)
+  {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(max_threads);
+
+  data.inputs.resize(item_count, 0);
+  data.states.resize(item_count, 0);
+  data.outputs.resize(item_count, project_structure::module_a::SomeStruct{0});
+  data.results.resize(item_count, 0);
+  for (std::size_t i = 0; i < item_count; ++i)
+  {
+    data.inputs[i] = static_cast<int>(i);
+    data.outputs[i].struct_var = static_cast<int>(i);
+  }
+  data.some_classes.reserve(item_count /
+      project_structure::kBenchSomeClassDivisor);
+  for (std::size_t i = 0; i < item_count /
+      project_structure::kBenchSomeClassDivisor; ++i)
+  {
+    data.some_classes.emplace_back(static_cast<int>(i),
+        static_cast<char>(i));
+  }
+
+  project_structure::ReportScaling("module_a::TempFuncBatch",
+      project_structure::Workload::kTempFuncBatch, thread_counts, data);
+  project_structure::ReportScaling("module_a::BulkRunner::DoSomething",
+      project_structure::Workload::kDoSomethingBulk, thread_counts, data);
+  project_structure::ReportScaling("module_a::BulkRunner::DoSomethingElse",
+      project_structure::Workload::kDoSomethingElseBulk, thread_counts, data);
+  return 0;
+}
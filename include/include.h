@@ -2,13 +2,241 @@
  *==============================================================================
  * Author: Carl Larsson
  * Creation date: 2024-09-09
- * Last modified: 2024-10-08 by Carl Larsson
- * Description: Example .h file used for example file structure and Google C++ 
- * style guide, it is only meant to be used as a template. All functions and 
- * variables are dummy and the contents of this file should in no way been seen 
- * as a reflection of a real file.
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Public interface of module_a and module_b for embedding
+ * applications. Inputs are non-owning spans and outputs are buffers owned by
+ * the caller, so nothing is copied or allocated across the boundary.
  * License: See LICENSE file for license details.
  *==============================================================================
  */
 
-/* Placeholder file used for showing structure, nothing else. */
+#ifndef PROJECTSTRUCTURE_INCLUDE_INCLUDE_H_
+#define PROJECTSTRUCTURE_INCLUDE_INCLUDE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+
+namespace project_structure
+{
+namespace api
+{
+
+/*!
+ * @brief Outcome of a call to the interface.
+ */
+enum class Status
+{
+  kOk = 0,
+  /* Spans which must be as long as each other, or as a handle, are not. */
+  kSizeMismatch = 1,
+  /* An index past the end, or an argument out of range. */
+  kInvalidArgument = 2,
+  /* The handle is empty, moved from or not created. */
+  kEmptyHandle = 3,
+  kOutOfMemory = 4,
+  /* RecordDecoder: input is used up, or the stream ended between records. */
+  kEnd = 5,
+  /* RecordDecoder: the stream ended in the middle of a record. */
+  kTruncated = 6,
+  /* RecordDecoder: the stream is damaged. */
+  kCorrupt = 7
+};
+
+/*! @brief Name of status, e.g. "size mismatch". */
+const char *StatusName(Status status);
+
+/*!
+ * @brief Selects the operation of DoSomethingElse. The same values as the
+ * SomeEnum of module_a and module_b.
+ */
+enum class SomeEnum
+{
+  kEnumVarOne = 1,
+  kEnumVarTwo = 2
+};
+
+/*!
+ * @brief Runs module_a's TempFunc loop for every element, in place.
+ *
+ * Element i is updated as TempFunc(some_other_inputs[i], &some_input,
+ * &some_input_outputs[i], ...) would update it, using the widest vector
+ * kernel of the CPU. Does not allocate.
+ *
+ * @param[in] some_other_inputs Per element inputs.
+ * @param[in] some_input Input shared by every element.
+ * @param[in, out] some_input_outputs Per element state, replaced by the
+ * final state.
+ *
+ * @return kOk, or kSizeMismatch with nothing changed.
+ */
+Status ModuleATempFunc(std::span<const int> some_other_inputs, int some_input,
+    std::span<int> some_input_outputs);
+
+/*!
+ * @brief Runs module_a's DoSomethingElse for every element.
+ *
+ * Branches on some_enum once for the whole batch. Does not allocate.
+ *
+ * @param[in] some_enum Selects the operation, unknown values copy the
+ * inputs.
+ * @param[in] struct_vars The struct_var of every SomeStruct.
+ * @param[out] results One result per element. May be struct_vars itself,
+ * but not otherwise overlap it.
+ *
+ * @return kOk, or kSizeMismatch with nothing changed.
+ */
+Status ModuleADoSomethingElse(SomeEnum some_enum,
+    std::span<const int> struct_vars, std::span<int> results);
+
+/*!
+ * @brief module_b's version of ModuleADoSomethingElse.
+ */
+Status ModuleBDoSomethingElse(SomeEnum some_enum,
+    std::span<const int> struct_vars, std::span<int> results);
+
+/*!
+ * @brief A fixed number of module_a SomeClass objects, stored one cache
+ * line each in a single block.
+ *
+ * Create allocates that block, which is the only allocation of the class
+ * apart from payloads longer than kPayloadInlineCapacity. Payloads are read
+ * in place through views.
+ *
+ * The class is move-only. It is not thread safe.
+ */
+class SomeClassArray
+{
+ public:
+  /*! @brief Longest payload stored inside an object without allocating. */
+  static constexpr std::size_t kPayloadInlineCapacity = 40;
+
+  /*! @brief An empty array, every other call fails until Create. */
+  SomeClassArray() = default;
+  SomeClassArray(const SomeClassArray &) = delete;
+  SomeClassArray &operator=(const SomeClassArray &) = delete;
+  SomeClassArray(SomeClassArray &&other) noexcept;
+  SomeClassArray &operator=(SomeClassArray &&other) noexcept;
+
+  ~SomeClassArray();
+
+  /*!
+   * @brief Replaces the objects with one per element of the spans.
+   *
+   * @param[in] class_consts kClassConst_ of every object.
+   * @param[in] class_chars Initial class_char_ of every object.
+   *
+   * @return kOk, kSizeMismatch or kOutOfMemory. The array is empty unless
+   * kOk is returned.
+   */
+  Status Create(std::span<const int> class_consts,
+      std::span<const char> class_chars);
+
+  /*! @brief Number of objects, 0 if the array is empty. */
+  std::size_t Size() const;
+
+  /*!
+   * @brief Sets class_char_ of object index.
+   *
+   * @return kOk, kEmptyHandle or kInvalidArgument.
+   */
+  Status SetClassChar(std::size_t index, char class_char);
+
+  /*!
+   * @brief Stores a copy of payload in object index.
+   *
+   * Allocates only for payloads longer than kPayloadInlineCapacity which do
+   * not fit where the previous payload of the object was.
+   *
+   * @return kOk, kEmptyHandle, kInvalidArgument or kOutOfMemory.
+   */
+  Status SetPayload(std::size_t index, std::span<const std::byte> payload);
+
+  /*!
+   * @brief View of the payload of object index, empty if index is out of
+   * range. Valid until the payload of the object is next set or the array
+   * is destroyed.
+   */
+  std::span<const std::byte> Payload(std::size_t index) const;
+
+  /*!
+   * @brief Runs module_a's DoSomething on every object. Does not allocate.
+   *
+   * @param[out] results One result per object.
+   *
+   * @return kOk, kEmptyHandle or kSizeMismatch.
+   */
+  Status DoSomething(std::span<int> results) const;
+
+ private:
+  /* A module_a::SomeClass, defined in public_api.cc. */
+  struct Object;
+
+  void Destroy();
+
+  Object *objects_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+/*!
+ * @brief Splits a module_b record stream, fed in chunks of any size, into
+ * its records.
+ *
+ * Records which lie completely inside a chunk are returned as views into the
+ * chunk. Only a record split over chunks is assembled in a buffer of the
+ * decoder, which is kept for later records.
+ *
+ * The class is move-only. It is not thread safe.
+ */
+class RecordDecoder
+{
+ public:
+  /*! @brief An empty decoder, every other call fails until Create. */
+  RecordDecoder() = default;
+  RecordDecoder(const RecordDecoder &) = delete;
+  RecordDecoder &operator=(const RecordDecoder &) = delete;
+  RecordDecoder(RecordDecoder &&other) noexcept;
+  RecordDecoder &operator=(RecordDecoder &&other) noexcept;
+
+  ~RecordDecoder();
+
+  /*!
+   * @brief Creates the decoder state, or resets it if it exists.
+   *
+   * @return kOk or kOutOfMemory.
+   */
+  Status Create();
+
+  /*!
+   * @brief Decodes the next record.
+   *
+   * @param[in, out] input Unused part of the current chunk, advanced past
+   * the bytes consumed.
+   * @param[out] record View of the payload, set only if kOk is returned.
+   * Valid until the next call and, if it points into input, as long as the
+   * chunk.
+   *
+   * @return kOk, kEnd once input is used up, kCorrupt or kEmptyHandle.
+   */
+  Status Next(std::span<const std::byte> &input,
+      std::span<const std::byte> &record);
+
+  /*!
+   * @brief Tells how the stream ended once its last chunk is decoded.
+   *
+   * @return kEnd, kTruncated, kCorrupt or kEmptyHandle.
+   */
+  Status Finish() const;
+
+ private:
+  /* A module_b::RecordStreamDecoder, defined in public_api.cc. */
+  struct State;
+
+  State *state_ = nullptr;
+};
+
+} /* namespace api */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_INCLUDE_INCLUDE_H_ */
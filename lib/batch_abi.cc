@@ -0,0 +1,343 @@
+/* batch_abi.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Stable C interface for embedding module_a and module_b through
+ * FFI, running batches of requests through the public interface and the
+ * work stealing thread pool.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "lib/batch_abi.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "include/include.h"
+#include "lib/library.h"
+
+
+namespace project_structure
+{
+namespace lib
+{
+
+/* The statuses shared with api::Status are passed on with a cast. */
+static_assert(kPsBatchOk == static_cast<int>(api::Status::kOk) &&
+    kPsBatchSizeMismatch == static_cast<int>(api::Status::kSizeMismatch) &&
+    kPsBatchInvalidArgument ==
+        static_cast<int>(api::Status::kInvalidArgument) &&
+    kPsBatchEmptyHandle == static_cast<int>(api::Status::kEmptyHandle) &&
+    kPsBatchOutOfMemory == static_cast<int>(api::Status::kOutOfMemory),
+    "PsBatchStatus has to match api::Status");
+static_assert(kPsBatchEnumVarOne ==
+    static_cast<int>(api::SomeEnum::kEnumVarOne) &&
+    kPsBatchEnumVarTwo == static_cast<int>(api::SomeEnum::kEnumVarTwo),
+    "PsBatchSomeEnum has to match api::SomeEnum");
+static_assert(static_cast<int>(api::Status::kCorrupt) < kPsBatchQueueFull,
+    "kPsBatchQueueFull has to be past every api::Status");
+/* The int32_t arrays of a request are handed to the api as int spans. */
+static_assert(std::is_same_v<std::int32_t, int>,
+    "the batch interface needs a 32 bit int");
+/* The layout documented in the header, which bindings depend on. */
+static_assert(sizeof(void *) != 8 || (sizeof(PsBatchRequest) == 40 &&
+    sizeof(PsBatchCompletion) == 24 && sizeof(PsBatchContextOptions) == 32),
+    "the layout of the batch interface has changed");
+
+/* max_in_flight of a context created with 0. */
+constexpr std::uint32_t kDefaultMaxInFlight = 64;
+
+struct BatchContext;
+
+/* A submitted batch, one per slot of max_in_flight. */
+struct BatchTask : public Task
+{
+  BatchContext *context = nullptr;
+  PsBatchRequest *requests = nullptr;
+  std::uint64_t count = 0;
+  std::uint64_t tag = 0;
+};
+
+/*
+ * What a PsBatchContext points to. The tasks and the completion ring are
+ * allocated up front, so submitting and completing a batch do not allocate.
+ *
+ * The struct is neither copyable nor movable.
+ */
+struct BatchContext
+{
+  BatchContext(const ThreadPoolOptions &pool_options, std::uint32_t capacity,
+      PsBatchCallback completion_callback, void *completion_user_data) :
+      pool(pool_options), group(pool), callback(completion_callback),
+      user_data(completion_user_data), tasks(capacity), ring(capacity)
+  {
+    free_tasks.reserve(capacity);
+    for (BatchTask &task : tasks)
+    {
+      free_tasks.push_back(&task);
+    }
+  }
+
+  BatchContext(const BatchContext &) = delete;
+  BatchContext &operator=(const BatchContext &) = delete;
+
+  /* Running tasks use the members below group, wait before they go. */
+  ~BatchContext()
+  {
+    group.Wait();
+  }
+
+  /* Declared before group, the pool has to outlive it. */
+  ThreadPool pool;
+  TaskGroup group;
+  PsBatchCallback callback;
+  void *user_data;
+  std::vector<BatchTask> tasks;
+  /* The rest is guarded by mutex. */
+  std::mutex mutex;
+  std::vector<BatchTask *> free_tasks;
+  /* Completions waiting for PsBatchPoll, only used without callback. */
+  std::vector<PsBatchCompletion> ring;
+  std::size_t ring_head = 0;
+  std::size_t ring_size = 0;
+  /*
+   * Batches submitted and not yet reported. Never more than tasks.size(),
+   * so neither the free tasks nor the ring run out.
+   */
+  std::size_t in_flight = 0;
+};
+
+/* Runs request on the calling thread and sets its status. */
+static void RunRequest(PsBatchRequest &request)
+{
+  const std::size_t kCount = static_cast<std::size_t>(request.count);
+  api::Status status = api::Status::kOk;
+  if (request.reserved != 0 || (kCount != 0 &&
+      (request.inputs == nullptr || request.outputs == nullptr)))
+  {
+    request.status = kPsBatchInvalidArgument;
+    return;
+  }
+  switch (request.operation)
+  {
+    case kPsBatchModuleATempFunc:
+    {
+      status = api::ModuleATempFunc(std::span<const int>(request.inputs,
+          kCount), request.argument, std::span<int>(request.outputs,
+          kCount));
+      break;
+    }
+    case kPsBatchModuleADoSomethingElse:
+    {
+      status = api::ModuleADoSomethingElse(
+          static_cast<api::SomeEnum>(request.argument),
+          std::span<const int>(request.inputs, kCount),
+          std::span<int>(request.outputs, kCount));
+      break;
+    }
+    case kPsBatchModuleBDoSomethingElse:
+    {
+      status = api::ModuleBDoSomethingElse(
+          static_cast<api::SomeEnum>(request.argument),
+          std::span<const int>(request.inputs, kCount),
+          std::span<int>(request.outputs, kCount));
+      break;
+    }
+    default:
+    {
+      status = api::Status::kInvalidArgument;
+      break;
+    }
+  }
+  request.status = static_cast<std::int32_t>(status);
+}
+
+/* Runs every request in order, returns how many failed. */
+static std::uint64_t RunRequests(PsBatchRequest *requests,
+    std::uint64_t count)
+{
+  std::uint64_t failed_count = 0;
+  for (std::uint64_t i = 0; i < count; ++i)
+  {
+    RunRequest(requests[i]);
+    failed_count += requests[i].status != kPsBatchOk ? 1 : 0;
+  }
+  return failed_count;
+}
+
+/* Task function of a submitted batch. */
+static void RunBatchTask(Task &task)
+{
+  BatchTask &batch = static_cast<BatchTask &>(task);
+  BatchContext &context = *batch.context;
+  const PsBatchCompletion kCompletion = {batch.tag, batch.count,
+      RunRequests(batch.requests, batch.count)};
+  if (context.callback != nullptr)
+  {
+    context.callback(context.user_data, &kCompletion);
+    std::lock_guard<std::mutex> lock(context.mutex);
+    context.free_tasks.push_back(&batch);
+    --context.in_flight;
+    return;
+  }
+  /* The slot stays in flight until the completion is polled. */
+  std::lock_guard<std::mutex> lock(context.mutex);
+  context.ring[(context.ring_head + context.ring_size) % context.ring.size()] =
+      kCompletion;
+  ++context.ring_size;
+  context.free_tasks.push_back(&batch);
+}
+
+} /* namespace lib */
+} /* namespace project_structure */
+
+/* The C interface only wraps the lib::BatchContext it hands out. */
+struct PsBatchContext
+{
+  project_structure::lib::BatchContext context;
+};
+
+uint32_t PsBatchAbiVersion(void)
+{
+  return kPsBatchAbiVersion;
+}
+
+const char *PsBatchStatusName(int32_t status)
+{
+  if (status == kPsBatchQueueFull)
+  {
+    return "queue full";
+  }
+  return project_structure::api::StatusName(
+      static_cast<project_structure::api::Status>(status));
+}
+
+int32_t PsBatchRun(PsBatchRequest *requests, uint64_t count,
+    uint64_t *failed_count)
+{
+  uint64_t failed = 0;
+  if (requests == nullptr && count != 0)
+  {
+    return kPsBatchInvalidArgument;
+  }
+  failed = project_structure::lib::RunRequests(requests, count);
+  if (failed_count != nullptr)
+  {
+    *failed_count = failed;
+  }
+  return kPsBatchOk;
+}
+
+int32_t PsBatchContextCreate(const PsBatchContextOptions *options,
+    PsBatchContext **context)
+{
+  PsBatchContextOptions settings = {};
+  project_structure::lib::ThreadPoolOptions pool_options;
+  if (context == nullptr)
+  {
+    return kPsBatchInvalidArgument;
+  }
+  *context = nullptr;
+  if (options != nullptr)
+  {
+    /* A newer caller may pass a longer struct, its extra fields are unset. */
+    if (options->struct_size < sizeof(PsBatchContextOptions) ||
+        options->reserved != 0)
+    {
+      return kPsBatchInvalidArgument;
+    }
+    settings = *options;
+  }
+  if (settings.max_in_flight == 0)
+  {
+    settings.max_in_flight = project_structure::lib::kDefaultMaxInFlight;
+  }
+  pool_options.thread_count = settings.thread_count;
+  /*
+   * No more than max_in_flight batches are ever queued, so neither queue of
+   * the pool fills up or grows, wherever PsBatchSubmit is called from.
+   */
+  pool_options.deque_capacity = std::max<std::size_t>(
+      pool_options.deque_capacity, settings.max_in_flight);
+  pool_options.injection_capacity = std::max<std::size_t>(
+      pool_options.injection_capacity, settings.max_in_flight);
+  *context = new (std::nothrow) PsBatchContext{
+      project_structure::lib::BatchContext(pool_options,
+          settings.max_in_flight, settings.callback, settings.user_data)};
+  return *context == nullptr ? kPsBatchOutOfMemory : kPsBatchOk;
+}
+
+void PsBatchContextDestroy(PsBatchContext *context)
+{
+  delete context;
+}
+
+int32_t PsBatchSubmit(PsBatchContext *context, PsBatchRequest *requests,
+    uint64_t count, uint64_t tag)
+{
+  project_structure::lib::BatchTask *task = nullptr;
+  if (context == nullptr)
+  {
+    return kPsBatchEmptyHandle;
+  }
+  if (requests == nullptr && count != 0)
+  {
+    return kPsBatchInvalidArgument;
+  }
+  {
+    std::lock_guard<std::mutex> lock(context->context.mutex);
+    if (context->context.in_flight == context->context.tasks.size())
+    {
+      return kPsBatchQueueFull;
+    }
+    ++context->context.in_flight;
+    task = context->context.free_tasks.back();
+    context->context.free_tasks.pop_back();
+  }
+  task->function = &project_structure::lib::RunBatchTask;
+  task->context = &context->context;
+  task->requests = requests;
+  task->count = count;
+  task->tag = tag;
+  context->context.group.Spawn(*task);
+  return kPsBatchOk;
+}
+
+uint64_t PsBatchPoll(PsBatchContext *context, PsBatchCompletion *completions,
+    uint64_t capacity)
+{
+  project_structure::lib::BatchContext *batch_context = nullptr;
+  uint64_t taken = 0;
+  if (context == nullptr || completions == nullptr)
+  {
+    return 0;
+  }
+  batch_context = &context->context;
+  std::lock_guard<std::mutex> lock(batch_context->mutex);
+  while (taken < capacity && batch_context->ring_size > 0)
+  {
+    completions[taken] = batch_context->ring[batch_context->ring_head];
+    batch_context->ring_head = (batch_context->ring_head + 1) %
+        batch_context->ring.size();
+    --batch_context->ring_size;
+    --batch_context->in_flight;
+    ++taken;
+  }
+  return taken;
+}
+
+void PsBatchWait(PsBatchContext *context)
+{
+  if (context != nullptr)
+  {
+    context->context.group.Wait();
+  }
+}
@@ -0,0 +1,242 @@
+/* batch_abi.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Stable C interface for embedding module_a and module_b through
+ * FFI. Requests are submitted in arrays, so the cost of crossing the
+ * boundary is paid once per batch rather than once per item. Plain C, so
+ * that bindings can be generated from it.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_LIB_BATCHABI_H_
+#define PROJECTSTRUCTURE_LIB_BATCHABI_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Everything else in the shared library is hidden. */
+#define PROJECTSTRUCTURE_BATCH_EXPORT __attribute__((visibility("default")))
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*!
+ * @brief Version of the interface described here. Compare with
+ * PsBatchAbiVersion() to detect a mismatched shared library.
+ *
+ * Structs and values are only ever appended to, existing ones keep their
+ * layout and meaning within a version.
+ */
+enum
+{
+  kPsBatchAbiVersion = 1
+};
+
+/*!
+ * @brief Outcome of a request or call, stored as int32_t. The values below
+ * kPsBatchQueueFull are those of api::Status.
+ */
+enum PsBatchStatus
+{
+  kPsBatchOk = 0,
+  /* Not returned, both arrays of a request are count long. */
+  kPsBatchSizeMismatch = 1,
+  /* Unknown operation, or a pointer is NULL where it may not be. */
+  kPsBatchInvalidArgument = 2,
+  /* The context is NULL. */
+  kPsBatchEmptyHandle = 3,
+  kPsBatchOutOfMemory = 4,
+  /* PsBatchSubmit: max_in_flight batches have not completed yet. */
+  kPsBatchQueueFull = 8
+};
+
+/*!
+ * @brief What a request does, stored as uint32_t.
+ */
+enum PsBatchOperation
+{
+  /*
+   * api::ModuleATempFunc: inputs are some_other_inputs, argument is
+   * some_input and outputs are some_input_outputs, updated in place.
+   */
+  kPsBatchModuleATempFunc = 1,
+  /*
+   * api::ModuleADoSomethingElse: argument is a PsBatchSomeEnum, inputs are
+   * the struct_vars and outputs the results. outputs may equal inputs.
+   */
+  kPsBatchModuleADoSomethingElse = 2,
+  /* api::ModuleBDoSomethingElse, as kPsBatchModuleADoSomethingElse. */
+  kPsBatchModuleBDoSomethingElse = 3
+};
+
+/*!
+ * @brief SomeEnum of module_a and module_b, the argument of DoSomethingElse.
+ */
+enum PsBatchSomeEnum
+{
+  kPsBatchEnumVarOne = 1,
+  kPsBatchEnumVarTwo = 2
+};
+
+/*!
+ * @brief One request. 40 bytes on 64 bit targets.
+ *
+ * The arrays are owned by the caller and used in place, they must stay
+ * alive until the batch holding the request has completed.
+ */
+typedef struct PsBatchRequest
+{
+  /* A PsBatchOperation. */
+  uint32_t operation;
+  /* Scalar argument of the operation, see PsBatchOperation. */
+  int32_t argument;
+  /* count inputs, may be NULL if count is 0. */
+  const int32_t *inputs;
+  /* count outputs, may be NULL if count is 0. */
+  int32_t *outputs;
+  uint64_t count;
+  /* Set to a PsBatchStatus when the request has run. */
+  int32_t status;
+  /* Must be 0. */
+  uint32_t reserved;
+} PsBatchRequest;
+
+/*!
+ * @brief Reports a batch submitted with PsBatchSubmit as completed. The
+ * status of every request has been set.
+ */
+typedef struct PsBatchCompletion
+{
+  /* The tag passed to PsBatchSubmit. */
+  uint64_t tag;
+  uint64_t request_count;
+  /* Requests whose status is not kPsBatchOk. */
+  uint64_t failed_count;
+} PsBatchCompletion;
+
+/*!
+ * @brief Called on a worker thread of the context once per completed batch.
+ * Must not call PsBatchWait or PsBatchContextDestroy on the context.
+ */
+typedef void (*PsBatchCallback)(void *user_data,
+    const PsBatchCompletion *completion);
+
+/*!
+ * @brief Configuration of a PsBatchContext. Zero initialize, then set
+ * struct_size and what differs from the defaults.
+ */
+typedef struct PsBatchContextOptions
+{
+  /* sizeof(PsBatchContextOptions), so later versions can append fields. */
+  uint32_t struct_size;
+  /* Worker threads running submitted batches, 0 means one per CPU. */
+  uint32_t thread_count;
+  /*
+   * Batches submitted but not yet reported, by callback or by PsBatchPoll.
+   * PsBatchSubmit fails with kPsBatchQueueFull beyond it. 0 means 64.
+   */
+  uint32_t max_in_flight;
+  /* Must be 0. */
+  uint32_t reserved;
+  /* Reports completions, NULL to queue them for PsBatchPoll instead. */
+  PsBatchCallback callback;
+  /* Passed to callback. */
+  void *user_data;
+} PsBatchContextOptions;
+
+/*!
+ * @brief Worker threads and completion queue for asynchronous batches.
+ * Every function taking a context may be called from any thread.
+ */
+typedef struct PsBatchContext PsBatchContext;
+
+/*! @brief kPsBatchAbiVersion of the shared library. */
+PROJECTSTRUCTURE_BATCH_EXPORT uint32_t PsBatchAbiVersion(void);
+
+/*! @brief Name of a PsBatchStatus, e.g. "queue full". */
+PROJECTSTRUCTURE_BATCH_EXPORT const char *PsBatchStatusName(int32_t status);
+
+/*!
+ * @brief Runs every request on the calling thread, in order.
+ *
+ * Does not allocate.
+ *
+ * @param[in, out] requests count requests, their statuses are set.
+ * @param[in] count Number of requests.
+ * @param[out] failed_count Requests whose status is not kPsBatchOk, may be
+ * NULL.
+ *
+ * @return kPsBatchOk once every request has run, even those which failed,
+ * or kPsBatchInvalidArgument if requests is NULL and count is not 0.
+ */
+PROJECTSTRUCTURE_BATCH_EXPORT int32_t PsBatchRun(PsBatchRequest *requests,
+    uint64_t count, uint64_t *failed_count);
+
+/*!
+ * @brief Starts the worker threads of a context.
+ *
+ * @param[in] options Configuration, NULL for the defaults.
+ * @param[out] context The new context, NULL unless kPsBatchOk is returned.
+ *
+ * @return kPsBatchOk, kPsBatchInvalidArgument or kPsBatchOutOfMemory.
+ */
+PROJECTSTRUCTURE_BATCH_EXPORT int32_t PsBatchContextCreate(
+    const PsBatchContextOptions *options, PsBatchContext **context);
+
+/*!
+ * @brief Waits for the submitted batches and stops the workers. Completions
+ * not yet polled are dropped. Accepts NULL.
+ */
+PROJECTSTRUCTURE_BATCH_EXPORT void PsBatchContextDestroy(
+    PsBatchContext *context);
+
+/*!
+ * @brief Queues a batch for the workers and returns at once.
+ *
+ * The batch runs on one worker, in order. Submit several batches to use
+ * several workers. Does not allocate or wait for the workers, also when
+ * called from a completion callback: the queues of the context are sized
+ * for max_in_flight batches when it is created.
+ *
+ * @param[in] context The context.
+ * @param[in, out] requests count requests, owned by the caller until the
+ * batch is reported as completed.
+ * @param[in] count Number of requests.
+ * @param[in] tag Returned in the completion of the batch.
+ *
+ * @return kPsBatchOk, kPsBatchQueueFull, kPsBatchInvalidArgument or
+ * kPsBatchEmptyHandle. The batch is queued only if kPsBatchOk is returned.
+ */
+PROJECTSTRUCTURE_BATCH_EXPORT int32_t PsBatchSubmit(PsBatchContext *context,
+    PsBatchRequest *requests, uint64_t count, uint64_t tag);
+
+/*!
+ * @brief Takes completions queued by a context without a callback. Never
+ * blocks.
+ *
+ * @param[in] context The context.
+ * @param[out] completions Room for capacity completions.
+ * @param[in] capacity Most completions to take.
+ *
+ * @return Number of completions taken, in the order the batches completed.
+ */
+PROJECTSTRUCTURE_BATCH_EXPORT uint64_t PsBatchPoll(PsBatchContext *context,
+    PsBatchCompletion *completions, uint64_t capacity);
+
+/*!
+ * @brief Blocks until every batch submitted so far has completed, helping
+ * the workers meanwhile. Their completions can be polled afterwards.
+ */
+PROJECTSTRUCTURE_BATCH_EXPORT void PsBatchWait(PsBatchContext *context);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* PROJECTSTRUCTURE_LIB_BATCHABI_H_ */
@@ -0,0 +1,502 @@
+/* library.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Work stealing thread pool used to spread module_a and module_b
+ * work over every core, with parallel loops over it.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "lib/library.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+
+namespace project_structure
+{
+namespace lib
+{
+
+/* Rounds of polling an idle worker does before it goes to sleep. */
+constexpr int kIdleSpinCount = 64;
+
+/*
+ * Pool and index of the worker running on this thread, nullptr and 0 on
+ * threads which are not workers. Thread local so that Spawn can find the
+ * calling worker's deque without a lookup.
+ */
+thread_local ThreadPool *current_pool = nullptr;
+thread_local std::size_t current_worker_index = 0;
+
+/*
+ * Random state for threads which steal without being workers, that is
+ * threads helping out while they wait for a TaskGroup.
+ */
+thread_local std::uint64_t helper_random_state = 0x9e3779b97f4a7c15u;
+
+static std::uint64_t NextRandom(std::uint64_t &state)
+{
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+/* CPUs the process may run on, in increasing order. */
+static std::vector<int> AllowedCpus()
+{
+  std::vector<int> cpus;
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+  {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+      if (CPU_ISSET(cpu, &allowed))
+      {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  return cpus;
+}
+
+WorkStealingDeque::WorkStealingDeque(std::size_t capacity)
+{
+  std::size_t size = 1;
+  while (size < capacity)
+  {
+    size *= 2;
+  }
+  ring_.store(new Ring{size - 1, new std::atomic<Task *>[size]},
+      std::memory_order_relaxed);
+}
+
+WorkStealingDeque::~WorkStealingDeque()
+{
+  Ring *ring = ring_.load(std::memory_order_relaxed);
+  delete[] ring->slots;
+  delete ring;
+  for (Ring *retired : retired_rings_)
+  {
+    delete[] retired->slots;
+    delete retired;
+  }
+}
+
+WorkStealingDeque::Ring *WorkStealingDeque::Grow(Ring *ring,
+    std::int64_t top, std::int64_t bottom)
+{
+  std::size_t size = 2 * (ring->mask + 1);
+  Ring *grown = new Ring{size - 1, new std::atomic<Task *>[size]};
+  for (std::int64_t i = top; i < bottom; ++i)
+  {
+    grown->slots[static_cast<std::size_t>(i) & grown->mask].store(
+        ring->slots[static_cast<std::size_t>(i) & ring->mask].load(
+            std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+  retired_rings_.push_back(ring);
+  ring_.store(grown, std::memory_order_release);
+  return grown;
+}
+
+void WorkStealingDeque::Push(Task *task)
+{
+  std::int64_t bottom = bottom_.load(std::memory_order_relaxed);
+  std::int64_t top = top_.load(std::memory_order_acquire);
+  Ring *ring = ring_.load(std::memory_order_relaxed);
+  if (bottom - top > static_cast<std::int64_t>(ring->mask))
+  {
+    ring = Grow(ring, top, bottom);
+  }
+  ring->slots[static_cast<std::size_t>(bottom) & ring->mask].store(task,
+      std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  bottom_.store(bottom + 1, std::memory_order_relaxed);
+}
+
+Task *WorkStealingDeque::Take()
+{
+  std::int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+  Ring *ring = ring_.load(std::memory_order_relaxed);
+  std::int64_t top = 0;
+  Task *task = nullptr;
+  bottom_.store(bottom, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  top = top_.load(std::memory_order_relaxed);
+  if (top > bottom)
+  {
+    /* Empty. */
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  task = ring->slots[static_cast<std::size_t>(bottom) & ring->mask].load(
+      std::memory_order_relaxed);
+  if (top == bottom)
+  {
+    /* Last task, race the thieves for it. */
+    if (!top_.compare_exchange_strong(top, top + 1,
+        std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+      task = nullptr;
+    }
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+  }
+  return task;
+}
+
+Task *WorkStealingDeque::Steal()
+{
+  std::int64_t top = top_.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  std::int64_t bottom = bottom_.load(std::memory_order_acquire);
+  Ring *ring = nullptr;
+  Task *task = nullptr;
+  if (top >= bottom)
+  {
+    return nullptr;
+  }
+  ring = ring_.load(std::memory_order_acquire);
+  task = ring->slots[static_cast<std::size_t>(top) & ring->mask].load(
+      std::memory_order_relaxed);
+  if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+      std::memory_order_relaxed))
+  {
+    return nullptr;
+  }
+  return task;
+}
+
+ThreadPool::ThreadPool(const ThreadPoolOptions &options)
+    : options_(options), injection_queue_(options.injection_capacity)
+{
+  if (options_.thread_count == 0)
+  {
+    options_.thread_count = AllowedCpus().size();
+  }
+  if (options_.thread_count == 0)
+  {
+    options_.thread_count = std::thread::hardware_concurrency();
+  }
+  if (options_.thread_count == 0)
+  {
+    options_.thread_count = 1;
+  }
+  workers_.assign(options_.thread_count, nullptr);
+  for (std::size_t i = 0; i < options_.thread_count; ++i)
+  {
+    threads_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+  }
+  WaitForWorkers();
+}
+
+ThreadPool::~ThreadPool()
+{
+  stopping_.store(true, std::memory_order_release);
+  work_epoch_.fetch_add(1, std::memory_order_release);
+  work_epoch_.notify_all();
+  /* Joined before any is deleted, the others may still steal from it. */
+  for (std::thread &thread : threads_)
+  {
+    thread.join();
+  }
+  for (Worker *worker : workers_)
+  {
+    delete worker;
+  }
+}
+
+std::size_t ThreadPool::ThreadCount() const
+{
+  return workers_.size();
+}
+
+std::size_t ThreadPool::CurrentWorkerIndex() const
+{
+  return current_pool == this ? current_worker_index : workers_.size();
+}
+
+void ThreadPool::Pin(std::size_t index)
+{
+  std::vector<int> cpus = options_.cpus.empty() ? AllowedCpus() :
+      options_.cpus;
+  cpu_set_t cpu_set;
+  int cpu = 0;
+  if (cpus.empty())
+  {
+    return;
+  }
+  cpu = cpus[index % cpus.size()];
+  if (cpu < 0 || cpu >= CPU_SETSIZE)
+  {
+    return;
+  }
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+  /* Pinning is an optimization, the pool works without it. */
+  (void)pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+}
+
+void ThreadPool::Schedule(Task *task)
+{
+  if (current_pool == this)
+  {
+    workers_[current_worker_index]->deque.Push(task);
+  }
+  else
+  {
+    /*
+     * Full, the workers empty the queue as they look for work. Waiting is
+     * the back pressure, running their tasks here could take locks the
+     * caller holds.
+     */
+    while (!injection_queue_.TryPush(task))
+    {
+      std::this_thread::yield();
+    }
+  }
+  /* Pairs with the increment of sleeping_workers_ in WorkerLoop. */
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleeping_workers_.load(std::memory_order_relaxed) > 0)
+  {
+    work_epoch_.fetch_add(1, std::memory_order_release);
+    work_epoch_.notify_one();
+  }
+}
+
+Task *ThreadPool::FindTask(Worker *worker)
+{
+  Task *task = nullptr;
+  std::size_t start = 0;
+  std::size_t victim = 0;
+  if (worker != nullptr)
+  {
+    task = worker->deque.Take();
+    if (task != nullptr)
+    {
+      return task;
+    }
+  }
+  if (injection_queue_.TryPop(task))
+  {
+    return task;
+  }
+  start = static_cast<std::size_t>(NextRandom(worker != nullptr ?
+      worker->random_state : helper_random_state));
+  for (std::size_t i = 0; i < workers_.size(); ++i)
+  {
+    victim = (start + i) % workers_.size();
+    if (workers_[victim] == worker)
+    {
+      continue;
+    }
+    task = workers_[victim]->deque.Steal();
+    if (task != nullptr)
+    {
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+bool ThreadPool::RunPendingTask()
+{
+  Worker *worker = current_pool == this ? workers_[current_worker_index] :
+      nullptr;
+  Task *task = FindTask(worker);
+  TaskGroup *group = nullptr;
+  if (task == nullptr)
+  {
+    return false;
+  }
+  /* Read before running, the task may be reused once the group finishes. */
+  group = task->group;
+  task->function(*task);
+  group->Finish();
+  return true;
+}
+
+void ThreadPool::WorkerLoop(std::size_t index)
+{
+  std::uint32_t epoch = 0;
+  bool found = false;
+  current_pool = this;
+  current_worker_index = index;
+  if (options_.pin_threads || !options_.cpus.empty())
+  {
+    Pin(index);
+  }
+  /* Allocated after pinning so that first touch puts it on our node. */
+  workers_[index] = new Worker(options_.deque_capacity);
+  workers_[index]->random_state = 0x9e3779b97f4a7c15u * (index + 1);
+  started_workers_.fetch_add(1, std::memory_order_release);
+  started_workers_.notify_all();
+  /* Every deque has to exist before anyone steals from it. */
+  WaitForWorkers();
+  while (!stopping_.load(std::memory_order_acquire))
+  {
+    found = RunPendingTask();
+    for (int spin = 0; !found && spin < kIdleSpinCount; ++spin)
+    {
+      std::this_thread::yield();
+      found = RunPendingTask();
+    }
+    if (found)
+    {
+      continue;
+    }
+
+    /*
+     * Announce the intent to sleep before the last look for work, Schedule
+     * checks sleeping_workers_ after publishing its task so either this look
+     * finds the task or Schedule bumps the epoch and wakes us.
+     */
+    epoch = work_epoch_.load(std::memory_order_acquire);
+    sleeping_workers_.fetch_add(1, std::memory_order_seq_cst);
+    if (!RunPendingTask() && !stopping_.load(std::memory_order_acquire))
+    {
+      work_epoch_.wait(epoch, std::memory_order_acquire);
+    }
+    sleeping_workers_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  current_pool = nullptr;
+}
+
+void ThreadPool::WaitForWorkers()
+{
+  std::size_t started = started_workers_.load(std::memory_order_acquire);
+  while (started < workers_.size())
+  {
+    started_workers_.wait(started, std::memory_order_acquire);
+    started = started_workers_.load(std::memory_order_acquire);
+  }
+}
+
+TaskGroup::TaskGroup(ThreadPool &pool) : pool_(pool)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+  Wait();
+}
+
+void TaskGroup::Spawn(Task &task)
+{
+  task.group = this;
+  pending_.fetch_add(1, std::memory_order_relaxed);
+  pool_.Schedule(&task);
+}
+
+void TaskGroup::Finish()
+{
+  /*
+   * Once pending_ reaches zero the waiter may destroy the group, so the pool
+   * is looked up before and only the pool is touched after.
+   */
+  ThreadPool &pool = pool_;
+  if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+  {
+    pool.group_epoch_.fetch_add(1, std::memory_order_release);
+    pool.group_epoch_.notify_all();
+  }
+}
+
+void TaskGroup::Wait()
+{
+  std::uint32_t epoch = 0;
+  bool on_worker = current_pool == &pool_;
+  while (true)
+  {
+    epoch = pool_.group_epoch_.load(std::memory_order_acquire);
+    if (pending_.load(std::memory_order_acquire) == 0)
+    {
+      return;
+    }
+    if (pool_.RunPendingTask())
+    {
+      continue;
+    }
+    /*
+     * A worker must not sleep here since nothing would wake it for new
+     * work, it keeps polling instead. Other threads sleep until some group
+     * of the pool finishes.
+     */
+    if (on_worker)
+    {
+      std::this_thread::yield();
+    }
+    else
+    {
+      pool_.group_epoch_.wait(epoch, std::memory_order_acquire);
+    }
+  }
+}
+
+AdaptiveGrain::AdaptiveGrain(const AdaptiveGrainOptions &options) :
+    options_(options)
+{
+}
+
+std::size_t AdaptiveGrain::Grain(std::size_t count,
+    std::size_t thread_count) const
+{
+  const double kCost = nanoseconds_per_element_.load(
+      std::memory_order_relaxed);
+  std::size_t grain = 0;
+  std::size_t balanced = 0;
+  if (thread_count <= 1 || kCost <= 0.0 || kCost *
+      static_cast<double>(count) < static_cast<double>(
+          options_.serial_time.count()))
+  {
+    return count;
+  }
+  grain = static_cast<std::size_t>(static_cast<double>(
+      options_.task_time.count()) / kCost);
+  balanced = count / (thread_count * std::max<std::size_t>(
+      options_.tasks_per_thread, 1));
+  return std::clamp<std::size_t>(std::min(grain, balanced), 1, count);
+}
+
+void AdaptiveGrain::Record(std::size_t count, std::chrono::nanoseconds busy)
+{
+  /* Keeps a loop too fast for the clock from looking like no estimate. */
+  const double kMinCost = 1e-3;
+  const double kOld = nanoseconds_per_element_.load(
+      std::memory_order_relaxed);
+  double sample = 0.0;
+  if (count == 0)
+  {
+    return;
+  }
+  sample = std::max(static_cast<double>(busy.count()) /
+      static_cast<double>(count), kMinCost);
+  /* Concurrent loops may lose each others update, that only delays it. */
+  nanoseconds_per_element_.store(kOld == 0.0 ? sample :
+      kOld + (sample - kOld) * options_.smoothing,
+      std::memory_order_relaxed);
+}
+
+double AdaptiveGrain::NanosecondsPerElement() const
+{
+  return nanoseconds_per_element_.load(std::memory_order_relaxed);
+}
+
+const AdaptiveGrainOptions &AdaptiveGrain::Options() const
+{
+  return options_;
+}
+
+} /* namespace lib */
+} /* namespace project_structure */
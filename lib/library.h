@@ -2,13 +2,497 @@
  *==============================================================================
  * Author: Carl Larsson
  * Creation date: 2024-09-09
- * Last modified: 2024-10-08 by Carl Larsson
- * Description: Example .h file used for example file structure and Google C++ 
- * style guide, it is only meant to be used as a template. All functions and 
- * variables are dummy and the contents of this file should in no way been seen 
- * as a reflection of a real file.
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Work stealing thread pool used to spread module_a and module_b
+ * work over every core, with parallel loops over it.
  * License: See LICENSE file for license details.
  *==============================================================================
  */
 
-/* Placeholder file used for showing structure, nothing else. */
+#ifndef PROJECTSTRUCTURE_LIB_LIBRARY_H_
+#define PROJECTSTRUCTURE_LIB_LIBRARY_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "common/ring_queue.h"
+
+
+namespace project_structure
+{
+namespace lib
+{
+
+class TaskGroup;
+
+/*!
+ * @brief A unit of work run by the ThreadPool.
+ *
+ * Tasks are owned by the caller and are never copied or freed by the pool.
+ * Spawning only allocates when a worker's deque grows past its capacity,
+ * the injection queue is preallocated. Derive from Task to carry
+ * arguments and cast back to the derived type in function:
+ *
+ * struct MyTask : public lib::Task { int argument; };
+ * static void RunMyTask(lib::Task &task)
+ * {
+ *   MyTask &my_task = static_cast<MyTask &>(task);
+ *   ...
+ * }
+ *
+ * A task must stay alive until the TaskGroup it was spawned in has been
+ * waited for.
+ */
+struct Task
+{
+  /* Called once on some worker (or waiting) thread. */
+  void (*function)(Task &task) = nullptr;
+  /* Set by TaskGroup::Spawn. */
+  TaskGroup *group = nullptr;
+};
+
+/*!
+ * @brief Growable deque of tasks with one owner and many thieves.
+ *
+ * Chase-Lev work stealing deque as formulated for C11 atomics by Le et al.,
+ * "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+ * The owning worker pushes and takes at the bottom without locking, other
+ * workers steal from the top with a single compare and swap. The ring grows
+ * when full, retired rings are kept until the deque is destroyed since a
+ * thief may still be reading them.
+ *
+ * The class is neither copyable nor movable.
+ */
+class WorkStealingDeque
+{
+ public:
+  /*!
+   * @param[in] capacity Initial capacity, rounded up to a power of two.
+   */
+  explicit WorkStealingDeque(std::size_t capacity);
+  WorkStealingDeque(const WorkStealingDeque &) = delete;
+  WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+  ~WorkStealingDeque();
+
+  /*! @brief Pushes task at the bottom, only called by the owner. */
+  void Push(Task *task);
+
+  /*!
+   * @brief Takes the most recently pushed task, only called by the owner.
+   *
+   * @return The task, nullptr if the deque is empty.
+   */
+  Task *Take();
+
+  /*!
+   * @brief Steals the oldest task, may be called by any thread.
+   *
+   * @return The task, nullptr if the deque is empty or another thread won the
+   * race for the task.
+   */
+  Task *Steal();
+
+ private:
+  struct Ring
+  {
+    std::size_t mask;
+    std::atomic<Task *> *slots;
+  };
+
+  Ring *Grow(Ring *ring, std::int64_t top, std::int64_t bottom);
+
+  alignas(64) std::atomic<std::int64_t> top_{0};
+  alignas(64) std::atomic<std::int64_t> bottom_{0};
+  alignas(64) std::atomic<Ring *> ring_{nullptr};
+  /* Rings replaced by Grow, only touched by the owner. */
+  std::vector<Ring *> retired_rings_;
+};
+
+/*!
+ * @brief Configuration of a ThreadPool.
+ */
+struct ThreadPoolOptions
+{
+  /* Number of worker threads, 0 means one per available CPU. */
+  std::size_t thread_count = 0;
+  /* Pin worker i to the i:th CPU the process is allowed to run on. */
+  bool pin_threads = false;
+  /* Initial capacity of every worker's deque. */
+  std::size_t deque_capacity = 1024;
+  /*
+   * Pin worker i to cpus[i % cpus.size()] instead, e.g. as placed by
+   * common::PlaceWorkers. Pinning that fails is ignored.
+   */
+  std::vector<int> cpus;
+  /*
+   * Tasks spawned by threads which are not workers that can wait to be
+   * picked up, rounded up to a power of two. Spawning into a full queue
+   * waits for a worker to take a task.
+   */
+  std::size_t injection_capacity = 4096;
+};
+
+/*!
+ * @brief Work stealing thread pool.
+ *
+ * Every worker owns a WorkStealingDeque. Tasks spawned by a worker go to its
+ * own deque, tasks spawned by other threads go to a shared, bounded injection
+ * queue which is allocated with the pool. Idle workers first look in their
+ * own deque, then in the injection queue and finally steal from the other
+ * workers, before they go to sleep.
+ *
+ * Every worker allocates its deque itself after it has been pinned, so on a
+ * NUMA machine the deque is on the node of the worker.
+ *
+ * The class is neither copyable nor movable.
+ */
+class ThreadPool
+{
+ public:
+  /*!
+   * @brief Starts the worker threads.
+   *
+   * @param[in] options Thread count, pinning and deque capacity.
+   */
+  explicit ThreadPool(const ThreadPoolOptions &options = ThreadPoolOptions{});
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /*!
+   * @brief Stops and joins the workers.
+   *
+   * @pre Every TaskGroup using the pool has been waited for.
+   */
+  ~ThreadPool();
+
+  /*! @brief Number of worker threads. */
+  std::size_t ThreadCount() const;
+
+  /*!
+   * @brief Index of the calling worker in [0, ThreadCount()), or
+   * ThreadCount() if the caller is not a worker of this pool.
+   */
+  std::size_t CurrentWorkerIndex() const;
+
+  /*!
+   * @brief Runs one pending task of the pool on the calling thread.
+   *
+   * Lets a worker which waits for a single task instead of a whole TaskGroup
+   * keep the pool going meanwhile, see TaskGroup::Wait.
+   *
+   * @return false if no task was pending.
+   */
+  bool RunPendingTask();
+
+ private:
+  friend class TaskGroup;
+
+  struct Worker
+  {
+    explicit Worker(std::size_t deque_capacity) : deque(deque_capacity)
+    {
+    }
+
+    WorkStealingDeque deque;
+    std::uint64_t random_state = 0;
+  };
+
+  void Schedule(Task *task);
+  Task *FindTask(Worker *worker);
+  void WorkerLoop(std::size_t index);
+  void Pin(std::size_t index);
+  /* Blocks until every worker has allocated its deque. */
+  void WaitForWorkers();
+
+  ThreadPoolOptions options_;
+  /* Filled in by the workers themselves before the constructor returns. */
+  std::vector<Worker *> workers_;
+  std::vector<std::thread> threads_;
+  std::atomic<std::size_t> started_workers_{0};
+  common::MpmcRingQueue<Task *> injection_queue_;
+  /* Bumped whenever work arrives, idle workers sleep on it. */
+  std::atomic<std::uint32_t> work_epoch_{0};
+  std::atomic<std::size_t> sleeping_workers_{0};
+  /* Bumped whenever a TaskGroup finishes, waiting threads sleep on it. */
+  std::atomic<std::uint32_t> group_epoch_{0};
+  std::atomic<bool> stopping_{false};
+};
+
+/*!
+ * @brief A set of tasks which can be waited for together.
+ *
+ * The class is neither copyable nor movable.
+ */
+class TaskGroup
+{
+ public:
+  explicit TaskGroup(ThreadPool &pool);
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+
+  /*! @brief Waits for every task spawned in the group. */
+  ~TaskGroup();
+
+  /*!
+   * @brief Schedules task on the pool.
+   *
+   * May be called from any thread, including from inside a running task of
+   * the same group.
+   *
+   * @param[in] task The task, must outlive the next Wait.
+   */
+  void Spawn(Task &task);
+
+  /*!
+   * @brief Blocks until every task spawned in the group has finished.
+   *
+   * The calling thread runs pending tasks of the pool while it waits, so Wait
+   * may be called from inside a task without risking a deadlock.
+   */
+  void Wait();
+
+ private:
+  friend class ThreadPool;
+
+  /* Called by the pool when a task of this group has finished. */
+  void Finish();
+
+  ThreadPool &pool_;
+  std::atomic<std::int64_t> pending_{0};
+};
+
+/*!
+ * @brief Calls function(i) for every i in [begin, end) using the pool.
+ *
+ * The range is split recursively in halves, a worker keeps splitting the half
+ * it owns and leaves the other half in its deque for thieves, so the big
+ * pieces are stolen first. Every leaf covers at most grain indices. Returns
+ * when every call has finished. The split tree is allocated per call, one
+ * task per node, so loops on the hot path should use a coarse grain.
+ *
+ * @param[in] pool The pool to run on.
+ * @param[in] begin First index.
+ * @param[in] end One past the last index.
+ * @param[in] grain Largest number of indices handled by one task, 0 is
+ * treated as 1.
+ * @param[in] function Callable taking a std::size_t, called concurrently.
+ */
+template <typename Function>
+void ParallelFor(ThreadPool &pool, std::size_t begin, std::size_t end,
+    std::size_t grain, const Function &function)
+{
+  struct RangeTask : public Task
+  {
+    const Function *body;
+    std::vector<RangeTask> *tasks;
+    std::size_t node;
+    std::size_t begin;
+    std::size_t end;
+    std::size_t grain;
+  };
+  struct Splitter
+  {
+    static void Run(Task &task)
+    {
+      RangeTask &range = static_cast<RangeTask &>(task);
+      std::size_t node = range.node;
+      std::size_t begin = range.begin;
+      std::size_t end = range.end;
+      std::size_t middle = 0;
+      RangeTask *right = nullptr;
+      while (end - begin > range.grain)
+      {
+        middle = begin + (end - begin) / 2;
+        right = &(*range.tasks)[2 * node + 2];
+        right->function = &Run;
+        right->begin = middle;
+        right->end = end;
+        right->node = 2 * node + 2;
+        range.group->Spawn(*right);
+        node = 2 * node + 1;
+        end = middle;
+      }
+      for (std::size_t i = begin; i < end; ++i)
+      {
+        (*range.body)(i);
+      }
+    }
+  };
+
+  if (end <= begin)
+  {
+    return;
+  }
+  if (grain == 0)
+  {
+    grain = 1;
+  }
+  /* Heap indexed split tree, 2 * 2^depth nodes always suffice. */
+  std::size_t leaves = 1;
+  while (leaves * grain < end - begin)
+  {
+    leaves *= 2;
+  }
+  std::vector<RangeTask> tasks(2 * leaves,
+      RangeTask{Task{}, &function, nullptr, 0, 0, 0, grain});
+  for (RangeTask &task : tasks)
+  {
+    task.tasks = &tasks;
+  }
+  tasks[0].function = &Splitter::Run;
+  tasks[0].begin = begin;
+  tasks[0].end = end;
+  TaskGroup group(pool);
+  group.Spawn(tasks[0]);
+  group.Wait();
+}
+
+/*!
+ * @brief Configuration of an AdaptiveGrain.
+ */
+struct AdaptiveGrainOptions
+{
+  /* Time one task should take, long enough to hide the cost of spawning it. */
+  std::chrono::nanoseconds task_time{50000};
+  /* Loops expected to take less than this run on the calling thread. */
+  std::chrono::nanoseconds serial_time{100000};
+  /* Elements timed on the calling thread while there is no estimate yet. */
+  std::size_t probe_count = 64;
+  /* Smallest number of tasks per thread, for load balance. */
+  std::size_t tasks_per_thread = 4;
+  /* Weight of a new measurement in the running estimate, in (0, 1]. */
+  double smoothing = 0.25;
+};
+
+/*!
+ * @brief Picks the number of elements per task of a parallel loop from the
+ * measured cost per element.
+ *
+ * Keep one per loop body, since the estimate is of that body. It is updated
+ * by every AdaptiveParallelFor run with it, so the grain follows the cost as
+ * it changes, e.g. with the size of the elements or a warming cache.
+ *
+ * The class is neither copyable nor movable. It is thread safe, concurrent
+ * loops may share it.
+ */
+class AdaptiveGrain
+{
+ public:
+  /*!
+   * @param[in] options Task and serial time targets and smoothing.
+   */
+  explicit AdaptiveGrain(const AdaptiveGrainOptions &options =
+      AdaptiveGrainOptions{});
+  AdaptiveGrain(const AdaptiveGrain &) = delete;
+  AdaptiveGrain &operator=(const AdaptiveGrain &) = delete;
+
+  /*!
+   * @brief Elements per task for a loop over count elements.
+   *
+   * @param[in] count Number of elements in the loop.
+   * @param[in] thread_count Number of threads the loop may run on.
+   *
+   * @return count if the loop should run serially: on one thread, without an
+   * estimate or if it is expected to take less than serial_time. Otherwise
+   * enough elements for task_time, but small enough for tasks_per_thread
+   * tasks per thread.
+   */
+  std::size_t Grain(std::size_t count, std::size_t thread_count) const;
+
+  /*!
+   * @brief Adds a measurement to the estimate.
+   *
+   * @param[in] count Number of elements processed, 0 is ignored.
+   * @param[in] busy Time spent processing them, summed over every thread.
+   */
+  void Record(std::size_t count, std::chrono::nanoseconds busy);
+
+  /*! @brief The estimated cost of one element, 0.0 before any Record. */
+  double NanosecondsPerElement() const;
+
+  /*! @brief The options it was created with. */
+  const AdaptiveGrainOptions &Options() const;
+
+ private:
+  AdaptiveGrainOptions options_;
+  std::atomic<double> nanoseconds_per_element_{0.0};
+};
+
+/*!
+ * @brief Calls function(range_begin, range_end) for consecutive ranges
+ * covering [begin, end), in parallel with a grain from grain.
+ *
+ * Without an estimate the first probe_count elements are run and timed on
+ * the calling thread first. Loops that are then expected to be short run on
+ * the calling thread, the rest are split into tasks of grain.Grain elements
+ * with ParallelFor. Every range is timed and the total is recorded in grain.
+ *
+ * How [begin, end) is split depends on the timing, so function should write
+ * one result per index rather than combine them in order, which keeps the
+ * results independent of the thread count.
+ *
+ * @param[in] pool The pool to run on.
+ * @param[in, out] grain Estimate of the cost of function per index.
+ * @param[in] begin First index.
+ * @param[in] end One past the last index.
+ * @param[in] function Callable taking two std::size_t, called concurrently
+ * with ranges that do not overlap.
+ */
+template <typename Function>
+void AdaptiveParallelFor(ThreadPool &pool, AdaptiveGrain &grain,
+    std::size_t begin, std::size_t end, const Function &function)
+{
+  std::chrono::steady_clock::time_point start;
+  std::atomic<std::int64_t> busy{0};
+  std::size_t probe_end = 0;
+  std::size_t task_grain = 0;
+  if (end <= begin)
+  {
+    return;
+  }
+  if (grain.NanosecondsPerElement() == 0.0)
+  {
+    probe_end = begin + std::min(end - begin, grain.Options().probe_count);
+    start = std::chrono::steady_clock::now();
+    function(begin, probe_end);
+    grain.Record(probe_end - begin, std::chrono::steady_clock::now() - start);
+    begin = probe_end;
+    if (begin == end)
+    {
+      return;
+    }
+  }
+
+  task_grain = grain.Grain(end - begin, pool.ThreadCount());
+  if (task_grain >= end - begin)
+  {
+    start = std::chrono::steady_clock::now();
+    function(begin, end);
+    grain.Record(end - begin, std::chrono::steady_clock::now() - start);
+    return;
+  }
+  ParallelFor(pool, 0, (end - begin + task_grain - 1) / task_grain, 1,
+      [&](std::size_t task)
+  {
+    const std::size_t kTaskBegin = begin + task * task_grain;
+    const std::chrono::steady_clock::time_point kTaskStart =
+        std::chrono::steady_clock::now();
+    function(kTaskBegin, std::min(end, kTaskBegin + task_grain));
+    busy.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - kTaskStart).count(),
+        std::memory_order_relaxed);
+  });
+  grain.Record(end - begin, std::chrono::nanoseconds{busy.load(
+      std::memory_order_relaxed)});
+}
+
+} /* namespace lib */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_LIB_LIBRARY_H_ */
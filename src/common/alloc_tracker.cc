@@ -0,0 +1,157 @@
+/* alloc_tracker.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Opt-in accounting of heap allocations, attributed to the
+ * module whose code made them.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "common/alloc_tracker.h"
+
+#include <malloc.h>
+
+#include <atomic>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+
+#include "common/sharded_counter.h"
+
+
+namespace project_structure
+{
+namespace common
+{
+
+constinit thread_local AllocationScope current_allocation_scope =
+    AllocationScope::kOther;
+
+constinit thread_local ThreadAllocationCounts thread_allocation_counts = {};
+
+/*
+ * Totals of every thread. Constant initialized since operator new runs
+ * before, and while, other translation units are dynamically initialized.
+ * Sharded, every allocation of every thread adds to them.
+ */
+constinit ShardedCounter allocation_counters[kAllocationScopeCount];
+constinit ShardedCounter allocated_bytes_counters[kAllocationScopeCount];
+constinit ShardedCounter free_counter;
+
+/*
+ * Live bytes of the whole process. One shared atomic rather than shards, the
+ * peak has to be compared against the sum, which makes the tracker too slow
+ * to leave linked into production binaries.
+ */
+constinit std::atomic<std::int64_t> live_bytes{0};
+constinit std::atomic<std::int64_t> peak_live_bytes{0};
+
+/* Names of the scopes, indexed by AllocationScope. */
+constexpr const char *kAllocationScopeNames[kAllocationScopeCount] = {
+    "other", "module_a", "module_b", "proto"};
+
+void RecordAllocation(void *memory, std::size_t size)
+{
+  const std::size_t kScope = static_cast<std::size_t>(
+      current_allocation_scope);
+  /*
+   * Usable sizes on both sides, RecordFree does not know what was requested.
+   * Also what the memory really costs.
+   */
+  const std::int64_t kUsableSize = static_cast<std::int64_t>(
+      malloc_usable_size(memory));
+  const std::int64_t kLive = live_bytes.fetch_add(kUsableSize,
+      std::memory_order_relaxed) + kUsableSize;
+  std::int64_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+  ++thread_allocation_counts.scopes[kScope].allocations;
+  thread_allocation_counts.scopes[kScope].bytes += size;
+  allocation_counters[kScope].Add(1);
+  allocated_bytes_counters[kScope].Add(static_cast<std::int64_t>(size));
+  while (kLive > peak)
+  {
+    if (peak_live_bytes.compare_exchange_weak(peak, kLive,
+        std::memory_order_relaxed))
+    {
+      break;
+    }
+  }
+}
+
+void RecordFree(void *memory)
+{
+  ++thread_allocation_counts.frees;
+  free_counter.Add(1);
+  live_bytes.fetch_sub(static_cast<std::int64_t>(malloc_usable_size(memory)),
+      std::memory_order_relaxed);
+}
+
+bool AllocationTrackerInstalled()
+{
+  const std::uint64_t kFreesBefore = thread_allocation_counts.frees;
+  /* Volatile, the pair may otherwise be optimized away. */
+  void *volatile probe = ::operator new(1, std::nothrow);
+  if (probe == nullptr)
+  {
+    return false;
+  }
+  ::operator delete(probe);
+  return thread_allocation_counts.frees != kFreesBefore;
+}
+
+AllocationStats CollectAllocationStats()
+{
+  AllocationStats stats = {};
+  for (std::size_t i = 0; i < kAllocationScopeCount; ++i)
+  {
+    stats.scopes[i].allocations = static_cast<std::uint64_t>(
+        allocation_counters[i].Snapshot());
+    stats.scopes[i].bytes = static_cast<std::uint64_t>(
+        allocated_bytes_counters[i].Snapshot());
+  }
+  stats.frees = static_cast<std::uint64_t>(free_counter.Snapshot());
+  stats.live_bytes = live_bytes.load(std::memory_order_relaxed);
+  stats.peak_live_bytes = peak_live_bytes.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void ResetAllocationPeak()
+{
+  peak_live_bytes.store(live_bytes.load(std::memory_order_relaxed),
+      std::memory_order_relaxed);
+}
+
+const char *AllocationScopeName(AllocationScope scope)
+{
+  const std::size_t kScope = static_cast<std::size_t>(scope);
+  return kScope < kAllocationScopeCount ? kAllocationScopeNames[kScope] :
+      "unknown";
+}
+
+void PrintAllocationReport(std::FILE *file)
+{
+  const AllocationStats kStats = CollectAllocationStats();
+  if (!AllocationTrackerInstalled())
+  {
+    std::fprintf(file, "allocations: tracker not linked in\n");
+    return;
+  }
+  std::fprintf(file, "allocations: %" PRId64 " bytes live, peak %" PRId64
+      " bytes, %" PRIu64 " frees\n%-10s %14s %16s %12s\n", kStats.live_bytes,
+      kStats.peak_live_bytes, kStats.frees, "scope", "allocations", "bytes",
+      "bytes/alloc");
+  for (std::size_t i = 0; i < kAllocationScopeCount; ++i)
+  {
+    std::fprintf(file, "%-10s %14" PRIu64 " %16" PRIu64 " %12.1f\n",
+        kAllocationScopeNames[i], kStats.scopes[i].allocations,
+        kStats.scopes[i].bytes, kStats.scopes[i].allocations == 0 ? 0.0 :
+            static_cast<double>(kStats.scopes[i].bytes) /
+            static_cast<double>(kStats.scopes[i].allocations));
+  }
+}
+
+} /* namespace common */
+} /* namespace project_structure */
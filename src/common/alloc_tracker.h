@@ -0,0 +1,173 @@
+/* alloc_tracker.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Opt-in accounting of heap allocations, attributed to the
+ * module whose code made them.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_COMMON_ALLOCTRACKER_H_
+#define PROJECTSTRUCTURE_COMMON_ALLOCTRACKER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/*!
+ * @brief What an allocation is attributed to, the innermost
+ * ScopedAllocationScope of the allocating thread.
+ */
+enum class AllocationScope : std::uint8_t
+{
+  /* Outside of every tagged scope. */
+  kOther = 0,
+  kModuleA = 1,
+  kModuleB = 2,
+  /* Parsing, building and serializing protobuf messages. */
+  kProto = 3
+};
+
+/*! @brief Number of AllocationScope values. */
+constexpr std::size_t kAllocationScopeCount = 4;
+
+/*!
+ * @brief Allocations made in one scope.
+ */
+struct AllocationCounts
+{
+  std::uint64_t allocations;
+  /* Bytes requested, not counting the allocator's own overhead. */
+  std::uint64_t bytes;
+};
+
+/*!
+ * @brief Allocations of the calling thread since it started, per scope.
+ */
+struct ThreadAllocationCounts
+{
+  AllocationCounts scopes[kAllocationScopeCount];
+  std::uint64_t frees;
+};
+
+/*!
+ * @brief Allocations of every thread since the process started.
+ */
+struct AllocationStats
+{
+  AllocationCounts scopes[kAllocationScopeCount];
+  std::uint64_t frees;
+  /*
+   * Bytes allocated and not yet freed now, and the most at once since
+   * ResetAllocationPeak. Usable sizes, so a little above what was requested.
+   */
+  std::int64_t live_bytes;
+  std::int64_t peak_live_bytes;
+};
+
+/*!
+ * @brief Scope of the calling thread, set by ScopedAllocationScope.
+ */
+extern constinit thread_local AllocationScope current_allocation_scope;
+
+/*!
+ * @brief Counters of the calling thread. Only the thread itself writes and
+ * reads them, so they are plain integers.
+ */
+extern constinit thread_local ThreadAllocationCounts
+    thread_allocation_counts;
+
+/*!
+ * @brief Attributes the allocations of the calling thread to scope until
+ * destruction, then restores the enclosing scope.
+ *
+ * Costs two thread local stores, whether or not the tracker is linked in:
+ *
+ * int TempFunc(...)
+ * {
+ *   common::ScopedAllocationScope allocation_scope(
+ *       common::AllocationScope::kModuleA);
+ *   ...
+ * }
+ *
+ * The class is neither copyable nor movable.
+ */
+class ScopedAllocationScope
+{
+ public:
+  explicit ScopedAllocationScope(AllocationScope scope)
+      : previous_(current_allocation_scope)
+  {
+    current_allocation_scope = scope;
+  }
+  ScopedAllocationScope(const ScopedAllocationScope &) = delete;
+  ScopedAllocationScope &operator=(const ScopedAllocationScope &) = delete;
+
+  ~ScopedAllocationScope()
+  {
+    current_allocation_scope = previous_;
+  }
+
+ private:
+  AllocationScope previous_;
+};
+
+/*!
+ * @brief Accounts an allocation to the calling thread's scope. Called by the
+ * replaced global operator new in alloc_tracker_new.cc.
+ *
+ * @param[in] memory The allocated memory, not nullptr.
+ * @param[in] size Bytes requested.
+ */
+void RecordAllocation(void *memory, std::size_t size);
+
+/*!
+ * @brief Accounts the release of memory. Called by the replaced global
+ * operator delete in alloc_tracker_new.cc.
+ *
+ * @param[in] memory Memory from RecordAllocation, not nullptr.
+ */
+void RecordFree(void *memory);
+
+/*!
+ * @brief Returns true if the global operator new of this binary is the one
+ * in alloc_tracker_new.cc. Every counter stays 0 otherwise.
+ *
+ * The tracker is opt-in: a binary gets it by linking alloc_tracker_new.cc as
+ * an object file, not from a static library.
+ */
+bool AllocationTrackerInstalled();
+
+/*!
+ * @brief Sums the counters of every thread.
+ *
+ * May be called at any time from any thread. Allocations made concurrently
+ * may or may not be included.
+ */
+AllocationStats CollectAllocationStats();
+
+/*! @brief Starts peak_live_bytes over from the current live bytes. */
+void ResetAllocationPeak();
+
+/*! @brief Name of scope, e.g. "module_a". */
+const char *AllocationScopeName(AllocationScope scope);
+
+/*!
+ * @brief Writes CollectAllocationStats as a table, one line per scope.
+ *
+ * @param[in] file Where to write, left open.
+ */
+void PrintAllocationReport(std::FILE *file);
+
+} /* namespace common */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_COMMON_ALLOCTRACKER_H_ */
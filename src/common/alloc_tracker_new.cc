@@ -0,0 +1,220 @@
+/* alloc_tracker_new.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Replaces the global operator new and delete with ones that
+ * report to the allocation tracker. Linked only into the binaries which want
+ * the accounting, such as the tests and the microbenchmarks.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <new>
+
+#include "common/alloc_tracker.h"
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/*
+ * Allocates size bytes aligned to alignment, 0 for the default alignment of
+ * malloc. Returns nullptr on failure.
+ */
+static void *TrackedAllocate(std::size_t size, std::size_t alignment)
+{
+  void *memory = nullptr;
+  if (size == 0)
+  {
+    size = 1;
+  }
+  if (alignment == 0)
+  {
+    memory = std::malloc(size);
+  }
+  else if (size > std::numeric_limits<std::size_t>::max() - (alignment - 1))
+  {
+    /* Rounding up would wrap around to a tiny size. */
+    return nullptr;
+  }
+  else
+  {
+    /* aligned_alloc wants a multiple of the alignment. */
+    memory = std::aligned_alloc(alignment,
+        (size + alignment - 1) & ~(alignment - 1));
+  }
+  if (memory != nullptr)
+  {
+    RecordAllocation(memory, size);
+  }
+  return memory;
+}
+
+/*
+ * As TrackedAllocate, but fails like the standard operator new: calls the new
+ * handler and retries as long as there is one, then throws std::bad_alloc.
+ */
+static void *TrackedAllocateOrThrow(std::size_t size, std::size_t alignment)
+{
+  void *memory = TrackedAllocate(size, alignment);
+  std::new_handler handler = nullptr;
+  while (memory == nullptr)
+  {
+    handler = std::get_new_handler();
+    if (handler == nullptr)
+    {
+      throw std::bad_alloc();
+    }
+    handler();
+    memory = TrackedAllocate(size, alignment);
+  }
+  return memory;
+}
+
+/*
+ * The nothrow forms behave as the throwing ones, new handler included, but
+ * return nullptr where those throw.
+ */
+static void *TrackedAllocateOrNull(std::size_t size,
+    std::size_t alignment) noexcept
+{
+  try
+  {
+    return TrackedAllocateOrThrow(size, alignment);
+  }
+  catch (const std::bad_alloc &)
+  {
+    return nullptr;
+  }
+}
+
+static void TrackedFree(void *memory)
+{
+  if (memory != nullptr)
+  {
+    RecordFree(memory);
+    std::free(memory);
+  }
+}
+
+} /* namespace common */
+} /* namespace project_structure */
+
+/*
+ * Every replaceable form, so that no memory is allocated by one allocator and
+ * released by the other. The sized and aligned deletes ignore the extra
+ * arguments, free does not need them.
+ */
+void *operator new(std::size_t size)
+{
+  return project_structure::common::TrackedAllocateOrThrow(size, 0);
+}
+
+void *operator new[](std::size_t size)
+{
+  return project_structure::common::TrackedAllocateOrThrow(size, 0);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+  return project_structure::common::TrackedAllocateOrNull(size, 0);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+  return project_structure::common::TrackedAllocateOrNull(size, 0);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+  return project_structure::common::TrackedAllocateOrThrow(size,
+      static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+  return project_structure::common::TrackedAllocateOrThrow(size,
+      static_cast<std::size_t>(alignment));
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment,
+    const std::nothrow_t &) noexcept
+{
+  return project_structure::common::TrackedAllocateOrNull(size,
+      static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment,
+    const std::nothrow_t &) noexcept
+{
+  return project_structure::common::TrackedAllocateOrNull(size,
+      static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *memory) noexcept
+{
+  project_structure::common::TrackedFree(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+  project_structure::common::TrackedFree(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+  project_structure::common::TrackedFree(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+  project_structure::common::TrackedFree(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept
+{
+  project_structure::common::TrackedFree(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept
+{
+  project_structure::common::TrackedFree(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+  project_structure::common::TrackedFree(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept
+{
+  project_structure::common::TrackedFree(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept
+{
+  project_structure::common::TrackedFree(memory);
+}
+
+void operator delete[](void *memory, std::size_t, std::align_val_t) noexcept
+{
+  project_structure::common::TrackedFree(memory);
+}
+
+void operator delete(void *memory, std::align_val_t,
+    const std::nothrow_t &) noexcept
+{
+  project_structure::common::TrackedFree(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t,
+    const std::nothrow_t &) noexcept
+{
+  project_structure::common::TrackedFree(memory);
+}
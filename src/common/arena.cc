@@ -0,0 +1,244 @@
+/* arena.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Monotonic (bump pointer) arena for request scoped objects.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "common/arena.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+
+#include "common/numa.h"
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/*
+ * Bytes reserved for the Block header at the start of every block, a cache
+ * line so that the first allocation in a block is cache line aligned.
+ */
+constexpr std::size_t kBlockHeaderSize = 64;
+
+/* Rounds value up to a multiple of alignment, which is a power of two. */
+static std::size_t RoundUp(std::size_t value, std::size_t alignment)
+{
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/* Rounds pointer up to a multiple of alignment, which is a power of two. */
+static char *AlignPointer(char *pointer, std::size_t alignment)
+{
+  std::uintptr_t address = reinterpret_cast<std::uintptr_t>(pointer);
+  return pointer + (RoundUp(address, alignment) - address);
+}
+
+Arena::Arena(const ArenaOptions &options) : options_(options)
+{
+  if (options_.use_huge_pages)
+  {
+    options_.block_size = RoundUp(options_.block_size, kHugePageSize);
+  }
+  if (options_.block_size < 2 * kBlockHeaderSize)
+  {
+    options_.block_size = 2 * kBlockHeaderSize;
+  }
+}
+
+Arena::~Arena()
+{
+  Reset();
+  Block *block = first_block_;
+  Block *next = nullptr;
+  while (block != nullptr)
+  {
+    next = block->next;
+    UnmapBlock(block);
+    block = next;
+  }
+}
+
+void *Arena::Allocate(std::size_t size, std::size_t alignment)
+{
+  char *aligned = nullptr;
+  /* The block for size would not fit in a size_t, see AllocateOversized. */
+  if (size > std::numeric_limits<std::size_t>::max() - alignment -
+      kBlockHeaderSize)
+  {
+    return nullptr;
+  }
+  aligned = AlignPointer(position_, alignment);
+  if (position_ != nullptr && aligned <= end_ &&
+      size <= static_cast<std::size_t>(end_ - aligned))
+  {
+    bytes_allocated_ += static_cast<std::size_t>(aligned + size - position_);
+    position_ = aligned + size;
+    return aligned;
+  }
+
+  if (size + alignment > options_.block_size - kBlockHeaderSize)
+  {
+    return AllocateOversized(size, alignment);
+  }
+  Block *next = current_block_ == nullptr ? first_block_ : current_block_->next;
+  if (next == nullptr)
+  {
+    next = MapBlock(options_.block_size);
+    if (next == nullptr)
+    {
+      return nullptr;
+    }
+    if (current_block_ == nullptr)
+    {
+      first_block_ = next;
+    }
+    else
+    {
+      current_block_->next = next;
+    }
+  }
+  current_block_ = next;
+  position_ = reinterpret_cast<char *>(next) + kBlockHeaderSize;
+  end_ = reinterpret_cast<char *>(next) + next->size;
+  return Allocate(size, alignment);
+}
+
+void *Arena::AllocateOversized(std::size_t size, std::size_t alignment)
+{
+  Block *block = MapBlock(kBlockHeaderSize + size + alignment);
+  if (block == nullptr)
+  {
+    return nullptr;
+  }
+  block->next = oversized_blocks_;
+  oversized_blocks_ = block;
+  bytes_allocated_ += size;
+  return AlignPointer(reinterpret_cast<char *>(block) + kBlockHeaderSize,
+      alignment);
+}
+
+Arena::Block *Arena::MapBlock(std::size_t size)
+{
+  void *memory = MAP_FAILED;
+  bool huge_pages = false;
+  if (options_.use_huge_pages)
+  {
+    size = RoundUp(size, kHugePageSize);
+    memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    huge_pages = memory != MAP_FAILED;
+  }
+  if (memory == MAP_FAILED)
+  {
+    size = RoundUp(size, static_cast<std::size_t>(sysconf(_SC_PAGESIZE)));
+    memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+      return nullptr;
+    }
+    if (options_.use_huge_pages)
+    {
+      /* Only a hint, failing is fine. */
+      (void)madvise(memory, size, MADV_HUGEPAGE);
+    }
+  }
+  /* Before the header is written, which is the first touch. */
+  if (options_.numa_node >= 0 &&
+      !BindToNumaNode(memory, size, options_.numa_node))
+  {
+    ++numa_bind_failures_;
+  }
+  bytes_reserved_ += size;
+  return new (memory) Block{nullptr, size, huge_pages};
+}
+
+void Arena::UnmapBlock(Block *block)
+{
+  bytes_reserved_ -= block->size;
+  munmap(block, block->size);
+}
+
+bool Arena::RegisterDestructor(void *object, void (*destroy)(void *))
+{
+  void *memory = Allocate(sizeof(DestructorNode), alignof(DestructorNode));
+  if (memory == nullptr)
+  {
+    return false;
+  }
+  destructors_ = new (memory) DestructorNode{destroy, object, destructors_};
+  return true;
+}
+
+void Arena::RunDestructors()
+{
+  /* The list is in reverse order of creation, which is the order wanted. */
+  DestructorNode *node = destructors_;
+  while (node != nullptr)
+  {
+    node->destroy(node->object);
+    node = node->next;
+  }
+  destructors_ = nullptr;
+}
+
+void Arena::Reset()
+{
+  RunDestructors();
+  Block *block = oversized_blocks_;
+  Block *next = nullptr;
+  while (block != nullptr)
+  {
+    next = block->next;
+    UnmapBlock(block);
+    block = next;
+  }
+  oversized_blocks_ = nullptr;
+  current_block_ = nullptr;
+  position_ = nullptr;
+  end_ = nullptr;
+  bytes_allocated_ = 0;
+}
+
+std::size_t Arena::BytesAllocated() const
+{
+  return bytes_allocated_;
+}
+
+std::size_t Arena::BytesReserved() const
+{
+  return bytes_reserved_;
+}
+
+bool Arena::UsesHugePages() const
+{
+  for (const Block *block = first_block_; block != nullptr;
+      block = block->next)
+  {
+    if (block->huge_pages)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::size_t Arena::NumaBindFailures() const
+{
+  return numa_bind_failures_;
+}
+
+} /* namespace common */
+} /* namespace project_structure */
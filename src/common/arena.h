@@ -0,0 +1,258 @@
+/* arena.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Monotonic (bump pointer) arena for request scoped objects.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_COMMON_ARENA_H_
+#define PROJECTSTRUCTURE_COMMON_ARENA_H_
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/*!
+ * @brief Size of the huge pages requested when ArenaOptions::use_huge_pages
+ * is set.
+ */
+constexpr std::size_t kHugePageSize = std::size_t{2} * 1024 * 1024;
+
+/*!
+ * @brief Configuration of an Arena.
+ */
+struct ArenaOptions
+{
+  /*
+   * Size of every block mapped by the arena. Allocations larger than a block
+   * get a block of their own which is released by Arena::Reset.
+   */
+  std::size_t block_size = std::size_t{1024} * 1024;
+  /*
+   * Back the blocks with huge pages, block_size is then rounded up to a
+   * multiple of kHugePageSize. If no huge pages are available the arena falls
+   * back to normal pages and asks for transparent huge pages instead.
+   */
+  bool use_huge_pages = false;
+  /*
+   * NUMA node to place the blocks on with BindToNumaNode, -1 leaves them to
+   * first touch, i.e. on the node of the thread that first allocates from
+   * them.
+   */
+  int numa_node = -1;
+};
+
+/*!
+ * @brief Monotonic arena, allocation is a pointer bump and everything is
+ * released at once by Reset.
+ *
+ * Intended to be owned by one worker and reset at the end of every request.
+ * Blocks are mapped directly from the operating system and are kept across
+ * Reset, so once the arena has grown to the size of a typical request it
+ * performs no system calls and no global heap allocations at all.
+ *
+ * Objects with non-trivial destructors created with Create are destroyed by
+ * Reset (and the destructor), in reverse order of creation. Memory from
+ * Allocate is never destroyed, only reused.
+ *
+ * The class is neither copyable nor movable, since pointers into it are handed
+ * out. It is not thread safe.
+ */
+class Arena
+{
+ public:
+  /*!
+   * @brief Creates an empty arena, no memory is mapped until the first
+   * allocation.
+   *
+   * @param[in] options Block size and page backing.
+   */
+  explicit Arena(const ArenaOptions &options = ArenaOptions{});
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  ~Arena();
+
+  /*!
+   * @brief Allocates size bytes aligned to alignment.
+   *
+   * @param[in] size Number of bytes.
+   * @param[in] alignment Alignment of the returned memory, a power of two no
+   * larger than kHugePageSize.
+   *
+   * @return The memory, or nullptr if mapping a new block failed or size is
+   * too large to map at all.
+   */
+  void *Allocate(std::size_t size, std::size_t alignment);
+
+  /*!
+   * @brief Constructs a T inside the arena.
+   *
+   * The destructor is registered only once the constructor has returned, so
+   * Reset never destroys an object which was not constructed.
+   *
+   * @param[in] args Arguments forwarded to the constructor of T.
+   *
+   * @return The object, or nullptr if the arena is out of memory. The object
+   * lives until the next Reset.
+   */
+  template <typename T, typename... Args>
+  T *Create(Args &&...args)
+  {
+    void *memory = Allocate(sizeof(T), alignof(T));
+    T *object = nullptr;
+    if (memory == nullptr)
+    {
+      return nullptr;
+    }
+    object = new (memory) T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>)
+    {
+      if (!RegisterDestructor(object, &DestroyObject<T>))
+      {
+        object->~T();
+        return nullptr;
+      }
+    }
+    return object;
+  }
+
+  /*!
+   * @brief Allocates an array of count value initialized elements.
+   *
+   * @param[in] count Number of elements.
+   *
+   * @return The array, empty if the arena is out of memory or the size of
+   * count elements does not fit in a size_t.
+   */
+  template <typename T>
+  std::span<T> CreateArray(std::size_t count)
+  {
+    static_assert(std::is_trivially_destructible_v<T>,
+        "Arena arrays must be trivially destructible");
+    void *memory = nullptr;
+    if (count > std::numeric_limits<std::size_t>::max() / sizeof(T))
+    {
+      return std::span<T>();
+    }
+    memory = Allocate(sizeof(T) * count, alignof(T));
+    if (memory == nullptr)
+    {
+      return std::span<T>();
+    }
+    T *elements = static_cast<T *>(memory);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      new (elements + i) T();
+    }
+    return std::span<T>(elements, count);
+  }
+
+  /*!
+   * @brief Destroys every object created since the last Reset and makes all
+   * memory available again.
+   *
+   * Regular blocks are kept for reuse, blocks created for oversized
+   * allocations are unmapped.
+   */
+  void Reset();
+
+  /*! @brief Bytes handed out since the last Reset, including padding. */
+  std::size_t BytesAllocated() const;
+
+  /*! @brief Bytes currently mapped by the arena. */
+  std::size_t BytesReserved() const;
+
+  /*! @brief True if at least one block is backed by explicit huge pages. */
+  bool UsesHugePages() const;
+
+  /*!
+   * @brief Number of blocks BindToNumaNode failed for, e.g. because
+   * ArenaOptions::numa_node does not exist on this machine.
+   */
+  std::size_t NumaBindFailures() const;
+
+  /*!
+   * @brief Calls function with every mapped block, e.g. to see which NUMA
+   * node its pages are on.
+   *
+   * @param[in] function Callable taking a std::span<const std::byte>.
+   */
+  template <typename Function>
+  void ForEachBlock(const Function &function) const
+  {
+    for (const Block *block = first_block_; block != nullptr;
+        block = block->next)
+    {
+      function(std::span<const std::byte>(
+          reinterpret_cast<const std::byte *>(block), block->size));
+    }
+    for (const Block *block = oversized_blocks_; block != nullptr;
+        block = block->next)
+    {
+      function(std::span<const std::byte>(
+          reinterpret_cast<const std::byte *>(block), block->size));
+    }
+  }
+
+ private:
+  /* Header placed at the start of every mapped block. */
+  struct Block
+  {
+    Block *next;
+    std::size_t size;
+    bool huge_pages;
+  };
+
+  /* Linked list node recording an object which has to be destroyed. */
+  struct DestructorNode
+  {
+    void (*destroy)(void *);
+    void *object;
+    DestructorNode *next;
+  };
+
+  template <typename T>
+  static void DestroyObject(void *object)
+  {
+    static_cast<T *>(object)->~T();
+  }
+
+  /* Maps a block with at least size usable bytes, nullptr on failure. */
+  Block *MapBlock(std::size_t size);
+  void UnmapBlock(Block *block);
+  /* Allocates from a dedicated block, used for oversized allocations. */
+  void *AllocateOversized(std::size_t size, std::size_t alignment);
+  bool RegisterDestructor(void *object, void (*destroy)(void *));
+  void RunDestructors();
+
+  ArenaOptions options_;
+  /* Regular blocks, in the order they were mapped. */
+  Block *first_block_ = nullptr;
+  Block *current_block_ = nullptr;
+  /* Next free byte and end of the usable part of current_block_. */
+  char *position_ = nullptr;
+  char *end_ = nullptr;
+  Block *oversized_blocks_ = nullptr;
+  DestructorNode *destructors_ = nullptr;
+  std::size_t bytes_allocated_ = 0;
+  std::size_t bytes_reserved_ = 0;
+  std::size_t numa_bind_failures_ = 0;
+};
+
+} /* namespace common */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_COMMON_ARENA_H_ */
@@ -0,0 +1,109 @@
+/* crc32c.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: CRC-32C (Castagnoli) checksum used to protect stored records.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "common/crc32c.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/* Reflected CRC-32C polynomial. */
+constexpr std::uint32_t kCrc32cPolynomial = 0x82f63b78u;
+
+/* Builds the byte wise lookup table at compile time. */
+static constexpr std::array<std::uint32_t, 256> MakeCrc32cTable()
+{
+  std::array<std::uint32_t, 256> table = {};
+  std::uint32_t crc = 0;
+  for (std::uint32_t i = 0; i < 256; ++i)
+  {
+    crc = i;
+    for (int bit = 0; bit < 8; ++bit)
+    {
+      crc = (crc & 1u) != 0 ? (crc >> 1) ^ kCrc32cPolynomial : crc >> 1;
+    }
+    table[i] = crc;
+  }
+  return table;
+}
+
+constexpr std::array<std::uint32_t, 256> kCrc32cTable = MakeCrc32cTable();
+
+static std::uint32_t Crc32cSoftware(const std::byte *data, std::size_t size,
+    std::uint32_t crc)
+{
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    crc = kCrc32cTable[(crc ^ std::to_integer<std::uint32_t>(data[i])) & 0xffu]
+        ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("sse4.2")))
+static std::uint32_t Crc32cHardware(const std::byte *data, std::size_t size,
+    std::uint32_t crc)
+{
+  std::uint64_t crc64 = crc;
+  std::uint64_t word = 0;
+  std::size_t i = 0;
+  for (; i + sizeof(word) <= size; i += sizeof(word))
+  {
+    std::memcpy(&word, data + i, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  crc = static_cast<std::uint32_t>(crc64);
+  for (; i < size; ++i)
+  {
+    crc = _mm_crc32_u8(crc, std::to_integer<std::uint8_t>(data[i]));
+  }
+  return crc;
+}
+
+/* Queries the CPU, only called once to initialize kHasCrc32cInstruction. */
+static bool QueryCrc32cInstruction()
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.2");
+}
+
+/* Global so that the CPU is only queried once. */
+const bool kHasCrc32cInstruction = QueryCrc32cInstruction();
+
+#endif /* defined(__x86_64__) */
+
+std::uint32_t Crc32c(std::span<const std::byte> data, std::uint32_t crc)
+{
+  crc = ~crc;
+#if defined(__x86_64__)
+  if (kHasCrc32cInstruction)
+  {
+    return ~Crc32cHardware(data.data(), data.size(), crc);
+  }
+#endif /* defined(__x86_64__) */
+  return ~Crc32cSoftware(data.data(), data.size(), crc);
+}
+
+} /* namespace common */
+} /* namespace project_structure */
@@ -0,0 +1,41 @@
+/* crc32c.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: CRC-32C (Castagnoli) checksum used to protect stored records.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_COMMON_CRC32C_H_
+#define PROJECTSTRUCTURE_COMMON_CRC32C_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/*!
+ * @brief Computes the CRC-32C of data.
+ *
+ * Uses the SSE4.2 crc32 instruction when the executing CPU supports it and a
+ * table driven implementation otherwise, both give the same result.
+ *
+ * @param[in] data Bytes to checksum.
+ * @param[in] crc Result of a previous call when checksumming data in pieces,
+ * 0 for the first piece.
+ *
+ * @return The checksum of all pieces so far.
+ */
+std::uint32_t Crc32c(std::span<const std::byte> data, std::uint32_t crc = 0);
+
+} /* namespace common */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_COMMON_CRC32C_H_ */
@@ -0,0 +1,161 @@
+/* function_memo.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Switchable memoization of a pure function in a MemoCache,
+ * shared by the TempFunc of every module.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_COMMON_FUNCTIONMEMO_H_
+#define PROJECTSTRUCTURE_COMMON_FUNCTIONMEMO_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+#include "common/memo_cache.h"
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/*!
+ * @brief The inputs which fully determine the result of TempFunc, in every
+ * module.
+ */
+struct TempFuncKey
+{
+  std::uint32_t some_other_input;
+  std::uint32_t some_input;
+  /* Value of *some_input_output on entry. */
+  std::uint32_t state;
+};
+
+/*!
+ * @brief Hash of a TempFuncKey, for MemoCache.
+ */
+struct TempFuncKeyHash
+{
+  std::uint64_t operator()(const TempFuncKey &key) const
+  {
+    return ((std::uint64_t{key.some_other_input} << 32) | key.some_input) ^
+        (std::uint64_t{key.state} * 0x9e3779b97f4a7c15u);
+  }
+};
+
+/*!
+ * @brief Memoization of one pure function which can be turned on and off at
+ * runtime.
+ *
+ * While on, the function first looks its inputs up with Lookup and only
+ * computes and Stores the result on a miss. The first Enable creates the
+ * cache, later calls only turn it back on and ignore their options. The cache
+ * is never freed, not even by the destructor, since the function may still be
+ * using it on other threads when memoization is turned off or the program
+ * exits.
+ *
+ * Constant initialized, so it may be a global used during dynamic
+ * initialization. The class is neither copyable nor movable, all members are
+ * thread safe.
+ *
+ * @tparam Key Inputs of the function, see MemoCache.
+ * @tparam Value Result of the function, see MemoCache.
+ * @tparam Hash Hash of a Key, see MemoCache.
+ */
+template <typename Key, typename Value, typename Hash>
+class FunctionMemo
+{
+ public:
+  constexpr FunctionMemo() = default;
+  FunctionMemo(const FunctionMemo &) = delete;
+  FunctionMemo &operator=(const FunctionMemo &) = delete;
+
+  ~FunctionMemo() = default;
+
+  /*!
+   * @brief Turns memoization on, creating the cache on the first call.
+   *
+   * @param[in] options Capacity and shard count of the cache.
+   */
+  void Enable(const MemoCacheOptions &options = MemoCacheOptions{})
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cache_.load(std::memory_order_relaxed) == nullptr)
+    {
+      cache_.store(new (std::nothrow) MemoCache<Key, Value, Hash>(options),
+          std::memory_order_release);
+    }
+    enabled_.store(true, std::memory_order_release);
+  }
+
+  /*!
+   * @brief Turns memoization off, the cached results are kept for when it is
+   * turned on again.
+   */
+  void Disable()
+  {
+    enabled_.store(false, std::memory_order_release);
+  }
+
+  /*!
+   * @brief Hit, miss, insertion and eviction counts of the cache, all zero if
+   * memoization has never been enabled.
+   */
+  MemoCacheStats Stats() const
+  {
+    MemoCache<Key, Value, Hash> *cache = cache_.load(
+        std::memory_order_acquire);
+    return cache == nullptr ? MemoCacheStats{0, 0, 0, 0} : cache->Stats();
+  }
+
+  /*!
+   * @brief Looks up the result of the function for key.
+   *
+   * @param[in] key The inputs.
+   * @param[out] value Set to the memoized result on a hit.
+   *
+   * @return true on a hit, false on a miss or if memoization is off.
+   */
+  bool Lookup(const Key &key, Value &value) const
+  {
+    MemoCache<Key, Value, Hash> *cache = nullptr;
+    if (!enabled_.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+    cache = cache_.load(std::memory_order_acquire);
+    return cache != nullptr && cache->Lookup(key, value);
+  }
+
+  /*! @brief Records the result of the function for key if memoization is on. */
+  void Store(const Key &key, const Value &value)
+  {
+    MemoCache<Key, Value, Hash> *cache = nullptr;
+    if (!enabled_.load(std::memory_order_acquire))
+    {
+      return;
+    }
+    cache = cache_.load(std::memory_order_acquire);
+    if (cache != nullptr)
+    {
+      cache->Insert(key, value);
+    }
+  }
+
+ private:
+  std::atomic<MemoCache<Key, Value, Hash> *> cache_{nullptr};
+  std::atomic<bool> enabled_{false};
+  /* Serializes the creation of cache_. */
+  std::mutex mutex_;
+};
+
+} /* namespace common */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_COMMON_FUNCTIONMEMO_H_ */
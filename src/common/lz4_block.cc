@@ -0,0 +1,296 @@
+/* lz4_block.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Compression in the LZ4 block format, fast enough to trade a
+ * little CPU for much less I/O when storing message streams.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "common/lz4_block.h"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/* Shortest match the format can express. */
+constexpr std::size_t kMinMatch = 4;
+
+/* The last bytes of a block are literals. */
+constexpr std::size_t kLastLiterals = 5;
+
+/* No match may start in the last bytes of a block. */
+constexpr std::size_t kMatchStartLimit = 12;
+
+/* Largest distance a match can point back. */
+constexpr std::size_t kMaxOffset = 65535;
+
+/* Bits of the hash, the table has 2^kHashBits entries. */
+constexpr int kHashBits = 12;
+
+/*
+ * The step of the search grows by one for every 2^kSkipShift bytes without a
+ * match, so data which does not compress is passed over quickly.
+ */
+constexpr int kSkipShift = 6;
+
+/* Largest input Lz4Compress accepts, positions are kept in 32 bits. */
+constexpr std::size_t kMaxInputSize = std::size_t{1} << 31;
+
+static std::uint32_t Load32(const std::byte *input)
+{
+  std::uint32_t value = 0;
+  std::memcpy(&value, input, sizeof(value));
+  return value;
+}
+
+static std::uint64_t Load64(const std::byte *input)
+{
+  std::uint64_t value = 0;
+  std::memcpy(&value, input, sizeof(value));
+  return value;
+}
+
+static std::uint32_t HashSequence(std::uint32_t sequence)
+{
+  return (sequence * 2654435761u) >> (32 - kHashBits);
+}
+
+/* Number of equal bytes at the start of two words which differ. */
+static std::size_t EqualBytes(std::uint64_t difference)
+{
+  if constexpr (std::endian::native == std::endian::little)
+  {
+    return static_cast<std::size_t>(std::countr_zero(difference)) / 8;
+  }
+  else
+  {
+    return static_cast<std::size_t>(std::countl_zero(difference)) / 8;
+  }
+}
+
+/* Writes the bytes continuing a length field of 15 for length. */
+static std::byte *WriteLengthExtension(std::size_t length, std::byte *output)
+{
+  length -= 15;
+  while (length >= 255)
+  {
+    *output++ = std::byte{255};
+    length -= 255;
+  }
+  *output++ = static_cast<std::byte>(length);
+  return output;
+}
+
+/*
+ * Writes a sequence of literal_length literals followed by a match, or by
+ * nothing if match_length is 0. Returns the end of the sequence.
+ */
+static std::byte *WriteSequence(const std::byte *literals,
+    std::size_t literal_length, std::size_t offset, std::size_t match_length,
+    std::byte *output)
+{
+  std::byte *token = output++;
+  std::size_t match_code = match_length == 0 ? 0 : match_length - kMinMatch;
+  *token = static_cast<std::byte>(
+      (literal_length < 15 ? literal_length : 15) << 4);
+  if (literal_length >= 15)
+  {
+    output = WriteLengthExtension(literal_length, output);
+  }
+  if (literal_length != 0)
+  {
+    std::memcpy(output, literals, literal_length);
+    output += literal_length;
+  }
+  if (match_length == 0)
+  {
+    return output;
+  }
+  *output++ = static_cast<std::byte>(offset & 0xffu);
+  *output++ = static_cast<std::byte>(offset >> 8);
+  *token |= static_cast<std::byte>(match_code < 15 ? match_code : 15);
+  if (match_code >= 15)
+  {
+    output = WriteLengthExtension(match_code, output);
+  }
+  return output;
+}
+
+/*
+ * Adds the bytes continuing a length field of 15 to length. Returns false if
+ * the block ends first.
+ */
+static bool ReadLengthExtension(const std::byte *&input,
+    const std::byte *input_end, std::size_t &length)
+{
+  std::size_t byte = 255;
+  while (byte == 255)
+  {
+    if (input == input_end)
+    {
+      return false;
+    }
+    byte = std::to_integer<std::size_t>(*input++);
+    length += byte;
+  }
+  return true;
+}
+
+std::size_t Lz4Compress(std::span<const std::byte> input,
+    std::span<std::byte> output)
+{
+  const std::byte *in = input.data();
+  const std::size_t kSize = input.size();
+  std::byte *out = output.data();
+  std::uint32_t table[std::size_t{1} << kHashBits] = {};
+  std::size_t position = 0;
+  std::size_t anchor = 0;
+  std::size_t candidate = 0;
+  std::size_t match_length = 0;
+  std::uint32_t sequence = 0;
+  std::uint32_t hash = 0;
+  std::uint64_t difference = 0;
+  if (output.size() < Lz4CompressBound(kSize) || kSize > kMaxInputSize)
+  {
+    return 0;
+  }
+  /* Shorter blocks can not hold a match, they are all literals. */
+  while (kSize > kMatchStartLimit && position <= kSize - kMatchStartLimit)
+  {
+    sequence = Load32(in + position);
+    hash = HashSequence(sequence);
+    candidate = table[hash];
+    table[hash] = static_cast<std::uint32_t>(position);
+    if (candidate >= position || position - candidate > kMaxOffset ||
+        Load32(in + candidate) != sequence)
+    {
+      position += 1 + ((position - anchor) >> kSkipShift);
+      continue;
+    }
+    /* The match may start before the sequence which found it. */
+    while (position > anchor && candidate > 0 &&
+        in[position - 1] == in[candidate - 1])
+    {
+      --position;
+      --candidate;
+    }
+    match_length = kMinMatch;
+    while (position + match_length + 8 <= kSize - kLastLiterals)
+    {
+      difference = Load64(in + position + match_length) ^
+          Load64(in + candidate + match_length);
+      if (difference != 0)
+      {
+        match_length += EqualBytes(difference);
+        break;
+      }
+      match_length += 8;
+    }
+    if (difference == 0)
+    {
+      while (position + match_length < kSize - kLastLiterals &&
+          in[position + match_length] == in[candidate + match_length])
+      {
+        ++match_length;
+      }
+    }
+    difference = 0;
+    out = WriteSequence(in + anchor, position - anchor, position - candidate,
+        match_length, out);
+    position += match_length;
+    anchor = position;
+    /* Makes the end of this match findable by the next one. */
+    table[HashSequence(Load32(in + position - 2))] =
+        static_cast<std::uint32_t>(position - 2);
+  }
+  out = WriteSequence(in + anchor, kSize - anchor, 0, 0, out);
+  return static_cast<std::size_t>(out - output.data());
+}
+
+bool Lz4Decompress(std::span<const std::byte> input,
+    std::span<std::byte> output)
+{
+  const std::byte *in = input.data();
+  const std::byte *in_end = in + input.size();
+  std::byte *out = output.data();
+  std::byte *out_end = out + output.size();
+  const std::byte *match = nullptr;
+  std::size_t token = 0;
+  std::size_t length = 0;
+  std::size_t offset = 0;
+  while (in != in_end)
+  {
+    token = std::to_integer<std::size_t>(*in++);
+    length = token >> 4;
+    if (length == 15 && !ReadLengthExtension(in, in_end, length))
+    {
+      return false;
+    }
+    if (length > static_cast<std::size_t>(in_end - in) ||
+        length > static_cast<std::size_t>(out_end - out))
+    {
+      return false;
+    }
+    if (length != 0)
+    {
+      std::memcpy(out, in, length);
+      in += length;
+      out += length;
+    }
+    /* Only the last sequence ends after its literals. */
+    if (in == in_end)
+    {
+      return out == out_end;
+    }
+    if (in_end - in < 2)
+    {
+      return false;
+    }
+    offset = std::to_integer<std::size_t>(in[0]) |
+        std::to_integer<std::size_t>(in[1]) << 8;
+    in += 2;
+    if (offset == 0 || offset > static_cast<std::size_t>(out - output.data()))
+    {
+      return false;
+    }
+    length = token & 15;
+    if (length == 15 && !ReadLengthExtension(in, in_end, length))
+    {
+      return false;
+    }
+    length += kMinMatch;
+    if (length > static_cast<std::size_t>(out_end - out))
+    {
+      return false;
+    }
+    match = out - offset;
+    if (offset >= length)
+    {
+      std::memcpy(out, match, length);
+      out += length;
+      continue;
+    }
+    /* The match overlaps what it writes, a repeating pattern. */
+    for (std::size_t i = 0; i < length; ++i)
+    {
+      out[i] = match[i];
+    }
+    out += length;
+  }
+  /* Empty, or ends with a match instead of literals. */
+  return false;
+}
+
+} /* namespace common */
+} /* namespace project_structure */
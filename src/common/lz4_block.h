@@ -0,0 +1,79 @@
+/* lz4_block.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Compression in the LZ4 block format, fast enough to trade a
+ * little CPU for much less I/O when storing message streams.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_COMMON_LZ4BLOCK_H_
+#define PROJECTSTRUCTURE_COMMON_LZ4BLOCK_H_
+
+#include <cstddef>
+#include <span>
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/*
+ * The block format is the one of the reference LZ4 implementation, see
+ * lz4_Block_format.md in the LZ4 sources, so blocks can be decoded by it
+ * too. A block is a series of sequences:
+ *
+ * token (1 byte, literal length << 4 | match length - 4) | literal length
+ * extension | literals | match offset (2 bytes) | match length extension
+ *
+ * A length field of 15 continues in bytes which are added to it, as long as
+ * they are 255. The last sequence has literals only, and the last 5 bytes of
+ * a block are always literals.
+ */
+
+/*!
+ * @brief Largest compressed size of size bytes, what Lz4Compress needs as
+ * output.
+ */
+constexpr std::size_t Lz4CompressBound(std::size_t size)
+{
+  return size + size / 255 + 16;
+}
+
+/*!
+ * @brief Compresses input into a single block.
+ *
+ * Greedy matching over a hash table of 4 byte sequences, like the default
+ * level of the reference implementation. Does not allocate.
+ *
+ * @param[in] input Bytes to compress, at most 2^31 bytes.
+ * @param[out] output Receives the block, must hold
+ * Lz4CompressBound(input.size()) bytes.
+ *
+ * @return Size of the block, 0 if output is too small.
+ */
+std::size_t Lz4Compress(std::span<const std::byte> input,
+    std::span<std::byte> output);
+
+/*!
+ * @brief Decompresses a block made by Lz4Compress or any LZ4 encoder.
+ *
+ * Every length and offset is checked, a damaged block fails instead of
+ * reading or writing out of bounds. Does not allocate.
+ *
+ * @param[in] input The block.
+ * @param[out] output Receives the bytes, must be exactly as long as the
+ * uncompressed block.
+ *
+ * @return false if the block is damaged or does not fill output exactly.
+ */
+bool Lz4Decompress(std::span<const std::byte> input,
+    std::span<std::byte> output);
+
+} /* namespace common */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_COMMON_LZ4BLOCK_H_ */
@@ -0,0 +1,393 @@
+/* mapped_store.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Versioned fixed layout store file which is memory mapped and
+ * used in place, without deserializing it.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "common/mapped_store.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+
+namespace project_structure
+{
+namespace common
+{
+
+static_assert(std::endian::native == std::endian::little,
+    "The store format is little endian and used in place");
+
+/* Largest file Create makes, far beyond any sensible store. */
+constexpr std::uint64_t kMaxStoreSize = std::uint64_t{1} << 46;
+
+constexpr char kStoreMagic[8] = {'P', 'S', 'S', 'T', 'O', 'R', 'E', '\0'};
+
+/* On disk header, see mapped_store.h. */
+struct StoreHeader
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t section_count;
+  std::uint64_t schema_hash;
+  std::uint64_t file_size;
+  std::byte reserved[32];
+};
+
+/* On disk section descriptor, see mapped_store.h. */
+struct StoreSectionHeader
+{
+  std::uint32_t id;
+  std::uint32_t record_size;
+  std::uint64_t capacity;
+  std::uint64_t offset;
+  std::uint64_t count;
+  std::byte reserved[32];
+};
+
+static_assert(sizeof(StoreHeader) == kStoreAlignment &&
+    sizeof(StoreSectionHeader) == kStoreAlignment,
+    "The store header and descriptors must fill one alignment unit each");
+
+static std::uint64_t AlignUp(std::uint64_t value)
+{
+  return (value + kStoreAlignment - 1) & ~std::uint64_t{kStoreAlignment - 1};
+}
+
+/* Loads or stores a committed count in the mapping. */
+static std::uint64_t LoadCount(std::uint64_t *count)
+{
+  return std::atomic_ref<std::uint64_t>(*count).load(
+      std::memory_order_acquire);
+}
+
+static void StoreCount(std::uint64_t *count, std::uint64_t value)
+{
+  std::atomic_ref<std::uint64_t>(*count).store(value,
+      std::memory_order_release);
+}
+
+MappedStore::~MappedStore()
+{
+  Close();
+}
+
+StoreStatus MappedStore::Create(const char *path, std::uint64_t schema_hash,
+    std::span<const StoreSectionSpec> sections,
+    const MappedStoreOptions &options)
+{
+  StoreHeader header = {};
+  StoreSectionHeader descriptor = {};
+  std::uint64_t offset = AlignUp(sizeof(StoreHeader) +
+      sections.size() * sizeof(StoreSectionHeader));
+  StoreStatus status = StoreStatus::kOk;
+  Close();
+  if (sections.size() > kMaxStoreSections)
+  {
+    return StoreStatus::kInvalidArgument;
+  }
+  for (std::size_t i = 0; i < sections.size(); ++i)
+  {
+    for (std::size_t j = 0; j < i; ++j)
+    {
+      if (sections[j].id == sections[i].id)
+      {
+        return StoreStatus::kInvalidArgument;
+      }
+    }
+    if (sections[i].record_size == 0 || offset > kMaxStoreSize ||
+        sections[i].capacity > (kMaxStoreSize - offset) /
+            sections[i].record_size)
+    {
+      return StoreStatus::kInvalidArgument;
+    }
+    offset = AlignUp(offset + sections[i].capacity * sections[i].record_size);
+  }
+
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+  {
+    return StoreStatus::kIoError;
+  }
+  /* The file stays sparse until records are written. */
+  if (ftruncate(fd, static_cast<off_t>(offset)) != 0)
+  {
+    close(fd);
+    return StoreStatus::kIoError;
+  }
+  header.version = kStoreVersion;
+  header.section_count = static_cast<std::uint32_t>(sections.size());
+  header.schema_hash = schema_hash;
+  header.file_size = offset;
+  offset = AlignUp(sizeof(StoreHeader) +
+      sections.size() * sizeof(StoreSectionHeader));
+  status = MapFile(fd, static_cast<std::size_t>(header.file_size), true);
+  close(fd);
+  if (status != StoreStatus::kOk)
+  {
+    return status;
+  }
+  std::memcpy(mapping_, &header, sizeof(header));
+  for (std::size_t i = 0; i < sections.size(); ++i)
+  {
+    descriptor.id = sections[i].id;
+    descriptor.record_size = sections[i].record_size;
+    descriptor.capacity = sections[i].capacity;
+    descriptor.offset = offset;
+    std::memcpy(mapping_ + sizeof(StoreHeader) + i * sizeof(descriptor),
+        &descriptor, sizeof(descriptor));
+    offset = AlignUp(offset + sections[i].capacity * sections[i].record_size);
+  }
+  /* Everything else is in place, the magic makes the file valid. */
+  if (msync(mapping_, kStoreAlignment * (1 + sections.size()), MS_SYNC) != 0)
+  {
+    Close();
+    return StoreStatus::kIoError;
+  }
+  std::memcpy(mapping_, kStoreMagic, sizeof(kStoreMagic));
+  msync_policy_ = options.msync_policy;
+  return ReadDescriptors();
+}
+
+StoreStatus MappedStore::Open(const char *path, std::uint64_t schema_hash,
+    const MappedStoreOptions &options)
+{
+  struct stat file_stat = {};
+  StoreHeader header = {};
+  StoreStatus status = StoreStatus::kOk;
+  Close();
+  int fd = open(path, (options.writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return StoreStatus::kIoError;
+  }
+  if (fstat(fd, &file_stat) != 0)
+  {
+    close(fd);
+    return StoreStatus::kIoError;
+  }
+  if (static_cast<std::uint64_t>(file_stat.st_size) < sizeof(StoreHeader))
+  {
+    close(fd);
+    return StoreStatus::kCorrupt;
+  }
+  status = MapFile(fd, static_cast<std::size_t>(file_stat.st_size),
+      options.writable);
+  close(fd);
+  if (status != StoreStatus::kOk)
+  {
+    return status;
+  }
+  std::memcpy(&header, mapping_, sizeof(header));
+  if (std::memcmp(header.magic, kStoreMagic, sizeof(kStoreMagic)) != 0)
+  {
+    status = StoreStatus::kCorrupt;
+  }
+  else if (header.version != kStoreVersion)
+  {
+    status = StoreStatus::kVersionMismatch;
+  }
+  else if (header.schema_hash != schema_hash)
+  {
+    status = StoreStatus::kSchemaMismatch;
+  }
+  else
+  {
+    msync_policy_ = options.msync_policy;
+    status = ReadDescriptors();
+  }
+  if (status != StoreStatus::kOk)
+  {
+    Close();
+  }
+  return status;
+}
+
+StoreStatus MappedStore::MapFile(int fd, std::size_t size, bool writable)
+{
+  void *mapping = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE :
+      PROT_READ, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED)
+  {
+    return StoreStatus::kIoError;
+  }
+  mapping_ = static_cast<std::byte *>(mapping);
+  mapping_size_ = size;
+  writable_ = writable;
+  return StoreStatus::kOk;
+}
+
+StoreStatus MappedStore::ReadDescriptors()
+{
+  StoreHeader header = {};
+  StoreSectionHeader descriptor = {};
+  std::uint64_t table_end = 0;
+  std::memcpy(&header, mapping_, sizeof(header));
+  table_end = sizeof(StoreHeader) +
+      std::uint64_t{header.section_count} * sizeof(StoreSectionHeader);
+  if (header.file_size != mapping_size_ ||
+      header.section_count > kMaxStoreSections || table_end > mapping_size_)
+  {
+    return StoreStatus::kCorrupt;
+  }
+  section_count_ = 0;
+  for (std::uint32_t i = 0; i < header.section_count; ++i)
+  {
+    std::memcpy(&descriptor, mapping_ + sizeof(StoreHeader) +
+        i * sizeof(descriptor), sizeof(descriptor));
+    if (descriptor.record_size == 0 || descriptor.offset < table_end ||
+        descriptor.offset % kStoreAlignment != 0 ||
+        descriptor.offset > mapping_size_ || descriptor.capacity >
+            (mapping_size_ - descriptor.offset) / descriptor.record_size ||
+        descriptor.count > descriptor.capacity ||
+        FindSection(descriptor.id) != nullptr)
+    {
+      section_count_ = 0;
+      return StoreStatus::kCorrupt;
+    }
+    sections_[section_count_++] = Section{descriptor.id,
+        descriptor.record_size, descriptor.capacity,
+        mapping_ + descriptor.offset, static_cast<std::uint64_t *>(
+            static_cast<void *>(mapping_ + sizeof(StoreHeader) +
+                i * sizeof(descriptor) + offsetof(StoreSectionHeader,
+                    count)))};
+  }
+  return StoreStatus::kOk;
+}
+
+void MappedStore::Close()
+{
+  if (mapping_ != nullptr)
+  {
+    if (writable_ && msync_policy_ != MsyncPolicy::kNone)
+    {
+      (void)msync(mapping_, mapping_size_, MS_SYNC);
+    }
+    munmap(mapping_, mapping_size_);
+  }
+  mapping_ = nullptr;
+  mapping_size_ = 0;
+  writable_ = false;
+  section_count_ = 0;
+}
+
+bool MappedStore::IsOpen() const
+{
+  return mapping_ != nullptr;
+}
+
+const MappedStore::Section *MappedStore::FindSection(
+    std::uint32_t section_id) const
+{
+  for (std::size_t i = 0; i < section_count_; ++i)
+  {
+    if (sections_[i].id == section_id)
+    {
+      return &sections_[i];
+    }
+  }
+  return nullptr;
+}
+
+std::span<const std::byte> MappedStore::Records(
+    std::uint32_t section_id) const
+{
+  const Section *section = FindSection(section_id);
+  if (section == nullptr)
+  {
+    return std::span<const std::byte>();
+  }
+  return std::span<const std::byte>(section->records,
+      LoadCount(section->count) * section->record_size);
+}
+
+std::size_t MappedStore::RecordSize(std::uint32_t section_id) const
+{
+  const Section *section = FindSection(section_id);
+  return section == nullptr ? 0 : section->record_size;
+}
+
+StoreStatus MappedStore::Append(std::uint32_t section_id,
+    std::span<const std::byte> records)
+{
+  const Section *section = FindSection(section_id);
+  std::uint64_t count = 0;
+  std::uint64_t added = 0;
+  std::byte *destination = nullptr;
+  StoreStatus status = StoreStatus::kOk;
+  if (!writable_ || section == nullptr ||
+      records.size() % section->record_size != 0)
+  {
+    return StoreStatus::kInvalidArgument;
+  }
+  /* Only this thread raises the count, a relaxed view of it is current. */
+  count = std::atomic_ref<std::uint64_t>(*section->count).load(
+      std::memory_order_relaxed);
+  added = records.size() / section->record_size;
+  if (added > section->capacity - count)
+  {
+    return StoreStatus::kFull;
+  }
+  destination = section->records + count * section->record_size;
+  std::memcpy(destination, records.data(), records.size());
+  /* The records must be on disk before a count which covers them. */
+  if (msync_policy_ == MsyncPolicy::kEveryAppend)
+  {
+    status = Sync(destination, records.size());
+  }
+  if (status != StoreStatus::kOk)
+  {
+    return status;
+  }
+  StoreCount(section->count, count + added);
+  if (msync_policy_ == MsyncPolicy::kEveryAppend)
+  {
+    status = Sync(static_cast<const std::byte *>(
+        static_cast<const void *>(section->count)), sizeof(std::uint64_t));
+  }
+  return status;
+}
+
+StoreStatus MappedStore::Flush()
+{
+  if (!writable_)
+  {
+    return StoreStatus::kInvalidArgument;
+  }
+  return Sync(mapping_, mapping_size_);
+}
+
+StoreStatus MappedStore::Sync(const std::byte *data, std::size_t size)
+{
+  const std::size_t kPageSize = static_cast<std::size_t>(
+      sysconf(_SC_PAGESIZE));
+  std::size_t begin = static_cast<std::size_t>(data - mapping_) /
+      kPageSize * kPageSize;
+  std::size_t end = static_cast<std::size_t>(data - mapping_) + size;
+  if (size == 0)
+  {
+    return StoreStatus::kOk;
+  }
+  if (msync(mapping_ + begin, end - begin, MS_SYNC) != 0)
+  {
+    return StoreStatus::kIoError;
+  }
+  return StoreStatus::kOk;
+}
+
+} /* namespace common */
+} /* namespace project_structure */
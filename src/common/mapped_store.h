@@ -0,0 +1,303 @@
+/* mapped_store.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Versioned fixed layout store file which is memory mapped and
+ * used in place, without deserializing it.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_COMMON_MAPPEDSTORE_H_
+#define PROJECTSTRUCTURE_COMMON_MAPPEDSTORE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/*
+ * File layout, all integers in native (little endian) byte order since the
+ * file is used in place:
+ *
+ * header:   "PSSTORE" NUL | version (4 bytes) | section count (4 bytes) |
+ *           schema hash (8 bytes) | file size (8 bytes) | 32 reserved bytes
+ * sections: one 64 byte descriptor per section, id (4 bytes) | record size
+ *           (4 bytes) | capacity (8 bytes) | offset (8 bytes) | committed
+ *           record count (8 bytes) | 32 reserved bytes
+ * records:  the records of every section, each section starting at a
+ *           multiple of kStoreAlignment and holding capacity records
+ *
+ * The whole file is allocated when it is created, appending only fills in
+ * records and raises the committed count.
+ */
+
+/*! @brief Current version of the store format. */
+constexpr std::uint32_t kStoreVersion = 1;
+
+/*! @brief Alignment, in bytes, of the header, descriptors and sections. */
+constexpr std::size_t kStoreAlignment = 64;
+
+/*! @brief Maximum number of sections in one store. */
+constexpr std::size_t kMaxStoreSections = 8;
+
+/*!
+ * @brief Outcome of a store operation.
+ */
+enum class StoreStatus
+{
+  kOk = 0,
+  /* A system call failed, errno tells why. */
+  kIoError = 1,
+  /* Bad magic, inconsistent descriptors or a truncated file. */
+  kCorrupt = 2,
+  /* The file was written by another version of the format. */
+  kVersionMismatch = 3,
+  /* The file was written for other record layouts. */
+  kSchemaMismatch = 4,
+  /* The section has no room left. */
+  kFull = 5,
+  /* Unknown section, wrong record size or a store not open for writing. */
+  kInvalidArgument = 6
+};
+
+/*!
+ * @brief When a writable store forces its changes to disk with msync.
+ *
+ * Without msync the changes still reach the page cache, so they survive a
+ * crash of the process but not of the machine.
+ */
+enum class MsyncPolicy
+{
+  /* Only on explicit Flush calls. */
+  kNone = 0,
+  /* On Flush and when the store is closed. */
+  kOnClose = 1,
+  /* Before every Append returns, the slowest and most durable choice. */
+  kEveryAppend = 2
+};
+
+/*!
+ * @brief Configuration of a MappedStore.
+ */
+struct MappedStoreOptions
+{
+  /* Map the file writable so that Append can be used. */
+  bool writable = false;
+  MsyncPolicy msync_policy = MsyncPolicy::kOnClose;
+};
+
+/*!
+ * @brief Describes one section of a store about to be created.
+ */
+struct StoreSectionSpec
+{
+  /* Any value, unique within the store. */
+  std::uint32_t id;
+  /* Size of one record in bytes, not 0. */
+  std::uint32_t record_size;
+  /* Number of records the section can hold. */
+  std::uint64_t capacity;
+};
+
+/*!
+ * @brief FNV-1a hash of a description of the record layouts in a store.
+ *
+ * Every user of a store keeps a description of its records, for example
+ * "SomeStruct{int32 struct_var}", and passes its hash when creating and
+ * opening. A file written for other layouts is rejected on open instead of
+ * being misread.
+ */
+constexpr std::uint64_t StoreSchemaHash(std::string_view description)
+{
+  std::uint64_t hash = 0xcbf29ce484222325u;
+  for (char character : description)
+  {
+    hash ^= static_cast<std::uint8_t>(character);
+    hash *= 0x100000001b3u;
+  }
+  return hash;
+}
+
+/*!
+ * @brief A store file mapped into memory.
+ *
+ * Opening costs a few system calls no matter how large the file is, records
+ * are paged in by the kernel when they are first touched and are read where
+ * they lie. Records are only ever appended, an append first writes the
+ * records and then publishes them by raising the committed count, so readers
+ * never see partly written records, also not readers in other processes
+ * which map the same file.
+ *
+ * Any number of threads may read concurrently with one appending thread. The
+ * class is neither copyable nor movable.
+ */
+class MappedStore
+{
+ public:
+  MappedStore() = default;
+  MappedStore(const MappedStore &) = delete;
+  MappedStore &operator=(const MappedStore &) = delete;
+
+  /*! @brief Closes the store, see Close. */
+  ~MappedStore();
+
+  /*!
+   * @brief Creates (or truncates) the file at path with empty sections and
+   * maps it writable.
+   *
+   * The magic is written last, so a file from an interrupted Create is
+   * rejected as corrupt when opened.
+   *
+   * @param[in] path Path of the file, may not be null.
+   * @param[in] schema_hash StoreSchemaHash of the record layouts.
+   * @param[in] sections The sections, at most kMaxStoreSections.
+   * @param[in] options options.writable is ignored, the store is writable.
+   *
+   * @return kOk, kInvalidArgument for bad sections or kIoError.
+   */
+  StoreStatus Create(const char *path, std::uint64_t schema_hash,
+      std::span<const StoreSectionSpec> sections,
+      const MappedStoreOptions &options = MappedStoreOptions{});
+
+  /*!
+   * @brief Maps the existing file at path and validates its header.
+   *
+   * @param[in] path Path of the file, may not be null.
+   * @param[in] schema_hash StoreSchemaHash the file must have been created
+   * with.
+   * @param[in] options Whether to map writable, and the msync policy.
+   *
+   * @return kOk, or the reason the file can not be used.
+   */
+  StoreStatus Open(const char *path, std::uint64_t schema_hash,
+      const MappedStoreOptions &options = MappedStoreOptions{});
+
+  /*!
+   * @brief Unmaps the store, syncing it first if the policy says so.
+   *
+   * Spans returned by Records become invalid.
+   */
+  void Close();
+
+  /*! @brief True between a successful Create or Open and Close. */
+  bool IsOpen() const;
+
+  /*!
+   * @brief Returns the committed records of a section as raw bytes.
+   *
+   * @param[in] section_id The section.
+   *
+   * @return The records, empty if there is no such section.
+   */
+  std::span<const std::byte> Records(std::uint32_t section_id) const;
+
+  /*!
+   * @brief Returns the committed records of a section as Record objects,
+   * pointing directly into the mapping.
+   *
+   * @tparam Record Trivially copyable type whose size is the section's record
+   * size.
+   *
+   * @return The records, empty if there is no such section or its record size
+   * differs from sizeof(Record).
+   */
+  template <typename Record>
+  std::span<const Record> RecordsAs(std::uint32_t section_id) const
+  {
+    static_assert(std::is_trivially_copyable_v<Record> &&
+        alignof(Record) <= kStoreAlignment,
+        "Record can not be used in place");
+    std::span<const std::byte> records = Records(section_id);
+    if (RecordSize(section_id) != sizeof(Record))
+    {
+      return std::span<const Record>();
+    }
+    /* The section is suitably aligned and only ever holds Record objects. */
+    return std::span<const Record>(static_cast<const Record *>(
+        static_cast<const void *>(records.data())),
+        records.size() / sizeof(Record));
+  }
+
+  /*!
+   * @brief Returns the record size of a section, 0 if there is no such
+   * section.
+   */
+  std::size_t RecordSize(std::uint32_t section_id) const;
+
+  /*!
+   * @brief Appends records to a section.
+   *
+   * Either every record is appended or none.
+   *
+   * @param[in] section_id The section.
+   * @param[in] records One or more records, back to back.
+   *
+   * @return kOk, kFull if they do not fit, kInvalidArgument if the store is
+   * not writable, the section does not exist or the size of records is not a
+   * multiple of the record size, or kIoError if msync failed.
+   */
+  StoreStatus Append(std::uint32_t section_id,
+      std::span<const std::byte> records);
+
+  /*!
+   * @brief Typed version of Append.
+   */
+  template <typename Record>
+  StoreStatus AppendRecords(std::uint32_t section_id,
+      std::span<const Record> records)
+  {
+    static_assert(std::is_trivially_copyable_v<Record>,
+        "Record can not be stored");
+    if (RecordSize(section_id) != sizeof(Record))
+    {
+      return StoreStatus::kInvalidArgument;
+    }
+    return Append(section_id, std::as_bytes(records));
+  }
+
+  /*!
+   * @brief Forces every change to disk with msync.
+   *
+   * @return kOk, kInvalidArgument if the store is not writable, or kIoError.
+   */
+  StoreStatus Flush();
+
+ private:
+  struct Section
+  {
+    std::uint32_t id;
+    std::uint32_t record_size;
+    std::uint64_t capacity;
+    std::byte *records;
+    /* Committed record count in the section's descriptor. */
+    std::uint64_t *count;
+  };
+
+  StoreStatus MapFile(int fd, std::size_t size, bool writable);
+  /* Validates the mapped header and descriptors and fills in sections_. */
+  StoreStatus ReadDescriptors();
+  const Section *FindSection(std::uint32_t section_id) const;
+  /* msync of the pages holding [data, data + size). */
+  StoreStatus Sync(const std::byte *data, std::size_t size);
+
+  std::byte *mapping_ = nullptr;
+  std::size_t mapping_size_ = 0;
+  bool writable_ = false;
+  MsyncPolicy msync_policy_ = MsyncPolicy::kOnClose;
+  Section sections_[kMaxStoreSections] = {};
+  std::size_t section_count_ = 0;
+};
+
+} /* namespace common */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_COMMON_MAPPEDSTORE_H_ */
@@ -0,0 +1,365 @@
+/* memo_cache.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Bounded, sharded CLOCK cache with lock-free reads, used to
+ * memoize pure functions such as TempFunc.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_COMMON_MEMOCACHE_H_
+#define PROJECTSTRUCTURE_COMMON_MEMOCACHE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
+#include "common/sharded_counter.h"
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/*!
+ * @brief Configuration of a MemoCache.
+ */
+struct MemoCacheOptions
+{
+  /* Number of entries, rounded up so that every set of every shard is full. */
+  std::size_t capacity = 1 << 16;
+  /* Number of independently locked shards, rounded up to a power of two. */
+  std::size_t shard_count = 64;
+};
+
+/*!
+ * @brief Counters of a MemoCache.
+ */
+struct MemoCacheStats
+{
+  std::int64_t hits;
+  std::int64_t misses;
+  std::int64_t insertions;
+  std::int64_t evictions;
+};
+
+/*!
+ * @brief Finalizer of SplitMix64, spreads every input bit over the result.
+ */
+constexpr std::uint64_t MixHash(std::uint64_t value)
+{
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9u;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebu;
+  value ^= value >> 31;
+  return value;
+}
+
+/*!
+ * @brief Bounded map from Key to Value for memoizing pure functions.
+ *
+ * The cache is split into shards, every shard into sets of kWays entries.
+ * A key hashes to one set of one shard and can only live there, when the set
+ * is full the CLOCK algorithm evicts an entry which has not been hit since the
+ * hand last passed it.
+ *
+ * Writers (Insert, Clear) lock the shard. Readers (Lookup) never lock, they
+ * validate what they read against the shard's sequence counter (a seqlock) and
+ * retry if a writer was active. A hit only writes the entry's reference bit
+ * and only if it is not already set, so hot keys read by many threads stay in
+ * shared cache lines.
+ *
+ * The class is neither copyable nor movable.
+ *
+ * @tparam Key Trivially copyable without padding, keys are compared bytewise.
+ * @tparam Value Trivially copyable.
+ * @tparam Hash Callable returning a std::uint64_t hash of a Key.
+ */
+template <typename Key, typename Value, typename Hash>
+class MemoCache
+{
+ public:
+  static_assert(std::is_trivially_copyable_v<Key> &&
+      std::has_unique_object_representations_v<Key>,
+      "Key must be trivially copyable without padding");
+  static_assert(std::is_trivially_copyable_v<Value>,
+      "Value must be trivially copyable");
+
+  /* Entries per set. */
+  static constexpr std::size_t kWays = 8;
+
+  explicit MemoCache(const MemoCacheOptions &options = MemoCacheOptions{})
+  {
+    std::size_t sets = 1;
+    shard_count_ = 1;
+    while (shard_count_ < options.shard_count)
+    {
+      shard_count_ *= 2;
+    }
+    while (shard_count_ * sets * kWays < options.capacity)
+    {
+      sets *= 2;
+    }
+    set_mask_ = sets - 1;
+    shards_.reset(new Shard[shard_count_]);
+    for (std::size_t i = 0; i < shard_count_; ++i)
+    {
+      shards_[i].entries.reset(new Entry[sets * kWays]);
+      shards_[i].hands.reset(new std::uint8_t[sets]());
+    }
+  }
+  MemoCache(const MemoCache &) = delete;
+  MemoCache &operator=(const MemoCache &) = delete;
+
+  ~MemoCache() = default;
+
+  /*!
+   * @brief Looks key up without locking.
+   *
+   * @param[in] key The key.
+   * @param[out] value Set to the cached value on a hit, untouched otherwise.
+   *
+   * @return true on a hit.
+   */
+  bool Lookup(const Key &key, Value &value)
+  {
+    const std::uint64_t kHash = MixHash(Hash{}(key));
+    Shard &shard = ShardOf(kHash);
+    Entry *set = SetOf(shard, kHash);
+    Entry *found = nullptr;
+    Value candidate{};
+    std::uint32_t sequence = 0;
+    for (int attempt = 0; attempt < kReadAttempts; ++attempt)
+    {
+      sequence = shard.sequence.load(std::memory_order_acquire);
+      if ((sequence & 1) != 0)
+      {
+        continue;
+      }
+      found = FindInSet(set, key, candidate);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (shard.sequence.load(std::memory_order_relaxed) == sequence)
+      {
+        return Finish(found, candidate, value);
+      }
+    }
+    /* Writers kept interfering, read under the lock instead. */
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    found = FindInSet(set, key, candidate);
+    return Finish(found, candidate, value);
+  }
+
+  /*!
+   * @brief Inserts or updates key, evicting an entry of its set if needed.
+   */
+  void Insert(const Key &key, const Value &value)
+  {
+    const std::uint64_t kHash = MixHash(Hash{}(key));
+    Shard &shard = ShardOf(kHash);
+    Entry *set = SetOf(shard, kHash);
+    std::uint8_t &hand = shard.hands[(kHash >> kSetShift) & set_mask_];
+    Value ignored{};
+    Entry *entry = nullptr;
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    entry = FindInSet(set, key, ignored);
+    for (std::size_t i = 0; entry == nullptr && i < kWays; ++i)
+    {
+      if (!set[i].occupied.load(std::memory_order_relaxed))
+      {
+        entry = &set[i];
+      }
+    }
+    /* CLOCK, terminates within two turns since every pass clears a bit. */
+    while (entry == nullptr)
+    {
+      if (set[hand].referenced.load(std::memory_order_relaxed))
+      {
+        set[hand].referenced.store(false, std::memory_order_relaxed);
+      }
+      else
+      {
+        entry = &set[hand];
+        evictions_.Increment();
+      }
+      hand = static_cast<std::uint8_t>((hand + 1) % kWays);
+    }
+    BeginWrite(shard);
+    StoreWords(entry->key, &key, sizeof(key));
+    StoreWords(entry->value, &value, sizeof(value));
+    entry->referenced.store(false, std::memory_order_relaxed);
+    entry->occupied.store(true, std::memory_order_relaxed);
+    EndWrite(shard);
+    insertions_.Increment();
+  }
+
+  /*! @brief Removes every entry, the counters are kept. */
+  void Clear()
+  {
+    for (std::size_t i = 0; i < shard_count_; ++i)
+    {
+      std::lock_guard<std::mutex> lock(shards_[i].mutex);
+      BeginWrite(shards_[i]);
+      for (std::size_t j = 0; j < (set_mask_ + 1) * kWays; ++j)
+      {
+        shards_[i].entries[j].occupied.store(false,
+            std::memory_order_relaxed);
+      }
+      EndWrite(shards_[i]);
+    }
+  }
+
+  /*! @brief Number of entries the cache can hold. */
+  std::size_t Capacity() const
+  {
+    return shard_count_ * (set_mask_ + 1) * kWays;
+  }
+
+  /*! @brief Snapshot of the counters. */
+  MemoCacheStats Stats() const
+  {
+    return MemoCacheStats{hits_.Snapshot(), misses_.Snapshot(),
+        insertions_.Snapshot(), evictions_.Snapshot()};
+  }
+
+ private:
+  /* Optimistic reads tried before Lookup falls back to locking. */
+  static constexpr int kReadAttempts = 4;
+
+  /* Bits of the hash above the set index select the shard. */
+  static constexpr int kSetShift = 0;
+  static constexpr int kShardShift = 40;
+
+  static constexpr std::size_t kKeyWords = (sizeof(Key) + 7) / 8;
+  static constexpr std::size_t kValueWords = (sizeof(Value) + 7) / 8;
+
+  /*
+   * Key and value are kept in atomic words, so that the optimistic reads of a
+   * Lookup racing with an Insert are well defined.
+   */
+  struct Entry
+  {
+    std::atomic<std::uint64_t> key[kKeyWords] = {};
+    std::atomic<std::uint64_t> value[kValueWords] = {};
+    std::atomic<bool> occupied{false};
+    std::atomic<bool> referenced{false};
+  };
+
+  struct alignas(kCacheLineSize) Shard
+  {
+    /* Odd while a writer modifies the shard. */
+    std::atomic<std::uint32_t> sequence{0};
+    std::mutex mutex;
+    std::unique_ptr<Entry[]> entries;
+    /* CLOCK hand of every set, only touched under mutex. */
+    std::unique_ptr<std::uint8_t[]> hands;
+  };
+
+  static void StoreWords(std::atomic<std::uint64_t> *words, const void *data,
+      std::size_t size)
+  {
+    std::uint64_t word = 0;
+    for (std::size_t i = 0; i * 8 < size; ++i)
+    {
+      word = 0;
+      std::memcpy(&word, static_cast<const std::byte *>(data) + i * 8,
+          size - i * 8 < 8 ? size - i * 8 : 8);
+      words[i].store(word, std::memory_order_relaxed);
+    }
+  }
+
+  static void LoadWords(const std::atomic<std::uint64_t> *words, void *data,
+      std::size_t size)
+  {
+    std::uint64_t word = 0;
+    for (std::size_t i = 0; i * 8 < size; ++i)
+    {
+      word = words[i].load(std::memory_order_relaxed);
+      std::memcpy(static_cast<std::byte *>(data) + i * 8, &word,
+          size - i * 8 < 8 ? size - i * 8 : 8);
+    }
+  }
+
+  static void BeginWrite(Shard &shard)
+  {
+    shard.sequence.store(shard.sequence.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  static void EndWrite(Shard &shard)
+  {
+    shard.sequence.store(shard.sequence.load(std::memory_order_relaxed) + 1,
+        std::memory_order_release);
+  }
+
+  /*
+   * Returns the entry of set holding key and copies its value to value, or
+   * returns nullptr. Used both optimistically and under the lock.
+   */
+  static Entry *FindInSet(Entry *set, const Key &key, Value &value)
+  {
+    Key stored{};
+    for (std::size_t i = 0; i < kWays; ++i)
+    {
+      if (!set[i].occupied.load(std::memory_order_relaxed))
+      {
+        continue;
+      }
+      LoadWords(set[i].key, &stored, sizeof(stored));
+      if (std::memcmp(&stored, &key, sizeof(key)) == 0)
+      {
+        LoadWords(set[i].value, &value, sizeof(value));
+        return &set[i];
+      }
+    }
+    return nullptr;
+  }
+
+  /* Counts the outcome of a validated lookup and hands out the value. */
+  bool Finish(Entry *found, const Value &candidate, Value &value)
+  {
+    if (found == nullptr)
+    {
+      misses_.Increment();
+      return false;
+    }
+    if (!found->referenced.load(std::memory_order_relaxed))
+    {
+      found->referenced.store(true, std::memory_order_relaxed);
+    }
+    hits_.Increment();
+    value = candidate;
+    return true;
+  }
+
+  Shard &ShardOf(std::uint64_t hash)
+  {
+    return shards_[(hash >> kShardShift) & (shard_count_ - 1)];
+  }
+
+  Entry *SetOf(Shard &shard, std::uint64_t hash)
+  {
+    return &shard.entries[((hash >> kSetShift) & set_mask_) * kWays];
+  }
+
+  std::size_t shard_count_ = 1;
+  std::size_t set_mask_ = 0;
+  std::unique_ptr<Shard[]> shards_;
+  ShardedCounter hits_;
+  ShardedCounter misses_;
+  ShardedCounter insertions_;
+  ShardedCounter evictions_;
+};
+
+} /* namespace common */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_COMMON_MEMOCACHE_H_ */
@@ -0,0 +1,334 @@
+/* numa.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: NUMA topology discovery, worker placement and memory binding.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "common/numa.h"
+
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/* Largest CPU number accepted in a CPU list, guards against huge ranges. */
+constexpr int kMaxCpuNumber = 1 << 16;
+
+/* Longest line of a topology file or sysfs file that is read. */
+constexpr std::size_t kMaxNumaLineLength = 4096;
+
+/* Pages queried per move_pages call. */
+constexpr std::size_t kPageQueryBatch = 512;
+
+/*
+ * Bits per word of the mbind node mask. The kernel takes an array of unsigned
+ * long, which is 64 bit on every platform this builds for.
+ */
+constexpr int kNodeMaskWordBits = 64;
+
+static std::string_view Trim(std::string_view text)
+{
+  while (!text.empty() && std::strchr(" \t\r\n", text.front()) != nullptr)
+  {
+    text.remove_prefix(1);
+  }
+  while (!text.empty() && std::strchr(" \t\r\n", text.back()) != nullptr)
+  {
+    text.remove_suffix(1);
+  }
+  return text;
+}
+
+/*
+ * Parses the decimal number at the start of text into number and drops it
+ * from text. Returns false if text does not start with one.
+ */
+static bool ConsumeNumber(std::string_view &text, int &number)
+{
+  std::from_chars_result result = std::from_chars(text.data(),
+      text.data() + text.size(), number);
+  if (result.ec != std::errc() || number < 0)
+  {
+    return false;
+  }
+  text.remove_prefix(static_cast<std::size_t>(result.ptr - text.data()));
+  return true;
+}
+
+/* Reads the first line of the file at path into line. */
+static bool ReadFirstLine(const std::string &path, std::string &line)
+{
+  char buffer[kMaxNumaLineLength];
+  std::FILE *file = std::fopen(path.c_str(), "r");
+  bool read = false;
+  if (file == nullptr)
+  {
+    return false;
+  }
+  read = std::fgets(buffer, sizeof(buffer), file) != nullptr;
+  std::fclose(file);
+  if (read)
+  {
+    line = buffer;
+  }
+  return read;
+}
+
+static bool NodeIdLess(const NumaNode &a, const NumaNode &b)
+{
+  return a.id < b.id;
+}
+
+/* Sorts the nodes and returns false if there is none or an id repeats. */
+static bool FinishTopology(NumaTopology &topology)
+{
+  std::sort(topology.nodes.begin(), topology.nodes.end(), &NodeIdLess);
+  for (std::size_t i = 1; i < topology.nodes.size(); ++i)
+  {
+    if (topology.nodes[i - 1].id == topology.nodes[i].id)
+    {
+      return false;
+    }
+  }
+  return !topology.nodes.empty();
+}
+
+bool ParseCpuList(std::string_view text, std::vector<int> &cpus)
+{
+  int first = 0;
+  int last = 0;
+  cpus.clear();
+  text = Trim(text);
+  while (!text.empty())
+  {
+    if (!ConsumeNumber(text, first))
+    {
+      return false;
+    }
+    last = first;
+    if (!text.empty() && text.front() == '-')
+    {
+      text.remove_prefix(1);
+      if (!ConsumeNumber(text, last) || last < first)
+      {
+        return false;
+      }
+    }
+    if (last > kMaxCpuNumber)
+    {
+      return false;
+    }
+    for (int cpu = first; cpu <= last; ++cpu)
+    {
+      cpus.push_back(cpu);
+    }
+    if (!text.empty())
+    {
+      if (text.front() != ',' || text.size() == 1)
+      {
+        return false;
+      }
+      text.remove_prefix(1);
+    }
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return true;
+}
+
+bool ReadNumaTopology(const char *node_directory, NumaTopology &topology)
+{
+  DIR *directory = opendir(node_directory);
+  dirent *entry = nullptr;
+  std::string_view name;
+  std::string line;
+  NumaNode node = {0, {}};
+  topology.nodes.clear();
+  topology.simulated = false;
+  if (directory == nullptr)
+  {
+    return false;
+  }
+  for (entry = readdir(directory); entry != nullptr;
+      entry = readdir(directory))
+  {
+    name = entry->d_name;
+    if (name.substr(0, 4) != "node")
+    {
+      continue;
+    }
+    name.remove_prefix(4);
+    if (!ConsumeNumber(name, node.id) || !name.empty() ||
+        !ReadFirstLine(std::string(node_directory) + "/" + entry->d_name +
+            "/cpulist", line) || !ParseCpuList(line, node.cpus))
+    {
+      continue;
+    }
+    /* Memory only nodes, e.g. CXL memory, get no workers. */
+    if (!node.cpus.empty())
+    {
+      topology.nodes.push_back(node);
+    }
+  }
+  closedir(directory);
+  return FinishTopology(topology);
+}
+
+bool ReadSimulatedNumaTopology(const char *path, NumaTopology &topology)
+{
+  char buffer[kMaxNumaLineLength];
+  std::FILE *file = std::fopen(path, "r");
+  std::string_view line;
+  NumaNode node = {0, {}};
+  bool valid = true;
+  topology.nodes.clear();
+  topology.simulated = true;
+  if (file == nullptr)
+  {
+    return false;
+  }
+  while (valid && std::fgets(buffer, sizeof(buffer), file) != nullptr)
+  {
+    line = Trim(buffer);
+    if (line.empty() || line.front() == '#')
+    {
+      continue;
+    }
+    valid = line.substr(0, 4) == "node";
+    line.remove_prefix(valid ? 4 : 0);
+    valid = valid && ConsumeNumber(line, node.id) && !line.empty() &&
+        (line.front() == ' ' || line.front() == '\t') &&
+        ParseCpuList(line, node.cpus) && !node.cpus.empty();
+    if (valid)
+    {
+      topology.nodes.push_back(node);
+    }
+  }
+  std::fclose(file);
+  return valid && FinishTopology(topology);
+}
+
+int NumaNodeOfCpu(const NumaTopology &topology, int cpu)
+{
+  for (const NumaNode &node : topology.nodes)
+  {
+    if (std::binary_search(node.cpus.begin(), node.cpus.end(), cpu))
+    {
+      return node.id;
+    }
+  }
+  return -1;
+}
+
+std::vector<int> PlaceWorkers(const NumaTopology &topology,
+    std::size_t worker_count, NumaPlacement placement)
+{
+  std::vector<int> cpus;
+  std::vector<int> compact;
+  std::vector<std::size_t> next_cpu(topology.nodes.size(), 0);
+  const NumaNode *node = nullptr;
+  for (const NumaNode &each : topology.nodes)
+  {
+    compact.insert(compact.end(), each.cpus.begin(), each.cpus.end());
+  }
+  if (compact.empty())
+  {
+    return cpus;
+  }
+  for (std::size_t i = 0; i < worker_count; ++i)
+  {
+    if (placement == NumaPlacement::kSpread)
+    {
+      node = &topology.nodes[i % topology.nodes.size()];
+      cpus.push_back(node->cpus[next_cpu[i % topology.nodes.size()]++ %
+          node->cpus.size()]);
+    }
+    else
+    {
+      cpus.push_back(compact[i % compact.size()]);
+    }
+  }
+  return cpus;
+}
+
+bool BindToNumaNode(void *memory, std::size_t size, int node)
+{
+  std::uint64_t mask[kMaxNumaNodes / kNodeMaskWordBits] = {};
+  if (node < 0 || node >= kMaxNumaNodes)
+  {
+    return false;
+  }
+  mask[node / kNodeMaskWordBits] |= std::uint64_t{1} <<
+      (node % kNodeMaskWordBits);
+  /* The kernel reads one bit less than the node count it is given. */
+  return syscall(SYS_mbind, memory, size, MPOL_PREFERRED, mask,
+      kMaxNumaNodes + 1, 0) == 0;
+}
+
+void CountNumaPages(const void *memory, std::size_t size, int node,
+    NumaPageStats &stats)
+{
+  const std::uintptr_t kPageSize = static_cast<std::uintptr_t>(
+      sysconf(_SC_PAGESIZE));
+  const std::uintptr_t kEnd = reinterpret_cast<std::uintptr_t>(memory) +
+      size;
+  std::uintptr_t page = reinterpret_cast<std::uintptr_t>(memory) &
+      ~(kPageSize - 1);
+  void *pages[kPageQueryBatch];
+  int status[kPageQueryBatch];
+  std::size_t count = 0;
+  while (size > 0 && page < kEnd)
+  {
+    for (count = 0; count < kPageQueryBatch && page < kEnd; ++count)
+    {
+      pages[count] = reinterpret_cast<void *>(page);
+      status[count] = -1;
+      page += kPageSize;
+    }
+    /* Without target nodes move_pages only reports where pages are. */
+    if (syscall(SYS_move_pages, 0, count, pages, nullptr, status, 0) != 0)
+    {
+      stats.unknown_pages += count;
+      continue;
+    }
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      if (status[i] < 0)
+      {
+        ++stats.unknown_pages;
+      }
+      else if (status[i] == node)
+      {
+        ++stats.local_pages;
+      }
+      else
+      {
+        ++stats.remote_pages;
+      }
+    }
+  }
+}
+
+} /* namespace common */
+} /* namespace project_structure */
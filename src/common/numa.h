@@ -0,0 +1,172 @@
+/* numa.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: NUMA topology discovery, worker placement and memory binding.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_COMMON_NUMA_H_
+#define PROJECTSTRUCTURE_COMMON_NUMA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/*! @brief Where Linux describes the NUMA nodes of the running machine. */
+constexpr char kNumaNodeDirectory[] = "/sys/devices/system/node";
+
+/*! @brief Highest node number BindToNumaNode can bind to, plus one. */
+constexpr int kMaxNumaNodes = 1024;
+
+/*!
+ * @brief One NUMA node and the CPUs it contains.
+ */
+struct NumaNode
+{
+  int id;
+  /* In increasing order. */
+  std::vector<int> cpus;
+};
+
+/*!
+ * @brief The NUMA nodes of a machine, real or simulated.
+ */
+struct NumaTopology
+{
+  /* In increasing order of id, nodes without CPUs are left out. */
+  std::vector<NumaNode> nodes;
+  /*
+   * Read from a topology file rather than from the running machine, the node
+   * numbers then mean nothing to the kernel and memory is not bound.
+   */
+  bool simulated = false;
+};
+
+/*!
+ * @brief Parses a Linux CPU list such as "0-3,8,10-11".
+ *
+ * @param[in] text The list, surrounding whitespace is ignored.
+ * @param[out] cpus The CPUs, in increasing order without duplicates.
+ *
+ * @return false if text is not a CPU list.
+ */
+bool ParseCpuList(std::string_view text, std::vector<int> &cpus);
+
+/*!
+ * @brief Reads the topology of the running machine.
+ *
+ * @param[in] node_directory Directory with a nodeN/cpulist file per node,
+ * normally kNumaNodeDirectory.
+ * @param[out] topology The nodes found.
+ *
+ * @return false if the directory could not be read or has no node with CPUs.
+ * Machines without NUMA support have no such directory.
+ */
+bool ReadNumaTopology(const char *node_directory, NumaTopology &topology);
+
+/*!
+ * @brief Reads a simulated topology, for testing placement on machines with
+ * a single node.
+ *
+ * The file has one line per node with its number and CPU list, e.g.
+ *
+ * # Two sockets with 4 cores and 2 hyper threads each.
+ * node0 0-3,8-11
+ * node1 4-7,12-15
+ *
+ * Empty lines and lines starting with # are ignored.
+ *
+ * @param[in] path The file.
+ * @param[out] topology The nodes, with simulated set.
+ *
+ * @return false if the file could not be read, a line is malformed or it
+ * names no node.
+ */
+bool ReadSimulatedNumaTopology(const char *path, NumaTopology &topology);
+
+/*!
+ * @brief Node of cpu in topology, -1 if no node contains it.
+ */
+int NumaNodeOfCpu(const NumaTopology &topology, int cpu);
+
+/*!
+ * @brief How PlaceWorkers assigns workers to CPUs.
+ */
+enum class NumaPlacement
+{
+  /* Fill the first node, then the next, keeps workers close together. */
+  kCompact = 0,
+  /* Round robin over the nodes, uses the memory bandwidth of every node. */
+  kSpread = 1
+};
+
+/*!
+ * @brief Picks a CPU for every worker.
+ *
+ * Worker counts above the number of CPUs wrap around, so some CPUs get more
+ * than one worker.
+ *
+ * @param[in] topology The nodes to place on, may not be empty.
+ * @param[in] worker_count Number of workers.
+ * @param[in] placement Compact or spread.
+ *
+ * @return One CPU per worker, empty if topology has no CPUs.
+ */
+std::vector<int> PlaceWorkers(const NumaTopology &topology,
+    std::size_t worker_count, NumaPlacement placement);
+
+/*!
+ * @brief Asks the kernel to place the pages of [memory, memory + size) on
+ * node when they are first touched.
+ *
+ * The policy is preferred rather than strict, so pages go to other nodes
+ * instead of failing when node is out of memory. Call it before the memory
+ * is touched, pages already present are not moved.
+ *
+ * @param[in] memory Start of the range, must be page aligned.
+ * @param[in] size Bytes in the range.
+ * @param[in] node The node, in [0, kMaxNumaNodes).
+ *
+ * @return false if the kernel refused, e.g. because node does not exist.
+ */
+bool BindToNumaNode(void *memory, std::size_t size, int node);
+
+/*!
+ * @brief Page counts of some memory relative to a node.
+ */
+struct NumaPageStats
+{
+  /* Present on the node. */
+  std::uint64_t local_pages = 0;
+  /* Present on another node. */
+  std::uint64_t remote_pages = 0;
+  /* Never touched, or the kernel could not say. */
+  std::uint64_t unknown_pages = 0;
+};
+
+/*!
+ * @brief Adds the pages of [memory, memory + size) to stats by where they
+ * are relative to node.
+ *
+ * @param[in] memory Start of the range, need not be page aligned.
+ * @param[in] size Bytes in the range.
+ * @param[in] node The node the memory should be on.
+ * @param[in, out] stats Counts to add to.
+ */
+void CountNumaPages(const void *memory, std::size_t size, int node,
+    NumaPageStats &stats);
+
+} /* namespace common */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_COMMON_NUMA_H_ */
@@ -0,0 +1,269 @@
+/* object_pool.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Pool of reusable objects which are cleared instead of
+ * destroyed, with a cap on how many are kept.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_COMMON_OBJECTPOOL_H_
+#define PROJECTSTRUCTURE_COMMON_OBJECTPOOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/*!
+ * @brief Configuration of an ObjectPool.
+ */
+struct ObjectPoolOptions
+{
+  /*
+   * Released objects kept for reuse, objects released while this many are
+   * kept are destroyed. Bounds the memory a pool holds on to after a burst.
+   */
+  std::size_t max_retained = 64;
+};
+
+/*!
+ * @brief Counters of an ObjectPool.
+ */
+struct ObjectPoolStats
+{
+  std::uint64_t acquires;
+  /* Acquires served by a kept object, the others constructed one. */
+  std::uint64_t hits;
+  std::uint64_t releases;
+  /* Releases which destroyed the object since max_retained were kept. */
+  std::uint64_t discards;
+  /* Objects kept for reuse now, and the most kept at once. */
+  std::uint64_t retained;
+  std::uint64_t peak_retained;
+  /* Objects acquired and not yet released now, and the most at once. */
+  std::uint64_t in_use;
+  std::uint64_t peak_in_use;
+};
+
+/*!
+ * @brief Fraction of the acquires of stats served without constructing an
+ * object, 0 if there were none.
+ */
+inline double ObjectPoolHitRate(const ObjectPoolStats &stats)
+{
+  return stats.acquires == 0 ? 0.0 : static_cast<double>(stats.hits) /
+      static_cast<double>(stats.acquires);
+}
+
+/*!
+ * @brief Hands out objects of type T and takes them back for reuse.
+ *
+ * Released objects are reset with their Clear member and kept, up to
+ * max_retained of them, instead of being destroyed. Types which keep their
+ * buffers on Clear, such as generated protobuf messages and std containers,
+ * then serve later acquires without allocating once the pool is warm.
+ *
+ * Objects are returned by destroying or resetting the Handle they were
+ * acquired with. Every handle must be gone before the pool is destroyed.
+ *
+ * The class is neither copyable nor movable. It is not thread safe, give
+ * each thread its own pool, e.g. a thread_local one, and release objects on
+ * the thread which acquired them.
+ *
+ * @tparam T Default constructible type with a void Clear() member.
+ */
+template <typename T>
+class ObjectPool
+{
+ public:
+  /*!
+   * @brief Owns one acquired object until it is returned to its pool.
+   *
+   * The class is move-only.
+   */
+  class Handle
+  {
+   public:
+    /*! @brief A handle without an object. */
+    Handle() = default;
+    Handle(const Handle &) = delete;
+    Handle &operator=(const Handle &) = delete;
+
+    Handle(Handle &&other) noexcept
+        : pool_(other.pool_), object_(other.object_)
+    {
+      other.pool_ = nullptr;
+      other.object_ = nullptr;
+    }
+
+    Handle &operator=(Handle &&other) noexcept
+    {
+      if (this != &other)
+      {
+        Reset();
+        pool_ = other.pool_;
+        object_ = other.object_;
+        other.pool_ = nullptr;
+        other.object_ = nullptr;
+      }
+      return *this;
+    }
+
+    ~Handle()
+    {
+      Reset();
+    }
+
+    /*! @brief Returns the object to its pool, the handle is empty after. */
+    void Reset()
+    {
+      if (object_ != nullptr)
+      {
+        pool_->Release(object_);
+      }
+      pool_ = nullptr;
+      object_ = nullptr;
+    }
+
+    /*! @brief The object, nullptr if the handle is empty. */
+    T *Get() const
+    {
+      return object_;
+    }
+
+    T *operator->() const
+    {
+      return object_;
+    }
+
+    T &operator*() const
+    {
+      return *object_;
+    }
+
+    /*! @brief True if the handle holds an object. */
+    explicit operator bool() const
+    {
+      return object_ != nullptr;
+    }
+
+   private:
+    friend class ObjectPool;
+
+    Handle(ObjectPool *pool, T *object) : pool_(pool), object_(object)
+    {
+    }
+
+    ObjectPool *pool_ = nullptr;
+    T *object_ = nullptr;
+  };
+
+  /*!
+   * @brief Creates an empty pool, objects are only constructed on demand.
+   *
+   * @param[in] options Retention cap of the pool.
+   */
+  explicit ObjectPool(const ObjectPoolOptions &options = ObjectPoolOptions{})
+      : options_(options)
+  {
+    /* Releasing never allocates, the list has room for every kept object. */
+    free_.reserve(options_.max_retained);
+  }
+
+  ObjectPool(const ObjectPool &) = delete;
+  ObjectPool &operator=(const ObjectPool &) = delete;
+
+  ~ObjectPool()
+  {
+    Trim();
+  }
+
+  /*!
+   * @brief Takes a kept object, or constructs one if none is kept.
+   *
+   * @return A handle to a cleared or newly constructed object, empty if one
+   * could not be allocated.
+   */
+  Handle Acquire()
+  {
+    T *object = nullptr;
+    ++stats_.acquires;
+    if (!free_.empty())
+    {
+      object = free_.back();
+      free_.pop_back();
+      ++stats_.hits;
+    }
+    else
+    {
+      object = new (std::nothrow) T();
+      if (object == nullptr)
+      {
+        return Handle();
+      }
+    }
+    ++stats_.in_use;
+    if (stats_.in_use > stats_.peak_in_use)
+    {
+      stats_.peak_in_use = stats_.in_use;
+    }
+    return Handle(this, object);
+  }
+
+  /*! @brief Destroys every kept object, objects in use are not affected. */
+  void Trim()
+  {
+    for (T *object : free_)
+    {
+      delete object;
+    }
+    free_.clear();
+  }
+
+  /*! @brief Counters since the pool was created. */
+  ObjectPoolStats Stats() const
+  {
+    ObjectPoolStats stats = stats_;
+    stats.retained = free_.size();
+    return stats;
+  }
+
+ private:
+  void Release(T *object)
+  {
+    ++stats_.releases;
+    --stats_.in_use;
+    if (free_.size() >= options_.max_retained)
+    {
+      ++stats_.discards;
+      delete object;
+      return;
+    }
+    object->Clear();
+    free_.push_back(object);
+    if (free_.size() > stats_.peak_retained)
+    {
+      stats_.peak_retained = free_.size();
+    }
+  }
+
+  ObjectPoolOptions options_;
+  /* Kept objects, the most recently released, and warmest, last. */
+  std::vector<T *> free_;
+  /* retained is filled in by Stats. */
+  ObjectPoolStats stats_ = {};
+};
+
+} /* namespace common */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_COMMON_OBJECTPOOL_H_ */
@@ -0,0 +1,649 @@
+/* ring_queue.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Bounded lock-free ring queues (SPSC and MPMC) with batch
+ * operations and pluggable wait policies, used between pipeline stages.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_COMMON_RINGQUEUE_H_
+#define PROJECTSTRUCTURE_COMMON_RINGQUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <thread>
+
+#include "common/sharded_counter.h"
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/*!
+ * @brief Wait policy which never sleeps.
+ *
+ * A waiting thread polls with a growing number of pause instructions and then
+ * yields. Gives the lowest handoff latency at the cost of keeping a core busy
+ * while waiting, use it when every stage has a core of its own.
+ *
+ * The class is neither copyable nor movable.
+ */
+class SpinWait
+{
+ public:
+  SpinWait() = default;
+  SpinWait(const SpinWait &) = delete;
+  SpinWait &operator=(const SpinWait &) = delete;
+
+  /*! @brief Returns a token to pass to Wait or CancelWait. */
+  std::uint32_t PrepareWait()
+  {
+    return 0;
+  }
+
+  /*! @brief Backs off once, the caller then retries its operation. */
+  void Wait(std::uint32_t token)
+  {
+    int spins = spins_.load(std::memory_order_relaxed);
+    (void)token;
+    if (spins < kMaxSpins)
+    {
+      for (int i = 0; i < (1 << spins); ++i)
+      {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+      }
+      spins_.store(spins + 1, std::memory_order_relaxed);
+      return;
+    }
+    std::this_thread::yield();
+  }
+
+  /*! @brief Called when the operation succeeded after PrepareWait. */
+  void CancelWait()
+  {
+    spins_.store(0, std::memory_order_relaxed);
+  }
+
+  /*! @brief Called after the state the waiters wait for may have changed. */
+  void Notify()
+  {
+  }
+
+  /*! @brief Wakes every waiter, used when the queue is closed. */
+  void NotifyAll()
+  {
+  }
+
+ private:
+  /* Doublings of the pause loop before falling back to yielding. */
+  static constexpr int kMaxSpins = 10;
+
+  /*
+   * Backoff state, shared by the threads waiting on the same condition. It is
+   * only a heuristic so races on it are harmless, it is atomic to keep them
+   * well defined.
+   */
+  std::atomic<int> spins_{0};
+};
+
+/*!
+ * @brief Wait policy which sleeps in the kernel.
+ *
+ * A waiting thread registers itself and sleeps on an epoch counter with
+ * std::atomic::wait. Notify only makes a system call when some thread is
+ * registered, so the uncontended path stays a single load. Use it when stages
+ * share cores or are idle for long periods.
+ *
+ * The class is neither copyable nor movable.
+ */
+class BlockingWait
+{
+ public:
+  BlockingWait() = default;
+  BlockingWait(const BlockingWait &) = delete;
+  BlockingWait &operator=(const BlockingWait &) = delete;
+
+  /*!
+   * @brief Registers the caller as a waiter.
+   *
+   * The caller must retry its operation after this call and then call either
+   * Wait or CancelWait with the returned token.
+   */
+  std::uint32_t PrepareWait()
+  {
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    return epoch_.load(std::memory_order_seq_cst);
+  }
+
+  /*! @brief Sleeps until Notify is called after PrepareWait returned token. */
+  void Wait(std::uint32_t token)
+  {
+    epoch_.wait(token, std::memory_order_acquire);
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  /*! @brief Unregisters a waiter whose retry succeeded. */
+  void CancelWait()
+  {
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  /*!
+   * @brief Wakes the waiters, if there are any.
+   *
+   * Every waiter is woken since a batch may satisfy more than one of them.
+   */
+  void Notify()
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) > 0)
+    {
+      epoch_.fetch_add(1, std::memory_order_release);
+      epoch_.notify_all();
+    }
+  }
+
+  /*! @brief Wakes every waiter. */
+  void NotifyAll()
+  {
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    epoch_.notify_all();
+  }
+
+ private:
+  std::atomic<std::uint32_t> epoch_{0};
+  std::atomic<std::uint32_t> waiters_{0};
+};
+
+/*!
+ * @brief Rounds capacity up to a power of two, at least 2.
+ */
+constexpr std::size_t RingQueueCapacity(std::size_t capacity)
+{
+  std::size_t size = 2;
+  while (size < capacity)
+  {
+    size *= 2;
+  }
+  return size;
+}
+
+/*!
+ * @brief Bounded single producer, single consumer queue.
+ *
+ * The producer only writes tail_ and the consumer only writes head_, each
+ * keeps a cached copy of the other index so that the shared cache lines are
+ * only read when the cached value says the queue is full or empty.
+ *
+ * Try operations never block. Push and Pop wait according to WaitPolicy
+ * (SpinWait or BlockingWait) until they can make progress or the queue is
+ * closed.
+ *
+ * The class is neither copyable nor movable.
+ *
+ * @tparam T Element type, must be default constructible and copy assignable.
+ * @tparam WaitPolicy SpinWait or BlockingWait.
+ */
+template <typename T, typename WaitPolicy = SpinWait>
+class SpscRingQueue
+{
+ public:
+  /*!
+   * @param[in] capacity Number of elements, rounded up to a power of two.
+   */
+  explicit SpscRingQueue(std::size_t capacity)
+      : mask_(RingQueueCapacity(capacity) - 1),
+        slots_(new T[RingQueueCapacity(capacity)])
+  {
+  }
+  SpscRingQueue(const SpscRingQueue &) = delete;
+  SpscRingQueue &operator=(const SpscRingQueue &) = delete;
+
+  ~SpscRingQueue() = default;
+
+  /*!
+   * @brief Pushes as many elements of values as fit, only called by the
+   * producer.
+   *
+   * @return Number of elements pushed, a prefix of values.
+   */
+  std::size_t TryPushBatch(std::span<const T> values)
+  {
+    std::size_t tail = tail_.value.load(std::memory_order_relaxed);
+    std::size_t free = mask_ + 1 - (tail - cached_head_);
+    std::size_t count = values.size();
+    if (free < count)
+    {
+      cached_head_ = head_.value.load(std::memory_order_acquire);
+      free = mask_ + 1 - (tail - cached_head_);
+    }
+    if (count > free)
+    {
+      count = free;
+    }
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      slots_[(tail + i) & mask_] = values[i];
+    }
+    if (count > 0)
+    {
+      tail_.value.store(tail + count, std::memory_order_release);
+      not_empty_.Notify();
+    }
+    return count;
+  }
+
+  /*!
+   * @brief Pops up to values.size() elements, only called by the consumer.
+   *
+   * @return Number of elements popped into the front of values.
+   */
+  std::size_t TryPopBatch(std::span<T> values)
+  {
+    std::size_t head = head_.value.load(std::memory_order_relaxed);
+    std::size_t available = cached_tail_ - head;
+    std::size_t count = values.size();
+    if (available < count)
+    {
+      cached_tail_ = tail_.value.load(std::memory_order_acquire);
+      available = cached_tail_ - head;
+    }
+    if (count > available)
+    {
+      count = available;
+    }
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      values[i] = slots_[(head + i) & mask_];
+    }
+    if (count > 0)
+    {
+      head_.value.store(head + count, std::memory_order_release);
+      not_full_.Notify();
+    }
+    return count;
+  }
+
+  /*! @brief Single element TryPushBatch. */
+  bool TryPush(const T &value)
+  {
+    return TryPushBatch(std::span<const T>(&value, 1)) == 1;
+  }
+
+  /*! @brief Single element TryPopBatch. */
+  bool TryPop(T &value)
+  {
+    return TryPopBatch(std::span<T>(&value, 1)) == 1;
+  }
+
+  /*!
+   * @brief Pushes every element of values, waiting for room when full.
+   *
+   * @return false if the queue was closed before everything was pushed.
+   */
+  bool PushBatch(std::span<const T> values)
+  {
+    std::uint32_t token = 0;
+    std::size_t count = 0;
+    while (!values.empty())
+    {
+      if (closed_.load(std::memory_order_acquire))
+      {
+        return false;
+      }
+      values = values.subspan(TryPushBatch(values));
+      if (values.empty())
+      {
+        break;
+      }
+      token = not_full_.PrepareWait();
+      count = TryPushBatch(values);
+      if (count > 0 || closed_.load(std::memory_order_acquire))
+      {
+        not_full_.CancelWait();
+        values = values.subspan(count);
+        continue;
+      }
+      not_full_.Wait(token);
+    }
+    return true;
+  }
+
+  /*!
+   * @brief Pops at least one element, waiting while the queue is empty.
+   *
+   * @return Number of elements popped, 0 only if the queue is closed and
+   * drained.
+   */
+  std::size_t PopBatch(std::span<T> values)
+  {
+    std::size_t count = 0;
+    std::uint32_t token = 0;
+    while (true)
+    {
+      count = TryPopBatch(values);
+      if (count > 0)
+      {
+        return count;
+      }
+      token = not_empty_.PrepareWait();
+      count = TryPopBatch(values);
+      if (count > 0 || closed_.load(std::memory_order_acquire))
+      {
+        not_empty_.CancelWait();
+        if (count > 0)
+        {
+          return count;
+        }
+        /* Closed, but a final push may have landed before the close. */
+        return TryPopBatch(values);
+      }
+      not_empty_.Wait(token);
+    }
+  }
+
+  /*!
+   * @brief Closes the queue, waiting Push and Pop calls return.
+   *
+   * Elements already in the queue can still be popped.
+   */
+  void Close()
+  {
+    closed_.store(true, std::memory_order_seq_cst);
+    not_empty_.NotifyAll();
+    not_full_.NotifyAll();
+  }
+
+  /*! @brief Maximum number of elements. */
+  std::size_t Capacity() const
+  {
+    return mask_ + 1;
+  }
+
+ private:
+  struct alignas(kCacheLineSize) PaddedIndex
+  {
+    std::atomic<std::size_t> value{0};
+  };
+
+  const std::size_t mask_;
+  std::unique_ptr<T[]> slots_;
+  /* Written by the consumer. */
+  PaddedIndex head_;
+  /* Written by the producer. */
+  PaddedIndex tail_;
+  /* Producer's copy of head_, on the producer's own cache line. */
+  alignas(kCacheLineSize) std::size_t cached_head_ = 0;
+  /* Consumer's copy of tail_, on the consumer's own cache line. */
+  alignas(kCacheLineSize) std::size_t cached_tail_ = 0;
+  alignas(kCacheLineSize) WaitPolicy not_empty_;
+  alignas(kCacheLineSize) WaitPolicy not_full_;
+  std::atomic<bool> closed_{false};
+};
+
+/*!
+ * @brief Bounded multi producer, multi consumer queue.
+ *
+ * Dmitry Vyukov's bounded MPMC queue: every slot carries a sequence number
+ * telling whether it is free for the producer or filled for the consumer of
+ * the current lap, producers and consumers claim slots with a compare and
+ * swap on tail_ and head_ respectively. Batch operations claim a run of
+ * consecutive ready slots with a single compare and swap.
+ *
+ * The class is neither copyable nor movable.
+ *
+ * @tparam T Element type, must be default constructible and copy assignable.
+ * @tparam WaitPolicy SpinWait or BlockingWait.
+ */
+template <typename T, typename WaitPolicy = SpinWait>
+class MpmcRingQueue
+{
+ public:
+  /*!
+   * @param[in] capacity Number of elements, rounded up to a power of two.
+   */
+  explicit MpmcRingQueue(std::size_t capacity)
+      : mask_(RingQueueCapacity(capacity) - 1),
+        slots_(new Slot[RingQueueCapacity(capacity)])
+  {
+    for (std::size_t i = 0; i <= mask_; ++i)
+    {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  MpmcRingQueue(const MpmcRingQueue &) = delete;
+  MpmcRingQueue &operator=(const MpmcRingQueue &) = delete;
+
+  ~MpmcRingQueue() = default;
+
+  /*!
+   * @brief Pushes as many elements of values as there are free consecutive
+   * slots, may be called by any thread.
+   *
+   * @return Number of elements pushed, a prefix of values.
+   */
+  std::size_t TryPushBatch(std::span<const T> values)
+  {
+    std::size_t tail = tail_.value.load(std::memory_order_relaxed);
+    std::size_t count = 0;
+    while (!values.empty())
+    {
+      count = CountReady(tail, 0, values.size());
+      if (count == 0)
+      {
+        /* Full, unless another producer moved tail_ in the meantime. */
+        if (tail == tail_.value.load(std::memory_order_relaxed))
+        {
+          return 0;
+        }
+        tail = tail_.value.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (tail_.value.compare_exchange_weak(tail, tail + count,
+          std::memory_order_relaxed, std::memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      slots_[(tail + i) & mask_].value = values[i];
+      slots_[(tail + i) & mask_].sequence.store(tail + i + 1,
+          std::memory_order_release);
+    }
+    if (count > 0)
+    {
+      not_empty_.Notify();
+    }
+    return count;
+  }
+
+  /*!
+   * @brief Pops up to values.size() consecutive ready elements, may be called
+   * by any thread.
+   *
+   * @return Number of elements popped into the front of values.
+   */
+  std::size_t TryPopBatch(std::span<T> values)
+  {
+    std::size_t head = head_.value.load(std::memory_order_relaxed);
+    std::size_t count = 0;
+    while (!values.empty())
+    {
+      count = CountReady(head, 1, values.size());
+      if (count == 0)
+      {
+        if (head == head_.value.load(std::memory_order_relaxed))
+        {
+          return 0;
+        }
+        head = head_.value.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (head_.value.compare_exchange_weak(head, head + count,
+          std::memory_order_relaxed, std::memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      values[i] = slots_[(head + i) & mask_].value;
+      slots_[(head + i) & mask_].sequence.store(head + i + mask_ + 1,
+          std::memory_order_release);
+    }
+    if (count > 0)
+    {
+      not_full_.Notify();
+    }
+    return count;
+  }
+
+  /*! @brief Single element TryPushBatch. */
+  bool TryPush(const T &value)
+  {
+    return TryPushBatch(std::span<const T>(&value, 1)) == 1;
+  }
+
+  /*! @brief Single element TryPopBatch. */
+  bool TryPop(T &value)
+  {
+    return TryPopBatch(std::span<T>(&value, 1)) == 1;
+  }
+
+  /*!
+   * @brief Pushes every element of values, waiting for room when full.
+   *
+   * @return false if the queue was closed before everything was pushed.
+   */
+  bool PushBatch(std::span<const T> values)
+  {
+    std::uint32_t token = 0;
+    std::size_t count = 0;
+    while (!values.empty())
+    {
+      if (closed_.load(std::memory_order_acquire))
+      {
+        return false;
+      }
+      values = values.subspan(TryPushBatch(values));
+      if (values.empty())
+      {
+        break;
+      }
+      token = not_full_.PrepareWait();
+      count = TryPushBatch(values);
+      if (count > 0 || closed_.load(std::memory_order_acquire))
+      {
+        not_full_.CancelWait();
+        values = values.subspan(count);
+        continue;
+      }
+      not_full_.Wait(token);
+    }
+    return true;
+  }
+
+  /*!
+   * @brief Pops at least one element, waiting while the queue is empty.
+   *
+   * @return Number of elements popped, 0 only if the queue is closed and
+   * drained.
+   */
+  std::size_t PopBatch(std::span<T> values)
+  {
+    std::size_t count = 0;
+    std::uint32_t token = 0;
+    while (true)
+    {
+      count = TryPopBatch(values);
+      if (count > 0)
+      {
+        return count;
+      }
+      token = not_empty_.PrepareWait();
+      count = TryPopBatch(values);
+      if (count > 0 || closed_.load(std::memory_order_acquire))
+      {
+        not_empty_.CancelWait();
+        if (count > 0)
+        {
+          return count;
+        }
+        return TryPopBatch(values);
+      }
+      not_empty_.Wait(token);
+    }
+  }
+
+  /*!
+   * @brief Closes the queue, waiting Push and Pop calls return.
+   *
+   * Elements already in the queue can still be popped.
+   */
+  void Close()
+  {
+    closed_.store(true, std::memory_order_seq_cst);
+    not_empty_.NotifyAll();
+    not_full_.NotifyAll();
+  }
+
+  /*! @brief Maximum number of elements. */
+  std::size_t Capacity() const
+  {
+    return mask_ + 1;
+  }
+
+ private:
+  struct Slot
+  {
+    std::atomic<std::size_t> sequence{0};
+    T value{};
+  };
+
+  struct alignas(kCacheLineSize) PaddedIndex
+  {
+    std::atomic<std::size_t> value{0};
+  };
+
+  /*
+   * Counts, up to limit, the consecutive slots from position on whose
+   * sequence is position + offset, that is slots free for a producer
+   * (offset 0) or filled for a consumer (offset 1).
+   */
+  std::size_t CountReady(std::size_t position, std::size_t offset,
+      std::size_t limit) const
+  {
+    std::size_t count = 0;
+    while (count < limit && count <= mask_ &&
+        slots_[(position + count) & mask_].sequence.load(
+            std::memory_order_acquire) == position + count + offset)
+    {
+      ++count;
+    }
+    return count;
+  }
+
+  const std::size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  PaddedIndex head_;
+  PaddedIndex tail_;
+  alignas(kCacheLineSize) WaitPolicy not_empty_;
+  alignas(kCacheLineSize) WaitPolicy not_full_;
+  std::atomic<bool> closed_{false};
+};
+
+} /* namespace common */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_COMMON_RINGQUEUE_H_ */
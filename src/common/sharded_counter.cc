@@ -0,0 +1,58 @@
+/* sharded_counter.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Counter split into cache line padded per thread shards, for
+ * counting on hot paths from many threads.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "common/sharded_counter.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace project_structure
+{
+namespace common
+{
+
+static_assert((kCounterShardCount & (kCounterShardCount - 1)) == 0,
+    "kCounterShardCount must be a power of two");
+
+/* Hands out shard indices to threads round-robin. */
+static constinit std::atomic<std::size_t> next_thread_shard{0};
+
+constinit thread_local std::size_t current_thread_shard = kCounterShardCount;
+
+std::size_t AssignThreadShard()
+{
+  current_thread_shard = next_thread_shard.fetch_add(1,
+      std::memory_order_relaxed) & (kCounterShardCount - 1);
+  return current_thread_shard;
+}
+
+std::int64_t ShardedCounter::Snapshot() const
+{
+  std::int64_t sum = 0;
+  for (const Slot &slot : slots_)
+  {
+    sum += slot.value.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+void ShardedCounter::Reset()
+{
+  for (Slot &slot : slots_)
+  {
+    slot.value.store(0, std::memory_order_relaxed);
+  }
+}
+
+} /* namespace common */
+} /* namespace project_structure */
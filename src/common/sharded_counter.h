@@ -0,0 +1,139 @@
+/* sharded_counter.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Counter split into cache line padded per thread shards, for
+ * counting on hot paths from many threads.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_COMMON_SHARDEDCOUNTER_H_
+#define PROJECTSTRUCTURE_COMMON_SHARDEDCOUNTER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/*!
+ * @brief Size, in bytes, assumed for one cache line.
+ *
+ * Used to pad data which is written by different threads so that the writes
+ * do not invalidate each others cache lines (false sharing).
+ */
+constexpr std::size_t kCacheLineSize = 64;
+
+/*!
+ * @brief Number of shards in every ShardedCounter, a power of two.
+ */
+constexpr std::size_t kCounterShardCount = 64;
+
+/*!
+ * @brief Shard index of the calling thread, kCounterShardCount until
+ * CurrentThreadShard has assigned one.
+ */
+extern constinit thread_local std::size_t current_thread_shard;
+
+/*!
+ * @brief Assigns the calling thread its shard index, the slow path of
+ * CurrentThreadShard.
+ *
+ * @return Index in the range [0, kCounterShardCount).
+ */
+std::size_t AssignThreadShard();
+
+/*!
+ * @brief Returns the shard index of the calling thread.
+ *
+ * Threads are assigned indices round-robin the first time they call this
+ * function, the index then stays the same for the lifetime of the thread. With
+ * more than kCounterShardCount threads some threads share a shard, which is
+ * still correct but contended. Inline, so that an increment costs a thread
+ * local load and an atomic add.
+ *
+ * @return Index in the range [0, kCounterShardCount).
+ */
+inline std::size_t CurrentThreadShard()
+{
+  if (current_thread_shard == kCounterShardCount)
+  {
+    return AssignThreadShard();
+  }
+  return current_thread_shard;
+}
+
+/*!
+ * @brief Event counter that scales with the number of threads.
+ *
+ * Every thread increments its own cache line padded slot with a relaxed
+ * atomic add, so increments from different threads never contend.
+ * Snapshot sums all slots, which makes reading more expensive than writing,
+ * this is the intended trade-off for counters that are updated on the hot path
+ * and read rarely (statistics, reports).
+ *
+ * The class is neither copyable nor movable.
+ *
+ * @note Snapshot is not a linearizable read, increments that happen
+ * concurrently with it may or may not be included.
+ */
+class ShardedCounter
+{
+ public:
+  ShardedCounter() = default;
+  ShardedCounter(const ShardedCounter &) = delete;
+  ShardedCounter &operator=(const ShardedCounter &) = delete;
+
+  ~ShardedCounter() = default;
+
+  /*!
+   * @brief Adds delta to the calling thread's slot.
+   *
+   * @param[in] delta Value to add, may be negative.
+   */
+  void Add(std::int64_t delta)
+  {
+    slots_[CurrentThreadShard()].value.fetch_add(delta,
+        std::memory_order_relaxed);
+  }
+
+  /*! @brief Adds one to the calling thread's slot. */
+  void Increment()
+  {
+    Add(1);
+  }
+
+  /*!
+   * @brief Returns the sum of every slot.
+   *
+   * @return The aggregated value of the counter.
+   */
+  std::int64_t Snapshot() const;
+
+  /*!
+   * @brief Sets every slot to zero.
+   *
+   * @warning Increments done concurrently with Reset may be lost.
+   */
+  void Reset();
+
+ private:
+  /* One slot per shard, padded so that no two slots share a cache line. */
+  struct alignas(kCacheLineSize) Slot
+  {
+    std::atomic<std::int64_t> value{0};
+  };
+
+  Slot slots_[kCounterShardCount];
+};
+
+} /* namespace common */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_COMMON_SHARDEDCOUNTER_H_ */
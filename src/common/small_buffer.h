@@ -0,0 +1,206 @@
+/* small_buffer.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Byte buffer which keeps short contents inline and only
+ * allocates for long ones.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_COMMON_SMALLBUFFER_H_
+#define PROJECTSTRUCTURE_COMMON_SMALLBUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <span>
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/*!
+ * @brief Byte buffer with room for kInlineCapacity bytes inside the object.
+ *
+ * Contents up to kInlineCapacity bytes live inline, next to whatever holds
+ * the buffer, so reading them costs no extra cache miss and storing them no
+ * allocation. Longer contents spill to one heap block, which is kept when the
+ * contents shrink again and reused for later contents that fit.
+ *
+ * Copying copies the contents and allocates only if they do not fit inline.
+ * Moving never allocates: a heap block is handed over and inline contents
+ * are copied. A moved from buffer is empty and can be reused.
+ *
+ * The class is copyable and movable. It is not thread safe.
+ */
+template <std::size_t kInlineCapacity>
+class SmallBuffer
+{
+ public:
+  static_assert(kInlineCapacity >= sizeof(std::byte *),
+      "the inline storage also holds the heap pointer");
+  static_assert(kInlineCapacity <= std::numeric_limits<std::uint32_t>::max(),
+      "sizes are 32 bit");
+
+  SmallBuffer() = default;
+
+  SmallBuffer(const SmallBuffer &other)
+  {
+    Assign(other.Data());
+  }
+
+  SmallBuffer(SmallBuffer &&other) noexcept
+  {
+    TakeFrom(other);
+  }
+
+  SmallBuffer &operator=(const SmallBuffer &other)
+  {
+    if (this != &other)
+    {
+      Assign(other.Data());
+    }
+    return *this;
+  }
+
+  SmallBuffer &operator=(SmallBuffer &&other) noexcept
+  {
+    if (this != &other)
+    {
+      Release();
+      TakeFrom(other);
+    }
+    return *this;
+  }
+
+  ~SmallBuffer()
+  {
+    Release();
+  }
+
+  /*!
+   * @brief Replaces the contents with a copy of data.
+   *
+   * @param[in] data The new contents, may point into this buffer.
+   *
+   * @return false, with the contents unchanged, if data is longer than
+   * 2^32 - 1 bytes or a heap block could not be allocated.
+   */
+  bool Assign(std::span<const std::byte> data)
+  {
+    std::byte *block = nullptr;
+    if (data.size() > std::numeric_limits<std::uint32_t>::max())
+    {
+      return false;
+    }
+    if (data.size() > Capacity())
+    {
+      block = new (std::nothrow) std::byte[data.size()];
+      if (block == nullptr)
+      {
+        return false;
+      }
+      std::memcpy(block, data.data(), data.size());
+      Release();
+      storage_.heap = block;
+      heap_capacity_ = static_cast<std::uint32_t>(data.size());
+    }
+    else if (!data.empty())
+    {
+      std::memmove(Bytes(), data.data(), data.size());
+    }
+    size_ = static_cast<std::uint32_t>(data.size());
+    return true;
+  }
+
+  /*! @brief Empties the buffer, keeping a heap block for reuse. */
+  void Clear()
+  {
+    size_ = 0;
+  }
+
+  /*! @brief The contents. */
+  std::span<const std::byte> Data() const
+  {
+    return std::span<const std::byte>(heap_capacity_ == 0 ?
+        storage_.inline_bytes : storage_.heap, size_);
+  }
+
+  /*! @brief The contents, writable in place. */
+  std::span<std::byte> MutableData()
+  {
+    return std::span<std::byte>(Bytes(), size_);
+  }
+
+  /*! @brief Number of bytes in the buffer. */
+  std::size_t Size() const
+  {
+    return size_;
+  }
+
+  /*! @brief Largest contents which fit without allocating. */
+  std::size_t Capacity() const
+  {
+    return heap_capacity_ == 0 ? kInlineCapacity : heap_capacity_;
+  }
+
+  /*! @brief True if the contents live inside the object. */
+  bool IsInline() const
+  {
+    return heap_capacity_ == 0;
+  }
+
+ private:
+  std::byte *Bytes()
+  {
+    return heap_capacity_ == 0 ? storage_.inline_bytes : storage_.heap;
+  }
+
+  /* Frees the heap block, if any, and goes back to inline storage. */
+  void Release()
+  {
+    if (heap_capacity_ != 0)
+    {
+      delete[] storage_.heap;
+    }
+    heap_capacity_ = 0;
+    size_ = 0;
+  }
+
+  /* Takes over the contents of other, which must not own a block any more. */
+  void TakeFrom(SmallBuffer &other)
+  {
+    size_ = other.size_;
+    heap_capacity_ = other.heap_capacity_;
+    if (heap_capacity_ != 0)
+    {
+      storage_.heap = other.storage_.heap;
+    }
+    else
+    {
+      std::memcpy(storage_.inline_bytes, other.storage_.inline_bytes, size_);
+    }
+    other.size_ = 0;
+    other.heap_capacity_ = 0;
+  }
+
+  std::uint32_t size_ = 0;
+  /* 0 while the contents are inline. */
+  std::uint32_t heap_capacity_ = 0;
+  union Storage
+  {
+    std::byte inline_bytes[kInlineCapacity];
+    std::byte *heap;
+  } storage_;
+};
+
+} /* namespace common */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_COMMON_SMALLBUFFER_H_ */
@@ -0,0 +1,277 @@
+/* stats.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Low overhead hot path instrumentation, scoped timers and named
+ * counters recorded into per thread buffers which are merged on demand.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "common/stats.h"
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <new>
+#include <vector>
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/* Shortest interval the tick rate is measured over. */
+constexpr std::chrono::milliseconds kMinCalibrationTime{10};
+
+constinit std::atomic<bool> stats_enabled{false};
+
+constinit thread_local ThreadStats *current_thread_stats = nullptr;
+
+/*
+ * The registry. Stats are registered while other translation units are
+ * dynamically initialized, so everything here is constant initialized to be
+ * usable before this file's own dynamic initialization has run. The mutex
+ * guards the names, the kinds and the list of buffers.
+ */
+constinit std::mutex stats_mutex;
+constinit const char *stat_names[kMaxStats] = {};
+constinit StatKind stat_kinds[kMaxStats] = {};
+constinit std::uint32_t stat_count = 0;
+constinit ThreadStats *thread_stats_list = nullptr;
+
+/*
+ * Shared by every thread when a buffer can not be allocated. The single writer
+ * assumption is broken then, so samples may get lost but nothing worse.
+ */
+constinit ThreadStats fallback_thread_stats;
+
+/* Start of the tick to nanosecond calibration interval. */
+const std::uint64_t kStartTicks = ReadStatTicks();
+const std::chrono::steady_clock::time_point kStartTime =
+    std::chrono::steady_clock::now();
+
+/*
+ * Hands the calling thread's buffer back when the thread exits. Thread local
+ * since thread exit is the only point where it is known that the buffer is no
+ * longer written.
+ */
+struct ThreadStatsOwner
+{
+  ~ThreadStatsOwner()
+  {
+    if (stats != nullptr && stats != &fallback_thread_stats)
+    {
+      std::lock_guard<std::mutex> lock(stats_mutex);
+      stats->in_use = false;
+    }
+    current_thread_stats = nullptr;
+  }
+
+  ThreadStats *stats = nullptr;
+};
+
+thread_local ThreadStatsOwner thread_stats_owner;
+
+StatId RegisterStat(const char *name, StatKind kind)
+{
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  if (stat_count == kMaxStats)
+  {
+    stat_names[kMaxStats - 1] = "<other>";
+    return StatId{static_cast<std::uint32_t>(kMaxStats - 1)};
+  }
+  stat_names[stat_count] = name;
+  stat_kinds[stat_count] = kind;
+  return StatId{stat_count++};
+}
+
+void SetStatsEnabled(bool enabled)
+{
+  stats_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+ThreadStats *AttachThreadStats()
+{
+  ThreadStats *stats = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    for (stats = thread_stats_list; stats != nullptr; stats = stats->next)
+    {
+      if (!stats->in_use)
+      {
+        break;
+      }
+    }
+    if (stats == nullptr)
+    {
+      stats = new (std::nothrow) ThreadStats();
+      if (stats != nullptr)
+      {
+        stats->next = thread_stats_list;
+        thread_stats_list = stats;
+      }
+    }
+    if (stats != nullptr)
+    {
+      stats->in_use = true;
+    }
+  }
+  if (stats == nullptr)
+  {
+    stats = &fallback_thread_stats;
+  }
+  thread_stats_owner.stats = stats;
+  current_thread_stats = stats;
+  return stats;
+}
+
+double NanosecondsPerStatTick()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::uint64_t ticks = 0;
+  std::chrono::duration<double, std::nano> elapsed;
+  /* Very early reports wait a little for a usable measurement. */
+  while (now - kStartTime < kMinCalibrationTime)
+  {
+    now = std::chrono::steady_clock::now();
+  }
+  ticks = ReadStatTicks() - kStartTicks;
+  elapsed = now - kStartTime;
+  return ticks == 0 ? 1.0 : elapsed.count() / static_cast<double>(ticks);
+#else
+  /* The ticks already are nanoseconds. */
+  return 1.0;
+#endif
+}
+
+/*
+ * Estimates the quantile, in ticks, from the log2 histogram by interpolating
+ * linearly within the bucket the quantile falls in.
+ */
+static double BucketQuantile(const std::uint64_t *buckets, std::uint64_t count,
+    double quantile, std::uint64_t max)
+{
+  std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(quantile *
+      static_cast<double>(count)));
+  std::uint64_t seen = 0;
+  double lower = 0.0;
+  double upper = 0.0;
+  double value = 0.0;
+  for (std::size_t i = 0; i < kStatBuckets; ++i)
+  {
+    if (buckets[i] == 0 || seen + buckets[i] < rank)
+    {
+      seen += buckets[i];
+      continue;
+    }
+    lower = i == 0 ? 0.0 : std::ldexp(1.0, static_cast<int>(i) - 1);
+    upper = std::ldexp(1.0, static_cast<int>(i));
+    value = lower + (upper - lower) * static_cast<double>(rank - seen) /
+        static_cast<double>(buckets[i]);
+    return value < static_cast<double>(max) ? value : static_cast<double>(max);
+  }
+  return static_cast<double>(max);
+}
+
+/* Sums of one stat over every buffer. */
+struct MergedStat
+{
+  std::uint64_t count = 0;
+  std::uint64_t sampled = 0;
+  std::uint64_t total = 0;
+  std::uint64_t max = 0;
+  std::uint64_t buckets[kStatBuckets] = {};
+};
+
+static void MergeStatSlot(const ThreadStatSlot &slot, MergedStat &merged)
+{
+  std::uint64_t max = slot.max.load(std::memory_order_relaxed);
+  merged.count += slot.count.load(std::memory_order_relaxed);
+  merged.sampled += slot.sampled.load(std::memory_order_relaxed);
+  merged.total += slot.total.load(std::memory_order_relaxed);
+  merged.max = max > merged.max ? max : merged.max;
+  for (std::size_t i = 0; i < kStatBuckets; ++i)
+  {
+    merged.buckets[i] += slot.buckets[i].load(std::memory_order_relaxed);
+  }
+}
+
+std::vector<StatSummary> CollectStats()
+{
+  const double kNanosecondsPerTick = NanosecondsPerStatTick();
+  std::vector<StatSummary> summaries;
+  MergedStat merged;
+  double total = 0.0;
+  double mean = 0.0;
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  for (std::uint32_t i = 0; i < stat_count; ++i)
+  {
+    merged = MergedStat{};
+    for (ThreadStats *stats = thread_stats_list; stats != nullptr;
+        stats = stats->next)
+    {
+      MergeStatSlot(stats->slots[i], merged);
+    }
+    MergeStatSlot(fallback_thread_stats.slots[i], merged);
+    if (stat_kinds[i] == StatKind::kCounter)
+    {
+      summaries.push_back(StatSummary{stat_names[i], stat_kinds[i],
+          merged.count, 0, static_cast<double>(merged.total),
+          merged.count == 0 ? 0.0 : static_cast<double>(merged.total) /
+              static_cast<double>(merged.count),
+          0.0, 0.0, 0.0});
+      continue;
+    }
+    /* Only the sampled scopes are timed, scale them up to all of them. */
+    mean = merged.sampled == 0 ? 0.0 : static_cast<double>(merged.total) *
+        kNanosecondsPerTick / static_cast<double>(merged.sampled);
+    total = mean * static_cast<double>(merged.count);
+    summaries.push_back(StatSummary{stat_names[i], stat_kinds[i],
+        merged.count, merged.sampled, total, mean,
+        BucketQuantile(merged.buckets, merged.sampled, 0.5, merged.max) *
+            kNanosecondsPerTick,
+        BucketQuantile(merged.buckets, merged.sampled, 0.99, merged.max) *
+            kNanosecondsPerTick,
+        static_cast<double>(merged.max) * kNanosecondsPerTick});
+  }
+  return summaries;
+}
+
+void PrintStatsReport(std::FILE *file)
+{
+  std::vector<StatSummary> summaries = CollectStats();
+  std::fprintf(file, "%-32s %12s %10s %10s %10s %10s %10s\n", "timer",
+      "calls", "total ms", "mean ns", "p50 ns", "p99 ns", "max ns");
+  for (const StatSummary &summary : summaries)
+  {
+    if (summary.kind == StatKind::kTimer && summary.count > 0)
+    {
+      std::fprintf(file, "%-32s %12" PRIu64 " %10.3f %10.1f %10.1f %10.1f "
+          "%10.1f\n", summary.name, summary.count,
+          summary.total / 1e6, summary.mean_ns, summary.p50_ns,
+          summary.p99_ns, summary.max_ns);
+    }
+  }
+  std::fprintf(file, "%-32s %12s %16s\n", "counter", "calls", "value");
+  for (const StatSummary &summary : summaries)
+  {
+    if (summary.kind == StatKind::kCounter && summary.count > 0)
+    {
+      std::fprintf(file, "%-32s %12" PRIu64 " %16.0f\n", summary.name,
+          summary.count, summary.total);
+    }
+  }
+  std::fflush(file);
+}
+
+} /* namespace common */
+} /* namespace project_structure */
@@ -0,0 +1,331 @@
+/* stats.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Low overhead hot path instrumentation, scoped timers and named
+ * counters recorded into per thread buffers which are merged on demand.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_COMMON_STATS_H_
+#define PROJECTSTRUCTURE_COMMON_STATS_H_
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/*!
+ * @brief Whether the probes are compiled in.
+ *
+ * Building with PROJECTSTRUCTURE_DISABLE_STATS defined turns every probe into
+ * nothing. When compiled in, a probe costs one relaxed load as long as the
+ * stats are not enabled at runtime with SetStatsEnabled.
+ */
+#if defined(PROJECTSTRUCTURE_DISABLE_STATS)
+constexpr bool kStatsCompiledIn = false;
+#else
+constexpr bool kStatsCompiledIn = true;
+#endif
+
+/*!
+ * @brief Maximum number of registered stats, later registrations share the
+ * last slot.
+ */
+constexpr std::size_t kMaxStats = 64;
+
+/*!
+ * @brief One in this many scopes of a timer is timed, per thread, a power of
+ * two.
+ *
+ * Reading the clock twice is most of the cost of a timed scope, 50 ns where
+ * the hypervisor traps rdtsc. Timing a sample keeps the average cost of a
+ * probe to a few nanoseconds. Every scope is still counted.
+ */
+constexpr std::uint64_t kStatSampleInterval = 8;
+
+/*!
+ * @brief Number of latency histogram buckets, bucket i counts durations of
+ * [2^(i-1), 2^i) ticks and the last bucket everything longer.
+ */
+constexpr std::size_t kStatBuckets = 40;
+
+/*!
+ * @brief What a stat measures.
+ */
+enum class StatKind
+{
+  kTimer = 0,
+  kCounter = 1
+};
+
+/*!
+ * @brief Handle of a registered stat, cheap to copy.
+ */
+struct StatId
+{
+  std::uint32_t index;
+};
+
+/*!
+ * @brief Per thread values of one stat. Only the owning thread writes them,
+ * the atomics let a report read them while the owner runs.
+ */
+struct ThreadStatSlot
+{
+  /* Timer: number of scopes. Counter: number of AddToStat calls. */
+  std::atomic<std::uint64_t> count{0};
+  /* Timer: number of timed scopes, unused for counters. */
+  std::atomic<std::uint64_t> sampled{0};
+  /* Timer: ticks spent in the timed scopes. Counter: sum of the values. */
+  std::atomic<std::uint64_t> total{0};
+  /* Timer only, the longest and the histogram of the timed scopes. */
+  std::atomic<std::uint64_t> max{0};
+  std::atomic<std::uint64_t> buckets[kStatBuckets] = {};
+};
+
+/*!
+ * @brief The per thread buffer, one slot per possible stat.
+ *
+ * Buffers are reused by new threads once their thread has exited, so their
+ * number is bounded by the largest number of threads alive at once.
+ */
+struct ThreadStats
+{
+  ThreadStatSlot slots[kMaxStats];
+  /* Every buffer ever created is kept in a list, see stats.cc. */
+  ThreadStats *next = nullptr;
+  bool in_use = false;
+};
+
+/*!
+ * @brief Set by SetStatsEnabled, read by every probe.
+ */
+extern constinit std::atomic<bool> stats_enabled;
+
+/*!
+ * @brief Buffer of the calling thread, nullptr until its first probe.
+ */
+extern constinit thread_local ThreadStats *current_thread_stats;
+
+/*!
+ * @brief Registers a stat and returns its handle.
+ *
+ * Meant to be called once per stat, typically to initialize a namespace scope
+ * constant in the .cc file containing the probes. Registering the same name
+ * twice gives two stats which are reported separately.
+ *
+ * @param[in] name Name used in reports, must outlive the process.
+ * @param[in] kind Timer or counter.
+ */
+StatId RegisterStat(const char *name, StatKind kind);
+
+/*!
+ * @brief Turns recording on or off at runtime, off by default.
+ */
+void SetStatsEnabled(bool enabled);
+
+/*! @brief Returns true if the probes currently record. */
+inline bool StatsEnabled()
+{
+  return stats_enabled.load(std::memory_order_relaxed);
+}
+
+/*!
+ * @brief Returns the tick counter timers measure with.
+ *
+ * The time stamp counter on x86, nanoseconds of the steady clock elsewhere.
+ * Ticks are converted to nanoseconds when the stats are collected.
+ */
+inline std::uint64_t ReadStatTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  return static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+/*!
+ * @brief Returns how many nanoseconds one tick of ReadStatTicks is.
+ *
+ * Measured against the steady clock since the program started, the first
+ * call may wait a few milliseconds for a usable interval.
+ */
+double NanosecondsPerStatTick();
+
+/*!
+ * @brief Creates the calling thread's buffer, called by the first probe.
+ */
+ThreadStats *AttachThreadStats();
+
+/*! @brief Slot of stat id in the calling thread's buffer. */
+inline ThreadStatSlot &CurrentThreadStatSlot(StatId id)
+{
+  ThreadStats *stats = current_thread_stats;
+  if (stats == nullptr)
+  {
+    stats = AttachThreadStats();
+  }
+  return stats->slots[id.index];
+}
+
+/*
+ * The slots have a single writer, so a load and a store is enough and
+ * cheaper than an atomic add.
+ */
+inline void AddToSlotValue(std::atomic<std::uint64_t> &value,
+    std::uint64_t delta)
+{
+  value.store(value.load(std::memory_order_relaxed) + delta,
+      std::memory_order_relaxed);
+}
+
+/*!
+ * @brief Adds the duration of one timed scope to a timer slot.
+ *
+ * @param[in] slot Slot of the timer in the calling thread's buffer.
+ * @param[in] ticks Duration of the scope.
+ */
+inline void RecordStatSample(ThreadStatSlot &slot, std::uint64_t ticks)
+{
+  std::size_t bucket = static_cast<std::size_t>(std::bit_width(ticks));
+  AddToSlotValue(slot.sampled, 1);
+  AddToSlotValue(slot.total, ticks);
+  if (ticks > slot.max.load(std::memory_order_relaxed))
+  {
+    slot.max.store(ticks, std::memory_order_relaxed);
+  }
+  bucket = bucket < kStatBuckets ? bucket : kStatBuckets - 1;
+  AddToSlotValue(slot.buckets[bucket], 1);
+}
+
+/*!
+ * @brief Adds value to counter id, does nothing when stats are disabled.
+ */
+inline void AddToStat(StatId id, std::uint64_t value)
+{
+  if constexpr (kStatsCompiledIn)
+  {
+    if (StatsEnabled())
+    {
+      ThreadStatSlot &slot = CurrentThreadStatSlot(id);
+      AddToSlotValue(slot.count, 1);
+      AddToSlotValue(slot.total, value);
+    }
+  }
+}
+
+/*!
+ * @brief Counts a scope of a timer and times one in kStatSampleInterval of
+ * them, from construction to destruction.
+ *
+ * An untimed scope costs a few relaxed loads and stores when enabled, a
+ * timed one two more reads of the time stamp counter. Nothing is left when
+ * the stats are compiled out:
+ *
+ * const common::StatId kSomeStat = common::RegisterStat("SomeFunction",
+ *     common::StatKind::kTimer);
+ * void SomeFunction()
+ * {
+ *   common::ScopedStatTimer timer(kSomeStat);
+ *   ...
+ * }
+ *
+ * The class is neither copyable nor movable.
+ */
+class ScopedStatTimer
+{
+ public:
+  explicit ScopedStatTimer(StatId id)
+  {
+    std::uint64_t count = 0;
+    if constexpr (kStatsCompiledIn)
+    {
+      if (StatsEnabled())
+      {
+        slot_ = &CurrentThreadStatSlot(id);
+        count = slot_->count.load(std::memory_order_relaxed);
+        slot_->count.store(count + 1, std::memory_order_relaxed);
+        if ((count & (kStatSampleInterval - 1)) == 0)
+        {
+          start_ = ReadStatTicks();
+        }
+      }
+    }
+  }
+  ScopedStatTimer(const ScopedStatTimer &) = delete;
+  ScopedStatTimer &operator=(const ScopedStatTimer &) = delete;
+
+  ~ScopedStatTimer()
+  {
+    if constexpr (kStatsCompiledIn)
+    {
+      if (start_ != 0)
+      {
+        RecordStatSample(*slot_, ReadStatTicks() - start_);
+      }
+    }
+  }
+
+ private:
+  /* nullptr if the stats were disabled at construction. */
+  ThreadStatSlot *slot_ = nullptr;
+  /* 0 unless this scope is timed. */
+  std::uint64_t start_ = 0;
+};
+
+/*!
+ * @brief Merged values of one stat over every thread, in nanoseconds for
+ * timers.
+ */
+struct StatSummary
+{
+  const char *name;
+  StatKind kind;
+  std::uint64_t count;
+  /* Timer: number of timed scopes, the rest are estimated from them. */
+  std::uint64_t sampled;
+  /*
+   * Timer: total nanoseconds, the timed ones scaled up to every scope.
+   * Counter: sum of the added values.
+   */
+  double total;
+  double mean_ns;
+  double p50_ns;
+  double p99_ns;
+  double max_ns;
+};
+
+/*!
+ * @brief Merges the buffers of every thread, including threads which have
+ * exited, into one summary per registered stat.
+ *
+ * May be called at any time from any thread. Samples recorded concurrently
+ * may or may not be included.
+ */
+std::vector<StatSummary> CollectStats();
+
+/*!
+ * @brief Writes a table of CollectStats to file, stats without samples are
+ * left out.
+ */
+void PrintStatsReport(std::FILE *file);
+
+} /* namespace common */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_COMMON_STATS_H_ */
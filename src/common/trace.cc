@@ -0,0 +1,298 @@
+/* trace.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Event tracer recording begin, end, instant and counter events
+ * into per thread rings, written out as Chrome trace JSON on demand.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "common/trace.h"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <mutex>
+#include <new>
+#include <string_view>
+#include <vector>
+
+#include "common/stats.h"
+
+
+namespace project_structure
+{
+namespace common
+{
+
+constinit std::atomic<std::uint32_t> trace_categories{0};
+
+constinit thread_local ThreadTrace *current_thread_trace = nullptr;
+
+/*
+ * Every ring ever created, reused once their thread has exited. Constant
+ * initialized like the stats registry, events may be recorded while other
+ * translation units are dynamically initialized. The mutex guards the list
+ * and the owner fields of the rings, not the events.
+ */
+constinit std::mutex trace_mutex;
+constinit ThreadTrace *thread_trace_list = nullptr;
+
+/* Origin of the timestamps in a trace. */
+const std::uint64_t kTraceStartTicks = ReadStatTicks();
+
+/* Names of the categories, bit i of the mask is kTraceCategoryNames[i]. */
+constexpr const char *kTraceCategoryNames[] = {"module_a", "module_b", "io"};
+
+/*
+ * Hands the calling thread's ring back when the thread exits. Thread local
+ * for the same reason as ThreadStatsOwner.
+ */
+struct ThreadTraceOwner
+{
+  ~ThreadTraceOwner()
+  {
+    if (trace != nullptr)
+    {
+      std::lock_guard<std::mutex> lock(trace_mutex);
+      trace->in_use = false;
+    }
+    current_thread_trace = nullptr;
+  }
+
+  ThreadTrace *trace = nullptr;
+};
+
+thread_local ThreadTraceOwner thread_trace_owner;
+
+void SetTraceCategories(std::uint32_t categories)
+{
+  trace_categories.store(categories & kAllTraceCategories,
+      std::memory_order_relaxed);
+}
+
+bool ParseTraceCategories(const char *text, std::uint32_t &categories)
+{
+  std::string_view rest = text;
+  std::string_view name;
+  std::size_t comma = 0;
+  std::size_t i = 0;
+  categories = 0;
+  while (!rest.empty())
+  {
+    comma = rest.find(',');
+    name = rest.substr(0, comma);
+    rest = comma == std::string_view::npos ? std::string_view() :
+        rest.substr(comma + 1);
+    if (name == "all")
+    {
+      categories |= kAllTraceCategories;
+      continue;
+    }
+    for (i = 0; i < std::size(kTraceCategoryNames); ++i)
+    {
+      if (name == kTraceCategoryNames[i])
+      {
+        break;
+      }
+    }
+    if (i == std::size(kTraceCategoryNames))
+    {
+      return false;
+    }
+    categories |= std::uint32_t{1} << i;
+  }
+  return categories != 0;
+}
+
+ThreadTrace *AttachThreadTrace()
+{
+  ThreadTrace *trace = nullptr;
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  for (trace = thread_trace_list; trace != nullptr; trace = trace->next)
+  {
+    if (!trace->in_use)
+    {
+      break;
+    }
+  }
+  if (trace == nullptr)
+  {
+    /* The events of a thread which can not get a ring are dropped. */
+    trace = new (std::nothrow) ThreadTrace();
+    if (trace == nullptr)
+    {
+      return nullptr;
+    }
+    trace->next = thread_trace_list;
+    thread_trace_list = trace;
+  }
+  trace->in_use = true;
+  trace->first_event = trace->committed.load(std::memory_order_relaxed);
+  trace->thread_id = static_cast<int>(syscall(SYS_gettid));
+  thread_trace_owner.trace = trace;
+  current_thread_trace = trace;
+  return trace;
+}
+
+/* Appends the events of trace which are still intact to records. */
+static void CollectThreadTrace(const ThreadTrace &trace,
+    double nanoseconds_per_tick, std::vector<TraceRecord> &records)
+{
+  const std::uint64_t kCommitted = trace.committed.load(
+      std::memory_order_acquire);
+  const std::size_t kFirstRecord = records.size();
+  std::uint64_t first = kCommitted > kTraceEventsPerThread ?
+      kCommitted - kTraceEventsPerThread : 0;
+  std::uint64_t overwritten = 0;
+  const TraceSlot *slot = nullptr;
+  std::uint32_t kind = 0;
+  std::int64_t ticks = 0;
+  std::int64_t value = 0;
+  first = first > trace.first_event ? first : trace.first_event;
+  for (std::uint64_t i = first; i < kCommitted; ++i)
+  {
+    slot = &trace.slots[i % kTraceEventsPerThread];
+    kind = slot->kind.load(std::memory_order_relaxed);
+    ticks = static_cast<std::int64_t>(slot->ticks.load(
+        std::memory_order_relaxed) - kTraceStartTicks);
+    value = slot->value.load(std::memory_order_relaxed);
+    records.push_back(TraceRecord{slot->name.load(std::memory_order_relaxed),
+        static_cast<TraceCategory>(kind >> 8),
+        static_cast<TracePhase>(kind & 0xffu), trace.thread_id,
+        static_cast<double>(ticks) * nanoseconds_per_tick,
+        static_cast<TracePhase>(kind & 0xffu) == TracePhase::kComplete ?
+            static_cast<double>(value) * nanoseconds_per_tick :
+            static_cast<double>(value)});
+  }
+  /*
+   * A slot the owner started to overwrite while it was copied belongs to an
+   * event older than reserved - kTraceEventsPerThread, drop those.
+   */
+  std::atomic_thread_fence(std::memory_order_acquire);
+  overwritten = trace.reserved.load(std::memory_order_relaxed);
+  overwritten = overwritten > kTraceEventsPerThread ?
+      overwritten - kTraceEventsPerThread : 0;
+  if (overwritten > first)
+  {
+    records.erase(records.begin() + static_cast<std::ptrdiff_t>(kFirstRecord),
+        records.begin() + static_cast<std::ptrdiff_t>(kFirstRecord +
+            (overwritten < kCommitted ? overwritten : kCommitted) - first));
+  }
+}
+
+std::vector<TraceRecord> CollectTrace()
+{
+  const double kNanosecondsPerTick = NanosecondsPerStatTick();
+  std::vector<TraceRecord> records;
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  for (ThreadTrace *trace = thread_trace_list; trace != nullptr;
+      trace = trace->next)
+  {
+    CollectThreadTrace(*trace, kNanosecondsPerTick, records);
+  }
+  return records;
+}
+
+/* Writes text as a JSON string. */
+static void WriteJsonString(std::FILE *file, const char *text)
+{
+  std::fputc('"', file);
+  for (const char *c = text; *c != '\0'; ++c)
+  {
+    if (*c == '"' || *c == '\\')
+    {
+      std::fputc('\\', file);
+      std::fputc(*c, file);
+    }
+    else if (static_cast<unsigned char>(*c) < 0x20)
+    {
+      std::fprintf(file, "\\u%04x", static_cast<unsigned int>(*c));
+    }
+    else
+    {
+      std::fputc(*c, file);
+    }
+  }
+  std::fputc('"', file);
+}
+
+/* Name of the single category in category. */
+static const char *TraceCategoryName(TraceCategory category)
+{
+  switch (category)
+  {
+    case TraceCategory::kModuleA:
+    {
+      return kTraceCategoryNames[0];
+    }
+    case TraceCategory::kModuleB:
+    {
+      return kTraceCategoryNames[1];
+    }
+    case TraceCategory::kIo:
+    {
+      return kTraceCategoryNames[2];
+    }
+    default:
+    {
+      return "unknown";
+    }
+  }
+}
+
+bool WriteChromeTrace(std::FILE *file)
+{
+  const int kProcessId = static_cast<int>(getpid());
+  std::vector<TraceRecord> records = CollectTrace();
+  bool first = true;
+  /* Chrome traces count in microseconds, with fractions for nanoseconds. */
+  std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  for (const TraceRecord &record : records)
+  {
+    std::fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+    first = false;
+    WriteJsonString(file, record.name != nullptr ? record.name : "");
+    std::fprintf(file, ",\"cat\":\"%s\",\"ph\":\"%c\",\"pid\":%d,"
+        "\"tid\":%d,\"ts\":%.3f", TraceCategoryName(record.category),
+        static_cast<char>(record.phase), kProcessId, record.thread_id,
+        record.timestamp_ns / 1e3);
+    switch (record.phase)
+    {
+      case TracePhase::kComplete:
+      {
+        std::fprintf(file, ",\"dur\":%.3f", record.value / 1e3);
+        break;
+      }
+      case TracePhase::kCounter:
+      {
+        std::fprintf(file, ",\"args\":{\"value\":%.0f}", record.value);
+        break;
+      }
+      case TracePhase::kInstant:
+      {
+        /* Drawn on the thread's track only. */
+        std::fprintf(file, ",\"s\":\"t\"");
+        break;
+      }
+      default:
+      {
+        break;
+      }
+    }
+    std::fputc('}', file);
+  }
+  std::fprintf(file, "\n]}\n");
+  std::fflush(file);
+  return std::ferror(file) == 0;
+}
+
+} /* namespace common */
+} /* namespace project_structure */
@@ -0,0 +1,321 @@
+/* trace.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Event tracer recording begin, end, instant and counter events
+ * into per thread rings, written out as Chrome trace JSON on demand.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_COMMON_TRACE_H_
+#define PROJECTSTRUCTURE_COMMON_TRACE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "common/stats.h"
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/*!
+ * @brief Whether the trace points are compiled in.
+ *
+ * Building with PROJECTSTRUCTURE_DISABLE_TRACE defined turns every trace
+ * point into nothing. When compiled in, a trace point costs one relaxed load
+ * while its category is not enabled with SetTraceCategories.
+ */
+#if defined(PROJECTSTRUCTURE_DISABLE_TRACE)
+constexpr bool kTraceCompiledIn = false;
+#else
+constexpr bool kTraceCompiledIn = true;
+#endif
+
+/*!
+ * @brief Events each thread keeps, a power of two. Older events are
+ * overwritten, so a trace holds the most recent ones of every thread.
+ */
+constexpr std::size_t kTraceEventsPerThread = std::size_t{1} << 15;
+
+/*!
+ * @brief What a trace event belongs to, one bit each so that they can be
+ * enabled in any combination.
+ */
+enum class TraceCategory : std::uint32_t
+{
+  kModuleA = 1,
+  kModuleB = 2,
+  /* Reads, writes and polling of sockets, pipes and files. */
+  kIo = 4
+};
+
+/*! @brief Every TraceCategory, for SetTraceCategories. */
+constexpr std::uint32_t kAllTraceCategories = 7;
+
+/*!
+ * @brief Kind of a trace event, the values are the Chrome trace phases.
+ */
+enum class TracePhase : std::uint8_t
+{
+  kBegin = 'B',
+  kEnd = 'E',
+  /* A whole scope, recorded at its end with its duration. */
+  kComplete = 'X',
+  kInstant = 'i',
+  kCounter = 'C'
+};
+
+/*!
+ * @brief One event in a thread's ring. Only the owning thread writes it, the
+ * atomics let a dump read it while the owner runs.
+ */
+struct TraceSlot
+{
+  std::atomic<std::uint64_t> ticks{0};
+  /* A string literal, only the pointer is recorded. */
+  std::atomic<const char *> name{nullptr};
+  /* Duration in ticks for kComplete, the value for kCounter. */
+  std::atomic<std::int64_t> value{0};
+  /* TracePhase in the low byte, TraceCategory above it. */
+  std::atomic<std::uint32_t> kind{0};
+};
+
+/*!
+ * @brief The per thread ring of events.
+ *
+ * Event i goes to slot i % kTraceEventsPerThread. The writer announces the
+ * event in reserved before it touches the slot and publishes it in committed
+ * afterwards, so a dump can tell which of the slots it copied may have been
+ * overwritten meanwhile. Rings are reused by new threads once their thread
+ * has exited, like the stats buffers.
+ */
+struct ThreadTrace
+{
+  TraceSlot slots[kTraceEventsPerThread];
+  std::atomic<std::uint64_t> reserved{0};
+  std::atomic<std::uint64_t> committed{0};
+  /* The fields below are guarded by the tracer's mutex, see trace.cc. */
+  /* First event of the current thread, earlier ones were a previous one's. */
+  std::uint64_t first_event = 0;
+  /* Kernel thread id of the owner. */
+  int thread_id = 0;
+  ThreadTrace *next = nullptr;
+  bool in_use = false;
+};
+
+/*!
+ * @brief Mask of the enabled categories, set by SetTraceCategories and read
+ * by every trace point.
+ */
+extern constinit std::atomic<std::uint32_t> trace_categories;
+
+/*!
+ * @brief Ring of the calling thread, nullptr until its first event.
+ */
+extern constinit thread_local ThreadTrace *current_thread_trace;
+
+/*!
+ * @brief Enables the categories in mask and disables the others, 0 turns
+ * tracing off. May be called at any time from any thread, events already
+ * recorded are kept.
+ *
+ * @param[in] categories Bitwise or of TraceCategory values.
+ */
+void SetTraceCategories(std::uint32_t categories);
+
+/*!
+ * @brief Parses a comma separated list of category names, "module_a",
+ * "module_b" and "io", or "all".
+ *
+ * @param[in] text The list.
+ * @param[out] categories Mask of the named categories.
+ *
+ * @return false if text names something else.
+ */
+bool ParseTraceCategories(const char *text, std::uint32_t &categories);
+
+/*! @brief Returns true if events of category are recorded. */
+inline bool TraceEnabled(TraceCategory category)
+{
+  return kTraceCompiledIn && (trace_categories.load(
+      std::memory_order_relaxed) & static_cast<std::uint32_t>(category)) != 0;
+}
+
+/*!
+ * @brief Creates the calling thread's ring, called by its first event.
+ *
+ * @return The ring, nullptr if it could not be allocated.
+ */
+ThreadTrace *AttachThreadTrace();
+
+/*!
+ * @brief Appends an event to the calling thread's ring, whether or not its
+ * category is enabled. The trace points below check that first.
+ */
+inline void RecordTraceEvent(TraceCategory category, TracePhase phase,
+    const char *name, std::uint64_t ticks, std::int64_t value)
+{
+  ThreadTrace *trace = current_thread_trace;
+  std::uint64_t index = 0;
+  if (trace == nullptr)
+  {
+    trace = AttachThreadTrace();
+    if (trace == nullptr)
+    {
+      return;
+    }
+  }
+  /* Single writer, so load and store is enough and cheaper than an add. */
+  index = trace->committed.load(std::memory_order_relaxed);
+  trace->reserved.store(index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  TraceSlot &slot = trace->slots[index % kTraceEventsPerThread];
+  slot.ticks.store(ticks, std::memory_order_relaxed);
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.value.store(value, std::memory_order_relaxed);
+  slot.kind.store(static_cast<std::uint32_t>(phase) |
+      (static_cast<std::uint32_t>(category) << 8), std::memory_order_relaxed);
+  trace->committed.store(index + 1, std::memory_order_release);
+}
+
+/*!
+ * @brief Starts a span on the calling thread which TraceEnd with the same
+ * category and name ends. Prefer ScopedTrace where the span is a scope.
+ *
+ * @param[in] category Category of the span.
+ * @param[in] name Name of the span, must be a string literal or otherwise
+ * outlive the process.
+ */
+inline void TraceBegin(TraceCategory category, const char *name)
+{
+  if (TraceEnabled(category))
+  {
+    RecordTraceEvent(category, TracePhase::kBegin, name, ReadStatTicks(), 0);
+  }
+}
+
+/*! @brief Ends the span started by TraceBegin. */
+inline void TraceEnd(TraceCategory category, const char *name)
+{
+  if (TraceEnabled(category))
+  {
+    RecordTraceEvent(category, TracePhase::kEnd, name, ReadStatTicks(), 0);
+  }
+}
+
+/*! @brief Records that something happened at this point in time. */
+inline void TraceInstant(TraceCategory category, const char *name)
+{
+  if (TraceEnabled(category))
+  {
+    RecordTraceEvent(category, TracePhase::kInstant, name, ReadStatTicks(),
+        0);
+  }
+}
+
+/*!
+ * @brief Records the current value of counter name, e.g. a queue depth.
+ * Trace viewers draw every counter as a graph over time.
+ */
+inline void TraceCounter(TraceCategory category, const char *name,
+    std::int64_t value)
+{
+  if (TraceEnabled(category))
+  {
+    RecordTraceEvent(category, TracePhase::kCounter, name, ReadStatTicks(),
+        value);
+  }
+}
+
+/*!
+ * @brief Records the time from construction to destruction as one span.
+ *
+ * The span is one complete event rather than a begin and end pair, which
+ * halves the cost and means that a ring which wrapped around never holds
+ * only half of a span:
+ *
+ * void SomeFunction()
+ * {
+ *   common::ScopedTrace trace(common::TraceCategory::kModuleA,
+ *       "SomeFunction");
+ *   ...
+ * }
+ *
+ * The class is neither copyable nor movable.
+ */
+class ScopedTrace
+{
+ public:
+  ScopedTrace(TraceCategory category, const char *name)
+      : category_(category), name_(name)
+  {
+    if (TraceEnabled(category))
+    {
+      start_ = ReadStatTicks();
+    }
+  }
+  ScopedTrace(const ScopedTrace &) = delete;
+  ScopedTrace &operator=(const ScopedTrace &) = delete;
+
+  ~ScopedTrace()
+  {
+    if (kTraceCompiledIn && start_ != 0)
+    {
+      RecordTraceEvent(category_, TracePhase::kComplete, name_, start_,
+          static_cast<std::int64_t>(ReadStatTicks() - start_));
+    }
+  }
+
+ private:
+  TraceCategory category_;
+  const char *name_;
+  /* 0 if the category was disabled at construction. */
+  std::uint64_t start_ = 0;
+};
+
+/*!
+ * @brief A recorded event, with its time converted to nanoseconds.
+ */
+struct TraceRecord
+{
+  const char *name;
+  TraceCategory category;
+  TracePhase phase;
+  int thread_id;
+  /* Since the tracer was loaded. */
+  double timestamp_ns;
+  /* Duration in nanoseconds for kComplete, the value for kCounter. */
+  double value;
+};
+
+/*!
+ * @brief Copies the events in the ring of every thread, including threads
+ * which have exited, ordered by thread and then by time.
+ *
+ * May be called at any time from any thread. Events which are overwritten
+ * while they are copied are left out.
+ */
+std::vector<TraceRecord> CollectTrace();
+
+/*!
+ * @brief Writes CollectTrace as Chrome trace JSON, which the Perfetto UI and
+ * Chrome's about:tracing open.
+ *
+ * @param[in] file Where to write, left open.
+ *
+ * @return false if writing failed.
+ */
+bool WriteChromeTrace(std::FILE *file);
+
+} /* namespace common */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_COMMON_TRACE_H_ */
@@ -0,0 +1,413 @@
+/* unix_server.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Server for length prefixed requests over a Unix domain stream
+ * socket, with pipelining and coalesced responses.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "common/unix_server.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "common/trace.h"
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/* Epoll data of the listening socket and of the stop eventfd. */
+constexpr std::uint64_t kListenSlot = ~std::uint64_t{0};
+constexpr std::uint64_t kStopSlot = kListenSlot - 1;
+
+/* Events taken per epoll_wait. */
+constexpr int kMaxServerEvents = 64;
+
+void AppendFrameHeader(std::vector<std::byte> &buffer, std::uint32_t size)
+{
+  for (std::size_t i = 0; i < kFrameHeaderSize; ++i)
+  {
+    buffer.push_back(static_cast<std::byte>(size >> (8 * i)));
+  }
+}
+
+std::uint32_t ReadFrameHeader(const std::byte *header)
+{
+  std::uint32_t size = 0;
+  for (std::size_t i = 0; i < kFrameHeaderSize; ++i)
+  {
+    size |= std::to_integer<std::uint32_t>(header[i]) << (8 * i);
+  }
+  return size;
+}
+
+UnixServer::UnixServer(const UnixServerOptions &options) :
+    options_(options)
+{
+}
+
+UnixServer::~UnixServer()
+{
+  CloseAll();
+  if (listen_fd_ >= 0)
+  {
+    close(listen_fd_);
+    unlink(path_.c_str());
+  }
+  if (epoll_fd_ >= 0)
+  {
+    close(epoll_fd_);
+  }
+  if (stop_fd_ >= 0)
+  {
+    close(stop_fd_);
+  }
+}
+
+bool UnixServer::Listen(const char *path)
+{
+  sockaddr_un address = {};
+  epoll_event event = {};
+  if (listen_fd_ >= 0 || std::strlen(path) >= sizeof(address.sun_path))
+  {
+    return false;
+  }
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, path, std::strlen(path));
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (epoll_fd_ < 0 || stop_fd_ < 0 || listen_fd_ < 0)
+  {
+    return false;
+  }
+  /* A socket file left behind by a server that did not exit cleanly. */
+  unlink(path);
+  if (bind(listen_fd_, reinterpret_cast<const sockaddr *>(&address),
+      sizeof(address)) != 0 || listen(listen_fd_, SOMAXCONN) != 0)
+  {
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+  path_ = path;
+  event.events = EPOLLIN;
+  event.data.u64 = kListenSlot;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event);
+  event.data.u64 = kStopSlot;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, stop_fd_, &event);
+  stats_ = UnixServerStats{};
+  return true;
+}
+
+bool UnixServer::Run(FrameHandler &handler)
+{
+  epoll_event events[kMaxServerEvents] = {};
+  int ready = 0;
+  std::uint64_t slot = 0;
+  Connection *connection = nullptr;
+  bool keep = true;
+  if (listen_fd_ < 0)
+  {
+    return false;
+  }
+
+  while (!stop_requested_.load(std::memory_order_acquire))
+  {
+    ready = epoll_wait(epoll_fd_, events, kMaxServerEvents, -1);
+    if (ready < 0 && errno != EINTR)
+    {
+      break;
+    }
+    for (int i = 0; i < ready; ++i)
+    {
+      slot = events[i].data.u64;
+      if (slot == kListenSlot)
+      {
+        Accept();
+        continue;
+      }
+      if (slot == kStopSlot || connections_[slot] == nullptr)
+      {
+        continue;
+      }
+      connection = connections_[slot].get();
+      keep = true;
+      if ((events[i].events & EPOLLOUT) != 0)
+      {
+        keep = Flush(slot, *connection);
+      }
+      /* Hang ups and errors are seen by the read. */
+      if (keep && (connection->events & EPOLLIN) != 0 &&
+          (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0)
+      {
+        keep = ReadRequests(slot, *connection, handler);
+      }
+      else if (keep && (events[i].events & (EPOLLHUP | EPOLLERR)) != 0)
+      {
+        keep = false;
+      }
+      if (!keep)
+      {
+        CloseConnection(slot);
+      }
+    }
+    free_slots_.insert(free_slots_.end(), closed_slots_.begin(),
+        closed_slots_.end());
+    closed_slots_.clear();
+  }
+
+  CloseAll();
+  close(listen_fd_);
+  listen_fd_ = -1;
+  unlink(path_.c_str());
+  return stop_requested_.load(std::memory_order_acquire);
+}
+
+void UnixServer::Stop()
+{
+  const std::uint64_t kOne = 1;
+  stop_requested_.store(true, std::memory_order_release);
+  if (stop_fd_ >= 0 && write(stop_fd_, &kOne, sizeof(kOne)) < 0)
+  {
+    /* The counter is already nonzero, Run wakes up either way. */
+  }
+}
+
+UnixServerStats UnixServer::Stats() const
+{
+  return stats_;
+}
+
+void UnixServer::Accept()
+{
+  epoll_event event = {};
+  std::size_t slot = 0;
+  int fd = accept4(listen_fd_, nullptr, nullptr,
+      SOCK_NONBLOCK | SOCK_CLOEXEC);
+  for (; fd >= 0; fd = accept4(listen_fd_, nullptr, nullptr,
+      SOCK_NONBLOCK | SOCK_CLOEXEC))
+  {
+    if (connection_count_ >= options_.max_connections)
+    {
+      close(fd);
+      continue;
+    }
+    if (free_slots_.empty())
+    {
+      slot = connections_.size();
+      connections_.emplace_back();
+    }
+    else
+    {
+      slot = free_slots_.back();
+      free_slots_.pop_back();
+    }
+    connections_[slot] = std::make_unique<Connection>(Connection{fd,
+        std::vector<std::byte>(options_.read_size), 0, 0, {}, 0, EPOLLIN});
+    event.events = EPOLLIN;
+    event.data.u64 = slot;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+      close(fd);
+      connections_[slot].reset();
+      free_slots_.push_back(slot);
+      continue;
+    }
+    ++connection_count_;
+    ++stats_.connections;
+  }
+}
+
+bool UnixServer::ReadRequests(std::size_t slot, Connection &connection,
+    FrameHandler &handler)
+{
+  std::size_t unhandled = 0;
+  ssize_t result = 0;
+  for (;;)
+  {
+    /* Move what is left of a partial request to the front. */
+    unhandled = connection.input_end - connection.input_begin;
+    if (connection.input_begin > 0 && connection.input.size() -
+        connection.input_end < options_.read_size)
+    {
+      std::memmove(connection.input.data(),
+          connection.input.data() + connection.input_begin, unhandled);
+      connection.input_begin = 0;
+      connection.input_end = unhandled;
+    }
+    /* Only a request larger than the buffer gets here with it full. */
+    if (connection.input_end == connection.input.size())
+    {
+      connection.input.resize(connection.input.size() * 2);
+    }
+    TraceBegin(TraceCategory::kIo, "UnixServer read");
+    result = read(connection.fd, connection.input.data() +
+        connection.input_end, connection.input.size() - connection.input_end);
+    TraceEnd(TraceCategory::kIo, "UnixServer read");
+    if (result < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (result <= 0)
+    {
+      break;
+    }
+    ++stats_.reads;
+    connection.input_end += static_cast<std::size_t>(result);
+    if (!HandleRequests(connection, handler))
+    {
+      return false;
+    }
+    /* A short read means that the socket is drained. */
+    if (connection.input_end < connection.input.size() ||
+        connection.output.size() - connection.output_begin >
+            options_.max_pending_output)
+    {
+      break;
+    }
+  }
+  if (result == 0)
+  {
+    /* The client is done sending, what it is owed is sent best effort. */
+    Flush(slot, connection);
+    return false;
+  }
+  if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+  {
+    return false;
+  }
+  return Flush(slot, connection);
+}
+
+bool UnixServer::HandleRequests(Connection &connection,
+    FrameHandler &handler)
+{
+  std::uint32_t size = 0;
+  while (connection.input_end - connection.input_begin >= kFrameHeaderSize)
+  {
+    size = ReadFrameHeader(connection.input.data() + connection.input_begin);
+    if (size > options_.max_frame_size)
+    {
+      return false;
+    }
+    if (connection.input_end - connection.input_begin <
+        kFrameHeaderSize + size)
+    {
+      break;
+    }
+    response_.clear();
+    if (!handler.HandleFrame(std::span<const std::byte>(
+        connection.input.data() + connection.input_begin + kFrameHeaderSize,
+        size), response_))
+    {
+      return false;
+    }
+    ++stats_.requests;
+    connection.input_begin += kFrameHeaderSize + size;
+    AppendFrameHeader(connection.output,
+        static_cast<std::uint32_t>(response_.size()));
+    connection.output.insert(connection.output.end(), response_.begin(),
+        response_.end());
+  }
+  if (connection.input_begin == connection.input_end)
+  {
+    connection.input_begin = 0;
+    connection.input_end = 0;
+  }
+  return true;
+}
+
+bool UnixServer::Flush(std::size_t slot, Connection &connection)
+{
+  epoll_event event = {};
+  ssize_t sent = 0;
+  std::size_t pending = 0;
+  while (connection.output_begin < connection.output.size())
+  {
+    TraceBegin(TraceCategory::kIo, "UnixServer send");
+    sent = send(connection.fd, connection.output.data() +
+        connection.output_begin, connection.output.size() -
+            connection.output_begin, MSG_NOSIGNAL);
+    TraceEnd(TraceCategory::kIo, "UnixServer send");
+    if (sent < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        break;
+      }
+      return false;
+    }
+    ++stats_.writes;
+    connection.output_begin += static_cast<std::size_t>(sent);
+  }
+  if (connection.output_begin == connection.output.size())
+  {
+    connection.output.clear();
+    connection.output_begin = 0;
+  }
+
+  /* Stop reading while the client does not keep up with the responses. */
+  pending = connection.output.size() - connection.output_begin;
+  TraceCounter(TraceCategory::kIo, "UnixServer pending output",
+      static_cast<std::int64_t>(pending));
+  event.events = (pending <= options_.max_pending_output ?
+      static_cast<std::uint32_t>(EPOLLIN) : 0) |
+      (pending > 0 ? static_cast<std::uint32_t>(EPOLLOUT) : 0);
+  if (event.events != connection.events)
+  {
+    event.data.u64 = slot;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd, &event) != 0)
+    {
+      return false;
+    }
+    connection.events = event.events;
+  }
+  return true;
+}
+
+void UnixServer::CloseConnection(std::size_t slot)
+{
+  close(connections_[slot]->fd);
+  connections_[slot].reset();
+  closed_slots_.push_back(slot);
+  --connection_count_;
+}
+
+void UnixServer::CloseAll()
+{
+  for (std::size_t i = 0; i < connections_.size(); ++i)
+  {
+    if (connections_[i] != nullptr)
+    {
+      CloseConnection(i);
+    }
+  }
+  connections_.clear();
+  free_slots_.clear();
+  closed_slots_.clear();
+}
+
+} /* namespace common */
+} /* namespace project_structure */
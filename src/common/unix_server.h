@@ -0,0 +1,208 @@
+/* unix_server.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Server for length prefixed requests over a Unix domain stream
+ * socket, with pipelining and coalesced responses.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_COMMON_UNIXSERVER_H_
+#define PROJECTSTRUCTURE_COMMON_UNIXSERVER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+
+namespace project_structure
+{
+namespace common
+{
+
+/*!
+ * @brief Size of the length prefix in front of every frame.
+ *
+ * The prefix is the payload size as a little endian 32 bit integer.
+ */
+constexpr std::size_t kFrameHeaderSize = 4;
+
+/*!
+ * @brief Appends a frame header for a payload of size bytes to buffer.
+ */
+void AppendFrameHeader(std::vector<std::byte> &buffer, std::uint32_t size);
+
+/*!
+ * @brief Reads the payload size from a frame header.
+ *
+ * @param[in] header At least kFrameHeaderSize bytes.
+ */
+std::uint32_t ReadFrameHeader(const std::byte *header);
+
+/*!
+ * @brief Handles the requests of a UnixServer.
+ *
+ * Called on the server thread. Requests of one connection are handled in
+ * the order they were sent.
+ *
+ * The class is neither copyable nor movable.
+ */
+class FrameHandler
+{
+ public:
+  FrameHandler() = default;
+  FrameHandler(const FrameHandler &) = delete;
+  FrameHandler &operator=(const FrameHandler &) = delete;
+
+  virtual ~FrameHandler() = default;
+
+  /*!
+   * @brief Handles one request.
+   *
+   * @param[in] request The payload of the request frame, only valid during
+   * the call.
+   * @param[out] response Empty on entry. The payload of the response frame,
+   * the server adds the header.
+   *
+   * @return false to close the connection without responding.
+   */
+  virtual bool HandleFrame(std::span<const std::byte> request,
+      std::vector<std::byte> &response) = 0;
+};
+
+/*!
+ * @brief Configuration of a UnixServer.
+ */
+struct UnixServerOptions
+{
+  /* Larger request frames close the connection. */
+  std::uint32_t max_frame_size = std::uint32_t{1} << 20;
+  /* Bytes asked for per read() of a connection. */
+  std::size_t read_size = std::size_t{64} << 10;
+  /*
+   * A connection with more unsent response bytes than this is not read from
+   * until the client has caught up.
+   */
+  std::size_t max_pending_output = std::size_t{1} << 20;
+  /* Further connections are accepted and closed right away. */
+  std::size_t max_connections = 1024;
+};
+
+/*!
+ * @brief Counters of a UnixServer.
+ */
+struct UnixServerStats
+{
+  std::uint64_t connections;
+  std::uint64_t requests;
+  /* read() calls that returned data. */
+  std::uint64_t reads;
+  /* send() calls, each carrying every response ready at the time. */
+  std::uint64_t writes;
+};
+
+/*!
+ * @brief Serves framed requests on a Unix domain stream socket from one
+ * thread.
+ *
+ * Clients may pipeline: every complete request in what one read returns is
+ * handled before anything is sent, and the responses are then sent together
+ * with one send() per connection. Responses come back in request order.
+ *
+ * The class is neither copyable nor movable. Stop may be called from any
+ * thread, everything else only from one.
+ */
+class UnixServer
+{
+ public:
+  explicit UnixServer(const UnixServerOptions &options =
+      UnixServerOptions{});
+  UnixServer(const UnixServer &) = delete;
+  UnixServer &operator=(const UnixServer &) = delete;
+
+  ~UnixServer();
+
+  /*!
+   * @brief Binds and listens on path, replacing a stale socket file there.
+   *
+   * @return false if the socket could not be set up.
+   */
+  bool Listen(const char *path);
+
+  /*!
+   * @brief Serves until Stop is called, then closes every connection and
+   * removes the socket file.
+   *
+   * @param[in] handler Handles every request.
+   *
+   * @return false if not listening or if polling failed.
+   */
+  bool Run(FrameHandler &handler);
+
+  /*!
+   * @brief Makes Run return. Safe to call from other threads and before Run.
+   */
+  void Stop();
+
+  /*! @brief Counters since Listen. */
+  UnixServerStats Stats() const;
+
+ private:
+  struct Connection
+  {
+    int fd;
+    /* Received bytes not yet handled are [input_begin, input_end). */
+    std::vector<std::byte> input;
+    std::size_t input_begin;
+    std::size_t input_end;
+    /* Response bytes not yet sent, starting at output_begin. */
+    std::vector<std::byte> output;
+    std::size_t output_begin;
+    /* The epoll events the connection is registered for. */
+    std::uint32_t events;
+  };
+
+  void Accept();
+  /* Reads and handles what the connection has. Returns false to close it. */
+  bool ReadRequests(std::size_t slot, Connection &connection,
+      FrameHandler &handler);
+  /* Handles every complete request in the input buffer. */
+  bool HandleRequests(Connection &connection, FrameHandler &handler);
+  /*
+   * Sends pending output and updates what the connection waits for. Returns
+   * false to close the connection.
+   */
+  bool Flush(std::size_t slot, Connection &connection);
+  void CloseConnection(std::size_t slot);
+  void CloseAll();
+
+  UnixServerOptions options_;
+  int listen_fd_ = -1;
+  int epoll_fd_ = -1;
+  int stop_fd_ = -1;
+  std::string path_;
+  /* Indexed by the slot stored in the epoll data, null if free. */
+  std::vector<std::unique_ptr<Connection>> connections_;
+  std::vector<std::size_t> free_slots_;
+  /*
+   * Slots closed while handling the current epoll events. They are reused
+   * only afterwards, so that later events of the same round can not reach a
+   * new connection.
+   */
+  std::vector<std::size_t> closed_slots_;
+  std::size_t connection_count_ = 0;
+  std::vector<std::byte> response_;
+  std::atomic<bool> stop_requested_{false};
+  UnixServerStats stats_ = {};
+};
+
+} /* namespace common */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_COMMON_UNIXSERVER_H_ */
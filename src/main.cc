@@ -2,14 +2,844 @@
  *==============================================================================
  * Author: Carl Larsson
  * Creation date: 2024-09-09
- * Last modified: 2024-10-08 by Carl Larsson
+ * Last modified: 2026-10-18 by Carl Larsson
  * Description: Main
  * License: See LICENSE file for license details.
  *==============================================================================
  */
 
+#include <pthread.h>
+#include <signal.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "common/alloc_tracker.h"
+#include "common/arena.h"
+#include "common/numa.h"
+#include "common/object_pool.h"
+#include "common/ring_queue.h"
+#include "common/stats.h"
+#include "common/trace.h"
+#include "common/unix_server.h"
+#include "lib/library.h"
+#include "module-a/a.h"
+#include "module-a/some_struct_store.h"
+#include "module-b/b.h"
+#include "module-b/generated/message.pb.h"
+#include "module-b/message_pool.h"
+
+
+namespace project_structure
+{
+
+/* Number of elements processed per run. */
+constexpr std::size_t kWorkItemCount = std::size_t{1} << 22;
+
+/* Number of elements handled by one task. */
+constexpr std::size_t kWorkChunkSize = 4096;
+
+/* Number of elements moved through the pipeline queue per operation. */
+constexpr std::size_t kPipelineBatchSize = 256;
+
+/* Capacity of the queue between the module_a and module_b stages. */
+constexpr std::size_t kPipelineQueueCapacity = std::size_t{1} << 14;
+
+/* How the work is spread over the threads. */
+enum class WorkMode
+{
+  kThreadPool = 0,
+  kPipelineSpin = 1,
+  kPipelineBlock = 2,
+  /* module_a results come from the --store file, only module_b runs. */
+  kStored = 3
+};
+
+/* Command line options. */
+struct MainOptions
+{
+  std::size_t thread_count = 0;
+  bool pin_threads = false;
+  WorkMode mode = WorkMode::kThreadPool;
+  bool stats = false;
+  /* Store file the module_a results are loaded from or saved to. */
+  const char *store_path = nullptr;
+  /* Socket to serve requests on instead of running the batch work. */
+  const char *serve_path = nullptr;
+  /* Place the workers over the NUMA nodes and report where memory went. */
+  bool numa = false;
+  /* Simulated topology file used instead of the machine's, implies numa. */
+  const char *numa_topology_path = nullptr;
+  /* File the trace is written to on SIGUSR2 and at exit, tracing is on. */
+  const char *trace_path = nullptr;
+  /* Categories traced, every one unless --trace-categories is given. */
+  std::uint32_t trace_categories = common::kAllTraceCategories;
+};
+
+static void PrintUsage(const char *program)
+{
+  std::fprintf(stderr, "usage: %s [--threads N] [--pin-threads] "
+      "[--pipeline spin|block] [--stats] [--store PATH] [--serve SOCKET] "
+      "[--numa] [--numa-topology FILE] [--trace FILE] "
+      "[--trace-categories module_a,module_b,io]\n", program);
+}
+
+/* Returns false if argv contains something which is not understood. */
+static bool ParseArguments(int argc, char **argv, MainOptions &options)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+    {
+      options.thread_count = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "--pin-threads") == 0)
+    {
+      options.pin_threads = true;
+    }
+    else if (std::strcmp(argv[i], "--stats") == 0)
+    {
+      options.stats = true;
+    }
+    else if (std::strcmp(argv[i], "--store") == 0 && i + 1 < argc)
+    {
+      options.store_path = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--serve") == 0 && i + 1 < argc)
+    {
+      options.serve_path = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--numa") == 0)
+    {
+      options.numa = true;
+    }
+    else if (std::strcmp(argv[i], "--numa-topology") == 0 && i + 1 < argc)
+    {
+      options.numa = true;
+      options.numa_topology_path = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+    {
+      options.trace_path = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--trace-categories") == 0 &&
+        i + 1 < argc)
+    {
+      if (!common::ParseTraceCategories(argv[++i], options.trace_categories))
+      {
+        return false;
+      }
+    }
+    else if (std::strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc)
+    {
+      ++i;
+      if (std::strcmp(argv[i], "spin") == 0)
+      {
+        options.mode = WorkMode::kPipelineSpin;
+      }
+      else if (std::strcmp(argv[i], "block") == 0)
+      {
+        options.mode = WorkMode::kPipelineBlock;
+      }
+      else
+      {
+        return false;
+      }
+    }
+    else
+    {
+      return false;
+    }
+  }
+  /* The NUMA report is only made for the thread pool work. */
+  if (options.numa && (options.mode != WorkMode::kThreadPool ||
+      options.store_path != nullptr || options.serve_path != nullptr))
+  {
+    std::fprintf(stderr, "--numa can not be combined with --pipeline, "
+        "--store or --serve\n");
+    return false;
+  }
+  /* Only the thread pool work saves its results to the store or reuses them. */
+  if (options.store_path != nullptr && options.mode != WorkMode::kThreadPool)
+  {
+    std::fprintf(stderr, "--store can not be combined with --pipeline\n");
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Runs module_a's TempFuncBatch over every chunk of inputs into outputs and
+ * hands the results to module_b's DoSomethingElse, one chunk per task.
+ * Returns the sum of the module_b results, summed per chunk first so that the
+ * result does not depend on the scheduling.
+ */
+static std::int64_t RunWork(lib::ThreadPool &pool,
+    std::span<const int> inputs, std::span<module_a::SomeStruct> outputs)
+{
+  const int kSomeInput = module_a::kTempVar;
+  const std::size_t kChunkCount = (inputs.size() + kWorkChunkSize - 1) /
+      kWorkChunkSize;
+  std::vector<int> states(inputs.size(), 0);
+  std::vector<std::int64_t> chunk_sums(kChunkCount, 0);
+  std::int64_t sum = 0;
+
+  lib::ParallelFor(pool, 0, kChunkCount, 1, [&](std::size_t chunk)
+  {
+    std::size_t begin = chunk * kWorkChunkSize;
+    std::size_t size = inputs.size() - begin < kWorkChunkSize ?
+        inputs.size() - begin : kWorkChunkSize;
+    std::int64_t chunk_sum = 0;
+    module_a::TempFuncBatch(inputs.subspan(begin, size), &kSomeInput,
+        std::span<int>(states).subspan(begin, size),
+        outputs.subspan(begin, size));
+    {
+      common::ScopedTrace trace(common::TraceCategory::kModuleB,
+          "module_b::DoSomethingElse chunk");
+      for (std::size_t i = begin; i < begin + size; ++i)
+      {
+        chunk_sum += module_b::DoSomethingElse<
+            module_b::SomeEnum::kEnumVarOne>(
+                module_b::SomeStruct{outputs[i].struct_var});
+      }
+    }
+    chunk_sums[chunk] = chunk_sum;
+  });
+
+  for (std::int64_t chunk_sum : chunk_sums)
+  {
+    sum += chunk_sum;
+  }
+  return sum;
+}
+
+/*
+ * The module_b half of RunWork, on module_a results read in place from a
+ * store file instead of computed.
+ */
+static std::int64_t RunStoredWork(lib::ThreadPool &pool,
+    std::span<const module_b::SomeStruct> some_structs)
+{
+  const std::size_t kChunkCount = (some_structs.size() + kWorkChunkSize - 1) /
+      kWorkChunkSize;
+  std::vector<std::int64_t> chunk_sums(kChunkCount, 0);
+  std::int64_t sum = 0;
+
+  lib::ParallelFor(pool, 0, kChunkCount, 1, [&](std::size_t chunk)
+  {
+    std::size_t begin = chunk * kWorkChunkSize;
+    std::size_t end = some_structs.size() - begin < kWorkChunkSize ?
+        some_structs.size() : begin + kWorkChunkSize;
+    std::int64_t chunk_sum = 0;
+    for (std::size_t i = begin; i < end; ++i)
+    {
+      chunk_sum += module_b::DoSomethingElse<module_b::SomeEnum::kEnumVarOne>(
+          some_structs[i]);
+    }
+    chunk_sums[chunk] = chunk_sum;
+  });
+
+  for (std::int64_t chunk_sum : chunk_sums)
+  {
+    sum += chunk_sum;
+  }
+  return sum;
+}
+
+/*
+ * RunWork with the scratch memory of every chunk taken from the arena of the
+ * worker running it, so that it is on the worker's node. arenas has one arena
+ * per worker of pool and a last one for the calling thread, which runs tasks
+ * while it waits. Returns false if an arena ran out of memory.
+ */
+static bool RunNumaWork(lib::ThreadPool &pool, std::span<const int> inputs,
+    std::span<const std::unique_ptr<common::Arena>> arenas,
+    std::int64_t &sum)
+{
+  const int kSomeInput = module_a::kTempVar;
+  const std::size_t kChunkCount = (inputs.size() + kWorkChunkSize - 1) /
+      kWorkChunkSize;
+  std::vector<std::int64_t> chunk_sums(kChunkCount, 0);
+  std::atomic<bool> out_of_memory{false};
+
+  lib::ParallelFor(pool, 0, kChunkCount, 1, [&](std::size_t chunk)
+  {
+    common::Arena &arena = *arenas[pool.CurrentWorkerIndex()];
+    std::size_t begin = chunk * kWorkChunkSize;
+    std::size_t size = inputs.size() - begin < kWorkChunkSize ?
+        inputs.size() - begin : kWorkChunkSize;
+    std::span<int> states = arena.CreateArray<int>(size);
+    std::span<module_a::SomeStruct> outputs =
+        arena.CreateArray<module_a::SomeStruct>(size);
+    std::int64_t chunk_sum = 0;
+    if (states.size() != size || outputs.size() != size)
+    {
+      out_of_memory.store(true, std::memory_order_relaxed);
+      return;
+    }
+    module_a::TempFuncBatch(inputs.subspan(begin, size), &kSomeInput, states,
+        outputs);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      chunk_sum += module_b::DoSomethingElse<module_b::SomeEnum::kEnumVarOne>(
+          module_b::SomeStruct{outputs[i].struct_var});
+    }
+    chunk_sums[chunk] = chunk_sum;
+  });
+
+  sum = 0;
+  for (std::int64_t chunk_sum : chunk_sums)
+  {
+    sum += chunk_sum;
+  }
+  return !out_of_memory.load(std::memory_order_relaxed);
+}
+
+/*
+ * Prints, per node, the workers placed on it and where the pages of their
+ * arenas ended up. Worker i runs on cpus[i] and uses arenas[i].
+ */
+static void PrintNumaReport(const common::NumaTopology &topology,
+    std::span<const int> cpus,
+    std::span<const std::unique_ptr<common::Arena>> arenas)
+{
+  const double kMebibyte = 1024.0 * 1024.0;
+  common::NumaPageStats stats;
+  std::size_t workers = 0;
+  std::size_t bytes = 0;
+  std::size_t bind_failures = 0;
+  std::printf("numa: %zu nodes%s, %zu workers spread over them\n",
+      topology.nodes.size(), topology.simulated ? " (simulated)" : "",
+      cpus.size());
+  if (topology.simulated)
+  {
+    std::printf("numa: memory is not bound on a simulated topology, pages "
+        "are on the machine's real nodes\n");
+  }
+  std::printf("%6s %8s %10s %12s %12s %10s %14s\n", "node", "workers",
+      "arena MiB", "local pages", "remote pages", "untouched",
+      "bind failures");
+  for (const common::NumaNode &node : topology.nodes)
+  {
+    stats = common::NumaPageStats{};
+    workers = 0;
+    bytes = 0;
+    bind_failures = 0;
+    for (std::size_t i = 0; i < cpus.size(); ++i)
+    {
+      if (common::NumaNodeOfCpu(topology, cpus[i]) != node.id)
+      {
+        continue;
+      }
+      ++workers;
+      bytes += arenas[i]->BytesReserved();
+      bind_failures += arenas[i]->NumaBindFailures();
+      arenas[i]->ForEachBlock([&](std::span<const std::byte> block)
+      {
+        common::CountNumaPages(block.data(), block.size(), node.id, stats);
+      });
+    }
+    std::printf("%6d %8zu %10.1f %12" PRIu64 " %12" PRIu64 " %10" PRIu64
+        " %14zu\n", node.id, workers, static_cast<double>(bytes) / kMebibyte,
+        stats.local_pages, stats.remote_pages, stats.unknown_pages,
+        bind_failures);
+  }
+}
+
+/*
+ * Saves outputs to a new store file at path. Returns false if the store could
+ * not be written.
+ */
+static bool SaveStore(const char *path,
+    std::span<const module_a::SomeStruct> outputs)
+{
+  module_a::SomeStructStore store;
+  if (store.Create(path, outputs.size(), 0) != common::StoreStatus::kOk ||
+      store.AppendSomeStructs(outputs) != common::StoreStatus::kOk ||
+      store.Flush() != common::StoreStatus::kOk)
+  {
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Same work as RunWork, but as a two stage pipeline: producer threads run
+ * module_a's TempFuncBatch chunk by chunk and push the results into a bounded
+ * MPMC queue, consumer threads pop them in batches and run module_b's
+ * DoSomethingElse. Half of thread_count produces and half consumes. The sum is
+ * the same as RunWork's since addition does not care about the order.
+ */
+template <typename WaitPolicy>
+static std::int64_t RunPipeline(std::size_t thread_count,
+    std::span<const int> inputs)
+{
+  const int kSomeInput = module_a::kTempVar;
+  const std::size_t kChunkCount = (inputs.size() + kWorkChunkSize - 1) /
+      kWorkChunkSize;
+  const std::size_t kProducerCount = std::max<std::size_t>(thread_count / 2,
+      1);
+  const std::size_t kConsumerCount = std::max<std::size_t>(
+      thread_count - kProducerCount, 1);
+  common::MpmcRingQueue<module_a::SomeStruct, WaitPolicy> queue(
+      kPipelineQueueCapacity);
+  std::atomic<std::size_t> next_chunk{0};
+  std::vector<std::int64_t> consumer_sums(kConsumerCount, 0);
+  std::vector<std::thread> producers;
+  std::vector<std::thread> consumers;
+  std::int64_t sum = 0;
+
+  for (std::size_t p = 0; p < kProducerCount; ++p)
+  {
+    producers.emplace_back([&]()
+    {
+      std::vector<int> states(kWorkChunkSize, 0);
+      std::vector<module_a::SomeStruct> outputs(kWorkChunkSize,
+          module_a::SomeStruct{0});
+      std::size_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+      std::size_t begin = 0;
+      std::size_t size = 0;
+      for (; chunk < kChunkCount;
+          chunk = next_chunk.fetch_add(1, std::memory_order_relaxed))
+      {
+        begin = chunk * kWorkChunkSize;
+        size = std::min(inputs.size() - begin, kWorkChunkSize);
+        std::fill(states.begin(), states.end(), 0);
+        module_a::TempFuncBatch(inputs.subspan(begin, size), &kSomeInput,
+            std::span<int>(states).first(size),
+            std::span<module_a::SomeStruct>(outputs).first(size));
+        queue.PushBatch(std::span<const module_a::SomeStruct>(outputs).first(
+            size));
+      }
+    });
+  }
+  for (std::size_t c = 0; c < kConsumerCount; ++c)
+  {
+    consumers.emplace_back([&, c]()
+    {
+      std::vector<module_a::SomeStruct> batch(kPipelineBatchSize,
+          module_a::SomeStruct{0});
+      std::size_t count = queue.PopBatch(batch);
+      std::int64_t consumer_sum = 0;
+      for (; count > 0; count = queue.PopBatch(batch))
+      {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+          consumer_sum += module_b::DoSomethingElse<
+              module_b::SomeEnum::kEnumVarOne>(
+                  module_b::SomeStruct{batch[i].struct_var});
+        }
+      }
+      consumer_sums[c] = consumer_sum;
+    });
+  }
+
+  for (std::thread &producer : producers)
+  {
+    producer.join();
+  }
+  /* Everything is pushed, the consumers drain the queue and stop. */
+  queue.Close();
+  for (std::thread &consumer : consumers)
+  {
+    consumer.join();
+  }
+  for (std::int64_t consumer_sum : consumer_sums)
+  {
+    sum += consumer_sum;
+  }
+  return sum;
+}
+
+/* Parses message from frame, attributing its allocations to proto. */
+static bool ParseMessage(std::span<const std::byte> frame,
+    module_b::SomeMessage &message)
+{
+  common::ScopedAllocationScope allocation_scope(
+      common::AllocationScope::kProto);
+  return message.ParseFromArray(frame.data(), static_cast<int>(frame.size()));
+}
+
+/* Serializes message into frame, which is resized to fit. */
+static bool SerializeMessage(const module_b::SomeMessage &message,
+    std::vector<std::byte> &frame)
+{
+  common::ScopedAllocationScope allocation_scope(
+      common::AllocationScope::kProto);
+  frame.resize(message.ByteSizeLong());
+  return message.SerializeToArray(frame.data(),
+      static_cast<int>(frame.size()));
+}
+
+/*
+ * Serves SomeMessage requests: module_a's TempFuncBatch runs over values and
+ * module_b's DoSomethingElse, selected by some_enum, over its results. The
+ * response carries those results in values and DoSomethingElse of struct_var
+ * in struct_var. The messages come from module_b's per thread message pool
+ * and the buffers are reused from request to request, so a warm server
+ * handles requests without allocating.
+ *
+ * The class is neither copyable nor movable.
+ */
+class MessageHandler : public common::FrameHandler
+{
+ public:
+  bool HandleFrame(std::span<const std::byte> request,
+      std::vector<std::byte> &response) override
+  {
+    const int kSomeInput = module_a::kTempVar;
+    common::ScopedTrace trace(common::TraceCategory::kModuleB,
+        "module_b::HandleFrame");
+    common::ScopedAllocationScope allocation_scope(
+        common::AllocationScope::kModuleB);
+    common::ObjectPool<module_b::SomeMessage>::Handle request_message =
+        module_b::AcquireMessage();
+    common::ObjectPool<module_b::SomeMessage>::Handle response_message =
+        module_b::AcquireMessage();
+    module_b::SomeEnum some_enum = module_b::SomeEnum::kEnumVarOne;
+    std::size_t count = 0;
+    int *results = nullptr;
+    if (!request_message || !response_message ||
+        !ParseMessage(request, *request_message))
+    {
+      return false;
+    }
+    some_enum = static_cast<module_b::SomeEnum>(
+        request_message->some_enum());
+    count = static_cast<std::size_t>(request_message->values_size());
+    inputs_.assign(request_message->values().begin(),
+        request_message->values().end());
+    states_.assign(count, 0);
+    outputs_.assign(count, module_a::SomeStruct{0});
+    module_a::TempFuncBatch(inputs_, &kSomeInput, states_, outputs_);
+
+    /* Pooled messages are handed out cleared. */
+    response_message->set_struct_var(module_b::DoSomethingElse(some_enum,
+        module_b::SomeStruct{request_message->struct_var()}));
+    response_message->set_class_const(request_message->class_const());
+    response_message->set_some_enum(request_message->some_enum());
+    response_message->mutable_values()->Resize(static_cast<int>(count), 0);
+    results = response_message->mutable_values()->mutable_data();
+    if (!module_b::VisitSomeEnum(some_enum, [&]<module_b::SomeEnum kSomeEnum>()
+    {
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        results[i] = module_b::DoSomethingElse<kSomeEnum>(
+            module_b::SomeStruct{outputs_[i].struct_var});
+      }
+    }))
+    {
+      /* Unknown values leave the struct unchanged, as DoSomethingElse does. */
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        results[i] = outputs_[i].struct_var;
+      }
+    }
+    return SerializeMessage(*response_message, response);
+  }
+
+ private:
+  std::vector<int> inputs_;
+  std::vector<int> states_;
+  std::vector<module_a::SomeStruct> outputs_;
+};
+
+/*
+ * Serves SomeMessage requests on path until server is stopped. Returns false
+ * if the socket could not be set up or polling failed.
+ */
+static bool Serve(common::UnixServer &server, const char *path)
+{
+  MessageHandler handler;
+  common::UnixServerStats stats = {};
+  common::ObjectPoolStats pool_stats = {};
+  bool served = false;
+  if (!server.Listen(path))
+  {
+    std::fprintf(stderr, "could not listen on %s\n", path);
+    return false;
+  }
+  std::printf("serving on %s\n", path);
+  std::fflush(stdout);
+  served = server.Run(handler);
+  stats = server.Stats();
+  std::printf("served %" PRIu64 " requests on %" PRIu64 " connections, "
+      "%" PRIu64 " reads and %" PRIu64 " writes\n", stats.requests,
+      stats.connections, stats.reads, stats.writes);
+  /* Run calls the handler on this thread, so this is the pool it used. */
+  pool_stats = module_b::MessagePoolStats();
+  std::printf("message pool: %" PRIu64 " acquires, %.1f%% hits, peak %"
+      PRIu64 " in use and %" PRIu64 " kept\n", pool_stats.acquires,
+      100.0 * common::ObjectPoolHitRate(pool_stats), pool_stats.peak_in_use,
+      pool_stats.peak_retained);
+  return served;
+}
+
+/* Writes the trace recorded so far to path, replacing an earlier one. */
+static void WriteTrace(const char *path)
+{
+  std::FILE *file = std::fopen(path, "w");
+  bool written = file != nullptr && common::WriteChromeTrace(file);
+  if (file != nullptr)
+  {
+    written = std::fclose(file) == 0 && written;
+  }
+  if (!written)
+  {
+    std::fprintf(stderr, "could not write the trace to %s\n", path);
+  }
+}
+
+/*
+ * Runs on its own thread when --stats, --serve or --trace is given, with
+ * signals blocked in every other thread. Prints the stats report on SIGUSR1
+ * and writes the trace to trace_path, if not nullptr, on SIGUSR2. On SIGINT
+ * or SIGTERM it stops server if there is one, otherwise it prints the report,
+ * writes the trace and exits. Printing is not async signal safe, which is why
+ * the signals are taken with sigwait instead of a handler. Returns once stop
+ * is set and the thread is sent SIGUSR1.
+ */
+static void RunSignalLoop(const sigset_t &signals,
+    const std::atomic<bool> &stop, common::UnixServer *server,
+    const char *trace_path)
+{
+  int signal_number = 0;
+  while (sigwait(&signals, &signal_number) == 0)
+  {
+    if (stop.load(std::memory_order_acquire))
+    {
+      return;
+    }
+    if (signal_number == SIGUSR1)
+    {
+      common::PrintStatsReport(stderr);
+    }
+    else if (signal_number == SIGUSR2)
+    {
+      WriteTrace(trace_path);
+    }
+    else if (server != nullptr)
+    {
+      server->Stop();
+    }
+    else
+    {
+      common::PrintStatsReport(stderr);
+      if (trace_path != nullptr)
+      {
+        WriteTrace(trace_path);
+      }
+      std::_Exit(128 + signal_number);
+    }
+  }
+}
+
+/*
+ * Stops the thread started for RunSignalLoop, prints the final report and
+ * writes the final trace.
+ */
+static void StopSignalLoop(const MainOptions &options, std::thread &thread,
+    std::atomic<bool> &stop)
+{
+  if (!thread.joinable())
+  {
+    return;
+  }
+  stop.store(true, std::memory_order_release);
+  pthread_kill(thread.native_handle(), SIGUSR1);
+  thread.join();
+  if (options.stats)
+  {
+    common::PrintStatsReport(stderr);
+  }
+  if (options.trace_path != nullptr)
+  {
+    common::SetTraceCategories(0);
+    WriteTrace(options.trace_path);
+  }
+}
+
+} /* namespace project_structure */
 
 int main(int argc, char **argv)
 {
+  project_structure::MainOptions options;
+  if (!project_structure::ParseArguments(argc, argv, options))
+  {
+    project_structure::PrintUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  /* Blocked before any thread starts so that every thread inherits it. */
+  sigset_t signals;
+  std::atomic<bool> stop_signal_thread{false};
+  std::thread signal_thread;
+  project_structure::common::UnixServer server;
+  bool served = false;
+  sigemptyset(&signals);
+  if (options.stats || options.serve_path != nullptr ||
+      options.trace_path != nullptr)
+  {
+    sigaddset(&signals, SIGUSR1);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    if (options.trace_path != nullptr)
+    {
+      sigaddset(&signals, SIGUSR2);
+      project_structure::common::SetTraceCategories(options.trace_categories);
+    }
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    project_structure::common::SetStatsEnabled(options.stats);
+    signal_thread = std::thread(project_structure::RunSignalLoop,
+        std::cref(signals), std::cref(stop_signal_thread),
+        options.serve_path != nullptr ? &server : nullptr, options.trace_path);
+  }
+
+  if (options.serve_path != nullptr)
+  {
+    served = project_structure::Serve(server, options.serve_path);
+    project_structure::StopSignalLoop(options, signal_thread,
+        stop_signal_thread);
+    return served ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  /* With --numa the workers are pinned to CPUs spread over the nodes. */
+  project_structure::common::NumaTopology topology;
+  std::vector<int> numa_cpus;
+  std::size_t numa_cpu_count = 0;
+  std::vector<std::unique_ptr<project_structure::common::Arena>> arenas;
+  if (options.numa)
+  {
+    if (options.numa_topology_path != nullptr ?
+        !project_structure::common::ReadSimulatedNumaTopology(
+            options.numa_topology_path, topology) :
+        !project_structure::common::ReadNumaTopology(
+            project_structure::common::kNumaNodeDirectory, topology))
+    {
+      std::fprintf(stderr, "could not read the NUMA topology from %s\n",
+          options.numa_topology_path != nullptr ? options.numa_topology_path :
+              project_structure::common::kNumaNodeDirectory);
+      project_structure::StopSignalLoop(options, signal_thread,
+          stop_signal_thread);
+      return EXIT_FAILURE;
+    }
+    /* One worker per CPU of the topology unless --threads says otherwise. */
+    for (const project_structure::common::NumaNode &node : topology.nodes)
+    {
+      numa_cpu_count += node.cpus.size();
+    }
+    numa_cpus = project_structure::common::PlaceWorkers(topology,
+        options.thread_count == 0 ? numa_cpu_count : options.thread_count,
+        project_structure::common::NumaPlacement::kSpread);
+    options.thread_count = numa_cpus.size();
+  }
+  project_structure::lib::ThreadPool pool(
+      project_structure::lib::ThreadPoolOptions{options.thread_count,
+          options.pin_threads, 1024, numa_cpus});
+  if (options.numa)
+  {
+    /* Mapped lazily, so each is first touched by the worker using it. */
+    for (std::size_t i = 0; i <= pool.ThreadCount(); ++i)
+    {
+      arenas.push_back(std::make_unique<project_structure::common::Arena>(
+          project_structure::common::ArenaOptions{std::size_t{1} << 20,
+              false, i == pool.ThreadCount() || topology.simulated ? -1 :
+                  project_structure::common::NumaNodeOfCpu(topology,
+                      numa_cpus[i])}));
+    }
+  }
+  std::vector<int> inputs(project_structure::kWorkItemCount, 0);
+  std::vector<project_structure::module_a::SomeStruct> outputs;
+  project_structure::module_a::SomeStructStore store;
+  bool loaded = false;
+  std::int64_t checksum = 0;
+  for (std::size_t i = 0; i < inputs.size(); ++i)
+  {
+    inputs[i] = static_cast<int>(i);
+  }
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  /* Results saved by an earlier run with the same inputs are reused. */
+  if (options.store_path != nullptr)
+  {
+    loaded = store.Open(options.store_path) ==
+        project_structure::common::StoreStatus::kOk &&
+        store.SomeStructs().size() == inputs.size();
+    /* Only the thread pool mode keeps the results around for saving. */
+    options.mode = loaded ? project_structure::WorkMode::kStored :
+        project_structure::WorkMode::kThreadPool;
+  }
+  switch (options.mode)
+  {
+    case project_structure::WorkMode::kStored:
+      checksum = project_structure::RunStoredWork(pool,
+          project_structure::module_b::MappedSomeStructs(store.Store(),
+              project_structure::module_a::kSomeStructSectionId));
+      break;
+    case project_structure::WorkMode::kPipelineSpin:
+      checksum = project_structure::RunPipeline<
+          project_structure::common::SpinWait>(pool.ThreadCount(), inputs);
+      break;
+    case project_structure::WorkMode::kPipelineBlock:
+      checksum = project_structure::RunPipeline<
+          project_structure::common::BlockingWait>(pool.ThreadCount(), inputs);
+      break;
+    case project_structure::WorkMode::kThreadPool:
+    default:
+      if (options.numa)
+      {
+        if (!project_structure::RunNumaWork(pool, inputs, arenas, checksum))
+        {
+          std::fprintf(stderr, "out of memory\n");
+          project_structure::StopSignalLoop(options, signal_thread,
+              stop_signal_thread);
+          return EXIT_FAILURE;
+        }
+        break;
+      }
+      outputs.assign(inputs.size(),
+          project_structure::module_a::SomeStruct{0});
+      checksum = project_structure::RunWork(pool, inputs, outputs);
+      break;
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() -
+      start;
+  std::printf("processed %zu elements on %zu threads in %.3f s "
+      "(checksum %" PRId64 ")\n", inputs.size(), pool.ThreadCount(),
+      elapsed.count(), checksum);
+  if (options.numa)
+  {
+    project_structure::PrintNumaReport(topology, numa_cpus, arenas);
+  }
+  if (options.store_path != nullptr)
+  {
+    if (loaded)
+    {
+      std::printf("module_a results loaded from %s\n", options.store_path);
+    }
+    else if (project_structure::SaveStore(options.store_path, outputs))
+    {
+      std::printf("module_a results saved to %s\n", options.store_path);
+    }
+    else
+    {
+      std::fprintf(stderr, "could not save %s\n", options.store_path);
+    }
+  }
+  project_structure::StopSignalLoop(options, signal_thread,
+      stop_signal_thread);
   return 0;
 }
@@ -2,7 +2,7 @@
  *==============================================================================
  * Author: Carl Larsson
  * Creation date: 2024-09-09
- * Last modified: 2024-10-08 by Carl Larsson
+ * Last modified: 2026-10-18 by Carl Larsson
  * Description: Example .h file used for example file structure and Google C++ 
  * style guide, it is only meant to be used as a template. All functions and 
  * variables are dummy and the contents of this file should in no way been seen 
@@ -71,19 +71,25 @@
  * - Project headers should be included as decendents of the src directory of 
  * the project.
  */
-#include "somewhere/some_file.h"
+/* No related .h file, a.h is the related .h file of a.cc. */
 
 /* Example C system header. */
 #include <unistd.h>
 
 /* Example C++ standard library header. */
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <utility>
 
-/* Other libraries .h files. */
-#include "other_header_needed.h"
+/* Other libraries .h files, none are needed here. */
 
 /* Projects .h files. */
-#include "somewhere/some_project_header.h"
+#include "common/function_memo.h"
+#include "common/sharded_counter.h"
+#include "common/small_buffer.h"
 
 /*
  * Always try to place code in namespaces.
@@ -119,7 +125,7 @@ namespace module_a
  *
  * @warning This function doesn't work, its just a placeholder.
  */
-static int TempFunc(int some_other_input,const *kSomeInput, 
+int TempFunc(int some_other_input, const int *kSomeInput,
     int *some_input_output, void *some_output);
 
 /*
@@ -132,12 +138,167 @@ static int TempFunc(int some_other_input,const *kSomeInput,
  */
 constexpr int kTempVar = 5;
 
+/*!
+ * @brief Number of iterations performed by the TempFunc loop.
+ */
+constexpr int kTempFuncIterations = 100;
+
+/*!
+ * @brief Performs one iteration of the TempFunc loop.
+ *
+ * The scalar TempFunc and every TempFuncBatch kernel are built on this single
+ * step, which is what keeps them bit-identical. The arithmetic is done on
+ * unsigned 32-bit integers so that wrap-around is well defined.
+ *
+ * @param[in] state Current value of some_input_output.
+ * @param[in] some_other_input Per element input.
+ * @param[in] some_input The value kSomeInput points to.
+ * @param[in] iteration Index of the current loop iteration.
+ *
+ * @return The next value of some_input_output.
+ */
+constexpr std::uint32_t TempFuncStep(std::uint32_t state,
+    std::uint32_t some_other_input, std::uint32_t some_input,
+    std::uint32_t iteration)
+{
+  return state * std::uint32_t{kTempVar} +
+      (some_other_input ^ (some_input + iteration));
+}
+
+/*!
+ * @brief temp_var to the power of exponent, wrapping around like
+ * TempFuncStep does.
+ */
+constexpr std::uint32_t TempFuncPower(std::uint32_t temp_var, int exponent)
+{
+  std::uint32_t power = 1;
+  for (int i = 0; i < exponent; ++i)
+  {
+    power *= temp_var;
+  }
+  return power;
+}
+
+/*!
+ * @brief The TempFunc loop for any trip count and multiplier, both only known
+ * at run time.
+ *
+ * Iterates TempFuncStep with temp_var in place of kTempVar. Prefer
+ * TempFuncUnrolled when both are constants.
+ *
+ * @param[in] state Value of some_input_output on entry.
+ * @param[in] some_other_input Per element input.
+ * @param[in] some_input The value kSomeInput points to.
+ * @param[in] iterations Trip count of the loop.
+ * @param[in] temp_var Multiplier of every step.
+ *
+ * @return Value of some_input_output after the loop.
+ */
+constexpr std::uint32_t TempFuncLoop(std::uint32_t state,
+    std::uint32_t some_other_input, std::uint32_t some_input, int iterations,
+    int temp_var)
+{
+  for (int i = 0; i < iterations; ++i)
+  {
+    state = state * static_cast<std::uint32_t>(temp_var) +
+        (some_other_input ^ (some_input + static_cast<std::uint32_t>(i)));
+  }
+  return state;
+}
+
+/*
+ * The body of TempFuncUnrolled, one term per iteration in kIteration. Each
+ * step is state * kTempVarValue + c_i, so after kIterations steps the state
+ * is kTempVarValue^kIterations * state plus every c_i times
+ * kTempVarValue^(kIterations - 1 - i), all modulo 2^32. The terms do not
+ * depend on each other, unlike the steps of the loop.
+ */
+template <int kIterations, int kTempVarValue, std::uint32_t... kIteration>
+constexpr std::uint32_t TempFuncUnrolledTerms(std::uint32_t state,
+    std::uint32_t some_other_input, std::uint32_t some_input,
+    std::integer_sequence<std::uint32_t, kIteration...>)
+{
+  return state * std::integral_constant<std::uint32_t, TempFuncPower(
+      static_cast<std::uint32_t>(kTempVarValue), kIterations)>::value +
+      (std::uint32_t{0} + ... + (std::integral_constant<std::uint32_t,
+          TempFuncPower(static_cast<std::uint32_t>(kTempVarValue),
+              kIterations - 1 - static_cast<int>(kIteration))>::value *
+          (some_other_input ^ (some_input + kIteration))));
+}
+
+/*!
+ * @brief The TempFunc loop with its trip count and multiplier fixed at
+ * compile time, fully unrolled and free of branches.
+ *
+ * Gives the same result as TempFuncLoop(state, some_other_input, some_input,
+ * kIterations, kTempVarValue) but does not run the steps one after the
+ * other: the multipliers of the steps are folded into constants at compile
+ * time, which leaves independent terms the CPU can evaluate in parallel.
+ *
+ * @tparam kIterations Trip count of the loop.
+ * @tparam kTempVarValue Multiplier of every step.
+ *
+ * @param[in] state Value of some_input_output on entry.
+ * @param[in] some_other_input Per element input.
+ * @param[in] some_input The value kSomeInput points to.
+ *
+ * @return Value of some_input_output after the loop.
+ */
+template <int kIterations = kTempFuncIterations, int kTempVarValue = kTempVar>
+constexpr std::uint32_t TempFuncUnrolled(std::uint32_t state,
+    std::uint32_t some_other_input, std::uint32_t some_input)
+{
+  static_assert(kIterations >= 0, "the trip count can not be negative");
+  return TempFuncUnrolledTerms<kIterations, kTempVarValue>(state,
+      some_other_input, some_input,
+      std::make_integer_sequence<std::uint32_t, kIterations>{});
+}
+
+/*!
+ * @brief The TempFunc loop, unrolled for the usual trip count and multiplier
+ * and a runtime loop for any other.
+ *
+ * @see TempFuncUnrolled
+ * @see TempFuncLoop
+ */
+constexpr std::uint32_t TempFuncIterate(std::uint32_t state,
+    std::uint32_t some_other_input, std::uint32_t some_input, int iterations,
+    int temp_var)
+{
+  if (iterations == kTempFuncIterations && temp_var == kTempVar)
+  {
+    return TempFuncUnrolled<kTempFuncIterations, kTempVar>(state,
+        some_other_input, some_input);
+  }
+  return TempFuncLoop(state, some_other_input, some_input, iterations,
+      temp_var);
+}
+
 /*
  * - Global variables should have comment describing what they are, what they 
  * are used for, and why they need to be global.
  * - Vaiables are all lowercase with _ for word seperation.
  */
-int global_var = 1;
+/*!
+ * @brief Number of elements processed by TempFunc and TempFuncBatch in
+ * module_a.
+ *
+ * Every call adds to it from whichever thread runs it, pool workers included,
+ * so it is global and sharded per thread. Read it with global_var.Snapshot().
+ */
+extern common::ShardedCounter global_var;
+
+/*!
+ * @brief Memoization of TempFunc in module_a, off until
+ * temp_func_memo.Enable() is called.
+ *
+ * TempFunc is a free function with nowhere else to keep the cache, and pool
+ * workers memoize through it concurrently, so it is global.
+ *
+ * @see common::FunctionMemo
+ */
+extern common::FunctionMemo<common::TempFuncKey, std::uint32_t,
+    common::TempFuncKeyHash> temp_func_memo;
 
 
 /*
@@ -147,7 +308,21 @@ int global_var = 1;
  * - Class names start with capital letter and every new word begins with 
  * capital letter.
  */
-class SomeClass
+/*!
+ * @brief Example class with a payload of arbitrary bytes.
+ *
+ * Aligned to and exactly as large as a 64 byte cache line, so an array of
+ * SomeClass never has an object straddling two lines. Payloads of up to
+ * kPayloadInlineCapacity bytes are stored in that line, longer ones in one
+ * heap block.
+ *
+ * The class is copy and move constructible but not assignable, since
+ * kClassConst_ is const. A copy has the same ClassCharVersion and its own
+ * copy of the payload, which allocates only if the payload is not inline.
+ * Moving never allocates and leaves the payload of the source empty.
+ * It is not thread safe.
+ */
+class alignas(64) SomeClass
 {
   /* 
    * Class definition order: public, then protected, lastly private.
@@ -174,20 +349,126 @@ class SomeClass
    * and ending with _ (class data member).
    */
   const int kClassConst_;
+
+  /*! @brief Longest payload stored inside the object. */
+  static constexpr std::size_t kPayloadInlineCapacity = 40;
+
+  /*!
+   * @brief Creates a SomeClass.
+   *
+   * Has no requirements on where it is placed, so it can be created on the
+   * stack, the heap or in a common::Arena.
+   *
+   * @param[in] class_const Value of kClassConst_.
+   * @param[in] class_char Initial value of class_char_.
+   */
+  SomeClass(int class_const, char class_char);
+
+  /*! @brief Returns class_char_. */
+  char ClassChar() const;
+
+  /*!
+   * @brief Sets class_char_.
+   *
+   * Gives class_char_ a new version if the value changes. Setting the value
+   * it already has keeps the version, so caches stay valid.
+   *
+   * @param[in] class_char New value of class_char_.
+   */
+  void SetClassChar(char class_char);
+
+  /*!
+   * @brief Version of class_char_.
+   *
+   * Versions are never 0 and are unique in the process: a new object and
+   * every change get a version no other object has had. Two objects only
+   * share a version if one is a copy of the other and class_char_ has not
+   * changed in either since. kClassConst_ never changes, so the version
+   * identifies every input of DoSomething.
+   */
+  std::uint64_t ClassCharVersion() const;
+
+  /*! @brief Returns the payload, valid until it is next set. */
+  std::span<const std::byte> Payload() const;
+
+  /*!
+   * @brief Replaces the payload with a copy of payload.
+   *
+   * Does not allocate if payload fits inline or in the heap block of an
+   * earlier payload. The payload is not an input of DoSomething, so
+   * ClassCharVersion stays the same.
+   *
+   * @param[in] payload The new payload, may be the current one.
+   *
+   * @return false, with the payload unchanged, if it could not be stored.
+   */
+  bool SetPayload(std::span<const std::byte> payload);
  /*
   * Classes data members which are part of a test fixture class (defined in a 
   * .cc file) can be protected if using Google Test.
   */
- protected:
+ /* Classes data members should be private unless they are constants. */
+ private:
   /* 
    * Class data members should be named with all lowercase and _ for seperating 
    * words and one _ in the end.
    */
+  /*
+   * Private so that SetClassChar, which keeps class_char_version_ in step, is
+   * the only writer. A derived class writing it would leave caches stale.
+   */
   char class_char_;
- /* Classes data members should be private unless they are constants. */
+  std::uint64_t class_char_version_;
+  common::SmallBuffer<kPayloadInlineCapacity> payload_;
+};
+
+static_assert(alignof(SomeClass) == 64 && sizeof(SomeClass) == 64,
+    "SomeClass should fill exactly one cache line");
+
+/*!
+ * @brief Derives a value from the state of some_class.
+ *
+ * Runs the TempFunc loop with kClassConst_ as input and class_char_ as
+ * initial state, so it costs about as much as one TempFunc call.
+ *
+ * @param[in] some_class The object to derive the value from.
+ *
+ * @return The derived value.
+ */
+int DoSomething(const SomeClass &some_class);
+
+/*!
+ * @brief Keeps the DoSomething result of a SomeClass and recomputes it only
+ * when an input of it has changed.
+ *
+ * Changes are detected with SomeClass::ClassCharVersion, so a cache hit costs
+ * one comparison. Keep one cache per object, e.g. in a vector next to the
+ * objects. Giving a cache another object is still correct, it just
+ * recomputes.
+ *
+ * The class is copyable and movable. It is not thread safe.
+ */
+class DoSomethingCache
+{
+ public:
+  /*!
+   * @brief Returns DoSomething(some_class), computed only if some_class has
+   * changed since the last call or is another object.
+   */
+  int Get(const SomeClass &some_class);
+
+  /*! @brief Makes the next Get recompute. */
+  void Invalidate();
+
+  /*! @brief Number of times Get called DoSomething. */
+  std::uint64_t Recomputations() const;
+
  private:
-  void class_private_;
-}
+  /* 0 is never a SomeClass version, so a new cache always recomputes. */
+  std::uint64_t version_ = 0;
+  int value_ = 0;
+  std::uint64_t recomputations_ = 0;
+};
 
 /*
  * - For enums, declare them using enum class, not just enum.
@@ -197,8 +478,10 @@ class SomeClass
  */
 enum class SomeEnum 
 {
-  kEnumVarOne = 1;
-  kEnumVarTwo = 2;
+  kEnumVarOne = 1,
+  kEnumVarTwo = 2,
+  /* One past the last value, not a value itself. Has to stay last. */
+  kEnd
 };
 
 /*
@@ -215,8 +498,199 @@ struct SomeStruct
    * words.
    */
   int struct_var;
+};
+
+/*!
+ * @brief DoSomethingElse for an operation chosen at compile time.
+ *
+ * Has no branches, so loops calling it can be fully inlined and vectorized.
+ * Instantiating it for a SomeEnum value without a case fails to compile. The
+ * arithmetic wraps around instead of overflowing.
+ *
+ * @tparam kSomeEnum Selects the operation.
+ * @param[in] some_struct The struct to derive the value from.
+ *
+ * @return The derived value.
+ */
+template <SomeEnum kSomeEnum>
+constexpr int DoSomethingElse(SomeStruct some_struct)
+{
+  if constexpr (kSomeEnum == SomeEnum::kEnumVarOne)
+  {
+    return static_cast<int>(static_cast<std::uint32_t>(
+        some_struct.struct_var) + std::uint32_t{kTempVar});
+  }
+  else if constexpr (kSomeEnum == SomeEnum::kEnumVarTwo)
+  {
+    return static_cast<int>(static_cast<std::uint32_t>(
+        some_struct.struct_var) * std::uint32_t{kTempVar});
+  }
+  else
+  {
+    static_assert(kSomeEnum != kSomeEnum,
+        "DoSomethingElse has no case for this SomeEnum value");
+    return some_struct.struct_var;
+  }
 }
 
+/*!
+ * @brief Calls visitor with some_enum as a template argument.
+ *
+ * The one runtime branch on some_enum for a whole batch, the visitor is
+ * compiled once per value so the loops inside it are free of the branch:
+ *
+ * VisitSomeEnum(some_enum, [&]<SomeEnum kSomeEnum>()
+ * {
+ *   for (std::size_t i = 0; i < results.size(); ++i)
+ *   {
+ *     results[i] = DoSomethingElse<kSomeEnum>(some_structs[i]);
+ *   }
+ * });
+ *
+ * @param[in] some_enum The value to dispatch on.
+ * @param[in] visitor Callable with a SomeEnum template parameter.
+ *
+ * @return false, without calling visitor, if some_enum is not a SomeEnum
+ * value.
+ */
+template <typename Visitor>
+constexpr bool VisitSomeEnum(SomeEnum some_enum, Visitor &&visitor)
+{
+  /* kEnd follows the last value, so a new value fails this until handled. */
+  static_assert(static_cast<int>(SomeEnum::kEnd) ==
+      static_cast<int>(SomeEnum::kEnumVarTwo) + 1,
+      "VisitSomeEnum does not handle every SomeEnum value");
+  switch (some_enum)
+  {
+    case SomeEnum::kEnumVarOne:
+    {
+      visitor.template operator()<SomeEnum::kEnumVarOne>();
+      return true;
+    }
+    case SomeEnum::kEnumVarTwo:
+    {
+      visitor.template operator()<SomeEnum::kEnumVarTwo>();
+      return true;
+    }
+    default:
+    {
+      return false;
+    }
+  }
+}
+
+/*!
+ * @brief Derives a value from some_struct depending on some_enum.
+ *
+ * Defined in the header so that it can be inlined. The arithmetic wraps
+ * around instead of overflowing.
+ * Branches on some_enum for every call, loops over many elements should
+ * dispatch once with VisitSomeEnum and call the DoSomethingElse template.
+ *
+ * @param[in] some_enum Selects the operation, unknown values return
+ * some_struct.struct_var unchanged.
+ * @param[in] some_struct The struct to derive the value from.
+ *
+ * @return The derived value.
+ */
+constexpr int DoSomethingElse(SomeEnum some_enum, SomeStruct some_struct)
+{
+  switch (some_enum)
+  {
+    case SomeEnum::kEnumVarOne:
+    {
+      return DoSomethingElse<SomeEnum::kEnumVarOne>(some_struct);
+    }
+    case SomeEnum::kEnumVarTwo:
+    {
+      return DoSomethingElse<SomeEnum::kEnumVarTwo>(some_struct);
+    }
+    default:
+    {
+      return some_struct.struct_var;
+    }
+  }
+}
+
+/*!
+ * @brief Batched version of DoSomethingElse.
+ *
+ * Computes results[i] = DoSomethingElse(some_enum, some_structs[i]) for every
+ * element, branching on some_enum once for the whole batch.
+ *
+ * @param[in] some_enum Selects the operation for every element.
+ * @param[in] some_structs The structs to derive the values from.
+ * @param[out] results One result per element.
+ *
+ * @return Number of processed elements, 0 if the spans differ in size.
+ */
+std::size_t DoSomethingElseBatch(SomeEnum some_enum,
+    std::span<const SomeStruct> some_structs, std::span<int> results);
+
+/*!
+ * @brief The kernels TempFuncBatch can run with.
+ */
+enum class TempFuncKernel
+{
+  kScalar = 0,
+  kSse41 = 1,
+  kAvx2 = 2,
+  kAvx512 = 3
+};
+
+/*!
+ * @brief Returns the widest TempFunc kernel the executing CPU supports.
+ *
+ * The CPU is only queried once, the result is cached for the lifetime of the
+ * process.
+ */
+TempFuncKernel DetectTempFuncKernel();
+
+/*!
+ * @brief Returns true if kernel can run on the executing CPU.
+ *
+ * @param[in] kernel The kernel to check.
+ */
+bool IsTempFuncKernelSupported(TempFuncKernel kernel);
+
+/*!
+ * @brief Batched version of TempFunc.
+ *
+ * Runs the TempFunc loop for every element of the spans using the kernel
+ * returned by DetectTempFuncKernel. Element i is processed exactly as
+ * TempFunc(some_other_inputs[i], kSomeInput, &some_input_outputs[i], ...)
+ * would process it, the final state is additionally stored in
+ * some_outputs[i].struct_var.
+ *
+ * @param[in] some_other_inputs Per element inputs.
+ * @param[in] kSomeInput Input shared by every element, may not be null.
+ * @param[in, out] some_input_outputs Per element state.
+ * @param[out] some_outputs Per element results, or empty if the final states
+ * in some_input_outputs are all that is needed.
+ *
+ * @return Number of processed elements, 0 if the spans differ in size or if
+ * kSomeInput is null.
+ *
+ * @see TempFuncStep
+ */
+std::size_t TempFuncBatch(std::span<const int> some_other_inputs,
+    const int *kSomeInput, std::span<int> some_input_outputs,
+    std::span<SomeStruct> some_outputs);
+
+/*!
+ * @brief Same as TempFuncBatch but runs with the given kernel.
+ *
+ * Mainly intended for tests and benchmarks comparing kernels.
+ *
+ * @param[in] kernel Kernel to use, falls back to kScalar if it is not
+ * supported by the executing CPU.
+ *
+ * @see TempFuncBatch for the remaining parameters and the return value.
+ */
+std::size_t TempFuncBatchWithKernel(TempFuncKernel kernel,
+    std::span<const int> some_other_inputs, const int *kSomeInput,
+    std::span<int> some_input_outputs, std::span<SomeStruct> some_outputs);
+
 } /* namespace module_a */
 } /* namespace project_structure */
 
@@ -0,0 +1,78 @@
+/* bulk_runner.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: DoSomething and DoSomethingElse over large ranges, spread over
+ * a thread pool with a grain adapted to the measured cost.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "module-a/bulk_runner.h"
+
+#include <cstddef>
+#include <span>
+
+#include "lib/library.h"
+#include "module-a/a.h"
+
+
+namespace project_structure
+{
+namespace module_a
+{
+
+BulkRunner::BulkRunner(lib::ThreadPool &pool,
+    const lib::AdaptiveGrainOptions &options) :
+    pool_(pool), do_something_grain_(options),
+    do_something_else_grain_(options)
+{
+}
+
+std::size_t BulkRunner::DoSomething(std::span<const SomeClass> some_classes,
+    std::span<int> results)
+{
+  if (some_classes.size() != results.size())
+  {
+    return 0;
+  }
+  lib::AdaptiveParallelFor(pool_, do_something_grain_, 0, results.size(),
+      [&](std::size_t begin, std::size_t end)
+  {
+    for (std::size_t i = begin; i < end; ++i)
+    {
+      results[i] = module_a::DoSomething(some_classes[i]);
+    }
+  });
+  return results.size();
+}
+
+std::size_t BulkRunner::DoSomethingElse(SomeEnum some_enum,
+    std::span<const SomeStruct> some_structs, std::span<int> results)
+{
+  if (some_structs.size() != results.size())
+  {
+    return 0;
+  }
+  lib::AdaptiveParallelFor(pool_, do_something_else_grain_, 0,
+      results.size(), [&](std::size_t begin, std::size_t end)
+  {
+    DoSomethingElseBatch(some_enum, some_structs.subspan(begin, end - begin),
+        results.subspan(begin, end - begin));
+  });
+  return results.size();
+}
+
+const lib::AdaptiveGrain &BulkRunner::DoSomethingGrain() const
+{
+  return do_something_grain_;
+}
+
+const lib::AdaptiveGrain &BulkRunner::DoSomethingElseGrain() const
+{
+  return do_something_else_grain_;
+}
+
+} /* namespace module_a */
+} /* namespace project_structure */
@@ -0,0 +1,86 @@
+/* bulk_runner.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: DoSomething and DoSomethingElse over large ranges, spread over
+ * a thread pool with a grain adapted to the measured cost.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_MODULEA_BULKRUNNER_H_
+#define PROJECTSTRUCTURE_MODULEA_BULKRUNNER_H_
+
+#include <cstddef>
+#include <span>
+
+#include "lib/library.h"
+#include "module-a/a.h"
+
+
+namespace project_structure
+{
+namespace module_a
+{
+
+/*!
+ * @brief Runs DoSomething and DoSomethingElse over whole ranges on a
+ * lib::ThreadPool.
+ *
+ * Each operation has its own lib::AdaptiveGrain, so ranges are split into
+ * tasks sized from what the operation has cost so far, and ranges too small
+ * to gain from threads run on the calling thread. Every element's result is
+ * written to its own slot, so the results are the same as a serial loop
+ * whatever the thread count and split.
+ *
+ * Keep one runner per pool and reuse it, a new runner has no estimates and
+ * times the first elements of each operation serially. The class is neither
+ * copyable nor movable. It is thread safe.
+ */
+class BulkRunner
+{
+ public:
+  /*!
+   * @param[in] pool The pool to run on, must outlive the runner.
+   * @param[in] options Grain options of both operations.
+   */
+  explicit BulkRunner(lib::ThreadPool &pool,
+      const lib::AdaptiveGrainOptions &options = lib::AdaptiveGrainOptions{});
+  BulkRunner(const BulkRunner &) = delete;
+  BulkRunner &operator=(const BulkRunner &) = delete;
+
+  /*!
+   * @brief Computes results[i] = DoSomething(some_classes[i]) for every
+   * element.
+   *
+   * @return Number of processed elements, 0 if the spans differ in size.
+   */
+  std::size_t DoSomething(std::span<const SomeClass> some_classes,
+      std::span<int> results);
+
+  /*!
+   * @brief Computes results[i] = DoSomethingElse(some_enum, some_structs[i])
+   * for every element, with DoSomethingElseBatch per task.
+   *
+   * @return Number of processed elements, 0 if the spans differ in size.
+   */
+  std::size_t DoSomethingElse(SomeEnum some_enum,
+      std::span<const SomeStruct> some_structs, std::span<int> results);
+
+  /*! @brief The grain estimate of DoSomething. */
+  const lib::AdaptiveGrain &DoSomethingGrain() const;
+
+  /*! @brief The grain estimate of DoSomethingElse. */
+  const lib::AdaptiveGrain &DoSomethingElseGrain() const;
+
+ private:
+  lib::ThreadPool &pool_;
+  lib::AdaptiveGrain do_something_grain_;
+  lib::AdaptiveGrain do_something_else_grain_;
+};
+
+} /* namespace module_a */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_MODULEA_BULKRUNNER_H_ */
@@ -0,0 +1,44 @@
+/* do_something_cache.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: DoSomething results kept per SomeClass and recomputed only when
+ * the version of their inputs changes.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "module-a/a.h"
+
+#include <cstdint>
+
+
+namespace project_structure
+{
+namespace module_a
+{
+
+int DoSomethingCache::Get(const SomeClass &some_class)
+{
+  if (some_class.ClassCharVersion() != version_)
+  {
+    value_ = DoSomething(some_class);
+    version_ = some_class.ClassCharVersion();
+    ++recomputations_;
+  }
+  return value_;
+}
+
+void DoSomethingCache::Invalidate()
+{
+  version_ = 0;
+}
+
+std::uint64_t DoSomethingCache::Recomputations() const
+{
+  return recomputations_;
+}
+
+} /* namespace module_a */
+} /* namespace project_structure */
@@ -0,0 +1,48 @@
+/* do_something_else_batch.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: DoSomethingElse over a batch of SomeStruct with a single
+ * dispatch on SomeEnum.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "module-a/a.h"
+
+#include <cstddef>
+#include <span>
+
+
+namespace project_structure
+{
+namespace module_a
+{
+
+std::size_t DoSomethingElseBatch(SomeEnum some_enum,
+    std::span<const SomeStruct> some_structs, std::span<int> results)
+{
+  if (some_structs.size() != results.size())
+  {
+    return 0;
+  }
+  if (!VisitSomeEnum(some_enum, [&]<SomeEnum kSomeEnum>()
+  {
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+      results[i] = DoSomethingElse<kSomeEnum>(some_structs[i]);
+    }
+  }))
+  {
+    /* Not a SomeEnum value, DoSomethingElse returns struct_var unchanged. */
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+      results[i] = some_structs[i].struct_var;
+    }
+  }
+  return results.size();
+}
+
+} /* namespace module_a */
+} /* namespace project_structure */
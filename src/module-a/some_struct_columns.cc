@@ -0,0 +1,169 @@
+/* some_struct_columns.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Column oriented (struct of arrays) container for SomeStruct.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "module-a/some_struct_columns.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <utility>
+
+#include "module-a/a.h"
+
+
+namespace project_structure
+{
+namespace module_a
+{
+
+/* Smallest capacity allocated, one cache line worth of int. */
+constexpr std::size_t kMinimumColumnCapacity = kColumnAlignment / sizeof(int);
+/* Largest capacity whose size in bytes fits in a size_t. */
+constexpr std::size_t kMaximumColumnCapacity =
+    std::numeric_limits<std::size_t>::max() / sizeof(int);
+
+SomeStructColumns::SomeStructColumns(SomeStructColumns &&other) noexcept
+    : struct_var_(std::move(other.struct_var_)), size_(other.size_)
+{
+  other.size_ = 0;
+}
+
+SomeStructColumns &SomeStructColumns::operator=(
+    SomeStructColumns &&other) noexcept
+{
+  if (this != &other)
+  {
+    struct_var_ = std::move(other.struct_var_);
+    size_ = other.size_;
+    other.size_ = 0;
+  }
+  return *this;
+}
+
+bool SomeStructColumns::Reserve(std::size_t capacity)
+{
+  return struct_var_.Reserve(capacity, size_);
+}
+
+bool SomeStructColumns::Grow(std::size_t required)
+{
+  std::size_t capacity = Capacity();
+  if (required <= capacity)
+  {
+    return true;
+  }
+  if (required > kMaximumColumnCapacity)
+  {
+    return false;
+  }
+  if (capacity < kMinimumColumnCapacity)
+  {
+    capacity = kMinimumColumnCapacity;
+  }
+  /* Doubling past kMaximumColumnCapacity would wrap around, take required. */
+  while (capacity < required)
+  {
+    capacity = capacity > kMaximumColumnCapacity / 2 ? required :
+        2 * capacity;
+  }
+  return Reserve(capacity);
+}
+
+bool SomeStructColumns::Append(const SomeStruct &some_struct)
+{
+  if (!Grow(size_ + 1))
+  {
+    return false;
+  }
+  struct_var_.Data()[size_] = some_struct.struct_var;
+  ++size_;
+  return true;
+}
+
+bool SomeStructColumns::Append(std::span<const SomeStruct> some_structs)
+{
+  if (!Grow(size_ + some_structs.size()))
+  {
+    return false;
+  }
+  int *struct_var = struct_var_.Data() + size_;
+  for (std::size_t i = 0; i < some_structs.size(); ++i)
+  {
+    struct_var[i] = some_structs[i].struct_var;
+  }
+  size_ += some_structs.size();
+  return true;
+}
+
+void SomeStructColumns::Clear()
+{
+  size_ = 0;
+}
+
+std::size_t SomeStructColumns::Size() const
+{
+  return size_;
+}
+
+std::size_t SomeStructColumns::Capacity() const
+{
+  return struct_var_.Capacity();
+}
+
+SomeStructRowView SomeStructColumns::Row(std::size_t index)
+{
+  return SomeStructRowView{struct_var_.Data()[index]};
+}
+
+SomeStructConstRowView SomeStructColumns::Row(std::size_t index) const
+{
+  return SomeStructConstRowView{struct_var_.Data()[index]};
+}
+
+SomeStruct SomeStructColumns::Get(std::size_t index) const
+{
+  return SomeStruct{struct_var_.Data()[index]};
+}
+
+std::span<int> SomeStructColumns::struct_var()
+{
+  return std::span<int>(struct_var_.Data(), size_);
+}
+
+std::span<const int> SomeStructColumns::struct_var() const
+{
+  return std::span<const int>(struct_var_.Data(), size_);
+}
+
+std::size_t DoSomethingElseColumns(SomeEnum some_enum,
+    const SomeStructColumns &columns, std::span<int> results)
+{
+  if (results.size() != columns.Size())
+  {
+    return 0;
+  }
+  const int *struct_var = columns.struct_var().data();
+  /* One dispatch, every case becomes a plain loop over the column. */
+  if (!VisitSomeEnum(some_enum, [&]<SomeEnum kSomeEnum>()
+  {
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+      results[i] = DoSomethingElse<kSomeEnum>(SomeStruct{struct_var[i]});
+    }
+  }))
+  {
+    std::copy(struct_var, struct_var + results.size(), results.begin());
+  }
+  return results.size();
+}
+
+} /* namespace module_a */
+} /* namespace project_structure */
@@ -0,0 +1,277 @@
+/* some_struct_columns.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Column oriented (struct of arrays) container for SomeStruct.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_MODULEA_SOMESTRUCTCOLUMNS_H_
+#define PROJECTSTRUCTURE_MODULEA_SOMESTRUCTCOLUMNS_H_
+
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <span>
+#include <type_traits>
+
+#include "module-a/a.h"
+
+
+namespace project_structure
+{
+namespace module_a
+{
+
+/*!
+ * @brief Alignment, in bytes, of every column in SomeStructColumns.
+ *
+ * One cache line, which is also enough for the widest vector loads.
+ */
+constexpr std::size_t kColumnAlignment = 64;
+
+/*!
+ * @brief Growable array of trivially copyable elements whose storage is
+ * aligned to kColumnAlignment.
+ *
+ * Building block for SomeStructColumns, one AlignedColumn is used per field.
+ * Memory is allocated with the nothrow operator new, allocation failures are
+ * reported through return values.
+ *
+ * The class is move-only.
+ *
+ * @tparam T Element type, must be trivially copyable.
+ */
+template <typename T>
+class AlignedColumn
+{
+  static_assert(std::is_trivially_copyable_v<T>,
+      "AlignedColumn only supports trivially copyable elements");
+
+ public:
+  AlignedColumn() = default;
+  AlignedColumn(const AlignedColumn &) = delete;
+  AlignedColumn &operator=(const AlignedColumn &) = delete;
+  AlignedColumn(AlignedColumn &&other) noexcept
+      : data_(other.data_), capacity_(other.capacity_)
+  {
+    other.data_ = nullptr;
+    other.capacity_ = 0;
+  }
+  AlignedColumn &operator=(AlignedColumn &&other) noexcept
+  {
+    if (this != &other)
+    {
+      Free();
+      data_ = other.data_;
+      capacity_ = other.capacity_;
+      other.data_ = nullptr;
+      other.capacity_ = 0;
+    }
+    return *this;
+  }
+
+  ~AlignedColumn()
+  {
+    Free();
+  }
+
+  /*!
+   * @brief Makes room for at least capacity elements.
+   *
+   * The first size elements are preserved, the rest are left uninitialized.
+   *
+   * @param[in] capacity Requested capacity.
+   * @param[in] size Number of elements currently in use.
+   *
+   * @return false if the allocation failed or capacity elements do not fit
+   * in a size_t, the column is then unchanged.
+   */
+  bool Reserve(std::size_t capacity, std::size_t size)
+  {
+    if (capacity <= capacity_)
+    {
+      return true;
+    }
+    if (capacity > std::numeric_limits<std::size_t>::max() / sizeof(T))
+    {
+      return false;
+    }
+    T *data = static_cast<T *>(::operator new(capacity * sizeof(T),
+        std::align_val_t{kColumnAlignment}, std::nothrow));
+    if (data == nullptr)
+    {
+      return false;
+    }
+    if (size != 0)
+    {
+      std::memcpy(data, data_, size * sizeof(T));
+    }
+    Free();
+    data_ = data;
+    capacity_ = capacity;
+    return true;
+  }
+
+  /*! @brief Pointer to the first element, nullptr if nothing is reserved. */
+  T *Data()
+  {
+    return data_;
+  }
+  const T *Data() const
+  {
+    return data_;
+  }
+
+  /*! @brief Number of elements that fit without reallocating. */
+  std::size_t Capacity() const
+  {
+    return capacity_;
+  }
+
+ private:
+  void Free()
+  {
+    if (data_ != nullptr)
+    {
+      ::operator delete(data_, std::align_val_t{kColumnAlignment});
+    }
+    data_ = nullptr;
+    capacity_ = 0;
+  }
+
+  T *data_ = nullptr;
+  std::size_t capacity_ = 0;
+};
+
+/*!
+ * @brief Mutable view of one row in a SomeStructColumns.
+ *
+ * Has the same field names as SomeStruct but each field refers into its
+ * column. Only valid until the owning container reallocates.
+ */
+struct SomeStructRowView
+{
+  int &struct_var;
+};
+
+/*!
+ * @brief Read only view of one row in a SomeStructColumns.
+ *
+ * @see SomeStructRowView
+ */
+struct SomeStructConstRowView
+{
+  const int &struct_var;
+};
+
+/*!
+ * @brief Struct of arrays container holding a collection of SomeStruct.
+ *
+ * Every field of SomeStruct is stored in its own contiguous column aligned to
+ * kColumnAlignment. A scan over one field therefore only pulls that field
+ * through the cache, and loops over a column can be vectorized. When a field
+ * is added to SomeStruct a column with the same name has to be added here.
+ *
+ * The class is move-only, copying a large collection should be explicit.
+ *
+ * @note The column spans and row views are invalidated by Append and Reserve
+ * if they have to reallocate.
+ */
+class SomeStructColumns
+{
+ public:
+  SomeStructColumns() = default;
+  SomeStructColumns(const SomeStructColumns &) = delete;
+  SomeStructColumns &operator=(const SomeStructColumns &) = delete;
+  SomeStructColumns(SomeStructColumns &&other) noexcept;
+  SomeStructColumns &operator=(SomeStructColumns &&other) noexcept;
+
+  ~SomeStructColumns() = default;
+
+  /*!
+   * @brief Makes room for at least capacity rows.
+   *
+   * @param[in] capacity Requested number of rows.
+   *
+   * @return false if an allocation failed or capacity rows do not fit in a
+   * size_t, the container is then unchanged.
+   */
+  bool Reserve(std::size_t capacity);
+
+  /*!
+   * @brief Appends one row, scattering the fields into their columns.
+   *
+   * @param[in] some_struct The row to append.
+   *
+   * @return false if growing the columns failed, nothing is appended then.
+   */
+  bool Append(const SomeStruct &some_struct);
+
+  /*!
+   * @brief Appends every element of some_structs.
+   *
+   * @param[in] some_structs Rows to append.
+   *
+   * @return false if growing the columns failed, nothing is appended then.
+   */
+  bool Append(std::span<const SomeStruct> some_structs);
+
+  /*! @brief Removes every row, the capacity is kept. */
+  void Clear();
+
+  /*! @brief Number of rows. */
+  std::size_t Size() const;
+
+  /*! @brief Number of rows that fit without reallocating. */
+  std::size_t Capacity() const;
+
+  /*!
+   * @brief Returns a view of row index.
+   *
+   * @pre index < Size()
+   */
+  SomeStructRowView Row(std::size_t index);
+  SomeStructConstRowView Row(std::size_t index) const;
+
+  /*!
+   * @brief Gathers row index back into a SomeStruct.
+   *
+   * @pre index < Size()
+   */
+  SomeStruct Get(std::size_t index) const;
+
+  /*! @brief The struct_var column, one element per row. */
+  std::span<int> struct_var();
+  std::span<const int> struct_var() const;
+
+ private:
+  /* Grows every column so that at least required rows fit. */
+  bool Grow(std::size_t required);
+
+  AlignedColumn<int> struct_var_;
+  std::size_t size_ = 0;
+};
+
+/*!
+ * @brief Column loop version of DoSomethingElse.
+ *
+ * Computes results[i] = DoSomethingElse(some_enum, columns.Get(i)) for every
+ * row, reading only the columns DoSomethingElse needs.
+ *
+ * @param[in] some_enum Selects the operation for every row.
+ * @param[in] columns Rows to process.
+ * @param[out] results One result per row.
+ *
+ * @return Number of processed rows, 0 if results.size() != columns.Size().
+ */
+std::size_t DoSomethingElseColumns(SomeEnum some_enum,
+    const SomeStructColumns &columns, std::span<int> results);
+
+} /* namespace module_a */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_MODULEA_SOMESTRUCTCOLUMNS_H_ */
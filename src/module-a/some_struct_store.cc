@@ -0,0 +1,93 @@
+/* some_struct_store.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Persistent SomeStruct and SomeClass state in a memory mapped
+ * common::MappedStore, so that it does not have to be rebuilt at startup.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "module-a/some_struct_store.h"
+
+#include <cstdint>
+#include <span>
+
+#include "common/mapped_store.h"
+#include "module-a/a.h"
+
+
+namespace project_structure
+{
+namespace module_a
+{
+
+common::StoreStatus SomeStructStore::Create(const char *path,
+    std::uint64_t some_struct_capacity, std::uint64_t some_class_capacity,
+    const common::MappedStoreOptions &options)
+{
+  const common::StoreSectionSpec kSections[] = {
+      {kSomeStructSectionId, sizeof(SomeStruct), some_struct_capacity},
+      {kSomeClassSectionId, sizeof(SomeClassRecord), some_class_capacity}};
+  return store_.Create(path, kSomeStructStoreSchema, kSections, options);
+}
+
+common::StoreStatus SomeStructStore::Open(const char *path,
+    const common::MappedStoreOptions &options)
+{
+  common::StoreStatus status = store_.Open(path, kSomeStructStoreSchema,
+      options);
+  /* Same schema hash but other sections means the file is broken. */
+  if (status == common::StoreStatus::kOk &&
+      (store_.RecordSize(kSomeStructSectionId) != sizeof(SomeStruct) ||
+      store_.RecordSize(kSomeClassSectionId) != sizeof(SomeClassRecord)))
+  {
+    store_.Close();
+    status = common::StoreStatus::kCorrupt;
+  }
+  return status;
+}
+
+std::span<const SomeStruct> SomeStructStore::SomeStructs() const
+{
+  return store_.RecordsAs<SomeStruct>(kSomeStructSectionId);
+}
+
+std::span<const SomeClassRecord> SomeStructStore::SomeClasses() const
+{
+  return store_.RecordsAs<SomeClassRecord>(kSomeClassSectionId);
+}
+
+common::StoreStatus SomeStructStore::AppendSomeStructs(
+    std::span<const SomeStruct> some_structs)
+{
+  return store_.AppendRecords(kSomeStructSectionId, some_structs);
+}
+
+common::StoreStatus SomeStructStore::AppendSomeClass(
+    const SomeClass &some_class)
+{
+  const SomeClassRecord kRecord[] = {{some_class.kClassConst_,
+      some_class.ClassChar(), {}}};
+  return store_.AppendRecords(kSomeClassSectionId,
+      std::span<const SomeClassRecord>(kRecord));
+}
+
+common::StoreStatus SomeStructStore::Flush()
+{
+  return store_.Flush();
+}
+
+void SomeStructStore::Close()
+{
+  store_.Close();
+}
+
+const common::MappedStore &SomeStructStore::Store() const
+{
+  return store_;
+}
+
+} /* namespace module_a */
+} /* namespace project_structure */
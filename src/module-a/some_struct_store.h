@@ -0,0 +1,145 @@
+/* some_struct_store.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Persistent SomeStruct and SomeClass state in a memory mapped
+ * common::MappedStore, so that it does not have to be rebuilt at startup.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_MODULEA_SOMESTRUCTSTORE_H_
+#define PROJECTSTRUCTURE_MODULEA_SOMESTRUCTSTORE_H_
+
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+#include "common/mapped_store.h"
+#include "module-a/a.h"
+
+
+namespace project_structure
+{
+namespace module_a
+{
+
+/*! @brief Id of the store section holding SomeStruct records. */
+constexpr std::uint32_t kSomeStructSectionId = 1;
+
+/*! @brief Id of the store section holding SomeClassRecord records. */
+constexpr std::uint32_t kSomeClassSectionId = 2;
+
+/*!
+ * @brief Stored form of a SomeClass, which itself can not be used in place.
+ */
+struct SomeClassRecord
+{
+  /* SomeClass::kClassConst_. */
+  std::int32_t class_const;
+  /* SomeClass::ClassChar(). */
+  char class_char;
+  /* Zero, keeps the layout free of padding. */
+  char reserved[3];
+};
+
+/*
+ * The records are used in place, so their layout is the file format. A change
+ * of either struct fails these checks, update kSomeStructStoreSchema together
+ * with them so that old files are rejected instead of misread.
+ */
+static_assert(std::is_trivially_copyable_v<SomeStruct> &&
+    sizeof(SomeStruct) == 4, "SomeStruct no longer matches the store schema");
+static_assert(std::is_trivially_copyable_v<SomeClassRecord> &&
+    sizeof(SomeClassRecord) == 8,
+    "SomeClassRecord no longer matches the store schema");
+
+/*!
+ * @brief Schema hash of the SomeStruct store, see common::StoreSchemaHash.
+ */
+constexpr std::uint64_t kSomeStructStoreSchema = common::StoreSchemaHash(
+    "SomeStruct{int32 struct_var}"
+    "SomeClassRecord{int32 class_const,char class_char,char reserved[3]}");
+
+/*!
+ * @brief The SomeStruct and SomeClass state of module_a, kept in a store file.
+ *
+ * Opening an existing store takes milliseconds whatever its size, SomeStructs
+ * returns the SomeStruct objects right where they lie in the mapping. Other
+ * modules can read the same mapping through Store, with their own record
+ * types for the sections.
+ *
+ * Reading is thread safe, appending is done by one thread at a time. The
+ * class is neither copyable nor movable.
+ */
+class SomeStructStore
+{
+ public:
+  SomeStructStore() = default;
+  SomeStructStore(const SomeStructStore &) = delete;
+  SomeStructStore &operator=(const SomeStructStore &) = delete;
+
+  /*!
+   * @brief Creates (or truncates) the store file at path.
+   *
+   * @param[in] path Path of the file, may not be null.
+   * @param[in] some_struct_capacity Number of SomeStruct objects it can hold.
+   * @param[in] some_class_capacity Number of SomeClass objects it can hold.
+   * @param[in] options The msync policy, the store is always writable.
+   *
+   * @return See common::MappedStore::Create.
+   */
+  common::StoreStatus Create(const char *path,
+      std::uint64_t some_struct_capacity, std::uint64_t some_class_capacity,
+      const common::MappedStoreOptions &options =
+          common::MappedStoreOptions{});
+
+  /*!
+   * @brief Opens an existing store file.
+   *
+   * @return See common::MappedStore::Open, kSchemaMismatch if the file was
+   * written for other layouts of SomeStruct or SomeClassRecord.
+   */
+  common::StoreStatus Open(const char *path,
+      const common::MappedStoreOptions &options =
+          common::MappedStoreOptions{});
+
+  /*! @brief The stored SomeStruct objects, in place. */
+  std::span<const SomeStruct> SomeStructs() const;
+
+  /*! @brief The stored SomeClass state, in place. */
+  std::span<const SomeClassRecord> SomeClasses() const;
+
+  /*!
+   * @brief Appends some_structs, all or none of them.
+   *
+   * @return See common::MappedStore::Append.
+   */
+  common::StoreStatus AppendSomeStructs(
+      std::span<const SomeStruct> some_structs);
+
+  /*!
+   * @brief Appends the state of some_class.
+   *
+   * @return See common::MappedStore::Append.
+   */
+  common::StoreStatus AppendSomeClass(const SomeClass &some_class);
+
+  /*! @brief See common::MappedStore::Flush. */
+  common::StoreStatus Flush();
+
+  /*! @brief See common::MappedStore::Close. */
+  void Close();
+
+  /*! @brief The underlying store, for readers in other modules. */
+  const common::MappedStore &Store() const;
+
+ private:
+  common::MappedStore store_;
+};
+
+} /* namespace module_a */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_MODULEA_SOMESTRUCTSTORE_H_ */
@@ -0,0 +1,305 @@
+/* temp_func_batch.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Batched TempFunc with SSE4.1, AVX2 and AVX-512 kernels which are
+ * selected at runtime depending on the executing CPU.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "module-a/a.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "common/alloc_tracker.h"
+#include "common/sharded_counter.h"
+#include "common/stats.h"
+#include "common/trace.h"
+
+
+namespace project_structure
+{
+namespace module_a
+{
+
+/* Probes of TempFuncBatch, global so that they are registered once. */
+const common::StatId kTempFuncBatchStat = common::RegisterStat(
+    "module_a::TempFuncBatch", common::StatKind::kTimer);
+const common::StatId kTempFuncBatchElementsStat = common::RegisterStat(
+    "module_a::TempFuncBatch elements", common::StatKind::kCounter);
+
+/*
+ * Scalar kernel, also used for the tail elements which do not fill a whole
+ * vector in the wider kernels. Every kernel leaves some_outputs alone if it
+ * is nullptr.
+ */
+static void TempFuncKernelScalar(const int *some_other_inputs,
+    std::uint32_t some_input, int *some_input_outputs, SomeStruct *some_outputs,
+    std::size_t count)
+{
+  std::uint32_t state = 0;
+  std::uint32_t other_input = 0;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    state = static_cast<std::uint32_t>(some_input_outputs[i]);
+    other_input = static_cast<std::uint32_t>(some_other_inputs[i]);
+    for (int j = 0; j < kTempFuncIterations; ++j)
+    {
+      state = TempFuncStep(state, other_input, some_input,
+          static_cast<std::uint32_t>(j));
+    }
+    some_input_outputs[i] = static_cast<int>(state);
+    if (some_outputs != nullptr)
+    {
+      some_outputs[i].struct_var = static_cast<int>(state);
+    }
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/*
+ * The vector kernels below are written out per instruction set rather than
+ * generated from a template, since each intrinsic family has its own types.
+ * They all evaluate TempFuncStep lane by lane:
+ * state = state * kTempVar + (some_other_input ^ (some_input + iteration)).
+ * Only the lane count differs.
+ */
+__attribute__((target("sse4.1")))
+static void TempFuncKernelSse41(const int *some_other_inputs,
+    std::uint32_t some_input, int *some_input_outputs, SomeStruct *some_outputs,
+    std::size_t count)
+{
+  constexpr std::size_t kLanes = 4;
+  const __m128i kMultiplier = _mm_set1_epi32(kTempVar);
+  __m128i state = _mm_setzero_si128();
+  __m128i other_input = _mm_setzero_si128();
+  __m128i mixed = _mm_setzero_si128();
+  alignas(16) int results[kLanes] = {};
+  std::size_t i = 0;
+  for (; i + kLanes <= count; i += kLanes)
+  {
+    state = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(some_input_outputs + i));
+    other_input = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(some_other_inputs + i));
+    for (int j = 0; j < kTempFuncIterations; ++j)
+    {
+      mixed = _mm_xor_si128(other_input,
+          _mm_set1_epi32(static_cast<int>(some_input +
+              static_cast<std::uint32_t>(j))));
+      state = _mm_add_epi32(_mm_mullo_epi32(state, kMultiplier), mixed);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(some_input_outputs + i),
+        state);
+    if (some_outputs != nullptr)
+    {
+      _mm_store_si128(reinterpret_cast<__m128i *>(results), state);
+      for (std::size_t k = 0; k < kLanes; ++k)
+      {
+        some_outputs[i + k].struct_var = results[k];
+      }
+    }
+  }
+  TempFuncKernelScalar(some_other_inputs + i, some_input,
+      some_input_outputs + i,
+      some_outputs == nullptr ? nullptr : some_outputs + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void TempFuncKernelAvx2(const int *some_other_inputs,
+    std::uint32_t some_input, int *some_input_outputs, SomeStruct *some_outputs,
+    std::size_t count)
+{
+  constexpr std::size_t kLanes = 8;
+  const __m256i kMultiplier = _mm256_set1_epi32(kTempVar);
+  __m256i state = _mm256_setzero_si256();
+  __m256i other_input = _mm256_setzero_si256();
+  __m256i mixed = _mm256_setzero_si256();
+  alignas(32) int results[kLanes] = {};
+  std::size_t i = 0;
+  for (; i + kLanes <= count; i += kLanes)
+  {
+    state = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(some_input_outputs + i));
+    other_input = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(some_other_inputs + i));
+    for (int j = 0; j < kTempFuncIterations; ++j)
+    {
+      mixed = _mm256_xor_si256(other_input,
+          _mm256_set1_epi32(static_cast<int>(some_input +
+              static_cast<std::uint32_t>(j))));
+      state = _mm256_add_epi32(_mm256_mullo_epi32(state, kMultiplier), mixed);
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(some_input_outputs + i),
+        state);
+    if (some_outputs != nullptr)
+    {
+      _mm256_store_si256(reinterpret_cast<__m256i *>(results), state);
+      for (std::size_t k = 0; k < kLanes; ++k)
+      {
+        some_outputs[i + k].struct_var = results[k];
+      }
+    }
+  }
+  TempFuncKernelScalar(some_other_inputs + i, some_input,
+      some_input_outputs + i,
+      some_outputs == nullptr ? nullptr : some_outputs + i, count - i);
+}
+
+__attribute__((target("avx512f")))
+static void TempFuncKernelAvx512(const int *some_other_inputs,
+    std::uint32_t some_input, int *some_input_outputs, SomeStruct *some_outputs,
+    std::size_t count)
+{
+  constexpr std::size_t kLanes = 16;
+  const __m512i kMultiplier = _mm512_set1_epi32(kTempVar);
+  __m512i state = _mm512_setzero_si512();
+  __m512i other_input = _mm512_setzero_si512();
+  __m512i mixed = _mm512_setzero_si512();
+  alignas(64) int results[kLanes] = {};
+  std::size_t i = 0;
+  for (; i + kLanes <= count; i += kLanes)
+  {
+    state = _mm512_loadu_si512(some_input_outputs + i);
+    other_input = _mm512_loadu_si512(some_other_inputs + i);
+    for (int j = 0; j < kTempFuncIterations; ++j)
+    {
+      mixed = _mm512_xor_si512(other_input,
+          _mm512_set1_epi32(static_cast<int>(some_input +
+              static_cast<std::uint32_t>(j))));
+      state = _mm512_add_epi32(_mm512_mullo_epi32(state, kMultiplier), mixed);
+    }
+    _mm512_storeu_si512(some_input_outputs + i, state);
+    if (some_outputs != nullptr)
+    {
+      _mm512_store_si512(results, state);
+      for (std::size_t k = 0; k < kLanes; ++k)
+      {
+        some_outputs[i + k].struct_var = results[k];
+      }
+    }
+  }
+  TempFuncKernelScalar(some_other_inputs + i, some_input,
+      some_input_outputs + i,
+      some_outputs == nullptr ? nullptr : some_outputs + i, count - i);
+}
+
+#endif /* defined(__x86_64__) || defined(__i386__) */
+
+/* Queries the CPU, only called once to initialize kDetectedTempFuncKernel. */
+static TempFuncKernel QueryTempFuncKernel()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+  {
+    return TempFuncKernel::kAvx512;
+  }
+  if (__builtin_cpu_supports("avx2"))
+  {
+    return TempFuncKernel::kAvx2;
+  }
+  if (__builtin_cpu_supports("sse4.1"))
+  {
+    return TempFuncKernel::kSse41;
+  }
+#endif /* defined(__x86_64__) || defined(__i386__) */
+  return TempFuncKernel::kScalar;
+}
+
+/*
+ * The widest kernel supported by the executing CPU. Global so that the CPU is
+ * only queried once instead of on every batch.
+ */
+const TempFuncKernel kDetectedTempFuncKernel = QueryTempFuncKernel();
+
+TempFuncKernel DetectTempFuncKernel()
+{
+  return kDetectedTempFuncKernel;
+}
+
+bool IsTempFuncKernelSupported(TempFuncKernel kernel)
+{
+  return static_cast<int>(kernel) <=
+      static_cast<int>(kDetectedTempFuncKernel);
+}
+
+std::size_t TempFuncBatch(std::span<const int> some_other_inputs,
+    const int *kSomeInput, std::span<int> some_input_outputs,
+    std::span<SomeStruct> some_outputs)
+{
+  return TempFuncBatchWithKernel(kDetectedTempFuncKernel, some_other_inputs,
+      kSomeInput, some_input_outputs, some_outputs);
+}
+
+std::size_t TempFuncBatchWithKernel(TempFuncKernel kernel,
+    std::span<const int> some_other_inputs, const int *kSomeInput,
+    std::span<int> some_input_outputs, std::span<SomeStruct> some_outputs)
+{
+  common::ScopedStatTimer timer(kTempFuncBatchStat);
+  common::ScopedTrace trace(common::TraceCategory::kModuleA,
+      "module_a::TempFuncBatch");
+  common::ScopedAllocationScope allocation_scope(
+      common::AllocationScope::kModuleA);
+  SomeStruct *outputs = some_outputs.empty() ? nullptr : some_outputs.data();
+  if (kSomeInput == nullptr ||
+      some_other_inputs.size() != some_input_outputs.size() ||
+      (outputs != nullptr && some_other_inputs.size() != some_outputs.size()))
+  {
+    return 0;
+  }
+  if (!IsTempFuncKernelSupported(kernel))
+  {
+    kernel = TempFuncKernel::kScalar;
+  }
+
+  const std::uint32_t kSomeInputValue = static_cast<std::uint32_t>(*kSomeInput);
+  switch (kernel)
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    case TempFuncKernel::kAvx512:
+    {
+      TempFuncKernelAvx512(some_other_inputs.data(), kSomeInputValue,
+          some_input_outputs.data(), outputs,
+          some_other_inputs.size());
+      break;
+    }
+    case TempFuncKernel::kAvx2:
+    {
+      TempFuncKernelAvx2(some_other_inputs.data(), kSomeInputValue,
+          some_input_outputs.data(), outputs,
+          some_other_inputs.size());
+      break;
+    }
+    case TempFuncKernel::kSse41:
+    {
+      TempFuncKernelSse41(some_other_inputs.data(), kSomeInputValue,
+          some_input_outputs.data(), outputs,
+          some_other_inputs.size());
+      break;
+    }
+#endif /* defined(__x86_64__) || defined(__i386__) */
+    default:
+    {
+      TempFuncKernelScalar(some_other_inputs.data(), kSomeInputValue,
+          some_input_outputs.data(), outputs,
+          some_other_inputs.size());
+      break;
+    }
+  }
+  global_var.Add(static_cast<std::int64_t>(some_other_inputs.size()));
+  common::AddToStat(kTempFuncBatchElementsStat, some_other_inputs.size());
+  return some_other_inputs.size();
+}
+
+} /* namespace module_a */
+} /* namespace project_structure */
@@ -2,7 +2,7 @@
  *==============================================================================
  * Author: Carl Larsson
  * Creation date: 2024-09-09
- * Last modified: 2024-10-08 by Carl Larsson
+ * Last modified: 2026-10-18 by Carl Larsson
  * Description: Example .cc file used for example file structure and Google C++ 
  * style guide, it is only meant to be used as a template. All functions and 
  * variables are dummy and the contents of this file should in no way been seen 
@@ -64,12 +64,14 @@
 
 /* Example C++ standard library header. */
 #include <algorithm>
+#include <cstdint>
 
-/* Other libraries .h files. */
-#include "other_header_needed.h"
+/* Other libraries .h files, none are needed here. */
 
 /* Projects .h files. */
-#include "somewhere/some_project_header.h"
+#include "common/alloc_tracker.h"
+#include "common/sharded_counter.h"
+#include "common/stats.h"
 
 
 /*
@@ -82,11 +84,24 @@
 namespace project_structure
 {
 /* Path */
-namespace module_a
+namespace module_b
 {
 
 /* The contents of namespaces should not be indented. */
-...
+
+common::ShardedCounter global_var;
+
+common::FunctionMemo<common::TempFuncKey, std::uint32_t,
+    common::TempFuncKeyHash> temp_func_memo;
+
+/* Probes of this file, global so that they are registered once. */
+const common::StatId kTempFuncStat = common::RegisterStat(
+    "module_b::TempFunc", common::StatKind::kTimer);
+
+SomeClass::SomeClass(int class_const, char class_char)
+    : kClassConst_(class_const), class_char_(class_char), class_private_(0)
+{
+}
 
 /*
  * Function names begin with capital letter and have capital letter for each
@@ -94,18 +109,6 @@ namespace module_a
  */
 void SomeFunction();
 
-/*
- * - Using the class, enum and struct from b.h, and avoiding forward decleration 
- * since they were declared in b.h and then just included (from b.h) for use 
- * here.
- */
-DoSomething(SomeClass);
-DoSomethingElse(SomeEnum, SomeStruct);
-
-...
-
-
-
 /*
  * - Write short and focused functions please!
  * - If TempFunc does not need to be referenced outside of this file, then use 
@@ -133,7 +136,7 @@ DoSomethingElse(SomeEnum, SomeStruct);
  * Constants start with a k and then capital letter at the beginning of each 
  * new word.
  */
-static int TempFunc(int some_other_input,const *kSomeInput, 
+int TempFunc(int some_other_input, const int *kSomeInput,
     int *some_input_output, void *some_output)
 {
   /*
@@ -143,34 +146,29 @@ static int TempFunc(int some_other_input,const *kSomeInput,
    * - DO NOT USE STATIC LOCAL VARIABLES!
    * - DO NOT USE SHORT, LONG OR LONG LONG!
    */
-  int var = 3;
-  /*
-   * - DO NOT use cast formats like: (int)x unless it is to void.
-   * - Use C++ style casts like: static_cast<float>(double_value) or brace 
-   * initialization like int64_t{1}.
-   */
-  DoSomething(int64_t{var});
-
-  /* Always write floating-point with radix point and digits on both sides. */
-  float some_float = 1.0f;
-  /* DO NOT USE LONG DOUBLE! */
-  double some_double = -0.5;
-  double some_other_double = 1000.0e6;
-
+  common::ScopedStatTimer timer(kTempFuncStat);
+  common::ScopedAllocationScope allocation_scope(
+      common::AllocationScope::kModuleB);
+  const common::TempFuncKey kKey{static_cast<std::uint32_t>(some_other_input),
+      static_cast<std::uint32_t>(*kSomeInput),
+      static_cast<std::uint32_t>(*some_input_output)};
+  std::uint32_t memoized = 0;
+  global_var.Increment();
   /*
+   * - Always write floating-point with radix point and digits on both sides,
+   * like 1.0f, -0.5 or 1000.0e6.
+   * - DO NOT USE LONG DOUBLE!
    * - If a pointer is suppossed to not point to anything, or it is the end of 
    * list or similar, then use nullptr (also use it to check if pointer points 
-   * to something).
+   * to something). And if it is char, then use '\0'.
+   * - No spaces around period or arrow, like r->y.
+   * - Use sizeof(varname), not sizeof(type).
+   * - DO NOT use cast formats like: (int)x unless it is to void, as for the
+   * unused some_output here.
+   * - Use C++ style casts like: static_cast<float>(double_value) or brace 
+   * initialization like int64_t{1}.
    */
-  int *int_pointer = nullptr;
-  /* And if it is char, then use '\0'. */
-
-  /* No spaces around period or arrow. */
-  x  = r->y;
-
-  /* Use sizeof(varname), not sizeof(type). */
-  SomeClass data;
-  memset(&data, 0, sizeof(data));
+  (void)some_output;
 
   /*
    * - Variables needed for: if, for, while statements should be attempted to be 
@@ -179,32 +177,24 @@ static int TempFunc(int some_other_input,const *kSomeInput,
    * statements and their component/condition/iteration specifier.
    * - Single space after each semicolon (;).
    * - Increment using ++i formand and decrement using the --i format.
+   * - DO NOT DECLARE VARIABLES IN LOOPS!
+   * - while (condition); is not allowed, write while (condition) {} or
+   * while (condition) continue; instead.
+   * - Switching statements must have a default case.
    */
-  for (int i = 0; i < 100; ++i)
+  if (temp_func_memo.Lookup(kKey, memoized))
   {
-    /* DO NOT DECLARE VARIABLES IN LOOPS! */
-    ...
+    *some_input_output = static_cast<int>(memoized);
   }
-
-  /*
-   * while (condition); is not allowed.
-   * Instead do:
-   */
-  while (condition) {};
-  /* or */
-  while (condition) continue;
-
-  /* Switching statements must have a default case. */
-  switch (var) 
+  else
   {
-    case 0;
-    {
-      ...
-    }
-    default:
-    {
-      ...
-    }
+    *some_input_output = static_cast<int>(TempFuncUnrolled<
+        kTempFuncIterations, kTempVar>(
+            static_cast<std::uint32_t>(*some_input_output),
+            static_cast<std::uint32_t>(some_other_input),
+            static_cast<std::uint32_t>(*kSomeInput)));
+    temp_func_memo.Store(kKey,
+        static_cast<std::uint32_t>(*some_input_output));
   }
 
   /*
@@ -212,8 +202,8 @@ static int TempFunc(int some_other_input,const *kSomeInput,
    * - Preferably return by value, if you can not, then return by reference. 
    */
   /* Avoid returning a raw pointer, unless it can be null. */
-  return something;
+  return *some_input_output;
 }
 
-} /* namespace module_a */
+} /* namespace module_b */
 } /* namespace project_structure */
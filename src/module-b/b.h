@@ -2,7 +2,7 @@
  *==============================================================================
  * Author: Carl Larsson
  * Creation date: 2024-09-09
- * Last modified: 2024-10-08 by Carl Larsson
+ * Last modified: 2026-10-18 by Carl Larsson
  * Description: Example .h file used for example file structure and Google C++ 
  * style guide, it is only meant to be used as a template. All functions and 
  * variables are dummy and the contents of this file should in no way been seen 
@@ -71,19 +71,24 @@
  * - Project headers should be included as decendents of the src directory of 
  * the project.
  */
-#include "somewhere/some_file.h"
+/* No related .h file, b.h is the related .h file of b.cc. */
 
 /* Example C system header. */
 #include <unistd.h>
 
 /* Example C++ standard library header. */
 #include <algorithm>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <utility>
 
-/* Other libraries .h files. */
-#include "other_header_needed.h"
+/* Other libraries .h files, none are needed here. */
 
 /* Projects .h files. */
-#include "somewhere/some_project_header.h"
+#include "common/function_memo.h"
+#include "common/mapped_store.h"
+#include "common/sharded_counter.h"
 
 /*
  * Always try to place code in namespaces.
@@ -95,7 +100,7 @@
 namespace project_structure
 {
 /* Path */
-namespace module_a
+namespace module_b
 {
 
 /*!
@@ -119,7 +124,7 @@ namespace module_a
  *
  * @warning This function doesn't work, its just a placeholder.
  */
-static int TempFunc(int some_other_input,const *kSomeInput, 
+int TempFunc(int some_other_input, const int *kSomeInput,
     int *some_input_output, void *some_output);
 
 /*
@@ -132,13 +137,125 @@ static int TempFunc(int some_other_input,const *kSomeInput,
  */
 constexpr int kTempVar = 5;
 
+/*!
+ * @brief Number of iterations performed by the TempFunc loop.
+ */
+constexpr int kTempFuncIterations = 100;
+
+/*!
+ * @brief Performs one iteration of the TempFunc loop.
+ *
+ * Same step as module_a::TempFuncStep, the arithmetic is done on unsigned
+ * 32-bit integers so that wrap-around is well defined.
+ *
+ * @param[in] state Current value of some_input_output.
+ * @param[in] some_other_input Per element input.
+ * @param[in] some_input The value kSomeInput points to.
+ * @param[in] iteration Index of the current loop iteration.
+ *
+ * @return The next value of some_input_output.
+ */
+constexpr std::uint32_t TempFuncStep(std::uint32_t state,
+    std::uint32_t some_other_input, std::uint32_t some_input,
+    std::uint32_t iteration)
+{
+  return state * std::uint32_t{kTempVar} +
+      (some_other_input ^ (some_input + iteration));
+}
+
+/*! @brief Same as module_a::TempFuncPower. */
+constexpr std::uint32_t TempFuncPower(std::uint32_t temp_var, int exponent)
+{
+  std::uint32_t power = 1;
+  for (int i = 0; i < exponent; ++i)
+  {
+    power *= temp_var;
+  }
+  return power;
+}
+
+/*!
+ * @brief Same as module_a::TempFuncLoop, the TempFunc loop with a trip count
+ * and multiplier known only at run time.
+ */
+constexpr std::uint32_t TempFuncLoop(std::uint32_t state,
+    std::uint32_t some_other_input, std::uint32_t some_input, int iterations,
+    int temp_var)
+{
+  for (int i = 0; i < iterations; ++i)
+  {
+    state = state * static_cast<std::uint32_t>(temp_var) +
+        (some_other_input ^ (some_input + static_cast<std::uint32_t>(i)));
+  }
+  return state;
+}
+
+/* The body of TempFuncUnrolled, see module_a::TempFuncUnrolledTerms. */
+template <int kIterations, int kTempVarValue, std::uint32_t... kIteration>
+constexpr std::uint32_t TempFuncUnrolledTerms(std::uint32_t state,
+    std::uint32_t some_other_input, std::uint32_t some_input,
+    std::integer_sequence<std::uint32_t, kIteration...>)
+{
+  return state * std::integral_constant<std::uint32_t, TempFuncPower(
+      static_cast<std::uint32_t>(kTempVarValue), kIterations)>::value +
+      (std::uint32_t{0} + ... + (std::integral_constant<std::uint32_t,
+          TempFuncPower(static_cast<std::uint32_t>(kTempVarValue),
+              kIterations - 1 - static_cast<int>(kIteration))>::value *
+          (some_other_input ^ (some_input + kIteration))));
+}
+
+/*!
+ * @brief Same as module_a::TempFuncUnrolled, the TempFunc loop fully unrolled
+ * for a trip count and multiplier fixed at compile time.
+ */
+template <int kIterations = kTempFuncIterations, int kTempVarValue = kTempVar>
+constexpr std::uint32_t TempFuncUnrolled(std::uint32_t state,
+    std::uint32_t some_other_input, std::uint32_t some_input)
+{
+  static_assert(kIterations >= 0, "the trip count can not be negative");
+  return TempFuncUnrolledTerms<kIterations, kTempVarValue>(state,
+      some_other_input, some_input,
+      std::make_integer_sequence<std::uint32_t, kIterations>{});
+}
+
+/*! @brief Same as module_a::TempFuncIterate. */
+constexpr std::uint32_t TempFuncIterate(std::uint32_t state,
+    std::uint32_t some_other_input, std::uint32_t some_input, int iterations,
+    int temp_var)
+{
+  if (iterations == kTempFuncIterations && temp_var == kTempVar)
+  {
+    return TempFuncUnrolled<kTempFuncIterations, kTempVar>(state,
+        some_other_input, some_input);
+  }
+  return TempFuncLoop(state, some_other_input, some_input, iterations,
+      temp_var);
+}
+
 /*
  * - Global variables should have comment describing what they are, what they 
  * are used for, and why they need to be global.
  * - Vaiables are all lowercase with _ for word seperation.
  */
-int global_var = 1;
+/*!
+ * @brief Number of elements processed by TempFunc in module_b.
+ *
+ * Kept apart from the module_a counter so the two modules are reported
+ * separately. Incremented once per TempFunc call, on the thread making it.
+ */
+extern common::ShardedCounter global_var;
 
+/*!
+ * @brief Memoization of TempFunc in module_b, off until
+ * temp_func_memo.Enable() is called.
+ *
+ * Global for the same reason as global_var, TempFunc has no object to keep
+ * the cache in and runs on whichever thread calls it.
+ *
+ * @see common::FunctionMemo
+ */
+extern common::FunctionMemo<common::TempFuncKey, std::uint32_t,
+    common::TempFuncKeyHash> temp_func_memo;
 
 /*
  * - Avoiding forward decleration.
@@ -173,6 +290,17 @@ class SomeClass
    * and ending with _ (class data member).
    */
   const int kClassConst_;
+
+  /*!
+   * @brief Creates a SomeClass.
+   *
+   * Has no requirements on where it is placed, so it can be created on the
+   * stack, the heap or in a common::Arena.
+   *
+   * @param[in] class_const Value of kClassConst_.
+   * @param[in] class_char Initial value of class_char_.
+   */
+  SomeClass(int class_const, char class_char);
  /*
   * Classes data members which are part of a test fixture class (defined in a 
   * .cc file) can be protected if using Google Test.
@@ -185,8 +313,8 @@ class SomeClass
   char class_char_;
  /* Classes data members should be private unless they are constants. */
  private:
-  void class_private_;
-}
+  int class_private_;
+};
 
 /*
  * - For enums, declare them using enum class, not just enum.
@@ -196,8 +324,10 @@ class SomeClass
  */
 enum class SomeEnum 
 {
-  kEnumVarOne = 1;
-  kEnumVarTwo = 2;
+  kEnumVarOne = 1,
+  kEnumVarTwo = 2,
+  /* One past the last value, not a value itself. Has to stay last. */
+  kEnd
 };
 
 /*
@@ -214,9 +344,140 @@ struct SomeStruct
    * words.
    */
   int struct_var;
+};
+
+/*!
+ * @brief DoSomethingElse for an operation chosen at compile time.
+ *
+ * Has no branches, so loops calling it can be fully inlined and vectorized.
+ * Instantiating it for a SomeEnum value without a case fails to compile. The
+ * arithmetic wraps around instead of overflowing.
+ *
+ * @tparam kSomeEnum Selects the operation.
+ * @param[in] some_struct The struct to derive the value from.
+ *
+ * @return The derived value.
+ */
+template <SomeEnum kSomeEnum>
+constexpr int DoSomethingElse(SomeStruct some_struct)
+{
+  if constexpr (kSomeEnum == SomeEnum::kEnumVarOne)
+  {
+    return static_cast<int>(static_cast<std::uint32_t>(
+        some_struct.struct_var) + std::uint32_t{kTempVar});
+  }
+  else if constexpr (kSomeEnum == SomeEnum::kEnumVarTwo)
+  {
+    return static_cast<int>(static_cast<std::uint32_t>(
+        some_struct.struct_var) * std::uint32_t{kTempVar});
+  }
+  else
+  {
+    static_assert(kSomeEnum != kSomeEnum,
+        "DoSomethingElse has no case for this SomeEnum value");
+    return some_struct.struct_var;
+  }
+}
+
+/*!
+ * @brief Calls visitor with some_enum as a template argument.
+ *
+ * The one runtime branch on some_enum for a whole batch, the visitor is
+ * compiled once per value so the loops inside it are free of the branch:
+ *
+ * VisitSomeEnum(some_enum, [&]<SomeEnum kSomeEnum>()
+ * {
+ *   for (std::size_t i = 0; i < results.size(); ++i)
+ *   {
+ *     results[i] = DoSomethingElse<kSomeEnum>(some_structs[i]);
+ *   }
+ * });
+ *
+ * @param[in] some_enum The value to dispatch on.
+ * @param[in] visitor Callable with a SomeEnum template parameter.
+ *
+ * @return false, without calling visitor, if some_enum is not a SomeEnum
+ * value.
+ */
+template <typename Visitor>
+constexpr bool VisitSomeEnum(SomeEnum some_enum, Visitor &&visitor)
+{
+  /* kEnd follows the last value, so a new value fails this until handled. */
+  static_assert(static_cast<int>(SomeEnum::kEnd) ==
+      static_cast<int>(SomeEnum::kEnumVarTwo) + 1,
+      "VisitSomeEnum does not handle every SomeEnum value");
+  switch (some_enum)
+  {
+    case SomeEnum::kEnumVarOne:
+    {
+      visitor.template operator()<SomeEnum::kEnumVarOne>();
+      return true;
+    }
+    case SomeEnum::kEnumVarTwo:
+    {
+      visitor.template operator()<SomeEnum::kEnumVarTwo>();
+      return true;
+    }
+    default:
+    {
+      return false;
+    }
+  }
+}
+
+/*!
+ * @brief Derives a value from some_struct depending on some_enum.
+ *
+ * Defined in the header so that it can be inlined. The arithmetic wraps
+ * around instead of overflowing.
+ * Branches on some_enum for every call, loops over many elements should
+ * dispatch once with VisitSomeEnum and call the DoSomethingElse template.
+ *
+ * @param[in] some_enum Selects the operation, unknown values return
+ * some_struct.struct_var unchanged.
+ * @param[in] some_struct The struct to derive the value from.
+ *
+ * @return The derived value.
+ */
+constexpr int DoSomethingElse(SomeEnum some_enum, SomeStruct some_struct)
+{
+  switch (some_enum)
+  {
+    case SomeEnum::kEnumVarOne:
+    {
+      return DoSomethingElse<SomeEnum::kEnumVarOne>(some_struct);
+    }
+    case SomeEnum::kEnumVarTwo:
+    {
+      return DoSomethingElse<SomeEnum::kEnumVarTwo>(some_struct);
+    }
+    default:
+    {
+      return some_struct.struct_var;
+    }
+  }
+}
+
+/*!
+ * @brief The SomeStruct objects of a store section, read in place.
+ *
+ * Lets module_b work directly on the state module_a keeps in a store file,
+ * see module-a/some_struct_store.h, since SomeStruct has the same layout in
+ * both modules.
+ *
+ * @param[in] store An open store.
+ * @param[in] section_id Section holding SomeStruct records.
+ *
+ * @return The structs, empty if there is no such section or it holds records
+ * of another size.
+ */
+inline std::span<const SomeStruct> MappedSomeStructs(
+    const common::MappedStore &store, std::uint32_t section_id)
+{
+  return store.RecordsAs<SomeStruct>(section_id);
 }
 
-} /* namespace module_a */
+} /* namespace module_b */
 } /* namespace project_structure */
 
 #endif /* PROJECTSTRUCTURE_MODULEB_B_H_ */
@@ -0,0 +1,645 @@
+/* block_log.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Block compressed logs of serialized message.proto messages,
+ * with an index for random access and parallel decompression on replay.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "module-b/block_log.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "common/crc32c.h"
+#include "common/lz4_block.h"
+#include "lib/library.h"
+#include "module-b/ingest.h"
+#include "module-b/record_stream.h"
+
+
+namespace project_structure
+{
+namespace module_b
+{
+
+constexpr std::byte kBlockLogMagic[4] = {std::byte{'P'}, std::byte{'S'},
+    std::byte{'B'}, std::byte{'L'}};
+
+constexpr std::byte kBlockIndexMagic[4] = {std::byte{'P'}, std::byte{'S'},
+    std::byte{'B'}, std::byte{'I'}};
+
+static void StoreLittleEndian(std::uint64_t value, std::size_t size,
+    std::byte *output)
+{
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    output[i] = static_cast<std::byte>((value >> (8 * i)) & 0xffu);
+  }
+}
+
+static std::uint64_t LoadLittleEndian(const std::byte *input,
+    std::size_t size)
+{
+  std::uint64_t value = 0;
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    value |= std::to_integer<std::uint64_t>(input[i]) << (8 * i);
+  }
+  return value;
+}
+
+BlockLogWriter::BlockLogWriter(const BlockLogWriterOptions &options)
+    : options_(options)
+{
+  if (options_.block_size == 0)
+  {
+    options_.block_size = 1;
+  }
+}
+
+BlockLogWriter::~BlockLogWriter()
+{
+  Close();
+}
+
+bool BlockLogWriter::Open(const char *path)
+{
+  std::byte header[kBlockLogHeaderSize] = {};
+  Close();
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+  {
+    return false;
+  }
+  fd_ = fd;
+  offset_ = 0;
+  raw_size_ = 0;
+  records_written_ = 0;
+  block_first_record_ = 0;
+  index_.clear();
+  std::memcpy(header, kBlockLogMagic, sizeof(kBlockLogMagic));
+  header[4] = std::byte{kBlockLogVersion};
+  header[5] = options_.compress ? std::byte{kBlockLogLz4} : std::byte{0};
+  return WriteAll(header, sizeof(header));
+}
+
+std::byte *BlockLogWriter::BeginRecord(std::size_t size)
+{
+  std::size_t needed = 0;
+  if (fd_ < 0 || size > kMaxRecordSize)
+  {
+    return nullptr;
+  }
+  /* Records are not split, one which does not fit starts the next block. */
+  if (raw_size_ > 0 && raw_size_ + kMaxVarintSize + size >
+      options_.block_size && !EndBlock())
+  {
+    return nullptr;
+  }
+  needed = raw_size_ + kMaxVarintSize + size;
+  if (raw_.size() < needed)
+  {
+    raw_.resize(std::max(needed, options_.block_size + kMaxVarintSize));
+  }
+  record_start_ = raw_size_;
+  raw_size_ += EncodeVarint(size, raw_.data() + raw_size_);
+  return raw_.data() + raw_size_;
+}
+
+bool BlockLogWriter::EndRecord(std::size_t size)
+{
+  raw_size_ += size;
+  ++records_written_;
+  return raw_size_ < options_.block_size || EndBlock();
+}
+
+void BlockLogWriter::AbortRecord()
+{
+  raw_size_ = record_start_;
+}
+
+bool BlockLogWriter::Write(std::span<const std::byte> payload)
+{
+  std::byte *destination = BeginRecord(payload.size());
+  if (destination == nullptr)
+  {
+    return false;
+  }
+  if (!payload.empty())
+  {
+    std::memcpy(destination, payload.data(), payload.size());
+  }
+  return EndRecord(payload.size());
+}
+
+bool BlockLogWriter::EndBlock()
+{
+  const std::byte *stored = raw_.data();
+  std::size_t stored_size = raw_size_;
+  std::size_t compressed_size = 0;
+  if (raw_size_ == 0)
+  {
+    return true;
+  }
+  if (stored_.size() < kBlockHeaderSize + common::Lz4CompressBound(raw_size_))
+  {
+    stored_.resize(kBlockHeaderSize + common::Lz4CompressBound(raw_size_));
+  }
+  if (options_.compress)
+  {
+    compressed_size = common::Lz4Compress(
+        std::span<const std::byte>(raw_.data(), raw_size_),
+        std::span<std::byte>(stored_).subspan(kBlockHeaderSize));
+    /* Kept raw unless that saves something, which also marks it as raw. */
+    if (compressed_size != 0 && compressed_size < raw_size_)
+    {
+      stored = stored_.data() + kBlockHeaderSize;
+      stored_size = compressed_size;
+    }
+  }
+  StoreLittleEndian(stored_size, 4, stored_.data());
+  StoreLittleEndian(raw_size_, 4, stored_.data() + 4);
+  StoreLittleEndian(records_written_ - block_first_record_, 4,
+      stored_.data() + 8);
+  StoreLittleEndian(common::Crc32c(std::span<const std::byte>(stored,
+      stored_size)), 4, stored_.data() + 12);
+  index_.push_back(IndexEntry{offset_, block_first_record_});
+  if (!WriteAll(stored_.data(), kBlockHeaderSize) ||
+      !WriteAll(stored, stored_size))
+  {
+    return false;
+  }
+  block_first_record_ = records_written_;
+  raw_size_ = 0;
+  return true;
+}
+
+bool BlockLogWriter::WriteIndex()
+{
+  const std::uint64_t kIndexOffset = offset_;
+  const std::size_t kIndexSize = index_.size() * kBlockIndexEntrySize;
+  std::byte *footer = nullptr;
+  if (stored_.size() < kIndexSize + kBlockLogFooterSize)
+  {
+    stored_.resize(kIndexSize + kBlockLogFooterSize);
+  }
+  for (std::size_t i = 0; i < index_.size(); ++i)
+  {
+    StoreLittleEndian(index_[i].offset, 8,
+        stored_.data() + i * kBlockIndexEntrySize);
+    StoreLittleEndian(index_[i].first_record, 8,
+        stored_.data() + i * kBlockIndexEntrySize + 8);
+  }
+  footer = stored_.data() + kIndexSize;
+  StoreLittleEndian(kIndexOffset, 8, footer);
+  StoreLittleEndian(index_.size(), 4, footer + 8);
+  StoreLittleEndian(common::Crc32c(std::span<const std::byte>(stored_.data(),
+      kIndexSize)), 4, footer + 12);
+  StoreLittleEndian(records_written_, 8, footer + 16);
+  std::memcpy(footer + 24, kBlockIndexMagic, sizeof(kBlockIndexMagic));
+  StoreLittleEndian(0, 4, footer + 28);
+  return WriteAll(stored_.data(), kIndexSize + kBlockLogFooterSize);
+}
+
+bool BlockLogWriter::WriteAll(const std::byte *data, std::size_t size)
+{
+  ssize_t written = 0;
+  while (size > 0)
+  {
+    written = write(fd_, data, size);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    size -= static_cast<std::size_t>(written);
+    offset_ += static_cast<std::uint64_t>(written);
+  }
+  return true;
+}
+
+bool BlockLogWriter::Close()
+{
+  bool ok = true;
+  if (fd_ < 0)
+  {
+    return true;
+  }
+  ok = EndBlock() && WriteIndex();
+  if (close(fd_) != 0)
+  {
+    ok = false;
+  }
+  fd_ = -1;
+  return ok;
+}
+
+std::uint64_t BlockLogWriter::RecordsWritten() const
+{
+  return records_written_;
+}
+
+std::uint64_t BlockLogWriter::BlocksWritten() const
+{
+  return index_.size();
+}
+
+BlockLogReader::~BlockLogReader()
+{
+  Close();
+}
+
+void BlockLogReader::Close()
+{
+  if (mapping_ != nullptr)
+  {
+    munmap(mapping_, size_);
+  }
+  mapping_ = nullptr;
+  data_ = nullptr;
+  size_ = 0;
+  lz4_ = false;
+  record_count_ = 0;
+  index_offset_ = 0;
+  block_offsets_.clear();
+  block_first_records_.clear();
+}
+
+RecordStatus BlockLogReader::Open(const char *path)
+{
+  struct stat file_stat = {};
+  void *mapping = nullptr;
+  RecordStatus status = RecordStatus::kOk;
+  Close();
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return RecordStatus::kIoError;
+  }
+  if (fstat(fd, &file_stat) != 0)
+  {
+    close(fd);
+    return RecordStatus::kIoError;
+  }
+  if (file_stat.st_size == 0)
+  {
+    close(fd);
+    return RecordStatus::kTruncated;
+  }
+  mapping = mmap(nullptr, static_cast<std::size_t>(file_stat.st_size),
+      PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    return RecordStatus::kIoError;
+  }
+  /* Blocks are read ahead on several threads, in order. */
+  (void)madvise(mapping, static_cast<std::size_t>(file_stat.st_size),
+      MADV_SEQUENTIAL);
+  mapping_ = mapping;
+  data_ = static_cast<const std::byte *>(mapping);
+  size_ = static_cast<std::size_t>(file_stat.st_size);
+  status = ReadLayout();
+  if (status != RecordStatus::kOk)
+  {
+    Close();
+  }
+  return status;
+}
+
+RecordStatus BlockLogReader::OpenBuffer(std::span<const std::byte> buffer)
+{
+  RecordStatus status = RecordStatus::kOk;
+  Close();
+  data_ = buffer.data();
+  size_ = buffer.size();
+  status = ReadLayout();
+  if (status != RecordStatus::kOk)
+  {
+    Close();
+  }
+  return status;
+}
+
+RecordStatus BlockLogReader::ReadLayout()
+{
+  const std::byte *footer = nullptr;
+  const std::byte *entry = nullptr;
+  std::uint64_t block_count = 0;
+  if (size_ < kBlockLogHeaderSize + kBlockLogFooterSize)
+  {
+    return RecordStatus::kTruncated;
+  }
+  if (std::memcmp(data_, kBlockLogMagic, sizeof(kBlockLogMagic)) != 0 ||
+      data_[4] != std::byte{kBlockLogVersion} ||
+      (std::to_integer<std::uint8_t>(data_[5]) & ~kBlockLogLz4) != 0)
+  {
+    return RecordStatus::kCorrupt;
+  }
+  lz4_ = (std::to_integer<std::uint8_t>(data_[5]) & kBlockLogLz4) != 0;
+  footer = data_ + size_ - kBlockLogFooterSize;
+  /* No footer, most likely a log whose writer was not closed. */
+  if (std::memcmp(footer + 24, kBlockIndexMagic,
+      sizeof(kBlockIndexMagic)) != 0)
+  {
+    return RecordStatus::kTruncated;
+  }
+  index_offset_ = LoadLittleEndian(footer, 8);
+  block_count = LoadLittleEndian(footer + 8, 4);
+  record_count_ = LoadLittleEndian(footer + 16, 8);
+  if (index_offset_ < kBlockLogHeaderSize ||
+      index_offset_ > size_ - kBlockLogFooterSize ||
+      size_ - kBlockLogFooterSize - index_offset_ !=
+          block_count * kBlockIndexEntrySize ||
+      common::Crc32c(std::span<const std::byte>(data_ + index_offset_,
+          block_count * kBlockIndexEntrySize)) !=
+          LoadLittleEndian(footer + 12, 4))
+  {
+    return RecordStatus::kCorrupt;
+  }
+  block_offsets_.resize(block_count);
+  block_first_records_.resize(block_count);
+  for (std::size_t i = 0; i < block_count; ++i)
+  {
+    entry = data_ + index_offset_ + i * kBlockIndexEntrySize;
+    block_offsets_[i] = LoadLittleEndian(entry, 8);
+    block_first_records_[i] = LoadLittleEndian(entry + 8, 8);
+    /* Blocks follow each other, each holding at least one record. */
+    if (block_offsets_[i] < (i == 0 ? kBlockLogHeaderSize :
+        block_offsets_[i - 1] + kBlockHeaderSize) ||
+        block_offsets_[i] + kBlockHeaderSize > index_offset_ ||
+        block_first_records_[i] >= record_count_ ||
+        (i > 0 && block_first_records_[i] <= block_first_records_[i - 1]))
+    {
+      return RecordStatus::kCorrupt;
+    }
+  }
+  if (block_count == 0 && record_count_ != 0)
+  {
+    return RecordStatus::kCorrupt;
+  }
+  return RecordStatus::kOk;
+}
+
+std::size_t BlockLogReader::BlockCount() const
+{
+  return block_offsets_.size();
+}
+
+std::uint64_t BlockLogReader::RecordCount() const
+{
+  return record_count_;
+}
+
+std::uint64_t BlockLogReader::BlockFirstRecord(std::size_t block) const
+{
+  return block < block_first_records_.size() ? block_first_records_[block] :
+      record_count_;
+}
+
+std::uint32_t BlockLogReader::BlockRecordCount(std::size_t block) const
+{
+  return static_cast<std::uint32_t>(BlockFirstRecord(block + 1) -
+      BlockFirstRecord(block));
+}
+
+std::size_t BlockLogReader::FindBlock(std::uint64_t record) const
+{
+  if (record >= record_count_)
+  {
+    return block_first_records_.size();
+  }
+  /* The last block starting at or before record. */
+  return static_cast<std::size_t>(std::upper_bound(
+      block_first_records_.begin(), block_first_records_.end(), record) -
+      block_first_records_.begin()) - 1;
+}
+
+RecordStatus BlockLogReader::ReadBlock(std::size_t block,
+    std::vector<std::byte> &buffer, std::span<const std::byte> &records) const
+{
+  const std::byte *header = nullptr;
+  std::uint64_t block_end = 0;
+  std::size_t stored_size = 0;
+  std::size_t raw_size = 0;
+  std::span<const std::byte> stored;
+  if (block >= block_offsets_.size())
+  {
+    return RecordStatus::kEnd;
+  }
+  header = data_ + block_offsets_[block];
+  block_end = block + 1 < block_offsets_.size() ?
+      block_offsets_[block + 1] : index_offset_;
+  stored_size = static_cast<std::size_t>(LoadLittleEndian(header, 4));
+  raw_size = static_cast<std::size_t>(LoadLittleEndian(header + 4, 4));
+  if (block_offsets_[block] + kBlockHeaderSize + stored_size != block_end ||
+      LoadLittleEndian(header + 8, 4) != BlockRecordCount(block))
+  {
+    return RecordStatus::kCorrupt;
+  }
+  stored = std::span<const std::byte>(header + kBlockHeaderSize,
+      stored_size);
+  if (common::Crc32c(stored) != LoadLittleEndian(header + 12, 4))
+  {
+    return RecordStatus::kCorrupt;
+  }
+  if (stored_size == raw_size)
+  {
+    records = stored;
+    return RecordStatus::kOk;
+  }
+  /* LZ4 can not shrink data more than 255 times. */
+  if (!lz4_ || raw_size > stored_size * 255)
+  {
+    return RecordStatus::kCorrupt;
+  }
+  if (buffer.size() < raw_size)
+  {
+    buffer.resize(raw_size);
+  }
+  if (!common::Lz4Decompress(stored,
+      std::span<std::byte>(buffer.data(), raw_size)))
+  {
+    return RecordStatus::kCorrupt;
+  }
+  records = std::span<const std::byte>(buffer.data(), raw_size);
+  return RecordStatus::kOk;
+}
+
+RecordStatus NextBlockRecord(std::span<const std::byte> &records,
+    std::span<const std::byte> &record)
+{
+  std::uint64_t length = 0;
+  std::size_t length_size = 0;
+  if (records.empty())
+  {
+    return RecordStatus::kEnd;
+  }
+  length_size = DecodeVarint(records, length);
+  if (length_size == 0 || length > records.size() - length_size)
+  {
+    return RecordStatus::kCorrupt;
+  }
+  record = records.subspan(length_size, static_cast<std::size_t>(length));
+  records = records.subspan(length_size + static_cast<std::size_t>(length));
+  return RecordStatus::kOk;
+}
+
+/* A block being decompressed ahead of the sink. */
+struct BlockReadTask : public lib::Task
+{
+  const BlockLogReader *reader = nullptr;
+  std::size_t block = 0;
+  std::vector<std::byte> buffer;
+  std::span<const std::byte> records;
+  RecordStatus status = RecordStatus::kOk;
+  /* Set by the worker once records and status are, cleared on reuse. */
+  std::atomic<bool> ready{false};
+};
+
+static void RunBlockReadTask(lib::Task &task)
+{
+  BlockReadTask &read = static_cast<BlockReadTask &>(task);
+  read.status = read.reader->ReadBlock(read.block, read.buffer, read.records);
+  read.ready.store(true, std::memory_order_release);
+  read.ready.notify_one();
+}
+
+/*
+ * Blocks until read is ready. A worker of pool runs other pending tasks
+ * meanwhile, read itself may be one of them, queued behind the caller.
+ */
+static void WaitForBlockRead(lib::ThreadPool &pool, const BlockReadTask &read)
+{
+  const bool kOnWorker = pool.CurrentWorkerIndex() < pool.ThreadCount();
+  while (!read.ready.load(std::memory_order_acquire))
+  {
+    if (!kOnWorker)
+    {
+      read.ready.wait(false, std::memory_order_acquire);
+    }
+    else if (!pool.RunPendingTask())
+    {
+      std::this_thread::yield();
+    }
+  }
+}
+
+/*
+ * Hands the records of a read block to sink, skipping those before
+ * first_record. Returns kOk, or kCorrupt if they do not match the index.
+ */
+static RecordStatus DeliverBlock(const BlockLogReader &reader,
+    std::size_t block, std::span<const std::byte> records,
+    std::uint64_t first_record, RecordSink &sink, std::size_t source)
+{
+  std::span<const std::byte> record;
+  std::uint64_t number = reader.BlockFirstRecord(block);
+  RecordStatus status = NextBlockRecord(records, record);
+  while (status == RecordStatus::kOk)
+  {
+    if (number >= first_record)
+    {
+      sink.OnRecord(source, record);
+    }
+    ++number;
+    status = NextBlockRecord(records, record);
+  }
+  return status == RecordStatus::kEnd &&
+      number == reader.BlockFirstRecord(block + 1) ? RecordStatus::kOk :
+      RecordStatus::kCorrupt;
+}
+
+RecordStatus ReplayBlockLog(const BlockLogReader &reader,
+    lib::ThreadPool *pool, const BlockLogReplayOptions &options,
+    RecordSink &sink, std::size_t source)
+{
+  const std::size_t kFirstBlock = reader.FindBlock(options.first_record);
+  const std::size_t kBlockCount = reader.BlockCount();
+  std::size_t in_flight = options.blocks_in_flight;
+  std::size_t next_read = kFirstBlock;
+  std::vector<std::byte> buffer;
+  std::span<const std::byte> records;
+  BlockReadTask *read = nullptr;
+  RecordStatus status = RecordStatus::kOk;
+  if (pool == nullptr)
+  {
+    for (std::size_t block = kFirstBlock; block < kBlockCount &&
+        status == RecordStatus::kOk; ++block)
+    {
+      status = reader.ReadBlock(block, buffer, records);
+      if (status == RecordStatus::kOk)
+      {
+        status = DeliverBlock(reader, block, records, options.first_record,
+            sink, source);
+      }
+    }
+    status = status == RecordStatus::kOk ? RecordStatus::kEnd :
+        RecordStatus::kCorrupt;
+    sink.OnSourceEnd(source, status);
+    return status;
+  }
+  if (in_flight == 0)
+  {
+    in_flight = 2 * pool->ThreadCount();
+  }
+  std::vector<BlockReadTask> reads(std::min(in_flight,
+      kBlockCount - kFirstBlock));
+  lib::TaskGroup group(*pool);
+  /* Block b is read by reads[(b - kFirstBlock) % reads.size()]. */
+  for (BlockReadTask &task : reads)
+  {
+    task.function = &RunBlockReadTask;
+    task.reader = &reader;
+    task.block = next_read++;
+    group.Spawn(task);
+  }
+  for (std::size_t block = kFirstBlock; block < kBlockCount &&
+      status == RecordStatus::kOk; ++block)
+  {
+    read = &reads[(block - kFirstBlock) % reads.size()];
+    WaitForBlockRead(*pool, *read);
+    status = read->status;
+    if (status == RecordStatus::kOk)
+    {
+      status = DeliverBlock(reader, block, read->records,
+          options.first_record, sink, source);
+    }
+    /* The slot is free again, it reads the next block not yet asked for. */
+    if (next_read < kBlockCount && status == RecordStatus::kOk)
+    {
+      read->ready.store(false, std::memory_order_relaxed);
+      read->block = next_read++;
+      group.Spawn(*read);
+    }
+  }
+  /* Blocks read ahead of an error are dropped. */
+  group.Wait();
+  status = status == RecordStatus::kOk ? RecordStatus::kEnd :
+      RecordStatus::kCorrupt;
+  sink.OnSourceEnd(source, status);
+  return status;
+}
+
+} /* namespace module_b */
+} /* namespace project_structure */
@@ -0,0 +1,341 @@
+/* block_log.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Block compressed logs of serialized message.proto messages,
+ * with an index for random access and parallel decompression on replay.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_MODULEB_BLOCKLOG_H_
+#define PROJECTSTRUCTURE_MODULEB_BLOCKLOG_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "lib/library.h"
+#include "module-b/ingest.h"
+#include "module-b/record_stream.h"
+
+
+namespace project_structure
+{
+namespace module_b
+{
+
+/*
+ * Log layout, all integers little endian:
+ *
+ * header:  "PSBL" | version (1 byte) | flags (1 byte) | 2 reserved bytes
+ * block:   stored size (4 bytes) | raw size (4 bytes) | record count
+ *          (4 bytes) | CRC-32C of the stored bytes (4 bytes) | stored bytes
+ * index:   per block: offset of the block (8 bytes) | number of its first
+ *          record (8 bytes)
+ * footer:  offset of the index (8 bytes) | block count (4 bytes) | CRC-32C
+ *          of the index (4 bytes) | record count (8 bytes) | "PSBI" |
+ *          4 reserved bytes
+ *
+ * The raw bytes of a block are its records, each a varint payload length
+ * followed by the payload. They are stored LZ4 compressed if the
+ * kBlockLogLz4 flag is set and that makes them smaller, as they are
+ * otherwise, which the reader tells from the stored size being the raw size.
+ * Every block is compressed on its own, so blocks can be decompressed in any
+ * order and on any thread.
+ */
+
+/*! @brief Size in bytes of the log header. */
+constexpr std::size_t kBlockLogHeaderSize = 8;
+
+/*! @brief Size in bytes of the header in front of every block. */
+constexpr std::size_t kBlockHeaderSize = 16;
+
+/*! @brief Size in bytes of an index entry. */
+constexpr std::size_t kBlockIndexEntrySize = 16;
+
+/*! @brief Size in bytes of the footer ending the log. */
+constexpr std::size_t kBlockLogFooterSize = 32;
+
+/*! @brief Current version of the log format. */
+constexpr std::uint8_t kBlockLogVersion = 1;
+
+/*! @brief Header flag telling that blocks may be LZ4 compressed. */
+constexpr std::uint8_t kBlockLogLz4 = 0x01;
+
+/*!
+ * @brief Configuration of a BlockLogWriter.
+ */
+struct BlockLogWriterOptions
+{
+  /*
+   * Raw bytes collected before a block is compressed and written. A record
+   * larger than this gets a block of its own.
+   */
+  std::size_t block_size = std::size_t{128} << 10;
+  /* Compress blocks, otherwise they are stored as they are. */
+  bool compress = true;
+};
+
+/*!
+ * @brief Writes a block compressed log.
+ *
+ * Records are collected in a block buffer, which is compressed and written
+ * with its header once it holds block_size bytes. Close writes the index and
+ * footer, a log which was not closed can not be read. Messages written with
+ * WriteMessage are serialized straight into the block buffer.
+ *
+ * The class is neither copyable nor movable. It is not thread safe.
+ */
+class BlockLogWriter
+{
+ public:
+  explicit BlockLogWriter(const BlockLogWriterOptions &options =
+      BlockLogWriterOptions{});
+  BlockLogWriter(const BlockLogWriter &) = delete;
+  BlockLogWriter &operator=(const BlockLogWriter &) = delete;
+
+  /*! @brief Closes the log if it is still open. */
+  ~BlockLogWriter();
+
+  /*!
+   * @brief Creates (or truncates) the file at path and writes the header.
+   *
+   * @param[in] path Path of the file, may not be null.
+   *
+   * @return false if the file could not be created or written.
+   */
+  bool Open(const char *path);
+
+  /*!
+   * @brief Appends one record.
+   *
+   * @param[in] payload The serialized message.
+   *
+   * @return false if the log is not open, payload exceeds kMaxRecordSize or
+   * a write failed.
+   */
+  bool Write(std::span<const std::byte> payload);
+
+  /*!
+   * @brief Serializes message directly into the block buffer.
+   *
+   * @param[in] message A generated message.proto message, or any type with
+   * the ByteSizeLong and SerializeToArray members of generated messages.
+   *
+   * @return false if serialization or writing failed. A message which fails
+   * to serialize leaves nothing behind in the log.
+   */
+  template <typename Message>
+  bool WriteMessage(const Message &message)
+  {
+    std::size_t size = static_cast<std::size_t>(message.ByteSizeLong());
+    std::byte *payload = BeginRecord(size);
+    if (payload == nullptr)
+    {
+      return false;
+    }
+    if (!message.SerializeToArray(payload, static_cast<int>(size)))
+    {
+      AbortRecord();
+      return false;
+    }
+    return EndRecord(size);
+  }
+
+  /*!
+   * @brief Writes the last block, the index and the footer and closes the
+   * file.
+   *
+   * @return false if a write or the close failed.
+   */
+  bool Close();
+
+  /*! @brief Number of records written since Open. */
+  std::uint64_t RecordsWritten() const;
+
+  /*! @brief Number of complete blocks written since Open. */
+  std::uint64_t BlocksWritten() const;
+
+ private:
+  /* A block as listed in the index. */
+  struct IndexEntry
+  {
+    std::uint64_t offset;
+    std::uint64_t first_record;
+  };
+
+  /* Writes the length and returns where the payload goes. */
+  std::byte *BeginRecord(std::size_t size);
+  /* Ends the block once the payload written after BeginRecord fills it. */
+  bool EndRecord(std::size_t size);
+  /* Drops the length written by BeginRecord, for a payload never written. */
+  void AbortRecord();
+  /* Compresses and writes the collected records as a block. */
+  bool EndBlock();
+  bool WriteIndex();
+  bool WriteAll(const std::byte *data, std::size_t size);
+
+  BlockLogWriterOptions options_;
+  /* Records of the current block. */
+  std::vector<std::byte> raw_;
+  std::size_t raw_size_ = 0;
+  /*
+   * raw_size_ before the last BeginRecord wrote the length, after it ended
+   * the block the record did not fit in.
+   */
+  std::size_t record_start_ = 0;
+  /* Block header and compressed block, also used for the index. */
+  std::vector<std::byte> stored_;
+  std::vector<IndexEntry> index_;
+  int fd_ = -1;
+  /* Bytes written to the file so far. */
+  std::uint64_t offset_ = 0;
+  std::uint64_t records_written_ = 0;
+  std::uint64_t block_first_record_ = 0;
+};
+
+/*!
+ * @brief Reads a block compressed log through its index.
+ *
+ * Blocks are read by number and records found by number without reading
+ * what lies before them. Stored blocks are returned in place, compressed
+ * ones are decompressed into a buffer of the caller, so several threads can
+ * read blocks of one reader at the same time.
+ *
+ * The class is neither copyable nor movable. ReadBlock and the accessors
+ * are thread safe, Open and Close are not.
+ */
+class BlockLogReader
+{
+ public:
+  BlockLogReader() = default;
+  BlockLogReader(const BlockLogReader &) = delete;
+  BlockLogReader &operator=(const BlockLogReader &) = delete;
+
+  ~BlockLogReader();
+
+  /*!
+   * @brief Memory maps the file at path and reads its header, footer and
+   * index.
+   *
+   * @param[in] path Path of the file, may not be null.
+   *
+   * @return kOk, or the reason the log can not be read.
+   */
+  RecordStatus Open(const char *path);
+
+  /*!
+   * @brief Reads the log from memory owned by the caller, which has to
+   * outlive the reader.
+   *
+   * @param[in] buffer The complete log.
+   *
+   * @return kOk, or the reason the log can not be read.
+   */
+  RecordStatus OpenBuffer(std::span<const std::byte> buffer);
+
+  /*! @brief Unmaps or releases the log. */
+  void Close();
+
+  /*! @brief Number of blocks, 0 unless open. */
+  std::size_t BlockCount() const;
+
+  /*! @brief Number of records, 0 unless open. */
+  std::uint64_t RecordCount() const;
+
+  /*! @brief Number of the first record of block. */
+  std::uint64_t BlockFirstRecord(std::size_t block) const;
+
+  /*!
+   * @brief Finds the block holding a record by binary search of the index.
+   *
+   * @return The block, BlockCount() if record is past the last one.
+   */
+  std::size_t FindBlock(std::uint64_t record) const;
+
+  /*!
+   * @brief Verifies and, if it is compressed, decompresses a block.
+   *
+   * @param[in] block Number of the block.
+   * @param[in, out] buffer Receives a compressed block, grown as needed.
+   * @param[out] records The raw bytes of the block, to be split with
+   * NextBlockRecord. Points into the log or into buffer.
+   *
+   * @return kOk, kEnd if block is past the last one, or kCorrupt.
+   */
+  RecordStatus ReadBlock(std::size_t block, std::vector<std::byte> &buffer,
+      std::span<const std::byte> &records) const;
+
+  /*! @brief Number of records stored in block. */
+  std::uint32_t BlockRecordCount(std::size_t block) const;
+
+ private:
+  RecordStatus ReadLayout();
+
+  const std::byte *data_ = nullptr;
+  std::size_t size_ = 0;
+  void *mapping_ = nullptr;
+  bool lz4_ = false;
+  std::uint64_t record_count_ = 0;
+  std::uint64_t index_offset_ = 0;
+  /* Offset and first record of every block. */
+  std::vector<std::uint64_t> block_offsets_;
+  std::vector<std::uint64_t> block_first_records_;
+};
+
+/*!
+ * @brief Takes the next record off the raw bytes of a block.
+ *
+ * @param[in, out] records Unread bytes of the block, advanced past the
+ * record.
+ * @param[out] record View of the payload, only set when kOk is returned.
+ *
+ * @return kOk, kEnd once records is empty, or kCorrupt.
+ */
+RecordStatus NextBlockRecord(std::span<const std::byte> &records,
+    std::span<const std::byte> &record);
+
+/*!
+ * @brief Configuration of ReplayBlockLog.
+ */
+struct BlockLogReplayOptions
+{
+  /*
+   * Blocks being decompressed ahead of the one handed to the sink, 0 means
+   * two per thread of the pool.
+   */
+  std::size_t blocks_in_flight = 0;
+  /* Number of the first record handed to the sink, found through the index. */
+  std::uint64_t first_record = 0;
+};
+
+/*!
+ * @brief Hands the records of a log to sink in order, decompressing the
+ * blocks ahead on a thread pool.
+ *
+ * The calling thread only delivers records, the workers verify and
+ * decompress the next blocks_in_flight blocks meanwhile. Without a pool the
+ * calling thread does both.
+ *
+ * @param[in] reader An open log.
+ * @param[in] pool Decompresses the blocks, may be nullptr. If the calling
+ * thread is one of its workers it runs pending tasks of the pool while it
+ * waits for a block.
+ * @param[in] options Read ahead and first record.
+ * @param[in] sink Receives the records and the end of the log, as source.
+ * @param[in] source Passed to the sink.
+ *
+ * @return kEnd if every record was delivered, kCorrupt otherwise. Also
+ * passed to sink.OnSourceEnd.
+ */
+RecordStatus ReplayBlockLog(const BlockLogReader &reader,
+    lib::ThreadPool *pool, const BlockLogReplayOptions &options,
+    RecordSink &sink, std::size_t source = 0);
+
+} /* namespace module_b */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_MODULEB_BLOCKLOG_H_ */
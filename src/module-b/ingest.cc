@@ -0,0 +1,857 @@
+/* ingest.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Asynchronous ingest of record streams from files, pipes and
+ * sockets, on io_uring with an epoll fallback.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "module-b/ingest.h"
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include "common/trace.h"
+#include "module-b/record_stream.h"
+
+
+namespace project_structure
+{
+namespace module_b
+{
+
+/* Slot in the user_data of the multishot receive of a socket. */
+constexpr std::uint32_t kReceiveSlot = 0xffffffffu;
+
+/* user_data of cancellations, their completions only count as done. */
+constexpr std::uint64_t kCancelUserData = ~std::uint64_t{0};
+
+/* Provided buffer group the socket receives pick their buffers from. */
+constexpr std::uint16_t kBufferGroup = 0;
+
+/* Largest provided buffer ring the kernel accepts. */
+constexpr std::size_t kMaxProvidedBuffers = 32768;
+
+/* Events taken per epoll_wait. */
+constexpr int kMaxEpollEvents = 64;
+
+static std::uint64_t MakeUserData(std::size_t source, std::uint32_t slot)
+{
+  return (static_cast<std::uint64_t>(source) << 32) | slot;
+}
+
+static std::uint32_t *RingField(void *ring, std::uint32_t offset)
+{
+  return static_cast<std::uint32_t *>(static_cast<void *>(
+      static_cast<std::byte *>(ring) + offset));
+}
+
+/*
+ * An io_uring driven through the raw system calls, so that liburing is not
+ * needed. Only what IngestLoop uses is there. The class is neither copyable
+ * nor movable.
+ */
+class IoUring
+{
+ public:
+  IoUring() = default;
+  IoUring(const IoUring &) = delete;
+  IoUring &operator=(const IoUring &) = delete;
+
+  ~IoUring()
+  {
+    if (sqes_ != nullptr)
+    {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != nullptr && cq_ring_ != sq_ring_)
+    {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != nullptr)
+    {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    if (fd_ >= 0)
+    {
+      close(fd_);
+    }
+  }
+
+  /* Creates the ring and maps its queues, false if the kernel refuses. */
+  bool Setup(std::uint32_t entries)
+  {
+    io_uring_params params = {};
+    void *mapping = nullptr;
+    fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd_ < 0)
+    {
+      return false;
+    }
+    sq_ring_size_ = params.sq_off.array +
+        params.sq_entries * sizeof(std::uint32_t);
+    cq_ring_size_ = params.cq_off.cqes +
+        params.cq_entries * sizeof(io_uring_cqe);
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+    {
+      sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+      cq_ring_size_ = sq_ring_size_;
+    }
+    mapping = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (mapping == MAP_FAILED)
+    {
+      return false;
+    }
+    sq_ring_ = mapping;
+    cq_ring_ = sq_ring_;
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0)
+    {
+      mapping = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+          MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+      if (mapping == MAP_FAILED)
+      {
+        cq_ring_ = nullptr;
+        return false;
+      }
+      cq_ring_ = mapping;
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    mapping = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (mapping == MAP_FAILED)
+    {
+      return false;
+    }
+    sqes_ = static_cast<io_uring_sqe *>(mapping);
+    sq_head_ = RingField(sq_ring_, params.sq_off.head);
+    sq_tail_ = RingField(sq_ring_, params.sq_off.tail);
+    sq_mask_ = *RingField(sq_ring_, params.sq_off.ring_mask);
+    sq_array_ = RingField(sq_ring_, params.sq_off.array);
+    sq_entries_ = params.sq_entries;
+    cq_head_ = RingField(cq_ring_, params.cq_off.head);
+    cq_tail_ = RingField(cq_ring_, params.cq_off.tail);
+    cq_mask_ = *RingField(cq_ring_, params.cq_off.ring_mask);
+    cqes_ = static_cast<io_uring_cqe *>(static_cast<void *>(
+        static_cast<std::byte *>(cq_ring_) + params.cq_off.cqes));
+    local_tail_ = *sq_tail_;
+    return true;
+  }
+
+  /* Returns a cleared entry to fill in, nullptr if the queue is full. */
+  io_uring_sqe *NextSqe()
+  {
+    std::uint32_t head = std::atomic_ref<std::uint32_t>(*sq_head_).load(
+        std::memory_order_acquire);
+    std::uint32_t index = local_tail_ & sq_mask_;
+    if (local_tail_ - head >= sq_entries_)
+    {
+      return nullptr;
+    }
+    sq_array_[index] = index;
+    std::memset(&sqes_[index], 0, sizeof(io_uring_sqe));
+    ++local_tail_;
+    return &sqes_[index];
+  }
+
+  /*
+   * Submits every filled in entry the kernel has not taken yet, all with one
+   * system call, and waits until at least wait_for completions are there.
+   */
+  int Enter(std::uint32_t wait_for)
+  {
+    std::uint32_t to_submit = local_tail_ -
+        std::atomic_ref<std::uint32_t>(*sq_head_).load(
+            std::memory_order_acquire);
+    int result = 0;
+    std::atomic_ref<std::uint32_t>(*sq_tail_).store(local_tail_,
+        std::memory_order_release);
+    common::TraceBegin(common::TraceCategory::kIo, "io_uring_enter");
+    result = static_cast<int>(syscall(__NR_io_uring_enter, fd_, to_submit,
+        wait_for, wait_for > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+    common::TraceEnd(common::TraceCategory::kIo, "io_uring_enter");
+    return result;
+  }
+
+  /* Returns the oldest completion not yet popped, nullptr if there is none. */
+  const io_uring_cqe *PeekCompletion() const
+  {
+    std::uint32_t head = *cq_head_;
+    if (head == std::atomic_ref<std::uint32_t>(*cq_tail_).load(
+        std::memory_order_acquire))
+    {
+      return nullptr;
+    }
+    return &cqes_[head & cq_mask_];
+  }
+
+  /* Hands the completion returned by PeekCompletion back to the kernel. */
+  void PopCompletion()
+  {
+    std::atomic_ref<std::uint32_t>(*cq_head_).store(*cq_head_ + 1,
+        std::memory_order_release);
+  }
+
+  int Register(unsigned int opcode, void *argument, unsigned int count)
+  {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd_, opcode,
+        argument, count));
+  }
+
+ private:
+  int fd_ = -1;
+  void *sq_ring_ = nullptr;
+  std::size_t sq_ring_size_ = 0;
+  void *cq_ring_ = nullptr;
+  std::size_t cq_ring_size_ = 0;
+  io_uring_sqe *sqes_ = nullptr;
+  std::size_t sqes_size_ = 0;
+  std::uint32_t *sq_head_ = nullptr;
+  std::uint32_t *sq_tail_ = nullptr;
+  std::uint32_t *sq_array_ = nullptr;
+  std::uint32_t sq_mask_ = 0;
+  std::uint32_t sq_entries_ = 0;
+  std::uint32_t *cq_head_ = nullptr;
+  std::uint32_t *cq_tail_ = nullptr;
+  std::uint32_t cq_mask_ = 0;
+  io_uring_cqe *cqes_ = nullptr;
+  /* Tail including entries filled in since the last Enter. */
+  std::uint32_t local_tail_ = 0;
+};
+
+/*
+ * Ring of buffers the kernel picks from for multishot receives. The class is
+ * neither copyable nor movable.
+ */
+class ProvidedBuffers
+{
+ public:
+  ProvidedBuffers() = default;
+  ProvidedBuffers(const ProvidedBuffers &) = delete;
+  ProvidedBuffers &operator=(const ProvidedBuffers &) = delete;
+
+  ~ProvidedBuffers()
+  {
+    if (buffers_ != nullptr)
+    {
+      munmap(buffers_, size_);
+    }
+  }
+
+  /* entries must be a power of two, at most kMaxProvidedBuffers. */
+  bool Setup(IoUring &ring, std::uint32_t entries)
+  {
+    io_uring_buf_reg registration = {};
+    void *memory = nullptr;
+    size_ = entries * sizeof(io_uring_buf);
+    memory = mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+      return false;
+    }
+    buffers_ = static_cast<io_uring_buf *>(memory);
+    mask_ = static_cast<std::uint16_t>(entries - 1);
+    registration.ring_addr = reinterpret_cast<std::uintptr_t>(memory);
+    registration.ring_entries = entries;
+    registration.bgid = kBufferGroup;
+    return ring.Register(IORING_REGISTER_PBUF_RING, &registration, 1) == 0;
+  }
+
+  /* Gives buffer id, data[0, size), to the kernel. */
+  void Provide(std::uint16_t id, std::byte *data, std::uint32_t size)
+  {
+    io_uring_buf &buffer = buffers_[tail_ & mask_];
+    /* The ring's tail overlaps resv of the first entry, leave resv alone. */
+    buffer.addr = reinterpret_cast<std::uintptr_t>(data);
+    buffer.len = size;
+    buffer.bid = id;
+    ++tail_;
+    std::atomic_ref<std::uint16_t>(buffers_[0].resv).store(tail_,
+        std::memory_order_release);
+  }
+
+ private:
+  io_uring_buf *buffers_ = nullptr;
+  std::size_t size_ = 0;
+  std::uint16_t mask_ = 0;
+  std::uint16_t tail_ = 0;
+};
+
+/*
+ * Tries a multishot receive on a socket pair holding one byte, only called
+ * once, by MultishotReceiveSupported. Kernels before 6.0 fail it
+ * with -EINVAL, even though they set up the ring and, from 5.19, the
+ * provided buffers.
+ */
+static bool ProbeMultishotReceive()
+{
+  const std::byte kByte{0};
+  std::byte buffer[1] = {};
+  /* Declared before the ring, which must go first, since it uses them. */
+  ProvidedBuffers provided_buffers;
+  IoUring ring;
+  int socket_fds[2] = {-1, -1};
+  io_uring_sqe *sqe = nullptr;
+  const io_uring_cqe *completion = nullptr;
+  bool supported = false;
+  if (!ring.Setup(1) || !provided_buffers.Setup(ring, 1) ||
+      socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, socket_fds) != 0)
+  {
+    return false;
+  }
+  provided_buffers.Provide(0, buffer, sizeof(buffer));
+  sqe = ring.NextSqe();
+  if (write(socket_fds[1], &kByte, sizeof(kByte)) == 1 && sqe != nullptr)
+  {
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = socket_fds[0];
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = kBufferGroup;
+    if (ring.Enter(1) == 1)
+    {
+      completion = ring.PeekCompletion();
+      supported = completion != nullptr && completion->res > 0;
+    }
+  }
+  /* Closing the ring cancels the receive if it is still armed. */
+  close(socket_fds[0]);
+  close(socket_fds[1]);
+  return supported;
+}
+
+/*
+ * Whether sockets can be read with multishot receives, valid once
+ * multishot_receive_probed is set. Global so that the kernel is only probed
+ * once instead of on every Run, and only by programs running io_uring.
+ */
+static std::once_flag multishot_receive_probed;
+static bool multishot_receive_supported = false;
+
+static void ProbeMultishotReceiveOnce()
+{
+  multishot_receive_supported = ProbeMultishotReceive();
+}
+
+/* Whether sockets can be read with multishot receives, probed on first use. */
+static bool MultishotReceiveSupported()
+{
+  std::call_once(multishot_receive_probed, &ProbeMultishotReceiveOnce);
+  return multishot_receive_supported;
+}
+
+IngestLoop::IngestLoop(const IngestOptions &options) : options_(options)
+{
+  options_.buffer_size = std::max<std::size_t>(options_.buffer_size, 1);
+  options_.buffer_count = std::clamp<std::size_t>(options_.buffer_count, 2,
+      kMaxProvidedBuffers);
+  options_.queue_depth = std::max<std::uint32_t>(options_.queue_depth, 1);
+  options_.reads_per_file = std::max<std::size_t>(options_.reads_per_file, 1);
+}
+
+std::size_t IngestLoop::AddSource(int fd)
+{
+  struct stat file_stat = {};
+  bool is_socket = false;
+  bool is_regular = false;
+  if (fstat(fd, &file_stat) == 0)
+  {
+    is_socket = S_ISSOCK(file_stat.st_mode);
+    is_regular = S_ISREG(file_stat.st_mode);
+  }
+  sources_.push_back(Source{fd, is_socket, is_regular, RecordStreamDecoder(),
+      std::vector<PendingRead>(is_regular ? options_.reads_per_file : 1,
+          PendingRead{0, 0, false}),
+      0, 0, 0, false, false, false, RecordStatus::kEnd});
+  return sources_.size() - 1;
+}
+
+bool IngestLoop::Run(RecordSink &sink)
+{
+  bool ran = true;
+  stats_ = IngestStats{0, 0, 0};
+  active_sources_ = sources_.size();
+  switch (options_.backend)
+  {
+    case IngestBackend::kIoUring:
+    {
+      backend_ = IngestBackend::kIoUring;
+      ran = RunIoUring(sink);
+      break;
+    }
+    case IngestBackend::kEpoll:
+    {
+      backend_ = IngestBackend::kEpoll;
+      ran = RunEpoll(sink);
+      break;
+    }
+    case IngestBackend::kBlocking:
+    {
+      backend_ = IngestBackend::kBlocking;
+      RunBlocking(sink);
+      break;
+    }
+    case IngestBackend::kAuto:
+    default:
+    {
+      backend_ = IngestBackend::kIoUring;
+      ran = RunIoUring(sink);
+      if (!ran)
+      {
+        backend_ = IngestBackend::kEpoll;
+        ran = RunEpoll(sink);
+      }
+      break;
+    }
+  }
+  sources_.clear();
+  active_sources_ = 0;
+  return ran;
+}
+
+IngestBackend IngestLoop::Backend() const
+{
+  return backend_;
+}
+
+IngestStats IngestLoop::Stats() const
+{
+  return stats_;
+}
+
+void IngestLoop::Feed(std::size_t index, std::span<const std::byte> data,
+    RecordSink &sink)
+{
+  Source &source = sources_[index];
+  std::span<const std::byte> record;
+  RecordStatus status = source.decoder.Next(data, record);
+  while (status == RecordStatus::kOk)
+  {
+    sink.OnRecord(index, record);
+    ++stats_.records;
+    status = source.decoder.Next(data, record);
+  }
+  if (status != RecordStatus::kEnd)
+  {
+    source.status = status;
+  }
+}
+
+void IngestLoop::EndSource(std::size_t index, RecordSink &sink)
+{
+  Source &source = sources_[index];
+  source.done = true;
+  --active_sources_;
+  sink.OnSourceEnd(index, source.status == RecordStatus::kEnd ?
+      source.decoder.Finish() : source.status);
+}
+
+bool IngestLoop::RunIoUring(RecordSink &sink)
+{
+  const std::size_t kBufferSize = options_.buffer_size;
+  const bool kMultishotReceive = options_.multishot_receive &&
+      MultishotReceiveSupported();
+  std::size_t socket_buffers = 0;
+  /* Declared before the ring, which must go first, since it uses them. */
+  std::vector<std::byte> pool;
+  ProvidedBuffers provided_buffers;
+  IoUring ring;
+  iovec pool_iovec = {};
+  bool fixed_buffers = false;
+  std::vector<std::uint32_t> free_buffers;
+  /* Reads, receives and cancellations the kernel has not completed yet. */
+  std::size_t operations = 0;
+  const io_uring_cqe *completion = nullptr;
+  std::uint64_t user_data = 0;
+  std::int32_t result = 0;
+  std::uint32_t flags = 0;
+  io_uring_sqe *sqe = nullptr;
+  int entered = 0;
+  Source *source = nullptr;
+  PendingRead *pending = nullptr;
+  std::size_t index = 0;
+  std::uint32_t slot = 0;
+  std::uint16_t id = 0;
+
+  for (const Source &added : sources_)
+  {
+    if (added.is_socket && kMultishotReceive)
+    {
+      /* Half of the buffers, rounded down to the power of two needed. */
+      socket_buffers = std::bit_floor(options_.buffer_count / 2);
+    }
+  }
+  if (!ring.Setup(options_.queue_depth))
+  {
+    return false;
+  }
+  pool.resize(options_.buffer_count * kBufferSize);
+  /* Registered buffers save pinning the pages on every pending-> */
+  pool_iovec.iov_base = pool.data();
+  pool_iovec.iov_len = pool.size();
+  fixed_buffers = ring.Register(IORING_REGISTER_BUFFERS, &pool_iovec, 1) == 0;
+  if (socket_buffers > 0)
+  {
+    if (!provided_buffers.Setup(ring,
+        static_cast<std::uint32_t>(socket_buffers)))
+    {
+      return false;
+    }
+    for (std::size_t i = 0; i < socket_buffers; ++i)
+    {
+      provided_buffers.Provide(static_cast<std::uint16_t>(i),
+          pool.data() + i * kBufferSize,
+          static_cast<std::uint32_t>(kBufferSize));
+    }
+  }
+  for (std::size_t i = options_.buffer_count; i > socket_buffers; --i)
+  {
+    free_buffers.push_back(static_cast<std::uint32_t>(i - 1));
+  }
+
+  while (active_sources_ > 0)
+  {
+    /* Queues reads and receives for every source which has room for them. */
+    for (std::size_t i = 0; i < sources_.size(); ++i)
+    {
+      source = &sources_[i];
+      if (source->done || source->at_end ||
+          source->status != RecordStatus::kEnd)
+      {
+        continue;
+      }
+      /* Without multishot receives sockets are read like pipes. */
+      if (source->is_socket && kMultishotReceive)
+      {
+        sqe = source->receive_armed ? nullptr : ring.NextSqe();
+        if (sqe != nullptr)
+        {
+          sqe->opcode = IORING_OP_RECV;
+          sqe->fd = source->fd;
+          sqe->ioprio = IORING_RECV_MULTISHOT;
+          sqe->flags = IOSQE_BUFFER_SELECT;
+          sqe->buf_group = kBufferGroup;
+          sqe->user_data = MakeUserData(i, kReceiveSlot);
+          source->receive_armed = true;
+          ++operations;
+        }
+        continue;
+      }
+      while (source->reads_in_flight < source->reads.size() &&
+          !free_buffers.empty())
+      {
+        sqe = ring.NextSqe();
+        if (sqe == nullptr)
+        {
+          break;
+        }
+        pending = &source->reads[(source->first_read +
+            source->reads_in_flight) % source->reads.size()];
+        *pending = PendingRead{free_buffers.back(), 0, false};
+        free_buffers.pop_back();
+        sqe->opcode = fixed_buffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->fd = source->fd;
+        sqe->addr = reinterpret_cast<std::uintptr_t>(pool.data() +
+            pending->buffer * kBufferSize);
+        sqe->len = static_cast<std::uint32_t>(kBufferSize);
+        /* Pipes read at their current position. */
+        sqe->off = source->is_regular ? source->next_offset : ~std::uint64_t{0};
+        sqe->buf_index = 0;
+        sqe->user_data = MakeUserData(i, static_cast<std::uint32_t>(
+            (source->first_read + source->reads_in_flight) %
+                source->reads.size()));
+        source->next_offset += kBufferSize;
+        ++source->reads_in_flight;
+        ++operations;
+      }
+    }
+
+    entered = operations == 0 ? -1 : ring.Enter(1);
+    ++stats_.syscalls;
+    if (entered < 0 && (operations == 0 || (errno != EINTR &&
+        errno != EAGAIN && errno != EBUSY)))
+    {
+      /* Nothing can complete any more, give up on what is left. */
+      for (std::size_t i = 0; i < sources_.size(); ++i)
+      {
+        if (!sources_[i].done)
+        {
+          sources_[i].status = RecordStatus::kIoError;
+          EndSource(i, sink);
+        }
+      }
+      break;
+    }
+
+    completion = ring.PeekCompletion();
+    while (completion != nullptr)
+    {
+      user_data = completion->user_data;
+      result = completion->res;
+      flags = completion->flags;
+      ring.PopCompletion();
+      completion = ring.PeekCompletion();
+      if (user_data == kCancelUserData)
+      {
+        --operations;
+        continue;
+      }
+      index = static_cast<std::size_t>(user_data >> 32);
+      slot = static_cast<std::uint32_t>(user_data);
+      source = &sources_[index];
+
+      if (slot == kReceiveSlot)
+      {
+        if (result > 0)
+        {
+          id = static_cast<std::uint16_t>(
+              flags >> IORING_CQE_BUFFER_SHIFT);
+          if (source->status == RecordStatus::kEnd)
+          {
+            Feed(index, std::span<const std::byte>(pool.data() +
+                id * kBufferSize, static_cast<std::size_t>(result)), sink);
+            stats_.bytes += static_cast<std::uint64_t>(result);
+          }
+          provided_buffers.Provide(id, pool.data() + id * kBufferSize,
+              static_cast<std::uint32_t>(kBufferSize));
+          /* A corrupt stream is not worth receiving further. */
+          if (source->status != RecordStatus::kEnd &&
+              (flags & IORING_CQE_F_MORE) != 0)
+          {
+            sqe = ring.NextSqe();
+            if (sqe != nullptr)
+            {
+              sqe->opcode = IORING_OP_ASYNC_CANCEL;
+              sqe->addr = MakeUserData(index, kReceiveSlot);
+              sqe->user_data = kCancelUserData;
+              ++operations;
+            }
+          }
+        }
+        if ((flags & IORING_CQE_F_MORE) == 0)
+        {
+          source->receive_armed = false;
+          --operations;
+          if (result == 0)
+          {
+            source->at_end = true;
+          }
+          else if (result < 0 && result != -ENOBUFS &&
+              source->status == RecordStatus::kEnd)
+          {
+            source->status = RecordStatus::kIoError;
+          }
+          /* Otherwise it is armed again by the next refill. */
+          if (source->at_end || source->status != RecordStatus::kEnd)
+          {
+            EndSource(index, sink);
+          }
+        }
+        continue;
+      }
+
+      source->reads[slot].result = result;
+      source->reads[slot].complete = true;
+      /* Reads complete in any order, the data is decoded in file order. */
+      while (source->reads_in_flight > 0 &&
+          source->reads[source->first_read].complete)
+      {
+        pending = &source->reads[source->first_read];
+        if (pending->result > 0 && !source->at_end &&
+            source->status == RecordStatus::kEnd)
+        {
+          Feed(index, std::span<const std::byte>(pool.data() +
+              pending->buffer * kBufferSize,
+              static_cast<std::size_t>(pending->result)), sink);
+          stats_.bytes += static_cast<std::uint64_t>(pending->result);
+          /* Regular files only read short at their end. */
+          if (source->is_regular &&
+              static_cast<std::size_t>(pending->result) < kBufferSize)
+          {
+            source->at_end = true;
+          }
+        }
+        else if (pending->result == 0)
+        {
+          source->at_end = true;
+        }
+        else if (pending->result < 0 && source->status == RecordStatus::kEnd)
+        {
+          source->status = RecordStatus::kIoError;
+        }
+        free_buffers.push_back(pending->buffer);
+        source->first_read = (source->first_read + 1) % source->reads.size();
+        --source->reads_in_flight;
+        --operations;
+      }
+      if (source->reads_in_flight == 0 &&
+          (source->at_end || source->status != RecordStatus::kEnd))
+      {
+        EndSource(index, sink);
+      }
+    }
+  }
+  return true;
+}
+
+bool IngestLoop::ReadOnce(std::size_t index, std::span<std::byte> buffer,
+    RecordSink &sink)
+{
+  Source &source = sources_[index];
+  ssize_t bytes_read = 0;
+  common::TraceBegin(common::TraceCategory::kIo, "IngestLoop read");
+  bytes_read = read(source.fd, buffer.data(), buffer.size());
+  common::TraceEnd(common::TraceCategory::kIo, "IngestLoop read");
+  ++stats_.syscalls;
+  if (bytes_read > 0)
+  {
+    stats_.bytes += static_cast<std::uint64_t>(bytes_read);
+    Feed(index, std::span<const std::byte>(buffer.data(),
+        static_cast<std::size_t>(bytes_read)), sink);
+    if (source.status == RecordStatus::kEnd)
+    {
+      return true;
+    }
+  }
+  else if (bytes_read < 0 && (errno == EAGAIN || errno == EINTR))
+  {
+    return false;
+  }
+  else if (bytes_read < 0)
+  {
+    source.status = RecordStatus::kIoError;
+  }
+  EndSource(index, sink);
+  return false;
+}
+
+bool IngestLoop::RunEpoll(RecordSink &sink)
+{
+  std::vector<std::byte> buffer(options_.buffer_size);
+  std::vector<int> saved_flags(sources_.size(), -1);
+  epoll_event event = {};
+  epoll_event events[kMaxEpollEvents] = {};
+  /* Regular files can not be polled, they are always ready instead. */
+  std::size_t regular_active = 0;
+  int ready = 0;
+  std::size_t index = 0;
+  int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd < 0)
+  {
+    return false;
+  }
+  for (std::size_t i = 0; i < sources_.size(); ++i)
+  {
+    if (sources_[i].is_regular)
+    {
+      ++regular_active;
+      continue;
+    }
+    saved_flags[i] = fcntl(sources_[i].fd, F_GETFL);
+    event.events = EPOLLIN;
+    event.data.u64 = i;
+    if (saved_flags[i] < 0 ||
+        fcntl(sources_[i].fd, F_SETFL, saved_flags[i] | O_NONBLOCK) != 0 ||
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sources_[i].fd, &event) != 0)
+    {
+      sources_[i].status = RecordStatus::kIoError;
+      EndSource(i, sink);
+    }
+  }
+
+  while (active_sources_ > 0)
+  {
+    /*
+     * One read per regular file and round keeps the sources interleaved. A
+     * read interrupted by a signal returns no data without ending the file.
+     */
+    for (std::size_t i = 0; i < sources_.size(); ++i)
+    {
+      if (sources_[i].is_regular && !sources_[i].done)
+      {
+        ReadOnce(i, buffer, sink);
+        if (sources_[i].done)
+        {
+          --regular_active;
+        }
+      }
+    }
+    if (active_sources_ == regular_active)
+    {
+      continue;
+    }
+    ready = epoll_wait(epoll_fd, events, kMaxEpollEvents,
+        regular_active > 0 ? 0 : -1);
+    ++stats_.syscalls;
+    if (ready < 0 && errno != EINTR)
+    {
+      for (std::size_t i = 0; i < sources_.size(); ++i)
+      {
+        if (!sources_[i].done)
+        {
+          sources_[i].status = RecordStatus::kIoError;
+          EndSource(i, sink);
+        }
+      }
+    }
+    for (int i = 0; i < ready; ++i)
+    {
+      index = static_cast<std::size_t>(events[i].data.u64);
+      /* Drain it, the next epoll_wait would only report it again. */
+      while (!sources_[index].done && ReadOnce(index, buffer, sink))
+      {
+      }
+      if (sources_[index].done)
+      {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, sources_[index].fd, nullptr);
+      }
+    }
+  }
+
+  for (std::size_t i = 0; i < sources_.size(); ++i)
+  {
+    if (saved_flags[i] >= 0)
+    {
+      fcntl(sources_[i].fd, F_SETFL, saved_flags[i]);
+    }
+  }
+  close(epoll_fd);
+  return true;
+}
+
+void IngestLoop::RunBlocking(RecordSink &sink)
+{
+  std::vector<std::byte> buffer(options_.buffer_size);
+  for (std::size_t i = 0; i < sources_.size(); ++i)
+  {
+    while (!sources_[i].done)
+    {
+      ReadOnce(i, buffer, sink);
+    }
+  }
+}
+
+} /* namespace module_b */
+} /* namespace project_structure */
@@ -0,0 +1,210 @@
+/* ingest.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Asynchronous ingest of record streams from files, pipes and
+ * sockets, on io_uring with an epoll fallback.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_MODULEB_INGEST_H_
+#define PROJECTSTRUCTURE_MODULEB_INGEST_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "module-b/record_stream.h"
+
+
+namespace project_structure
+{
+namespace module_b
+{
+
+/*!
+ * @brief How an IngestLoop reads its sources.
+ */
+enum class IngestBackend
+{
+  /* io_uring if the kernel allows it, epoll otherwise. */
+  kAuto = 0,
+  /*
+   * io_uring with batched submission. Files and pipes are read with fixed
+   * reads into registered buffers, several reads in flight per regular file.
+   * Sockets use one multishot receive each, completing into a ring of
+   * provided buffers, on kernels which support them (6.0 and later). They
+   * are read like pipes otherwise.
+   */
+  kIoUring = 1,
+  /* Non-blocking reads of whatever epoll reports ready. */
+  kEpoll = 2,
+  /* One blocking read at a time, one source after the other. */
+  kBlocking = 3
+};
+
+/*!
+ * @brief Configuration of an IngestLoop.
+ */
+struct IngestOptions
+{
+  IngestBackend backend = IngestBackend::kAuto;
+  /* Size of one read buffer. */
+  std::size_t buffer_size = std::size_t{64} << 10;
+  /* io_uring: buffers shared by every source, at most 32768. */
+  std::size_t buffer_count = 64;
+  /* io_uring: submission queue entries. */
+  std::uint32_t queue_depth = 64;
+  /* io_uring: reads in flight per regular file. */
+  std::size_t reads_per_file = 4;
+  /*
+   * io_uring: receive from sockets with multishot receives if the kernel
+   * supports them. Off reads sockets like pipes on any kernel.
+   */
+  bool multishot_receive = true;
+};
+
+/*!
+ * @brief Counters of the last IngestLoop::Run.
+ */
+struct IngestStats
+{
+  std::uint64_t records;
+  std::uint64_t bytes;
+  /* read, epoll_wait and io_uring_enter calls made while running. */
+  std::uint64_t syscalls;
+};
+
+/*!
+ * @brief Receives what an IngestLoop reads, on the thread calling Run.
+ *
+ * The class is neither copyable nor movable.
+ */
+class RecordSink
+{
+ public:
+  RecordSink() = default;
+  RecordSink(const RecordSink &) = delete;
+  RecordSink &operator=(const RecordSink &) = delete;
+
+  virtual ~RecordSink() = default;
+
+  /*!
+   * @brief Called for every record, in stream order per source.
+   *
+   * @param[in] source Index returned by IngestLoop::AddSource.
+   * @param[in] record The payload, only valid during the call.
+   */
+  virtual void OnRecord(std::size_t source,
+      std::span<const std::byte> record) = 0;
+
+  /*!
+   * @brief Called once per source when it is done.
+   *
+   * @param[in] source Index returned by IngestLoop::AddSource.
+   * @param[in] status kEnd if the stream ended cleanly, kTruncated, kCorrupt
+   * or kIoError otherwise.
+   */
+  virtual void OnSourceEnd(std::size_t source, RecordStatus status) = 0;
+};
+
+/*!
+ * @brief Reads record streams from many descriptors on one thread and hands
+ * their records to a RecordSink.
+ *
+ * Each source is a file, pipe or socket carrying one stream as written by
+ * RecordWriter. The descriptors stay owned by the caller. The epoll backend
+ * makes pipes and sockets non-blocking while it runs and restores their
+ * flags afterwards.
+ *
+ * The class is neither copyable nor movable. It is not thread safe.
+ */
+class IngestLoop
+{
+ public:
+  explicit IngestLoop(const IngestOptions &options = IngestOptions{});
+  IngestLoop(const IngestLoop &) = delete;
+  IngestLoop &operator=(const IngestLoop &) = delete;
+
+  ~IngestLoop() = default;
+
+  /*!
+   * @brief Adds a descriptor to read in the next Run.
+   *
+   * @param[in] fd Descriptor open for reading, at the start of a stream.
+   *
+   * @return Index of the source, passed to the RecordSink.
+   */
+  std::size_t AddSource(int fd);
+
+  /*!
+   * @brief Reads every source to its end, then forgets the sources.
+   *
+   * @param[in] sink Receives the records and the end of every source.
+   *
+   * @return false if the backend could not be set up, no source was read then.
+   * With kAuto that only happens if epoll fails too.
+   */
+  bool Run(RecordSink &sink);
+
+  /*! @brief Backend used by the last Run, kAuto before the first. */
+  IngestBackend Backend() const;
+
+  /*! @brief Counters of the last Run. */
+  IngestStats Stats() const;
+
+ private:
+  /* A read of a file, pipe or socket in flight on io_uring. */
+  struct PendingRead
+  {
+    std::uint32_t buffer;
+    std::int32_t result;
+    bool complete;
+  };
+
+  struct Source
+  {
+    int fd;
+    bool is_socket;
+    bool is_regular;
+    RecordStreamDecoder decoder;
+    /* Reads in submission order, a ring of reads_per_file entries. */
+    std::vector<PendingRead> reads;
+    std::size_t first_read;
+    std::size_t reads_in_flight;
+    std::uint64_t next_offset;
+    bool receive_armed;
+    bool at_end;
+    bool done;
+    /* kEnd unless reading or decoding failed. */
+    RecordStatus status;
+  };
+
+  bool RunIoUring(RecordSink &sink);
+  bool RunEpoll(RecordSink &sink);
+  void RunBlocking(RecordSink &sink);
+  /*
+   * One read() of a source into buffer. Returns true if data was read, false
+   * if the source would block or has ended.
+   */
+  bool ReadOnce(std::size_t index, std::span<std::byte> buffer,
+      RecordSink &sink);
+  /* Decodes data and hands its records to sink. */
+  void Feed(std::size_t index, std::span<const std::byte> data,
+      RecordSink &sink);
+  void EndSource(std::size_t index, RecordSink &sink);
+
+  IngestOptions options_;
+  std::vector<Source> sources_;
+  std::size_t active_sources_ = 0;
+  IngestBackend backend_ = IngestBackend::kAuto;
+  IngestStats stats_ = {};
+};
+
+} /* namespace module_b */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_MODULEB_INGEST_H_ */
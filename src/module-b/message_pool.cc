@@ -0,0 +1,50 @@
+/* message_pool.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Per thread pool of SomeMessage objects reused across requests.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "module-b/message_pool.h"
+
+#include "common/alloc_tracker.h"
+#include "common/object_pool.h"
+#include "module-b/generated/message.pb.h"
+
+
+namespace project_structure
+{
+namespace module_b
+{
+
+/*
+ * The pool behind AcquireMessage. Thread local since messages are acquired
+ * and released on the thread handling a request, which then needs neither
+ * locks nor atomics. Created on the first AcquireMessage of each thread.
+ */
+thread_local common::ObjectPool<SomeMessage> message_pool(
+    common::ObjectPoolOptions{kMessagePoolRetention});
+
+common::ObjectPool<SomeMessage>::Handle AcquireMessage()
+{
+  /* A miss constructs a new message. */
+  common::ScopedAllocationScope allocation_scope(
+      common::AllocationScope::kProto);
+  return message_pool.Acquire();
+}
+
+common::ObjectPoolStats MessagePoolStats()
+{
+  return message_pool.Stats();
+}
+
+void TrimMessagePool()
+{
+  message_pool.Trim();
+}
+
+} /* namespace module_b */
+} /* namespace project_structure */
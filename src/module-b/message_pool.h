@@ -0,0 +1,62 @@
+/* message_pool.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Per thread pool of SomeMessage objects reused across requests.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_MODULEB_MESSAGEPOOL_H_
+#define PROJECTSTRUCTURE_MODULEB_MESSAGEPOOL_H_
+
+#include <cstddef>
+
+#include "common/object_pool.h"
+#include "module-b/generated/message.pb.h"
+
+
+namespace project_structure
+{
+namespace module_b
+{
+
+/*!
+ * @brief Messages each thread keeps for reuse.
+ *
+ * A request handler holds a few messages at a time, so this covers several
+ * handlers per thread while bounding what a burst leaves behind.
+ */
+constexpr std::size_t kMessagePoolRetention = 16;
+
+/*!
+ * @brief Takes a cleared SomeMessage from the calling thread's pool.
+ *
+ * Released messages are cleared rather than destroyed, which keeps the
+ * capacity of their repeated fields and the buffers of their bytes fields.
+ * Once a thread has handled a few requests, parsing and building messages
+ * of similar size no longer allocates.
+ *
+ * @return The message, returned to the pool when the handle is destroyed or
+ * reset. The handle must be released on the calling thread, before the
+ * thread exits. Empty if a message could not be allocated.
+ */
+common::ObjectPool<SomeMessage>::Handle AcquireMessage();
+
+/*!
+ * @brief Acquire and release counts of the calling thread's pool, all zero
+ * if the thread never acquired a message.
+ */
+common::ObjectPoolStats MessagePoolStats();
+
+/*!
+ * @brief Destroys the messages kept by the calling thread's pool, e.g. after
+ * a burst of unusually large requests.
+ */
+void TrimMessagePool();
+
+} /* namespace module_b */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_MODULEB_MESSAGEPOOL_H_ */
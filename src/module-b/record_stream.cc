@@ -0,0 +1,665 @@
+/* record_stream.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Length delimited record streams for serialized message.proto
+ * messages, with an optional CRC per record.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "module-b/record_stream.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#include "common/crc32c.h"
+
+
+namespace project_structure
+{
+namespace module_b
+{
+
+constexpr std::byte kRecordStreamMagic[4] = {std::byte{'P'}, std::byte{'S'},
+    std::byte{'R'}, std::byte{'S'}};
+
+/* Size of the CRC stored in front of the payload. */
+constexpr std::size_t kRecordCrcSize = 4;
+
+static void StoreLittleEndian32(std::uint32_t value, std::byte *output)
+{
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    output[i] = static_cast<std::byte>((value >> (8 * i)) & 0xffu);
+  }
+}
+
+static std::uint32_t LoadLittleEndian32(const std::byte *input)
+{
+  std::uint32_t value = 0;
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    value |= std::to_integer<std::uint32_t>(input[i]) << (8 * i);
+  }
+  return value;
+}
+
+std::size_t EncodeVarint(std::uint64_t value, std::byte *output)
+{
+  std::size_t size = 0;
+  while (value >= 0x80u)
+  {
+    output[size] = static_cast<std::byte>((value & 0x7fu) | 0x80u);
+    value >>= 7;
+    ++size;
+  }
+  output[size] = static_cast<std::byte>(value);
+  return size + 1;
+}
+
+std::size_t DecodeVarint(std::span<const std::byte> input,
+    std::uint64_t &value)
+{
+  std::uint64_t result = 0;
+  std::uint64_t byte = 0;
+  for (std::size_t i = 0; i < input.size() && i < kMaxVarintSize; ++i)
+  {
+    byte = std::to_integer<std::uint64_t>(input[i]);
+    result |= (byte & 0x7fu) << (7 * i);
+    if ((byte & 0x80u) == 0)
+    {
+      value = result;
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+RecordWriter::RecordWriter(const RecordWriterOptions &options)
+    : options_(options)
+{
+}
+
+RecordWriter::~RecordWriter()
+{
+  Close();
+}
+
+bool RecordWriter::Open(const char *path)
+{
+  Close();
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+  {
+    return false;
+  }
+  fd_ = fd;
+  owns_fd_ = true;
+  return WriteHeader();
+}
+
+bool RecordWriter::OpenDescriptor(int fd)
+{
+  Close();
+  fd_ = fd;
+  owns_fd_ = false;
+  return WriteHeader();
+}
+
+bool RecordWriter::WriteHeader()
+{
+  buffer_.resize(options_.buffer_size < kRecordStreamHeaderSize ?
+      kRecordStreamHeaderSize : options_.buffer_size);
+  std::memcpy(buffer_.data(), kRecordStreamMagic, sizeof(kRecordStreamMagic));
+  buffer_[4] = std::byte{kRecordStreamVersion};
+  buffer_[5] = options_.use_crc ? std::byte{kRecordStreamCrc} : std::byte{0};
+  buffer_[6] = std::byte{0};
+  buffer_[7] = std::byte{0};
+  buffered_ = kRecordStreamHeaderSize;
+  records_written_ = 0;
+  return true;
+}
+
+std::byte *RecordWriter::BeginRecord(std::size_t size)
+{
+  const std::size_t kRecordHeaderSize = kMaxVarintSize +
+      (options_.use_crc ? kRecordCrcSize : 0);
+  std::size_t length_size = 0;
+  if (fd_ < 0 || size > kMaxRecordSize)
+  {
+    return nullptr;
+  }
+  if (buffered_ + kRecordHeaderSize + size > buffer_.size())
+  {
+    if (!Flush())
+    {
+      return nullptr;
+    }
+    if (kRecordHeaderSize + size > buffer_.size())
+    {
+      buffer_.resize(kRecordHeaderSize + size);
+    }
+  }
+  length_size = EncodeVarint(size, buffer_.data() + buffered_);
+  return buffer_.data() + buffered_ + length_size +
+      (options_.use_crc ? kRecordCrcSize : 0);
+}
+
+bool RecordWriter::EndRecord(std::byte *payload, std::size_t size)
+{
+  if (options_.use_crc)
+  {
+    StoreLittleEndian32(common::Crc32c(std::span<const std::byte>(payload,
+        size)), payload - kRecordCrcSize);
+  }
+  buffered_ = static_cast<std::size_t>(payload + size - buffer_.data());
+  ++records_written_;
+  return true;
+}
+
+bool RecordWriter::Write(std::span<const std::byte> payload)
+{
+  std::byte header[kMaxVarintSize + kRecordCrcSize] = {};
+  std::size_t header_size = 0;
+  struct iovec parts[2] = {};
+  ssize_t written = 0;
+  std::size_t done = 0;
+  std::byte *destination = nullptr;
+  if (fd_ < 0 || payload.size() > kMaxRecordSize)
+  {
+    return false;
+  }
+  if (payload.size() <= buffer_.size() / 2)
+  {
+    destination = BeginRecord(payload.size());
+    if (destination == nullptr)
+    {
+      return false;
+    }
+    /* An empty payload may have a null data pointer, memcpy rejects it. */
+    if (!payload.empty())
+    {
+      std::memcpy(destination, payload.data(), payload.size());
+    }
+    return EndRecord(destination, payload.size());
+  }
+
+  /* Large records bypass the buffer, the payload is written in place. */
+  if (!Flush())
+  {
+    return false;
+  }
+  header_size = EncodeVarint(payload.size(), header);
+  if (options_.use_crc)
+  {
+    StoreLittleEndian32(common::Crc32c(payload), header + header_size);
+    header_size += kRecordCrcSize;
+  }
+  parts[0].iov_base = header;
+  parts[0].iov_len = header_size;
+  parts[1].iov_base = const_cast<std::byte *>(payload.data());
+  parts[1].iov_len = payload.size();
+  do
+  {
+    written = writev(fd_, parts, 2);
+  } while (written < 0 && errno == EINTR);
+  if (written < 0)
+  {
+    return false;
+  }
+  done = static_cast<std::size_t>(written);
+  if (done < header_size + payload.size())
+  {
+    /* Partial write, finish the remainder with plain writes. */
+    if (done < header_size)
+    {
+      if (!WriteAll(header + done, header_size - done))
+      {
+        return false;
+      }
+      done = header_size;
+    }
+    if (!WriteAll(payload.data() + (done - header_size),
+        payload.size() - (done - header_size)))
+    {
+      return false;
+    }
+  }
+  ++records_written_;
+  return true;
+}
+
+bool RecordWriter::WriteAll(const std::byte *data, std::size_t size)
+{
+  ssize_t written = 0;
+  while (size > 0)
+  {
+    written = write(fd_, data, size);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    size -= static_cast<std::size_t>(written);
+  }
+  return true;
+}
+
+bool RecordWriter::Flush()
+{
+  if (fd_ < 0)
+  {
+    return false;
+  }
+  if (!WriteAll(buffer_.data(), buffered_))
+  {
+    return false;
+  }
+  buffered_ = 0;
+  return true;
+}
+
+bool RecordWriter::Close()
+{
+  bool ok = true;
+  if (fd_ < 0)
+  {
+    return true;
+  }
+  ok = Flush();
+  if (owns_fd_ && close(fd_) != 0)
+  {
+    ok = false;
+  }
+  fd_ = -1;
+  owns_fd_ = false;
+  return ok;
+}
+
+std::uint64_t RecordWriter::RecordsWritten() const
+{
+  return records_written_;
+}
+
+RecordReader::~RecordReader()
+{
+  Close();
+}
+
+void RecordReader::Close()
+{
+  if (mapping_ != nullptr)
+  {
+    munmap(mapping_, mapping_size_);
+  }
+  mapping_ = nullptr;
+  mapping_size_ = 0;
+  position_ = nullptr;
+  end_ = nullptr;
+  fd_ = -1;
+  descriptor_end_ = false;
+  has_crc_ = false;
+  error_ = RecordStatus::kOk;
+}
+
+RecordStatus RecordReader::Open(const char *path)
+{
+  struct stat file_stat = {};
+  void *mapping = nullptr;
+  Close();
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return RecordStatus::kIoError;
+  }
+  if (fstat(fd, &file_stat) != 0)
+  {
+    close(fd);
+    return RecordStatus::kIoError;
+  }
+  if (file_stat.st_size == 0)
+  {
+    close(fd);
+    return RecordStatus::kTruncated;
+  }
+  mapping = mmap(nullptr, static_cast<std::size_t>(file_stat.st_size),
+      PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    return RecordStatus::kIoError;
+  }
+  (void)madvise(mapping, static_cast<std::size_t>(file_stat.st_size),
+      MADV_SEQUENTIAL);
+  mapping_ = mapping;
+  mapping_size_ = static_cast<std::size_t>(file_stat.st_size);
+  position_ = static_cast<const std::byte *>(mapping);
+  end_ = position_ + mapping_size_;
+  return ReadHeader();
+}
+
+RecordStatus RecordReader::OpenBuffer(std::span<const std::byte> buffer)
+{
+  Close();
+  position_ = buffer.data();
+  end_ = buffer.data() + buffer.size();
+  return ReadHeader();
+}
+
+RecordStatus RecordReader::OpenDescriptor(int fd, std::size_t buffer_size)
+{
+  Close();
+  buffer_.resize(buffer_size < kRecordStreamHeaderSize ?
+      kRecordStreamHeaderSize : buffer_size);
+  fd_ = fd;
+  position_ = buffer_.data();
+  end_ = buffer_.data();
+  return ReadHeader();
+}
+
+RecordStatus RecordReader::ReadHeader()
+{
+  RecordStatus status = Fill(kRecordStreamHeaderSize);
+  if (status != RecordStatus::kOk)
+  {
+    error_ = status;
+    return status;
+  }
+  if (std::memcmp(position_, kRecordStreamMagic,
+      sizeof(kRecordStreamMagic)) != 0 ||
+      position_[4] != std::byte{kRecordStreamVersion})
+  {
+    error_ = RecordStatus::kCorrupt;
+    return error_;
+  }
+  has_crc_ = (std::to_integer<std::uint8_t>(position_[5]) &
+      kRecordStreamCrc) != 0;
+  position_ += kRecordStreamHeaderSize;
+  return RecordStatus::kOk;
+}
+
+RecordStatus RecordReader::Fill(std::size_t size)
+{
+  std::size_t available = static_cast<std::size_t>(end_ - position_);
+  ssize_t bytes_read = 0;
+  if (available >= size)
+  {
+    return RecordStatus::kOk;
+  }
+  if (fd_ < 0 || descriptor_end_)
+  {
+    return RecordStatus::kTruncated;
+  }
+
+  /* Move the unread bytes to the front, then top the buffer up. */
+  std::memmove(buffer_.data(), position_, available);
+  if (size > buffer_.size())
+  {
+    buffer_.resize(size);
+  }
+  position_ = buffer_.data();
+  end_ = buffer_.data() + available;
+  while (available < size)
+  {
+    bytes_read = read(fd_, buffer_.data() + available,
+        buffer_.size() - available);
+    if (bytes_read < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return RecordStatus::kIoError;
+    }
+    if (bytes_read == 0)
+    {
+      descriptor_end_ = true;
+      return RecordStatus::kTruncated;
+    }
+    available += static_cast<std::size_t>(bytes_read);
+    end_ = buffer_.data() + available;
+  }
+  return RecordStatus::kOk;
+}
+
+RecordStatus RecordReader::Next(std::span<const std::byte> &record)
+{
+  std::uint64_t length = 0;
+  std::size_t length_size = 0;
+  std::size_t header_size = 0;
+  RecordStatus status = RecordStatus::kOk;
+  if (error_ != RecordStatus::kOk)
+  {
+    return error_;
+  }
+  status = Fill(1);
+  if (status == RecordStatus::kTruncated)
+  {
+    return position_ == end_ ? RecordStatus::kEnd : status;
+  }
+  if (status != RecordStatus::kOk)
+  {
+    error_ = status;
+    return error_;
+  }
+
+  /*
+   * Reads only while the length is incomplete, one read at a time. A short
+   * record whose sender then waits for a reply must not block the reader.
+   */
+  length_size = DecodeVarint(std::span<const std::byte>(position_, end_),
+      length);
+  while (length_size == 0 &&
+      static_cast<std::size_t>(end_ - position_) < kMaxVarintSize)
+  {
+    status = Fill(static_cast<std::size_t>(end_ - position_) + 1);
+    if (status != RecordStatus::kOk)
+    {
+      error_ = status;
+      return error_;
+    }
+    length_size = DecodeVarint(std::span<const std::byte>(position_, end_),
+        length);
+  }
+  if (length_size == 0)
+  {
+    error_ = RecordStatus::kCorrupt;
+    return error_;
+  }
+  if (length > kMaxRecordSize)
+  {
+    error_ = RecordStatus::kCorrupt;
+    return error_;
+  }
+
+  header_size = length_size + (has_crc_ ? kRecordCrcSize : 0);
+  status = Fill(header_size + static_cast<std::size_t>(length));
+  if (status != RecordStatus::kOk)
+  {
+    error_ = status;
+    return error_;
+  }
+  record = std::span<const std::byte>(position_ + header_size,
+      static_cast<std::size_t>(length));
+  if (has_crc_ && common::Crc32c(record) !=
+      LoadLittleEndian32(position_ + length_size))
+  {
+    error_ = RecordStatus::kCorrupt;
+    return error_;
+  }
+  position_ += header_size + static_cast<std::size_t>(length);
+  return RecordStatus::kOk;
+}
+
+bool RecordReader::HasCrc() const
+{
+  return has_crc_;
+}
+
+/*
+ * Decodes the record at the start of input. Returns kTruncated if input ends
+ * before the record does, with frame_size set to the size of the whole record
+ * including its length and CRC, or to 0 if input ends within the length.
+ */
+static RecordStatus DecodeFrame(std::span<const std::byte> input, bool has_crc,
+    std::size_t &frame_size, std::span<const std::byte> &payload)
+{
+  std::uint64_t length = 0;
+  std::size_t length_size = DecodeVarint(input, length);
+  std::size_t header_size = 0;
+  frame_size = 0;
+  if (length_size == 0)
+  {
+    return input.size() < kMaxVarintSize ? RecordStatus::kTruncated :
+        RecordStatus::kCorrupt;
+  }
+  if (length > kMaxRecordSize)
+  {
+    return RecordStatus::kCorrupt;
+  }
+  header_size = length_size + (has_crc ? kRecordCrcSize : 0);
+  frame_size = header_size + static_cast<std::size_t>(length);
+  if (input.size() < frame_size)
+  {
+    return RecordStatus::kTruncated;
+  }
+  payload = input.subspan(header_size, static_cast<std::size_t>(length));
+  if (has_crc && common::Crc32c(payload) !=
+      LoadLittleEndian32(input.data() + length_size))
+  {
+    return RecordStatus::kCorrupt;
+  }
+  return RecordStatus::kOk;
+}
+
+RecordStatus RecordStreamDecoder::Next(std::span<const std::byte> &input,
+    std::span<const std::byte> &record)
+{
+  std::size_t take = 0;
+  std::size_t frame_size = 0;
+  RecordStatus status = RecordStatus::kOk;
+  if (error_ != RecordStatus::kOk)
+  {
+    return error_;
+  }
+  if (pending_returned_)
+  {
+    pending_.clear();
+    pending_returned_ = false;
+  }
+
+  if (!header_done_)
+  {
+    take = std::min(kRecordStreamHeaderSize - pending_.size(), input.size());
+    pending_.insert(pending_.end(), input.begin(), input.begin() + take);
+    input = input.subspan(take);
+    if (pending_.size() < kRecordStreamHeaderSize)
+    {
+      return RecordStatus::kEnd;
+    }
+    if (std::memcmp(pending_.data(), kRecordStreamMagic,
+        sizeof(kRecordStreamMagic)) != 0 ||
+        pending_[4] != std::byte{kRecordStreamVersion})
+    {
+      error_ = RecordStatus::kCorrupt;
+      return error_;
+    }
+    has_crc_ = (std::to_integer<std::uint8_t>(pending_[5]) &
+        kRecordStreamCrc) != 0;
+    header_done_ = true;
+    pending_.clear();
+  }
+
+  /* Completes a record started in an earlier chunk. */
+  if (!pending_.empty())
+  {
+    status = DecodeFrame(pending_, has_crc_, frame_size, record);
+    /* The length is at most kMaxVarintSize bytes, add them one by one. */
+    while (status == RecordStatus::kTruncated && frame_size == 0 &&
+        !input.empty())
+    {
+      pending_.push_back(input[0]);
+      input = input.subspan(1);
+      status = DecodeFrame(pending_, has_crc_, frame_size, record);
+    }
+    if (status == RecordStatus::kTruncated && frame_size != 0)
+    {
+      take = std::min(frame_size - pending_.size(), input.size());
+      pending_.insert(pending_.end(), input.begin(), input.begin() + take);
+      input = input.subspan(take);
+      status = DecodeFrame(pending_, has_crc_, frame_size, record);
+    }
+    if (status == RecordStatus::kTruncated)
+    {
+      return RecordStatus::kEnd;
+    }
+    if (status != RecordStatus::kOk)
+    {
+      error_ = status;
+      return error_;
+    }
+    pending_returned_ = true;
+    return RecordStatus::kOk;
+  }
+
+  if (input.empty())
+  {
+    return RecordStatus::kEnd;
+  }
+  status = DecodeFrame(input, has_crc_, frame_size, record);
+  if (status == RecordStatus::kOk)
+  {
+    input = input.subspan(frame_size);
+    return RecordStatus::kOk;
+  }
+  if (status == RecordStatus::kTruncated)
+  {
+    pending_.assign(input.begin(), input.end());
+    input = input.subspan(input.size());
+    return RecordStatus::kEnd;
+  }
+  error_ = status;
+  return error_;
+}
+
+RecordStatus RecordStreamDecoder::Finish() const
+{
+  if (error_ != RecordStatus::kOk)
+  {
+    return error_;
+  }
+  if (!header_done_ || (!pending_.empty() && !pending_returned_))
+  {
+    return RecordStatus::kTruncated;
+  }
+  return RecordStatus::kEnd;
+}
+
+void RecordStreamDecoder::Reset()
+{
+  pending_.clear();
+  pending_returned_ = false;
+  header_done_ = false;
+  has_crc_ = false;
+  error_ = RecordStatus::kOk;
+}
+
+} /* namespace module_b */
+} /* namespace project_structure */
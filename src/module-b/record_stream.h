@@ -0,0 +1,349 @@
+/* record_stream.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Length delimited record streams for serialized message.proto
+ * messages, with an optional CRC per record.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_MODULEB_RECORDSTREAM_H_
+#define PROJECTSTRUCTURE_MODULEB_RECORDSTREAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+namespace project_structure
+{
+namespace module_b
+{
+
+/*
+ * Stream layout, all integers little endian:
+ *
+ * header:  "PSRS" | version (1 byte) | flags (1 byte) | 2 reserved bytes
+ * record:  varint payload length | CRC-32C of payload (4 bytes, only if the
+ *          kRecordStreamCrc flag is set) | payload
+ *
+ * The payload is a serialized message.proto message, the stream itself does
+ * not look inside it.
+ */
+
+/*! @brief Size in bytes of the stream header. */
+constexpr std::size_t kRecordStreamHeaderSize = 8;
+
+/*! @brief Current version of the stream format. */
+constexpr std::uint8_t kRecordStreamVersion = 1;
+
+/*! @brief Header flag telling that every record carries a CRC-32C. */
+constexpr std::uint8_t kRecordStreamCrc = 0x01;
+
+/*!
+ * @brief Largest accepted payload, larger lengths are treated as corruption.
+ */
+constexpr std::uint64_t kMaxRecordSize = std::uint64_t{1} << 30;
+
+/*! @brief Maximum number of bytes in an encoded varint of 64 bits. */
+constexpr std::size_t kMaxVarintSize = 10;
+
+/*!
+ * @brief Outcome of reading a record.
+ */
+enum class RecordStatus
+{
+  kOk = 0,
+  /* Clean end of the stream. */
+  kEnd = 1,
+  /* The stream ends in the middle of a record. */
+  kTruncated = 2,
+  /* Bad header, bad length or CRC mismatch. */
+  kCorrupt = 3,
+  /* A system call failed, errno tells why. */
+  kIoError = 4
+};
+
+/*!
+ * @brief Encodes value as a varint.
+ *
+ * @param[in] value Value to encode.
+ * @param[out] output Receives the encoding, must hold kMaxVarintSize bytes.
+ *
+ * @return Number of bytes written to output.
+ */
+std::size_t EncodeVarint(std::uint64_t value, std::byte *output);
+
+/*!
+ * @brief Decodes a varint from the start of input.
+ *
+ * @param[in] input Bytes to decode.
+ * @param[out] value Receives the decoded value.
+ *
+ * @return Number of bytes consumed, 0 if input ends before the varint does or
+ * if the varint is longer than kMaxVarintSize.
+ */
+std::size_t DecodeVarint(std::span<const std::byte> input,
+    std::uint64_t &value);
+
+/*!
+ * @brief Configuration of a RecordWriter.
+ */
+struct RecordWriterOptions
+{
+  /* Bytes buffered before they are written to the file. */
+  std::size_t buffer_size = std::size_t{1} << 20;
+  /* Store a CRC-32C with every record. */
+  bool use_crc = true;
+};
+
+/*!
+ * @brief Buffered writer producing a record stream.
+ *
+ * Records are collected in a buffer which is written with one system call
+ * once it is full, instead of one call per record. Messages written with
+ * WriteMessage are serialized straight into the buffer.
+ *
+ * The class is neither copyable nor movable. It is not thread safe.
+ */
+class RecordWriter
+{
+ public:
+  explicit RecordWriter(const RecordWriterOptions &options =
+      RecordWriterOptions{});
+  RecordWriter(const RecordWriter &) = delete;
+  RecordWriter &operator=(const RecordWriter &) = delete;
+
+  /*! @brief Flushes and closes the stream if it is still open. */
+  ~RecordWriter();
+
+  /*!
+   * @brief Creates (or truncates) the file at path and writes the header.
+   *
+   * @param[in] path Path of the file, may not be null.
+   *
+   * @return false if the file could not be created or written.
+   */
+  bool Open(const char *path);
+
+  /*!
+   * @brief Writes the stream to an already open file descriptor, for example
+   * a pipe or socket. The descriptor is not closed by the writer.
+   *
+   * @param[in] fd Descriptor open for writing.
+   *
+   * @return false if the header could not be written.
+   */
+  bool OpenDescriptor(int fd);
+
+  /*!
+   * @brief Appends one record.
+   *
+   * @param[in] payload The serialized message.
+   *
+   * @return false if the stream is not open, payload exceeds kMaxRecordSize or
+   * a write failed.
+   */
+  bool Write(std::span<const std::byte> payload);
+
+  /*!
+   * @brief Serializes message directly into the write buffer.
+   *
+   * @param[in] message A generated message.proto message, or any type with
+   * the ByteSizeLong and SerializeToArray members of generated messages.
+   *
+   * @return false if serialization or writing failed.
+   */
+  template <typename Message>
+  bool WriteMessage(const Message &message)
+  {
+    std::size_t size = static_cast<std::size_t>(message.ByteSizeLong());
+    std::byte *payload = BeginRecord(size);
+    if (payload == nullptr ||
+        !message.SerializeToArray(payload, static_cast<int>(size)))
+    {
+      return false;
+    }
+    return EndRecord(payload, size);
+  }
+
+  /*!
+   * @brief Writes all buffered records to the file.
+   *
+   * @return false if a write failed.
+   */
+  bool Flush();
+
+  /*!
+   * @brief Flushes and closes the stream.
+   *
+   * @return false if the final flush or close failed.
+   */
+  bool Close();
+
+  /*! @brief Number of records written since Open. */
+  std::uint64_t RecordsWritten() const;
+
+ private:
+  bool WriteHeader();
+  /* Writes the length and reserves room for the CRC and payload. */
+  std::byte *BeginRecord(std::size_t size);
+  /* Fills in the CRC of the payload written after BeginRecord. */
+  bool EndRecord(std::byte *payload, std::size_t size);
+  bool WriteAll(const std::byte *data, std::size_t size);
+
+  RecordWriterOptions options_;
+  std::vector<std::byte> buffer_;
+  std::size_t buffered_ = 0;
+  int fd_ = -1;
+  bool owns_fd_ = false;
+  std::uint64_t records_written_ = 0;
+};
+
+/*!
+ * @brief Reads a record stream without copying the records.
+ *
+ * The stream is either a memory mapped file (Open), memory owned by the
+ * caller (OpenBuffer) or a descriptor read through a buffer (OpenDescriptor).
+ * The records returned by Next point directly into the mapping or buffer.
+ *
+ * The class is neither copyable nor movable. It is not thread safe.
+ */
+class RecordReader
+{
+ public:
+  RecordReader() = default;
+  RecordReader(const RecordReader &) = delete;
+  RecordReader &operator=(const RecordReader &) = delete;
+
+  ~RecordReader();
+
+  /*!
+   * @brief Memory maps the file at path and validates the header.
+   *
+   * Records returned by Next stay valid until the reader is closed.
+   *
+   * @param[in] path Path of the file, may not be null.
+   *
+   * @return kOk, or the reason the stream can not be read.
+   */
+  RecordStatus Open(const char *path);
+
+  /*!
+   * @brief Reads the stream from memory owned by the caller.
+   *
+   * Records returned by Next stay valid as long as buffer does.
+   *
+   * @param[in] buffer The complete stream, including its header.
+   *
+   * @return kOk, or the reason the stream can not be read.
+   */
+  RecordStatus OpenBuffer(std::span<const std::byte> buffer);
+
+  /*!
+   * @brief Reads the stream from a descriptor, for example a pipe or socket.
+   *
+   * The descriptor is read in chunks of buffer_size bytes and is not closed
+   * by the reader. Records returned by Next are only valid until the next
+   * call to Next.
+   *
+   * @param[in] fd Descriptor open for reading.
+   * @param[in] buffer_size Size of the read buffer, grown if a record does
+   * not fit.
+   *
+   * @return kOk, or the reason the stream can not be read.
+   */
+  RecordStatus OpenDescriptor(int fd,
+      std::size_t buffer_size = std::size_t{1} << 20);
+
+  /*!
+   * @brief Returns the next record.
+   *
+   * @param[out] record View of the payload, only set when kOk is returned.
+   *
+   * @return kOk, kEnd at the end of the stream, or an error. After an error
+   * every following call returns the same error.
+   */
+  RecordStatus Next(std::span<const std::byte> &record);
+
+  /*! @brief Unmaps or releases the stream. */
+  void Close();
+
+  /*! @brief True if the records carry a CRC which is verified by Next. */
+  bool HasCrc() const;
+
+ private:
+  RecordStatus ReadHeader();
+  /* Makes at least size unread bytes available, false at end of stream. */
+  RecordStatus Fill(std::size_t size);
+
+  /* Unread part of the stream available in memory. */
+  const std::byte *position_ = nullptr;
+  const std::byte *end_ = nullptr;
+  void *mapping_ = nullptr;
+  std::size_t mapping_size_ = 0;
+  std::vector<std::byte> buffer_;
+  int fd_ = -1;
+  bool descriptor_end_ = false;
+  bool has_crc_ = false;
+  RecordStatus error_ = RecordStatus::kOk;
+};
+
+/*!
+ * @brief Decodes a record stream which arrives in chunks of any size, for
+ * example from asynchronous reads which complete into fixed buffers.
+ *
+ * The caller hands each chunk to Next until it returns kEnd. Records lying
+ * completely inside a chunk are returned in place, only a record (or the
+ * stream header) split over chunks is assembled in an internal buffer, so a
+ * chunk can be reused as soon as Next has used it up.
+ *
+ * The class is copyable and movable. It is not thread safe.
+ */
+class RecordStreamDecoder
+{
+ public:
+  /*!
+   * @brief Decodes the next record.
+   *
+   * @param[in,out] input Unused part of the current chunk, advanced past the
+   * bytes consumed.
+   * @param[out] record View of the payload, only set when kOk is returned.
+   * Points into the chunk or into the decoder and stays valid until the next
+   * call.
+   *
+   * @return kOk, kEnd once input is used up, the bytes of an incomplete
+   * record being kept for the next chunk, or kCorrupt. After kCorrupt every
+   * following call returns kCorrupt.
+   */
+  RecordStatus Next(std::span<const std::byte> &input,
+      std::span<const std::byte> &record);
+
+  /*!
+   * @brief Tells how the stream ended once its last chunk is decoded.
+   *
+   * @return kEnd if it ended between two records, kTruncated if it ended in
+   * the header or a record, or kCorrupt.
+   */
+  RecordStatus Finish() const;
+
+  /*! @brief Forgets everything, the next chunk starts a new stream. */
+  void Reset();
+
+ private:
+  /* Bytes of the header or of a record split over chunks. */
+  std::vector<std::byte> pending_;
+  /* pending_ holds a record returned by the previous call. */
+  bool pending_returned_ = false;
+  bool header_done_ = false;
+  bool has_crc_ = false;
+  RecordStatus error_ = RecordStatus::kOk;
+};
+
+} /* namespace module_b */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_MODULEB_RECORDSTREAM_H_ */
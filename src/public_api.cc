@@ -0,0 +1,387 @@
+/* public_api.cc
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Public interface of module_a and module_b for embedding
+ * applications, forwarding to the modules without copies or allocations.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#include "include/include.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <span>
+
+#include "module-a/a.h"
+#include "module-b/b.h"
+#include "module-b/record_stream.h"
+
+
+namespace project_structure
+{
+namespace api
+{
+
+/* The public enum is passed on with a cast, the values have to agree. */
+static_assert(static_cast<int>(SomeEnum::kEnumVarOne) ==
+    static_cast<int>(module_a::SomeEnum::kEnumVarOne) &&
+    static_cast<int>(SomeEnum::kEnumVarTwo) ==
+    static_cast<int>(module_a::SomeEnum::kEnumVarTwo) &&
+    static_cast<int>(SomeEnum::kEnumVarOne) ==
+    static_cast<int>(module_b::SomeEnum::kEnumVarOne) &&
+    static_cast<int>(SomeEnum::kEnumVarTwo) ==
+    static_cast<int>(module_b::SomeEnum::kEnumVarTwo),
+    "api::SomeEnum has to match the SomeEnum of the modules");
+static_assert(static_cast<int>(module_a::SomeEnum::kEnd) ==
+    static_cast<int>(SomeEnum::kEnumVarTwo) + 1 &&
+    static_cast<int>(module_b::SomeEnum::kEnd) ==
+    static_cast<int>(SomeEnum::kEnumVarTwo) + 1,
+    "api::SomeEnum is missing a value of the modules");
+static_assert(SomeClassArray::kPayloadInlineCapacity ==
+    module_a::SomeClass::kPayloadInlineCapacity,
+    "kPayloadInlineCapacity has to match module_a::SomeClass");
+
+struct SomeClassArray::Object
+{
+  module_a::SomeClass some_class;
+};
+
+struct RecordDecoder::State
+{
+  module_b::RecordStreamDecoder decoder;
+};
+
+/*
+ * Sets results[i] to operation(SomeStruct{struct_vars[i]}) for every element.
+ * Working in place gets its own loop, the compiler only vectorizes the other
+ * one after checking that the spans do not overlap, which fails in place.
+ */
+template <typename SomeStruct, typename Operation>
+static void ApplyToStructVars(std::span<const int> struct_vars,
+    std::span<int> results, Operation operation)
+{
+  int *values = results.data();
+  const int *inputs = struct_vars.data();
+  if (values == inputs)
+  {
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+      values[i] = operation(SomeStruct{values[i]});
+    }
+    return;
+  }
+  for (std::size_t i = 0; i < results.size(); ++i)
+  {
+    values[i] = operation(SomeStruct{inputs[i]});
+  }
+}
+
+const char *StatusName(Status status)
+{
+  switch (status)
+  {
+    case Status::kOk:
+    {
+      return "ok";
+    }
+    case Status::kSizeMismatch:
+    {
+      return "size mismatch";
+    }
+    case Status::kInvalidArgument:
+    {
+      return "invalid argument";
+    }
+    case Status::kEmptyHandle:
+    {
+      return "empty handle";
+    }
+    case Status::kOutOfMemory:
+    {
+      return "out of memory";
+    }
+    case Status::kEnd:
+    {
+      return "end";
+    }
+    case Status::kTruncated:
+    {
+      return "truncated";
+    }
+    case Status::kCorrupt:
+    {
+      return "corrupt";
+    }
+    default:
+    {
+      return "unknown";
+    }
+  }
+}
+
+Status ModuleATempFunc(std::span<const int> some_other_inputs, int some_input,
+    std::span<int> some_input_outputs)
+{
+  if (some_other_inputs.size() != some_input_outputs.size())
+  {
+    return Status::kSizeMismatch;
+  }
+  /* No SomeStruct outputs, the final states are the results. */
+  module_a::TempFuncBatch(some_other_inputs, &some_input, some_input_outputs,
+      std::span<module_a::SomeStruct>());
+  return Status::kOk;
+}
+
+Status ModuleADoSomethingElse(SomeEnum some_enum,
+    std::span<const int> struct_vars, std::span<int> results)
+{
+  if (struct_vars.size() != results.size())
+  {
+    return Status::kSizeMismatch;
+  }
+  if (!module_a::VisitSomeEnum(static_cast<module_a::SomeEnum>(some_enum),
+      [&]<module_a::SomeEnum kSomeEnum>()
+  {
+    ApplyToStructVars<module_a::SomeStruct>(struct_vars, results,
+        module_a::DoSomethingElse<kSomeEnum>);
+  }))
+  {
+    /* Unknown values leave the struct unchanged, as DoSomethingElse does. */
+    std::copy(struct_vars.begin(), struct_vars.end(), results.begin());
+  }
+  return Status::kOk;
+}
+
+Status ModuleBDoSomethingElse(SomeEnum some_enum,
+    std::span<const int> struct_vars, std::span<int> results)
+{
+  if (struct_vars.size() != results.size())
+  {
+    return Status::kSizeMismatch;
+  }
+  if (!module_b::VisitSomeEnum(static_cast<module_b::SomeEnum>(some_enum),
+      [&]<module_b::SomeEnum kSomeEnum>()
+  {
+    ApplyToStructVars<module_b::SomeStruct>(struct_vars, results,
+        module_b::DoSomethingElse<kSomeEnum>);
+  }))
+  {
+    std::copy(struct_vars.begin(), struct_vars.end(), results.begin());
+  }
+  return Status::kOk;
+}
+
+SomeClassArray::SomeClassArray(SomeClassArray &&other) noexcept
+    : objects_(other.objects_), size_(other.size_)
+{
+  other.objects_ = nullptr;
+  other.size_ = 0;
+}
+
+SomeClassArray &SomeClassArray::operator=(SomeClassArray &&other) noexcept
+{
+  if (this != &other)
+  {
+    Destroy();
+    objects_ = other.objects_;
+    size_ = other.size_;
+    other.objects_ = nullptr;
+    other.size_ = 0;
+  }
+  return *this;
+}
+
+SomeClassArray::~SomeClassArray()
+{
+  Destroy();
+}
+
+Status SomeClassArray::Create(std::span<const int> class_consts,
+    std::span<const char> class_chars)
+{
+  const std::size_t kSize = class_consts.size();
+  Destroy();
+  if (class_chars.size() != kSize)
+  {
+    return Status::kSizeMismatch;
+  }
+  if (kSize > SIZE_MAX / sizeof(Object))
+  {
+    return Status::kOutOfMemory;
+  }
+  /* One block for every object, aligned like SomeClass to a cache line. */
+  objects_ = static_cast<Object *>(::operator new(
+      (kSize == 0 ? 1 : kSize) * sizeof(Object),
+      std::align_val_t{alignof(Object)}, std::nothrow));
+  if (objects_ == nullptr)
+  {
+    return Status::kOutOfMemory;
+  }
+  for (std::size_t i = 0; i < kSize; ++i)
+  {
+    new (&objects_[i]) Object{module_a::SomeClass(class_consts[i],
+        class_chars[i])};
+  }
+  size_ = kSize;
+  return Status::kOk;
+}
+
+std::size_t SomeClassArray::Size() const
+{
+  return size_;
+}
+
+Status SomeClassArray::SetClassChar(std::size_t index, char class_char)
+{
+  if (objects_ == nullptr)
+  {
+    return Status::kEmptyHandle;
+  }
+  if (index >= size_)
+  {
+    return Status::kInvalidArgument;
+  }
+  objects_[index].some_class.SetClassChar(class_char);
+  return Status::kOk;
+}
+
+Status SomeClassArray::SetPayload(std::size_t index,
+    std::span<const std::byte> payload)
+{
+  if (objects_ == nullptr)
+  {
+    return Status::kEmptyHandle;
+  }
+  if (index >= size_)
+  {
+    return Status::kInvalidArgument;
+  }
+  return objects_[index].some_class.SetPayload(payload) ? Status::kOk :
+      Status::kOutOfMemory;
+}
+
+std::span<const std::byte> SomeClassArray::Payload(std::size_t index) const
+{
+  if (index >= size_)
+  {
+    return std::span<const std::byte>();
+  }
+  return objects_[index].some_class.Payload();
+}
+
+Status SomeClassArray::DoSomething(std::span<int> results) const
+{
+  if (objects_ == nullptr)
+  {
+    return Status::kEmptyHandle;
+  }
+  if (results.size() != size_)
+  {
+    return Status::kSizeMismatch;
+  }
+  for (std::size_t i = 0; i < size_; ++i)
+  {
+    results[i] = module_a::DoSomething(objects_[i].some_class);
+  }
+  return Status::kOk;
+}
+
+void SomeClassArray::Destroy()
+{
+  if (objects_ == nullptr)
+  {
+    return;
+  }
+  for (std::size_t i = 0; i < size_; ++i)
+  {
+    objects_[i].~Object();
+  }
+  ::operator delete(objects_, std::align_val_t{alignof(Object)});
+  objects_ = nullptr;
+  size_ = 0;
+}
+
+/* The public status of a status of the record stream. */
+static Status ToStatus(module_b::RecordStatus status)
+{
+  switch (status)
+  {
+    case module_b::RecordStatus::kOk:
+    {
+      return Status::kOk;
+    }
+    case module_b::RecordStatus::kEnd:
+    {
+      return Status::kEnd;
+    }
+    case module_b::RecordStatus::kTruncated:
+    {
+      return Status::kTruncated;
+    }
+    default:
+    {
+      /* The decoder does no I/O, anything else is a damaged stream. */
+      return Status::kCorrupt;
+    }
+  }
+}
+
+RecordDecoder::RecordDecoder(RecordDecoder &&other) noexcept
+    : state_(other.state_)
+{
+  other.state_ = nullptr;
+}
+
+RecordDecoder &RecordDecoder::operator=(RecordDecoder &&other) noexcept
+{
+  if (this != &other)
+  {
+    delete state_;
+    state_ = other.state_;
+    other.state_ = nullptr;
+  }
+  return *this;
+}
+
+RecordDecoder::~RecordDecoder()
+{
+  delete state_;
+}
+
+Status RecordDecoder::Create()
+{
+  if (state_ != nullptr)
+  {
+    state_->decoder.Reset();
+    return Status::kOk;
+  }
+  state_ = new (std::nothrow) State();
+  return state_ == nullptr ? Status::kOutOfMemory : Status::kOk;
+}
+
+Status RecordDecoder::Next(std::span<const std::byte> &input,
+    std::span<const std::byte> &record)
+{
+  if (state_ == nullptr)
+  {
+    return Status::kEmptyHandle;
+  }
+  return ToStatus(state_->decoder.Next(input, record));
+}
+
+Status RecordDecoder::Finish() const
+{
+  if (state_ == nullptr)
+  {
+    return Status::kEmptyHandle;
+  }
+  return ToStatus(state_->decoder.Finish());
+}
+
+} /* namespace api */
+} /* namespace project_structure */
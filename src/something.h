@@ -2,7 +2,7 @@
  *==============================================================================
  * Author: Carl Larsson
  * Creation date: 2024-09-09
- * Last modified: 2024-10-08 by Carl Larsson
+ * Last modified: 2026-10-18 by Carl Larsson
  * Description: Example .h file used for example file structure and Google C++ 
  * style guide, it is only meant to be used as a template. All functions and 
  * variables are dummy and the contents of this file should in no way been seen 
@@ -84,6 +84,7 @@
 #include "other_header_needed.h"
 
 /* Projects .h files. */
+#include "common/sharded_counter.h"
 #include "somewhere/some_project_header.h"
 
 
@@ -139,7 +140,14 @@ constexpr int kTempVar = 5;
  * are used for, and why they need to be global.
  * - Vaiables are all lowercase with _ for word seperation.
  */
-int global_var = 1;
+/*!
+ * @brief Example global, the number of elements processed by TempFunc and
+ * TempFuncBatch in module_a.
+ *
+ * Every call adds to it from whichever thread runs it, pool workers included,
+ * so it is global and sharded per thread. Read it with global_var.Snapshot().
+ */
+extern common::ShardedCounter global_var;
 
 
 /*
@@ -0,0 +1,87 @@
+/* alloc_assertions.h
+ *==============================================================================
+ * Author: Carl Larsson
+ * Creation date: 2026-10-18
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: gtest assertion that a block of code does not allocate, for
+ * test binaries linked with the allocation tracker.
+ * License: See LICENSE file for license details.
+ *==============================================================================
+ */
+
+#ifndef PROJECTSTRUCTURE_TEST_ALLOCASSERTIONS_H_
+#define PROJECTSTRUCTURE_TEST_ALLOCASSERTIONS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "gtest/gtest.h"
+
+#include "common/alloc_tracker.h"
+
+
+namespace project_structure
+{
+namespace test
+{
+
+/*!
+ * @brief Runs function and succeeds if it made no heap allocation.
+ *
+ * Only allocations of the calling thread are counted, work function hands
+ * to other threads is not. On failure the message lists the allocations per
+ * scope:
+ *
+ * EXPECT_TRUE(test::AllocatesNothing([&]()
+ * {
+ *   module_a::TempFuncBatch(inputs, &kSomeInput, states, outputs);
+ * }));
+ *
+ * Fails without running function if the test binary is not linked with
+ * common/alloc_tracker_new.cc.
+ *
+ * @param[in] function Callable taking no arguments.
+ */
+template <typename Function>
+::testing::AssertionResult AllocatesNothing(Function &&function)
+{
+  common::ThreadAllocationCounts before = {};
+  std::uint64_t allocations = 0;
+  ::testing::AssertionResult result = ::testing::AssertionSuccess();
+  if (!common::AllocationTrackerInstalled())
+  {
+    return ::testing::AssertionFailure() <<
+        "common/alloc_tracker_new.cc is not linked into the test";
+  }
+  before = common::thread_allocation_counts;
+  function();
+  for (std::size_t i = 0; i < common::kAllocationScopeCount; ++i)
+  {
+    allocations += common::thread_allocation_counts.scopes[i].allocations -
+        before.scopes[i].allocations;
+  }
+  if (allocations == 0)
+  {
+    return result;
+  }
+  result = ::testing::AssertionFailure() << allocations << " allocations:";
+  for (std::size_t i = 0; i < common::kAllocationScopeCount; ++i)
+  {
+    if (common::thread_allocation_counts.scopes[i].allocations !=
+        before.scopes[i].allocations)
+    {
+      result << " " << common::AllocationScopeName(
+          static_cast<common::AllocationScope>(i)) << " " <<
+          common::thread_allocation_counts.scopes[i].allocations -
+              before.scopes[i].allocations << " (" <<
+          common::thread_allocation_counts.scopes[i].bytes -
+              before.scopes[i].bytes << " bytes)";
+    }
+  }
+  return result;
+}
+
+} /* namespace test */
+} /* namespace project_structure */
+
+#endif /* PROJECTSTRUCTURE_TEST_ALLOCASSERTIONS_H_ */
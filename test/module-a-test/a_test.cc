@@ -2,13 +2,786 @@
  *==============================================================================
  * Author: Carl Larsson
  * Creation date: 2024-09-09
- * Last modified: 2024-10-08 by Carl Larsson
- * Description: Example .cc file used for example file structure and Google C++ 
- * style guide, it is only meant to be used as a template. All functions and 
- * variables are dummy and the contents of this file should in no way been seen 
- * as a reflection of a real file.
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Unit tests for module_a.
  * License: See LICENSE file for license details.
  *==============================================================================
  */
 
-/* Placeholder file used for showing structure, nothing else. */
+#include "module-a/a.h"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "common/arena.h"
+#include "common/mapped_store.h"
+#include "common/memo_cache.h"
+#include "common/numa.h"
+#include "common/small_buffer.h"
+#include "lib/library.h"
+#include "module-a/bulk_runner.h"
+#include "module-a/some_struct_columns.h"
+#include "module-a/some_struct_store.h"
+#include "test/alloc_assertions.h"
+
+
+namespace project_structure
+{
+namespace module_a
+{
+
+/*
+ * Builds inputs covering negative values, zero and values close to the int
+ * limits, with an element count that is not a multiple of any vector width so
+ * that the scalar tail of every kernel is exercised as well.
+ */
+static std::vector<int> MakeTempFuncInputs(std::size_t count)
+{
+  std::vector<int> inputs(count, 0);
+  std::uint32_t seed = 0x9e3779b9u;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    seed = seed * 1664525u + 1013904223u;
+    inputs[i] = static_cast<int>(seed);
+  }
+  return inputs;
+}
+
+/* Reference result computed directly from TempFuncStep. */
+static int TempFuncReference(int some_other_input, int some_input,
+    int some_input_output)
+{
+  std::uint32_t state = static_cast<std::uint32_t>(some_input_output);
+  for (int i = 0; i < kTempFuncIterations; ++i)
+  {
+    state = TempFuncStep(state, static_cast<std::uint32_t>(some_other_input),
+        static_cast<std::uint32_t>(some_input), static_cast<std::uint32_t>(i));
+  }
+  return static_cast<int>(state);
+}
+
+TEST(TempFuncBatchTest, EveryKernelIsBitIdenticalToScalar)
+{
+  const std::size_t kCount = 1027;
+  const int kSomeInput = -123456;
+  const std::vector<int> kOtherInputs = MakeTempFuncInputs(kCount);
+  const std::vector<int> kInitialStates = MakeTempFuncInputs(kCount + 7);
+  const TempFuncKernel kKernels[] = {TempFuncKernel::kScalar,
+      TempFuncKernel::kSse41, TempFuncKernel::kAvx2, TempFuncKernel::kAvx512};
+  std::vector<int> states;
+  std::vector<SomeStruct> outputs;
+  int expected = 0;
+
+  for (TempFuncKernel kernel : kKernels)
+  {
+    states.assign(kInitialStates.begin(), kInitialStates.begin() + kCount);
+    outputs.assign(kCount, SomeStruct{0});
+    ASSERT_EQ(kCount, TempFuncBatchWithKernel(kernel, kOtherInputs,
+        &kSomeInput, states, outputs));
+    for (std::size_t i = 0; i < kCount; ++i)
+    {
+      expected = TempFuncReference(kOtherInputs[i], kSomeInput,
+          kInitialStates[i]);
+      ASSERT_EQ(expected, states[i]) << "kernel " << static_cast<int>(kernel)
+          << " element " << i;
+      ASSERT_EQ(expected, outputs[i].struct_var);
+    }
+  }
+}
+
+TEST(TempFuncBatchTest, DetectedKernelIsSupported)
+{
+  EXPECT_TRUE(IsTempFuncKernelSupported(DetectTempFuncKernel()));
+  EXPECT_TRUE(IsTempFuncKernelSupported(TempFuncKernel::kScalar));
+}
+
+TEST(TempFuncBatchTest, RejectsMismatchedSpans)
+{
+  const int kSomeInput = 1;
+  std::vector<int> other_inputs(4, 0);
+  std::vector<int> states(3, 0);
+  std::vector<SomeStruct> outputs(4, SomeStruct{0});
+
+  EXPECT_EQ(0u, TempFuncBatch(other_inputs, &kSomeInput, states, outputs));
+  states.resize(4);
+  EXPECT_EQ(0u, TempFuncBatch(other_inputs, nullptr, states, outputs));
+  EXPECT_EQ(4u, TempFuncBatch(other_inputs, &kSomeInput, states, outputs));
+}
+
+TEST(TempFuncBatchTest, CountsProcessedElements)
+{
+  const int kSomeInput = 2;
+  std::vector<int> other_inputs(37, 1);
+  std::vector<int> states(37, 0);
+  std::vector<SomeStruct> outputs(37, SomeStruct{0});
+  const std::int64_t kBefore = global_var.Snapshot();
+
+  ASSERT_EQ(37u, TempFuncBatch(other_inputs, &kSomeInput, states, outputs));
+  EXPECT_EQ(kBefore + 37, global_var.Snapshot());
+}
+
+TEST(TempFuncBatchTest, HotPathsDoNotAllocate)
+{
+  const int kSomeInput = 3;
+  const std::vector<int> kOtherInputs = MakeTempFuncInputs(1027);
+  const SomeClass kSomeClass(4, 'd');
+  std::vector<int> states(kOtherInputs.size(), 0);
+  std::vector<SomeStruct> outputs(kOtherInputs.size(), SomeStruct{0});
+  int some_input_output = 0;
+  SomeStruct some_output{0};
+  int some_result = 0;
+
+  EXPECT_TRUE(test::AllocatesNothing([&]()
+  {
+    TempFuncBatch(kOtherInputs, &kSomeInput, states, outputs);
+  }));
+  EXPECT_TRUE(test::AllocatesNothing([&]()
+  {
+    TempFunc(kOtherInputs[0], &kSomeInput, &some_input_output, &some_output);
+    some_result = DoSomething(kSomeClass);
+  }));
+  EXPECT_EQ(DoSomething(kSomeClass), some_result);
+}
+
+TEST(TempFuncUnrolledTest, MatchesLoopForEveryConfiguration)
+{
+  const std::vector<int> kInputs = MakeTempFuncInputs(64);
+  std::uint32_t state = 0;
+  std::uint32_t other_input = 0;
+  for (std::size_t i = 0; i + 1 < kInputs.size(); ++i)
+  {
+    state = static_cast<std::uint32_t>(kInputs[i]);
+    other_input = static_cast<std::uint32_t>(kInputs[i + 1]);
+    ASSERT_EQ(static_cast<std::uint32_t>(TempFuncReference(kInputs[i + 1],
+        kTempVar, kInputs[i])), TempFuncUnrolled(state, other_input,
+            std::uint32_t{kTempVar}));
+    ASSERT_EQ((TempFuncLoop(state, other_input, 9, 0, 3)),
+        (TempFuncUnrolled<0, 3>(state, other_input, 9)));
+    ASSERT_EQ((TempFuncLoop(state, other_input, 9, 1, 3)),
+        (TempFuncUnrolled<1, 3>(state, other_input, 9)));
+    ASSERT_EQ((TempFuncLoop(state, other_input, 9, 37, -7)),
+        (TempFuncUnrolled<37, -7>(state, other_input, 9)));
+    ASSERT_EQ((TempFuncLoop(state, other_input, 9, 100, 4)),
+        (TempFuncUnrolled<100, 4>(state, other_input, 9)));
+    /* Other configurations fall back to the loop. */
+    ASSERT_EQ(TempFuncLoop(state, other_input, 9, 64, kTempVar),
+        TempFuncIterate(state, other_input, 9, 64, kTempVar));
+    ASSERT_EQ(TempFuncUnrolled(state, other_input, 9),
+        TempFuncIterate(state, other_input, 9, kTempFuncIterations,
+            kTempVar));
+  }
+  static_assert(TempFuncUnrolled(1, 2, 3) == TempFuncLoop(1, 2, 3,
+      kTempFuncIterations, kTempVar));
+}
+
+TEST(SomeStructColumnsTest, AppendKeepsRowsAndAlignment)
+{
+  const std::vector<SomeStruct> kRows = {{3}, {-1}, {42}, {7}};
+  SomeStructColumns columns;
+
+  ASSERT_TRUE(columns.Reserve(2));
+  ASSERT_TRUE(columns.Append(kRows[0]));
+  ASSERT_TRUE(columns.Append(std::span<const SomeStruct>(kRows).subspan(1)));
+  ASSERT_EQ(kRows.size(), columns.Size());
+  EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(columns.struct_var().data()) %
+      kColumnAlignment);
+  for (std::size_t i = 0; i < kRows.size(); ++i)
+  {
+    EXPECT_EQ(kRows[i].struct_var, columns.Get(i).struct_var);
+    EXPECT_EQ(kRows[i].struct_var, columns.Row(i).struct_var);
+  }
+
+  columns.Row(2).struct_var = 5;
+  EXPECT_EQ(5, columns.struct_var()[2]);
+  columns.Clear();
+  EXPECT_EQ(0u, columns.Size());
+}
+
+TEST(SomeStructColumnsTest, ReserveRejectsCapacitiesThatOverflow)
+{
+  SomeStructColumns columns;
+
+  ASSERT_TRUE(columns.Append(SomeStruct{3}));
+  const std::size_t kCapacity = columns.Capacity();
+  EXPECT_FALSE(columns.Reserve(std::numeric_limits<std::size_t>::max()));
+  EXPECT_FALSE(columns.Reserve(
+      std::numeric_limits<std::size_t>::max() / sizeof(int) + 1));
+  EXPECT_EQ(kCapacity, columns.Capacity());
+  ASSERT_EQ(1u, columns.Size());
+  EXPECT_EQ(3, columns.Get(0).struct_var);
+}
+
+TEST(SomeStructColumnsTest, DoSomethingElseColumnsMatchesScalar)
+{
+  const std::vector<int> kValues = MakeTempFuncInputs(300);
+  const SomeEnum kEnums[] = {SomeEnum::kEnumVarOne, SomeEnum::kEnumVarTwo,
+      static_cast<SomeEnum>(0)};
+  SomeStructColumns columns;
+  std::vector<int> results(kValues.size(), 0);
+
+  for (int value : kValues)
+  {
+    ASSERT_TRUE(columns.Append(SomeStruct{value}));
+  }
+  for (SomeEnum some_enum : kEnums)
+  {
+    ASSERT_EQ(results.size(), DoSomethingElseColumns(some_enum, columns,
+        results));
+    for (std::size_t i = 0; i < kValues.size(); ++i)
+    {
+      ASSERT_EQ(DoSomethingElse(some_enum, SomeStruct{kValues[i]}),
+          results[i]);
+    }
+  }
+}
+
+/* The memoized function in the cache tests, cheap but key dependent. */
+static std::uint32_t MemoValue(const common::TempFuncKey &key)
+{
+  return key.some_other_input * 31u + key.some_input * 7u + key.state;
+}
+
+TEST(MemoCacheTest, MissInsertHitAndCounters)
+{
+  common::MemoCache<common::TempFuncKey, std::uint32_t,
+      common::TempFuncKeyHash> cache(common::MemoCacheOptions{64, 4});
+  const common::TempFuncKey kKey{1, 2, 3};
+  std::uint32_t value = 0;
+
+  EXPECT_FALSE(cache.Lookup(kKey, value));
+  cache.Insert(kKey, 42);
+  EXPECT_TRUE(cache.Lookup(kKey, value));
+  EXPECT_EQ(42u, value);
+  cache.Insert(kKey, 43);
+  EXPECT_TRUE(cache.Lookup(kKey, value));
+  EXPECT_EQ(43u, value);
+  EXPECT_FALSE(cache.Lookup(common::TempFuncKey{1, 2, 4}, value));
+
+  common::MemoCacheStats stats = cache.Stats();
+  EXPECT_EQ(2, stats.hits);
+  EXPECT_EQ(2, stats.misses);
+  EXPECT_EQ(2, stats.insertions);
+  EXPECT_EQ(0, stats.evictions);
+
+  cache.Clear();
+  EXPECT_FALSE(cache.Lookup(kKey, value));
+}
+
+TEST(MemoCacheTest, StaysWithinCapacityAndEvicts)
+{
+  common::MemoCache<common::TempFuncKey, std::uint32_t,
+      common::TempFuncKeyHash> cache(common::MemoCacheOptions{256, 4});
+  const std::uint32_t kKeyCount = 10 * 256;
+  std::uint32_t value = 0;
+  std::int64_t present = 0;
+  ASSERT_EQ(256u, cache.Capacity());
+
+  for (std::uint32_t i = 0; i < kKeyCount; ++i)
+  {
+    cache.Insert(common::TempFuncKey{i, 0, 0}, i);
+  }
+  for (std::uint32_t i = 0; i < kKeyCount; ++i)
+  {
+    if (cache.Lookup(common::TempFuncKey{i, 0, 0}, value))
+    {
+      EXPECT_EQ(i, value);
+      ++present;
+    }
+  }
+  EXPECT_LE(present, 256);
+  EXPECT_GT(present, 128);
+  EXPECT_EQ(kKeyCount - present, cache.Stats().evictions);
+}
+
+TEST(MemoCacheTest, ConcurrentReadersOnlySeeWrittenValues)
+{
+  common::MemoCache<common::TempFuncKey, std::uint32_t,
+      common::TempFuncKeyHash> cache(common::MemoCacheOptions{1024, 8});
+  std::vector<std::thread> threads;
+  for (std::uint32_t t = 0; t < 4; ++t)
+  {
+    threads.emplace_back([&cache, t]()
+    {
+      common::TempFuncKey key{0, t % 2, 0};
+      std::uint32_t value = 0;
+      for (std::uint32_t i = 0; i < 200000; ++i)
+      {
+        key.some_other_input = (i * 2654435761u) % 4096;
+        if (cache.Lookup(key, value))
+        {
+          ASSERT_EQ(MemoValue(key), value);
+        }
+        else
+        {
+          cache.Insert(key, MemoValue(key));
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads)
+  {
+    thread.join();
+  }
+  EXPECT_GT(cache.Stats().hits, 0);
+}
+
+TEST(DoSomethingElseBatchTest, MatchesScalarForEveryEnumValue)
+{
+  const SomeEnum kSomeEnums[] = {SomeEnum::kEnumVarOne, SomeEnum::kEnumVarTwo,
+      static_cast<SomeEnum>(7)};
+  std::vector<SomeStruct> some_structs(37, SomeStruct{0});
+  std::vector<int> results(some_structs.size(), 0);
+  for (std::size_t i = 0; i < some_structs.size(); ++i)
+  {
+    some_structs[i].struct_var = static_cast<int>(i * 7) - 100;
+  }
+  for (SomeEnum some_enum : kSomeEnums)
+  {
+    ASSERT_EQ(some_structs.size(),
+        DoSomethingElseBatch(some_enum, some_structs, results));
+    for (std::size_t i = 0; i < some_structs.size(); ++i)
+    {
+      EXPECT_EQ(DoSomethingElse(some_enum, some_structs[i]), results[i]);
+    }
+  }
+  EXPECT_EQ(0u, DoSomethingElseBatch(SomeEnum::kEnumVarOne, some_structs,
+      std::span<int>(results).first(3)));
+}
+
+TEST(DoSomethingElseBatchTest, TemplateIsUsableInConstantExpressions)
+{
+  static_assert(DoSomethingElse<SomeEnum::kEnumVarOne>(SomeStruct{5}) ==
+      DoSomethingElse(SomeEnum::kEnumVarOne, SomeStruct{5}));
+  static_assert(VisitSomeEnum(SomeEnum::kEnumVarTwo,
+      []<SomeEnum kSomeEnum>() {}));
+  static_assert(!VisitSomeEnum(static_cast<SomeEnum>(7),
+      []<SomeEnum kSomeEnum>() {}));
+  static_assert(!VisitSomeEnum(SomeEnum::kEnd, []<SomeEnum kSomeEnum>() {}));
+}
+
+/* Returns a path for a temporary file which is removed by the caller. */
+static std::string TemporaryPath(const char *name)
+{
+  return testing::TempDir() + name + std::to_string(getpid());
+}
+
+TEST(SomeStructStoreTest, AppendedStateIsReadInPlaceAfterReopen)
+{
+  const std::string kPath = TemporaryPath("some_struct_store_test");
+  const SomeClass kSomeClass(42, 'x');
+  std::vector<SomeStruct> some_structs(60, SomeStruct{0});
+  for (std::size_t i = 0; i < some_structs.size(); ++i)
+  {
+    some_structs[i].struct_var = static_cast<int>(i * 3) - 7;
+  }
+
+  SomeStructStore store;
+  ASSERT_EQ(common::StoreStatus::kOk, store.Create(kPath.c_str(), 100, 1));
+  EXPECT_TRUE(store.SomeStructs().empty());
+  ASSERT_EQ(common::StoreStatus::kOk, store.AppendSomeStructs(some_structs));
+  ASSERT_EQ(common::StoreStatus::kOk, store.AppendSomeClass(kSomeClass));
+  EXPECT_EQ(common::StoreStatus::kFull, store.AppendSomeClass(kSomeClass));
+  EXPECT_EQ(common::StoreStatus::kFull, store.AppendSomeStructs(some_structs));
+  store.Close();
+
+  ASSERT_EQ(common::StoreStatus::kOk, store.Open(kPath.c_str()));
+  ASSERT_EQ(some_structs.size(), store.SomeStructs().size());
+  EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(store.SomeStructs().data()) %
+      common::kStoreAlignment);
+  for (std::size_t i = 0; i < some_structs.size(); ++i)
+  {
+    EXPECT_EQ(some_structs[i].struct_var, store.SomeStructs()[i].struct_var);
+  }
+  ASSERT_EQ(1u, store.SomeClasses().size());
+  EXPECT_EQ(42, store.SomeClasses()[0].class_const);
+  EXPECT_EQ('x', store.SomeClasses()[0].class_char);
+  EXPECT_EQ(common::StoreStatus::kInvalidArgument,
+      store.AppendSomeStructs(some_structs));
+  store.Close();
+  std::remove(kPath.c_str());
+}
+
+TEST(SomeStructStoreTest, RejectsForeignAndDamagedFiles)
+{
+  const std::string kPath = TemporaryPath("some_struct_store_bad_test");
+  const SomeStruct kSomeStruct[] = {{1}};
+  common::MappedStore store;
+  SomeStructStore some_struct_store;
+  EXPECT_EQ(common::StoreStatus::kIoError, some_struct_store.Open(
+      kPath.c_str()));
+
+  ASSERT_EQ(common::StoreStatus::kOk, some_struct_store.Create(kPath.c_str(),
+      16, 16));
+  ASSERT_EQ(common::StoreStatus::kOk, some_struct_store.AppendSomeStructs(
+      kSomeStruct));
+  some_struct_store.Close();
+  EXPECT_EQ(common::StoreStatus::kSchemaMismatch, store.Open(kPath.c_str(),
+      common::StoreSchemaHash("SomeStruct{int64 struct_var}")));
+  EXPECT_FALSE(store.IsOpen());
+
+  ASSERT_EQ(0, truncate(kPath.c_str(), 200));
+  EXPECT_EQ(common::StoreStatus::kCorrupt, some_struct_store.Open(
+      kPath.c_str()));
+  EXPECT_TRUE(some_struct_store.SomeStructs().empty());
+  std::remove(kPath.c_str());
+}
+
+TEST(TempFuncMemoTest, CachesOnlyWhileEnabled)
+{
+  const common::TempFuncKey kKey{11, 22, 33};
+  std::uint32_t state = 0;
+
+  temp_func_memo.Store(kKey, 7);
+  EXPECT_FALSE(temp_func_memo.Lookup(kKey, state));
+
+  temp_func_memo.Enable(common::MemoCacheOptions{1024, 4});
+  temp_func_memo.Store(kKey, 7);
+  EXPECT_TRUE(temp_func_memo.Lookup(kKey, state));
+  EXPECT_EQ(7u, state);
+  EXPECT_GE(temp_func_memo.Stats().hits, 1);
+
+  temp_func_memo.Disable();
+  EXPECT_FALSE(temp_func_memo.Lookup(kKey, state));
+  temp_func_memo.Enable();
+  EXPECT_TRUE(temp_func_memo.Lookup(kKey, state));
+  temp_func_memo.Disable();
+}
+
+TEST(DoSomethingCacheTest, MatchesFullRecomputationUnderSmallUpdates)
+{
+  const std::size_t kObjectCount = 256;
+  std::vector<SomeClass> some_classes;
+  std::vector<DoSomethingCache> caches(kObjectCount);
+  std::uint64_t changes = kObjectCount;
+  std::uint64_t recomputations = 0;
+  std::size_t index = 0;
+  char class_char = '\0';
+  for (std::size_t i = 0; i < kObjectCount; ++i)
+  {
+    some_classes.emplace_back(static_cast<int>(i), 'a');
+  }
+  for (std::size_t i = 0; i < kObjectCount; ++i)
+  {
+    caches[i].Get(some_classes[i]);
+  }
+  for (int round = 0; round < 100; ++round)
+  {
+    /* A few objects per round, some set to the value they already have. */
+    for (int j = 0; j < 5; ++j)
+    {
+      index = static_cast<std::size_t>(round * 37 + j * 101) % kObjectCount;
+      class_char = static_cast<char>('a' + (round + j) % 3);
+      changes += some_classes[index].ClassChar() != class_char ? 1 : 0;
+      some_classes[index].SetClassChar(class_char);
+    }
+    for (std::size_t i = 0; i < kObjectCount; ++i)
+    {
+      ASSERT_EQ(DoSomething(some_classes[i]), caches[i].Get(some_classes[i]))
+          << "round " << round << ", object " << i;
+    }
+  }
+  for (const DoSomethingCache &cache : caches)
+  {
+    recomputations += cache.Recomputations();
+  }
+  EXPECT_EQ(changes, recomputations);
+}
+
+TEST(DoSomethingCacheTest, VersionsAreUniqueUnlessCopied)
+{
+  SomeClass some_class(3, 'a');
+  SomeClass same_state(3, 'a');
+  SomeClass copy(some_class);
+  DoSomethingCache cache;
+  std::uint64_t version = some_class.ClassCharVersion();
+  EXPECT_NE(0u, version);
+  EXPECT_NE(version, same_state.ClassCharVersion());
+  EXPECT_EQ(version, copy.ClassCharVersion());
+
+  some_class.SetClassChar('a');
+  EXPECT_EQ(version, some_class.ClassCharVersion());
+  some_class.SetClassChar('b');
+  EXPECT_NE(version, some_class.ClassCharVersion());
+  EXPECT_EQ(version, copy.ClassCharVersion());
+
+  /* Another object at the cache, or an invalidated one, is recomputed. */
+  EXPECT_EQ(DoSomething(some_class), cache.Get(some_class));
+  EXPECT_EQ(DoSomething(copy), cache.Get(copy));
+  EXPECT_EQ(DoSomething(copy), cache.Get(copy));
+  EXPECT_EQ(2u, cache.Recomputations());
+  cache.Invalidate();
+  EXPECT_EQ(DoSomething(copy), cache.Get(copy));
+  EXPECT_EQ(3u, cache.Recomputations());
+}
+
+/* Returns count bytes, counting up from first. */
+static std::vector<std::byte> Bytes(std::size_t count, int first)
+{
+  std::vector<std::byte> bytes(count);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    bytes[i] = static_cast<std::byte>(first + static_cast<int>(i));
+  }
+  return bytes;
+}
+
+static bool SameBytes(std::span<const std::byte> a,
+    std::span<const std::byte> b)
+{
+  return a.size() == b.size() &&
+      (a.empty() || std::memcmp(a.data(), b.data(), a.size()) == 0);
+}
+
+TEST(SmallBufferTest, SpillsOnlyPastTheInlineCapacity)
+{
+  const std::vector<std::byte> kShort = Bytes(16, 1);
+  const std::vector<std::byte> kLong = Bytes(100, 2);
+  common::SmallBuffer<16> buffer;
+  const std::byte *block = nullptr;
+  EXPECT_TRUE(buffer.IsInline());
+  EXPECT_EQ(0u, buffer.Size());
+
+  ASSERT_TRUE(buffer.Assign(kShort));
+  EXPECT_TRUE(buffer.IsInline());
+  EXPECT_TRUE(SameBytes(kShort, buffer.Data()));
+
+  ASSERT_TRUE(buffer.Assign(kLong));
+  EXPECT_FALSE(buffer.IsInline());
+  EXPECT_EQ(100u, buffer.Capacity());
+  EXPECT_TRUE(SameBytes(kLong, buffer.Data()));
+
+  /* Shorter contents reuse the block, also when taken from the buffer. */
+  block = buffer.Data().data();
+  ASSERT_TRUE(buffer.Assign(kShort));
+  EXPECT_EQ(block, buffer.Data().data());
+  ASSERT_TRUE(buffer.Assign(buffer.Data().subspan(4)));
+  EXPECT_TRUE(SameBytes(std::span<const std::byte>(kShort).subspan(4),
+      buffer.Data()));
+  buffer.Clear();
+  EXPECT_EQ(0u, buffer.Size());
+  EXPECT_EQ(100u, buffer.Capacity());
+}
+
+TEST(SmallBufferTest, CopiesAndMoves)
+{
+  const std::vector<std::byte> kShort = Bytes(8, 3);
+  const std::vector<std::byte> kLong = Bytes(64, 4);
+  common::SmallBuffer<16> inline_buffer;
+  common::SmallBuffer<16> heap_buffer;
+  const std::byte *block = nullptr;
+  ASSERT_TRUE(inline_buffer.Assign(kShort));
+  ASSERT_TRUE(heap_buffer.Assign(kLong));
+  block = heap_buffer.Data().data();
+
+  common::SmallBuffer<16> inline_copy(inline_buffer);
+  common::SmallBuffer<16> heap_copy(heap_buffer);
+  const common::SmallBuffer<16> &self = heap_copy;
+  EXPECT_TRUE(SameBytes(kShort, inline_copy.Data()));
+  EXPECT_TRUE(SameBytes(kLong, heap_copy.Data()));
+  EXPECT_NE(block, heap_copy.Data().data());
+
+  /* Moving hands the block over and leaves the source empty. */
+  common::SmallBuffer<16> moved(std::move(heap_buffer));
+  EXPECT_EQ(block, moved.Data().data());
+  EXPECT_EQ(0u, heap_buffer.Size());
+  EXPECT_TRUE(heap_buffer.IsInline());
+  moved = std::move(inline_buffer);
+  EXPECT_TRUE(SameBytes(kShort, moved.Data()));
+  EXPECT_TRUE(moved.IsInline());
+
+  heap_copy = self;
+  EXPECT_TRUE(SameBytes(kLong, heap_copy.Data()));
+  inline_copy = heap_copy;
+  EXPECT_TRUE(SameBytes(kLong, inline_copy.Data()));
+  ASSERT_TRUE(heap_buffer.Assign(kShort));
+  EXPECT_TRUE(SameBytes(kShort, heap_buffer.Data()));
+}
+
+TEST(SomeClassTest, FillsOneCacheLineAndKeepsShortPayloadsInside)
+{
+  const std::vector<std::byte> kShort =
+      Bytes(SomeClass::kPayloadInlineCapacity, 5);
+  const std::vector<std::byte> kLong =
+      Bytes(SomeClass::kPayloadInlineCapacity + 1, 6);
+  std::vector<SomeClass> some_classes;
+  const std::byte *object = nullptr;
+  std::uint64_t version = 0;
+  bool assigned = false;
+  some_classes.emplace_back(1, 'a');
+  some_classes.emplace_back(2, 'b');
+  EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(&some_classes[1]) % 64);
+  version = some_classes[0].ClassCharVersion();
+
+  EXPECT_TRUE(test::AllocatesNothing([&]()
+  {
+    assigned = some_classes[0].SetPayload(kShort);
+  }));
+  ASSERT_TRUE(assigned);
+  object = reinterpret_cast<const std::byte *>(&some_classes[0]);
+  EXPECT_TRUE(some_classes[0].Payload().data() >= object &&
+      some_classes[0].Payload().data() < object + sizeof(SomeClass));
+  EXPECT_TRUE(SameBytes(kShort, some_classes[0].Payload()));
+  EXPECT_EQ(version, some_classes[0].ClassCharVersion());
+
+  ASSERT_TRUE(some_classes[1].SetPayload(kLong));
+  SomeClass copy(some_classes[1]);
+  SomeClass moved(std::move(some_classes[1]));
+  EXPECT_TRUE(SameBytes(kLong, copy.Payload()));
+  EXPECT_TRUE(SameBytes(kLong, moved.Payload()));
+  EXPECT_TRUE(some_classes[1].Payload().empty());
+  EXPECT_EQ(2, moved.kClassConst_);
+}
+
+TEST(AdaptiveGrainTest, SplitsOnlyLoopsLongerThanTheSerialTime)
+{
+  lib::AdaptiveGrain grain;
+  EXPECT_EQ(0.0, grain.NanosecondsPerElement());
+  EXPECT_EQ(1000u, grain.Grain(1000, 4));
+
+  /* 10 ns per element, 50 us tasks are 5000 elements. */
+  grain.Record(1000, std::chrono::microseconds{10});
+  EXPECT_DOUBLE_EQ(10.0, grain.NanosecondsPerElement());
+  EXPECT_EQ(1000u, grain.Grain(1000, 4));
+  EXPECT_EQ(1000000u, grain.Grain(1000000, 1));
+  EXPECT_EQ(5000u, grain.Grain(1000000, 4));
+  /* Too few elements for 5000 per task and 4 tasks per thread. */
+  EXPECT_EQ(1250u, grain.Grain(20000, 4));
+
+  grain.Record(0, std::chrono::microseconds{10});
+  grain.Record(1000, std::chrono::microseconds{30});
+  EXPECT_DOUBLE_EQ(15.0, grain.NanosecondsPerElement());
+}
+
+TEST(BulkRunnerTest, MatchesSerialLoopsForEverySize)
+{
+  const std::size_t kSizes[] = {0, 1, 63, 64, 65, 1000, 20000, 200000};
+  lib::ThreadPool pool(lib::ThreadPoolOptions{4, false, 1024, {}});
+  BulkRunner runner(pool);
+  std::vector<SomeClass> some_classes;
+  std::vector<SomeStruct> some_structs;
+  std::vector<int> results;
+  for (std::size_t size : kSizes)
+  {
+    some_classes.clear();
+    some_structs.assign(size, SomeStruct{0});
+    results.assign(size, 0);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      some_classes.emplace_back(static_cast<int>(i), static_cast<char>(i));
+      some_structs[i].struct_var = static_cast<int>(i * 2654435761u);
+    }
+    ASSERT_EQ(size, runner.DoSomething(some_classes, results));
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      ASSERT_EQ(DoSomething(some_classes[i]), results[i]) << size << ", " << i;
+    }
+    for (SomeEnum some_enum : {SomeEnum::kEnumVarOne, SomeEnum::kEnumVarTwo,
+        static_cast<SomeEnum>(7)})
+    {
+      ASSERT_EQ(size, runner.DoSomethingElse(some_enum, some_structs,
+          results));
+      for (std::size_t i = 0; i < size; ++i)
+      {
+        ASSERT_EQ(DoSomethingElse(some_enum, some_structs[i]), results[i])
+            << size << ", " << i;
+      }
+    }
+  }
+  EXPECT_GT(runner.DoSomethingGrain().NanosecondsPerElement(), 0.0);
+  EXPECT_GT(runner.DoSomethingElseGrain().NanosecondsPerElement(), 0.0);
+  EXPECT_EQ(0u, runner.DoSomething(some_classes, std::span<int>()));
+}
+
+TEST(NumaTest, ParsesCpuLists)
+{
+  std::vector<int> cpus;
+  ASSERT_TRUE(common::ParseCpuList(" 8,0-2,10-11,1\n", cpus));
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 8, 10, 11}), cpus);
+  ASSERT_TRUE(common::ParseCpuList("\n", cpus));
+  EXPECT_TRUE(cpus.empty());
+  EXPECT_FALSE(common::ParseCpuList("3-1", cpus));
+  EXPECT_FALSE(common::ParseCpuList("0,", cpus));
+  EXPECT_FALSE(common::ParseCpuList("0-", cpus));
+  EXPECT_FALSE(common::ParseCpuList("a", cpus));
+  EXPECT_FALSE(common::ParseCpuList("0-100000000", cpus));
+}
+
+TEST(NumaTest, PlacesWorkersOnASimulatedTopology)
+{
+  const std::string kPath = TemporaryPath("numa_topology_test");
+  common::NumaTopology topology;
+  {
+    std::ofstream file(kPath);
+    file << "# Two nodes, listed out of order.\n\nnode1 4-5\nnode0 0-1,8\n";
+  }
+  ASSERT_TRUE(common::ReadSimulatedNumaTopology(kPath.c_str(), topology));
+  EXPECT_TRUE(topology.simulated);
+  ASSERT_EQ(2u, topology.nodes.size());
+  EXPECT_EQ(0, topology.nodes[0].id);
+  EXPECT_EQ((std::vector<int>{0, 1, 8}), topology.nodes[0].cpus);
+  EXPECT_EQ(1, common::NumaNodeOfCpu(topology, 5));
+  EXPECT_EQ(-1, common::NumaNodeOfCpu(topology, 3));
+
+  EXPECT_EQ((std::vector<int>{0, 4, 1, 5, 8, 4, 0}), common::PlaceWorkers(
+      topology, 7, common::NumaPlacement::kSpread));
+  EXPECT_EQ((std::vector<int>{0, 1, 8, 4, 5, 0}), common::PlaceWorkers(
+      topology, 6, common::NumaPlacement::kCompact));
+
+  {
+    std::ofstream file(kPath);
+    file << "node0 0-1\nnode0 2-3\n";
+  }
+  EXPECT_FALSE(common::ReadSimulatedNumaTopology(kPath.c_str(), topology));
+  {
+    std::ofstream file(kPath);
+    file << "socket0 0-1\n";
+  }
+  EXPECT_FALSE(common::ReadSimulatedNumaTopology(kPath.c_str(), topology));
+  std::remove(kPath.c_str());
+}
+
+TEST(NumaTest, ArenaBoundToANodeIsOnIt)
+{
+  common::NumaTopology topology;
+  common::NumaPageStats stats;
+  if (!common::ReadNumaTopology(common::kNumaNodeDirectory, topology))
+  {
+    GTEST_SKIP() << "no NUMA topology in " << common::kNumaNodeDirectory;
+  }
+  common::Arena arena(common::ArenaOptions{std::size_t{1} << 20, false,
+      topology.nodes[0].id});
+  std::span<std::byte> memory = arena.CreateArray<std::byte>(
+      std::size_t{4} << 20);
+  ASSERT_EQ(std::size_t{4} << 20, memory.size());
+  EXPECT_EQ(0u, arena.NumaBindFailures());
+  arena.ForEachBlock([&](std::span<const std::byte> block)
+  {
+    common::CountNumaPages(block.data(), block.size(), topology.nodes[0].id,
+        stats);
+  });
+  EXPECT_GE(stats.local_pages, (std::size_t{4} << 20) /
+      static_cast<std::size_t>(getpagesize()));
+  EXPECT_EQ(0u, stats.remote_pages);
+
+  common::Arena missing_node(common::ArenaOptions{std::size_t{1} << 20,
+      false, common::kMaxNumaNodes - 1});
+  EXPECT_NE(nullptr, missing_node.Allocate(64, 64));
+  EXPECT_EQ(1u, missing_node.NumaBindFailures());
+}
+
+} /* namespace module_a */
+} /* namespace project_structure */
@@ -2,13 +2,683 @@
  *==============================================================================
  * Author: Carl Larsson
  * Creation date: 2024-09-09
- * Last modified: 2024-10-08 by Carl Larsson
- * Description: Example .cc file used for example file structure and Google C++ 
- * style guide, it is only meant to be used as a template. All functions and 
- * variables are dummy and the contents of this file should in no way been seen 
- * as a reflection of a real file.
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Integration tests for module_a together with the common
+ * facilities it is used with.
  * License: See LICENSE file for license details.
  *==============================================================================
  */
 
-/* Placeholder file used for showing structure, nothing else. */
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <span>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "common/alloc_tracker.h"
+#include "common/arena.h"
+#include "common/stats.h"
+#include "common/trace.h"
+#include "include/include.h"
+#include "lib/batch_abi.h"
+#include "lib/library.h"
+#include "module-a/a.h"
+#include "test/alloc_assertions.h"
+
+
+namespace project_structure
+{
+namespace module_a
+{
+
+/*
+ * One request as the service handles it: the request object and every
+ * temporary buffer live in the arena, which is reset when the request is done.
+ */
+static int HandleRequest(common::Arena &arena, int request_id)
+{
+  const std::size_t kBatchSize = 256;
+  const int kSomeInput = request_id;
+  SomeClass *some_class = arena.Create<SomeClass>(request_id, 'a');
+  std::span<int> other_inputs = arena.CreateArray<int>(kBatchSize);
+  std::span<int> states = arena.CreateArray<int>(kBatchSize);
+  std::span<SomeStruct> outputs = arena.CreateArray<SomeStruct>(kBatchSize);
+  if (some_class == nullptr || outputs.empty())
+  {
+    return 0;
+  }
+  for (std::size_t i = 0; i < kBatchSize; ++i)
+  {
+    other_inputs[i] = static_cast<int>(i) + some_class->kClassConst_;
+  }
+  TempFuncBatch(other_inputs, &kSomeInput, states, outputs);
+  return outputs[kBatchSize - 1].struct_var;
+}
+
+/* Returns the summary of the stat called name, a zero summary if none. */
+static common::StatSummary FindStat(const char *name)
+{
+  std::vector<common::StatSummary> summaries = common::CollectStats();
+  for (const common::StatSummary &summary : summaries)
+  {
+    if (std::strcmp(summary.name, name) == 0)
+    {
+      return summary;
+    }
+  }
+  return common::StatSummary{name, common::StatKind::kTimer, 0, 0, 0.0, 0.0,
+      0.0, 0.0, 0.0};
+}
+
+/* Runs TempFuncBatch over kBatchSize elements. */
+static void RunTempFuncBatch()
+{
+  const std::size_t kBatchSize = 256;
+  const int kSomeInput = kTempVar;
+  std::vector<int> inputs(kBatchSize, 1);
+  std::vector<int> states(kBatchSize, 0);
+  std::vector<SomeStruct> outputs(kBatchSize, SomeStruct{0});
+  TempFuncBatch(inputs, &kSomeInput, states, outputs);
+}
+
+/*
+ * Runs kStatSampleInterval batches, exactly one of which is timed whatever
+ * the thread has timed before.
+ */
+static void RunSampledTempFuncBatches()
+{
+  for (std::uint64_t i = 0; i < common::kStatSampleInterval; ++i)
+  {
+    RunTempFuncBatch();
+  }
+}
+
+/* Returns the recorded events called name. */
+static std::vector<common::TraceRecord> FindTraceRecords(const char *name)
+{
+  std::vector<common::TraceRecord> records = common::CollectTrace();
+  std::vector<common::TraceRecord> found;
+  for (const common::TraceRecord &record : records)
+  {
+    if (record.name != nullptr && std::strcmp(record.name, name) == 0)
+    {
+      found.push_back(record);
+    }
+  }
+  return found;
+}
+
+/* Counts its runs, for the thread pool tests. */
+struct CountingTask : public lib::Task
+{
+  std::atomic<int> *runs;
+};
+
+static void RunCountingTask(lib::Task &task)
+{
+  static_cast<CountingTask &>(task).runs->fetch_add(1,
+      std::memory_order_relaxed);
+}
+
+/* Records count values of the counter "test wrap" on the calling thread. */
+static void RecordTraceCounters(std::size_t count)
+{
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    common::TraceCounter(common::TraceCategory::kModuleA, "test wrap",
+        static_cast<std::int64_t>(i));
+  }
+}
+
+/* Calls of CountingNewHandler since the test reset it. */
+static int new_handler_calls = 0;
+
+/* A new handler which gives up at once: counts the call, removes itself. */
+static void CountingNewHandler()
+{
+  ++new_handler_calls;
+  std::set_new_handler(nullptr);
+}
+
+TEST(ArenaIntegrationTest, SteadyStateRequestPathDoesNotAllocate)
+{
+  common::Arena arena(common::ArenaOptions{64 * 1024, false});
+
+  /* Warm up, the arena maps its blocks during the first requests. */
+  for (int i = 0; i < 4; ++i)
+  {
+    HandleRequest(arena, i);
+    arena.Reset();
+  }
+
+  EXPECT_TRUE(test::AllocatesNothing([&]()
+  {
+    for (int i = 0; i < 1000; ++i)
+    {
+      HandleRequest(arena, i);
+      arena.Reset();
+    }
+  }));
+}
+
+TEST(ArenaIntegrationTest, ResetReusesBlocksAndReleasesOversized)
+{
+  common::Arena arena(common::ArenaOptions{64 * 1024, false});
+
+  ASSERT_NE(nullptr, arena.Allocate(100, 64));
+  const std::size_t kReserved = arena.BytesReserved();
+  ASSERT_NE(nullptr, arena.Allocate(1024 * 1024, 64));
+  EXPECT_GT(arena.BytesReserved(), kReserved);
+
+  arena.Reset();
+  EXPECT_EQ(kReserved, arena.BytesReserved());
+  EXPECT_EQ(0u, arena.BytesAllocated());
+}
+
+TEST(ArenaIntegrationTest, CreateArrayRejectsSizesThatOverflow)
+{
+  common::Arena arena(common::ArenaOptions{64 * 1024, false});
+
+  EXPECT_TRUE(arena.CreateArray<std::uint64_t>(
+      std::numeric_limits<std::size_t>::max() / 4).empty());
+  EXPECT_EQ(0u, arena.BytesAllocated());
+  EXPECT_EQ(16u, arena.CreateArray<std::uint64_t>(16).size());
+}
+
+TEST(ArenaIntegrationTest, AllocateRejectsSizesThatOverflow)
+{
+  common::Arena arena(common::ArenaOptions{64 * 1024, false});
+
+  EXPECT_EQ(nullptr, arena.Allocate(std::numeric_limits<std::size_t>::max(),
+      64));
+  EXPECT_EQ(nullptr, arena.Allocate(
+      std::numeric_limits<std::size_t>::max() - 64, 64));
+  EXPECT_EQ(0u, arena.BytesAllocated());
+  EXPECT_EQ(0u, arena.BytesReserved());
+  EXPECT_NE(nullptr, arena.Allocate(100, 64));
+}
+
+TEST(ArenaIntegrationTest, HugePageBackingFallsBackWhenUnavailable)
+{
+  common::Arena arena(common::ArenaOptions{4096, true});
+  void *memory = arena.Allocate(4096, 4096);
+
+  ASSERT_NE(nullptr, memory);
+  EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(memory) % 4096);
+  EXPECT_GE(arena.BytesReserved(), common::kHugePageSize);
+}
+
+TEST(ThreadPoolIntegrationTest, ExternalSpawnsPastTheQueueCapacityDoNotAllocate)
+{
+  const std::size_t kTaskCount = 256;
+  std::atomic<int> runs{0};
+  std::vector<CountingTask> tasks(kTaskCount);
+  lib::ThreadPool pool(lib::ThreadPoolOptions{1, false, 64, {}, 4});
+  lib::TaskGroup group(pool);
+
+  for (CountingTask &task : tasks)
+  {
+    task.function = &RunCountingTask;
+    task.runs = &runs;
+  }
+  /* The queue holds 4 tasks, the rest wait for the worker to make room. */
+  EXPECT_TRUE(test::AllocatesNothing([&]()
+  {
+    for (CountingTask &task : tasks)
+    {
+      group.Spawn(task);
+    }
+    group.Wait();
+  }));
+  EXPECT_EQ(static_cast<int>(kTaskCount), runs.load());
+}
+
+TEST(StatsIntegrationTest, ProbesRecordOnlyWhenEnabledAndSurviveThreadExit)
+{
+  const common::StatSummary kTimerBefore = FindStat("module_a::TempFuncBatch");
+  const common::StatSummary kElementsBefore = FindStat(
+      "module_a::TempFuncBatch elements");
+  common::StatSummary timer_after = kTimerBefore;
+
+  RunTempFuncBatch();
+  EXPECT_EQ(kTimerBefore.count,
+      FindStat("module_a::TempFuncBatch").count);
+
+  common::SetStatsEnabled(true);
+  RunSampledTempFuncBatches();
+  std::thread worker(RunSampledTempFuncBatches);
+  worker.join();
+  common::SetStatsEnabled(false);
+
+  timer_after = FindStat("module_a::TempFuncBatch");
+  EXPECT_EQ(kTimerBefore.count + 2 * common::kStatSampleInterval,
+      timer_after.count);
+  EXPECT_EQ(kTimerBefore.sampled + 2, timer_after.sampled);
+  EXPECT_GT(timer_after.total, 0.0);
+  EXPECT_GE(timer_after.max_ns, timer_after.p99_ns);
+  EXPECT_GE(timer_after.p99_ns, timer_after.p50_ns);
+  EXPECT_EQ(kElementsBefore.total +
+      512.0 * static_cast<double>(common::kStatSampleInterval),
+      FindStat("module_a::TempFuncBatch elements").total);
+}
+
+TEST(TraceIntegrationTest, ParsesCategoryLists)
+{
+  std::uint32_t categories = 0;
+  EXPECT_TRUE(common::ParseTraceCategories("module_a,io", categories));
+  EXPECT_EQ(static_cast<std::uint32_t>(common::TraceCategory::kModuleA) |
+      static_cast<std::uint32_t>(common::TraceCategory::kIo), categories);
+  EXPECT_TRUE(common::ParseTraceCategories("all", categories));
+  EXPECT_EQ(common::kAllTraceCategories, categories);
+  EXPECT_FALSE(common::ParseTraceCategories("module_c", categories));
+  EXPECT_FALSE(common::ParseTraceCategories("", categories));
+}
+
+TEST(TraceIntegrationTest, RecordsOnlyEnabledCategoriesOnEveryThread)
+{
+  const std::size_t kBefore = FindTraceRecords(
+      "module_a::TempFuncBatch").size();
+  std::vector<common::TraceRecord> records;
+  std::FILE *file = std::tmpfile();
+  std::string json(4096, '\0');
+
+  RunTempFuncBatch();
+  common::SetTraceCategories(
+      static_cast<std::uint32_t>(common::TraceCategory::kIo));
+  RunTempFuncBatch();
+  EXPECT_EQ(kBefore, FindTraceRecords("module_a::TempFuncBatch").size());
+
+  common::SetTraceCategories(common::kAllTraceCategories);
+  RunTempFuncBatch();
+  std::thread worker(RunTempFuncBatch);
+  worker.join();
+  common::TraceBegin(common::TraceCategory::kModuleB, "test span");
+  common::TraceInstant(common::TraceCategory::kModuleB, "test instant");
+  common::TraceEnd(common::TraceCategory::kModuleB, "test span");
+  common::SetTraceCategories(0);
+
+  records = FindTraceRecords("module_a::TempFuncBatch");
+  ASSERT_EQ(kBefore + 2, records.size());
+  EXPECT_NE(records[kBefore].thread_id, records[kBefore + 1].thread_id);
+  EXPECT_EQ(common::TracePhase::kComplete, records[kBefore].phase);
+  EXPECT_EQ(common::TraceCategory::kModuleA, records[kBefore].category);
+  EXPECT_GE(records[kBefore].value, 0.0);
+  records = FindTraceRecords("test span");
+  ASSERT_EQ(2u, records.size());
+  EXPECT_EQ(common::TracePhase::kBegin, records[0].phase);
+  EXPECT_EQ(common::TracePhase::kEnd, records[1].phase);
+  EXPECT_LE(records[0].timestamp_ns, records[1].timestamp_ns);
+
+  ASSERT_NE(nullptr, file);
+  ASSERT_TRUE(common::WriteChromeTrace(file));
+  std::rewind(file);
+  json.resize(std::fread(json.data(), 1, json.size(), file));
+  std::fclose(file);
+  EXPECT_EQ(0u, json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+  EXPECT_NE(std::string::npos, json.find(
+      "{\"name\":\"module_a::TempFuncBatch\",\"cat\":\"module_a\","
+      "\"ph\":\"X\""));
+}
+
+TEST(TraceIntegrationTest, FullRingKeepsTheNewestEvents)
+{
+  std::vector<common::TraceRecord> records;
+  common::SetTraceCategories(common::kAllTraceCategories);
+  std::thread worker(RecordTraceCounters, common::kTraceEventsPerThread + 10);
+  worker.join();
+  common::SetTraceCategories(0);
+
+  records = FindTraceRecords("test wrap");
+  ASSERT_EQ(common::kTraceEventsPerThread, records.size());
+  EXPECT_EQ(10.0, records.front().value);
+  EXPECT_EQ(static_cast<double>(common::kTraceEventsPerThread + 9),
+      records.back().value);
+}
+
+TEST(AllocationIntegrationTest, FailedNewCallsTheNewHandlerThenThrows)
+{
+  /*
+   * Too large to round up to the alignment, so malloc is never asked.
+   * Volatile, the compiler warns about the constant otherwise.
+   */
+  const volatile std::size_t kTooLarge =
+      std::numeric_limits<std::size_t>::max() - 1;
+  const std::align_val_t kAlignment{64};
+  void *volatile memory = nullptr;
+  ASSERT_TRUE(common::AllocationTrackerInstalled());
+  new_handler_calls = 0;
+
+  std::set_new_handler(&CountingNewHandler);
+  EXPECT_THROW(memory = ::operator new(kTooLarge, kAlignment),
+      std::bad_alloc);
+  EXPECT_EQ(1, new_handler_calls);
+
+  std::set_new_handler(&CountingNewHandler);
+  memory = ::operator new(kTooLarge, kAlignment, std::nothrow);
+  EXPECT_EQ(nullptr, memory);
+  EXPECT_EQ(2, new_handler_calls);
+  EXPECT_EQ(nullptr, std::get_new_handler());
+}
+
+TEST(AllocationIntegrationTest, AttributesToTheInnermostScopeAndTracksPeak)
+{
+  const common::ThreadAllocationCounts kBefore =
+      common::thread_allocation_counts;
+  common::ThreadAllocationCounts after = {};
+  common::AllocationStats allocated = {};
+  common::AllocationStats freed = {};
+  void *volatile outer = nullptr;
+  void *volatile inner = nullptr;
+  ASSERT_TRUE(common::AllocationTrackerInstalled());
+  common::ResetAllocationPeak();
+
+  {
+    common::ScopedAllocationScope module_scope(
+        common::AllocationScope::kModuleA);
+    outer = ::operator new(100);
+    {
+      common::ScopedAllocationScope proto_scope(
+          common::AllocationScope::kProto);
+      inner = ::operator new(1000);
+    }
+  }
+  after = common::thread_allocation_counts;
+  allocated = common::CollectAllocationStats();
+  ::operator delete(inner);
+  ::operator delete(outer);
+  freed = common::CollectAllocationStats();
+
+  EXPECT_EQ(common::AllocationScope::kOther, common::current_allocation_scope);
+  EXPECT_EQ(kBefore.scopes[1].allocations + 1, after.scopes[1].allocations);
+  EXPECT_EQ(kBefore.scopes[1].bytes + 100, after.scopes[1].bytes);
+  EXPECT_EQ(kBefore.scopes[3].allocations + 1, after.scopes[3].allocations);
+  EXPECT_EQ(kBefore.scopes[3].bytes + 1000, after.scopes[3].bytes);
+  EXPECT_GE(allocated.scopes[3].bytes, 1000u);
+  EXPECT_EQ(allocated.frees + 2, freed.frees);
+  EXPECT_GE(allocated.live_bytes - freed.live_bytes, 1100);
+  EXPECT_GE(freed.peak_live_bytes - freed.live_bytes, 1100);
+}
+
+TEST(AllocationIntegrationTest, FailureNamesTheAllocatingScope)
+{
+  const ::testing::AssertionResult kResult = test::AllocatesNothing([]()
+  {
+    common::ScopedAllocationScope scope(common::AllocationScope::kModuleB);
+    void *volatile memory = ::operator new(24);
+    ::operator delete(memory);
+  });
+  EXPECT_FALSE(kResult);
+  EXPECT_NE(std::string::npos, std::string(kResult.message()).find(
+      "module_b 1 (24 bytes)"));
+}
+
+TEST(PublicApiTest, BatchCallsMatchModuleAInPlaceWithoutAllocating)
+{
+  const int kSomeInput = 11;
+  const std::vector<int> kOtherInputs = {-7, 0, 1, 99, 1 << 30, -(1 << 30),
+      12345, 6, 7};
+  std::vector<int> expected_states(kOtherInputs.size(), 3);
+  std::vector<SomeStruct> expected_outputs(kOtherInputs.size(),
+      SomeStruct{0});
+  std::vector<int> states(kOtherInputs.size(), 3);
+  std::vector<int> values(kOtherInputs);
+  api::Status temp_func_status = api::Status::kSizeMismatch;
+  api::Status do_something_else_status = api::Status::kSizeMismatch;
+
+  ASSERT_EQ(kOtherInputs.size(), TempFuncBatch(kOtherInputs, &kSomeInput,
+      expected_states, expected_outputs));
+  EXPECT_TRUE(test::AllocatesNothing([&]()
+  {
+    temp_func_status = api::ModuleATempFunc(kOtherInputs, kSomeInput,
+        states);
+    do_something_else_status = api::ModuleADoSomethingElse(
+        api::SomeEnum::kEnumVarTwo, values, values);
+  }));
+  EXPECT_EQ(api::Status::kOk, temp_func_status);
+  EXPECT_EQ(expected_states, states);
+  EXPECT_EQ(api::Status::kOk, do_something_else_status);
+  for (std::size_t i = 0; i < kOtherInputs.size(); ++i)
+  {
+    EXPECT_EQ(DoSomethingElse(SomeEnum::kEnumVarTwo,
+        SomeStruct{kOtherInputs[i]}), values[i]);
+  }
+
+  EXPECT_EQ(api::Status::kOk, api::ModuleADoSomethingElse(
+      static_cast<api::SomeEnum>(9), kOtherInputs, values));
+  EXPECT_EQ(kOtherInputs, values);
+  values.pop_back();
+  EXPECT_EQ(api::Status::kSizeMismatch, api::ModuleATempFunc(kOtherInputs,
+      kSomeInput, values));
+  EXPECT_EQ(api::Status::kSizeMismatch, api::ModuleADoSomethingElse(
+      api::SomeEnum::kEnumVarOne, kOtherInputs, values));
+}
+
+TEST(PublicApiTest, SomeClassArrayIsMoveOnlyAndReadsPayloadsInPlace)
+{
+  static_assert(!std::is_copy_constructible_v<api::SomeClassArray> &&
+      !std::is_copy_assignable_v<api::SomeClassArray> &&
+      std::is_nothrow_move_constructible_v<api::SomeClassArray> &&
+      std::is_nothrow_move_assignable_v<api::SomeClassArray>,
+      "SomeClassArray should be move-only");
+  const int kClassConsts[] = {1, 2, 3};
+  const char kClassChars[] = {'a', 'b', 'c'};
+  const std::byte kPayload[] = {std::byte{1}, std::byte{2}, std::byte{3}};
+  api::SomeClassArray array;
+  api::SomeClassArray moved;
+  std::vector<int> results(3, 0);
+  std::span<const std::byte> payload;
+  api::Status status = api::Status::kEmptyHandle;
+
+  EXPECT_EQ(api::Status::kEmptyHandle, array.DoSomething(results));
+  EXPECT_EQ(api::Status::kSizeMismatch, array.Create(kClassConsts,
+      std::span<const char>(kClassChars).first(2)));
+  ASSERT_EQ(api::Status::kOk, array.Create(kClassConsts, kClassChars));
+  ASSERT_EQ(3u, array.Size());
+  EXPECT_TRUE(test::AllocatesNothing([&]()
+  {
+    status = array.SetPayload(1, kPayload);
+  }));
+  ASSERT_EQ(api::Status::kOk, status);
+  payload = array.Payload(1);
+  EXPECT_NE(kPayload, payload.data());
+  EXPECT_TRUE(std::equal(payload.begin(), payload.end(),
+      std::begin(kPayload), std::end(kPayload)));
+  EXPECT_EQ(api::Status::kInvalidArgument, array.SetClassChar(3, 'x'));
+  EXPECT_TRUE(array.Payload(3).empty());
+  ASSERT_EQ(api::Status::kOk, array.SetClassChar(2, 'z'));
+
+  /* Moving hands over the objects, the payload stays where it is. */
+  moved = std::move(array);
+  EXPECT_EQ(0u, array.Size());
+  EXPECT_EQ(payload.data(), moved.Payload(1).data());
+  EXPECT_TRUE(test::AllocatesNothing([&]()
+  {
+    status = moved.DoSomething(results);
+  }));
+  ASSERT_EQ(api::Status::kOk, status);
+  EXPECT_EQ(DoSomething(SomeClass(1, 'a')), results[0]);
+  EXPECT_EQ(DoSomething(SomeClass(2, 'b')), results[1]);
+  EXPECT_EQ(DoSomething(SomeClass(3, 'z')), results[2]);
+  EXPECT_STREQ("size mismatch", api::StatusName(moved.DoSomething(
+      std::span<int>(results).first(1))));
+}
+
+/* Counts the completions of a context created with it as user data. */
+static void CountCompletion(void *user_data,
+    const PsBatchCompletion *completion)
+{
+  std::atomic<std::uint64_t> *counts =
+      static_cast<std::atomic<std::uint64_t> *>(user_data);
+  counts[0].fetch_add(1, std::memory_order_relaxed);
+  counts[1].fetch_add(completion->request_count, std::memory_order_relaxed);
+  counts[2].fetch_add(completion->failed_count, std::memory_order_relaxed);
+}
+
+TEST(BatchAbiTest, RunMatchesTheApiAndReportsFailuresPerRequest)
+{
+  const int kSomeInput = 11;
+  const std::vector<int> kOtherInputs = {-7, 0, 1, 99, 1 << 30, 6};
+  std::vector<int> expected_states(kOtherInputs.size(), 3);
+  std::vector<int> expected_results(kOtherInputs.size(), 0);
+  std::vector<int> states(kOtherInputs.size(), 3);
+  std::vector<int> values(kOtherInputs);
+  std::vector<PsBatchRequest> requests(4, PsBatchRequest{});
+  std::uint64_t failed_count = 0;
+  std::int32_t status = kPsBatchInvalidArgument;
+
+  ASSERT_EQ(kPsBatchAbiVersion, static_cast<int>(PsBatchAbiVersion()));
+  ASSERT_EQ(api::Status::kOk, api::ModuleATempFunc(kOtherInputs, kSomeInput,
+      expected_states));
+  ASSERT_EQ(api::Status::kOk, api::ModuleBDoSomethingElse(
+      api::SomeEnum::kEnumVarOne, kOtherInputs, expected_results));
+  requests[0] = PsBatchRequest{kPsBatchModuleATempFunc, kSomeInput,
+      kOtherInputs.data(), states.data(), kOtherInputs.size(), -1, 0};
+  requests[1] = PsBatchRequest{kPsBatchModuleBDoSomethingElse,
+      kPsBatchEnumVarOne, values.data(), values.data(), values.size(), -1, 0};
+  requests[2] = PsBatchRequest{99, 0, values.data(), values.data(),
+      values.size(), -1, 0};
+  requests[3] = PsBatchRequest{kPsBatchModuleADoSomethingElse,
+      kPsBatchEnumVarTwo, nullptr, values.data(), values.size(), -1, 0};
+  EXPECT_TRUE(test::AllocatesNothing([&]()
+  {
+    status = PsBatchRun(requests.data(), requests.size(), &failed_count);
+  }));
+  EXPECT_EQ(kPsBatchOk, status);
+  EXPECT_EQ(2u, failed_count);
+  EXPECT_EQ(kPsBatchOk, requests[0].status);
+  EXPECT_EQ(expected_states, states);
+  EXPECT_EQ(kPsBatchOk, requests[1].status);
+  EXPECT_EQ(expected_results, values);
+  /* The failed requests leave their outputs alone. */
+  EXPECT_EQ(kPsBatchInvalidArgument, requests[2].status);
+  EXPECT_EQ(kPsBatchInvalidArgument, requests[3].status);
+  EXPECT_STREQ("invalid argument", PsBatchStatusName(requests[3].status));
+
+  EXPECT_EQ(kPsBatchOk, PsBatchRun(nullptr, 0, nullptr));
+  EXPECT_EQ(kPsBatchInvalidArgument, PsBatchRun(nullptr, 1, nullptr));
+}
+
+TEST(BatchAbiTest, SubmittedBatchesCompleteThroughCallbackAndPoll)
+{
+  const std::size_t kBatchCount = 8;
+  const std::size_t kBatchSize = 100;
+  std::vector<int> values(kBatchCount * kBatchSize, 0);
+  std::vector<int> expected(values.size(), 0);
+  std::vector<PsBatchRequest> requests(values.size(), PsBatchRequest{});
+  std::atomic<std::uint64_t> counts[3] = {0, 0, 0};
+  PsBatchCompletion completions[4] = {};
+  PsBatchContextOptions options = {};
+  PsBatchContext *context = nullptr;
+
+  for (std::size_t i = 0; i < values.size(); ++i)
+  {
+    values[i] = static_cast<int>(i);
+    expected[i] = DoSomethingElse(SomeEnum::kEnumVarTwo,
+        SomeStruct{values[i]});
+    requests[i] = PsBatchRequest{kPsBatchModuleADoSomethingElse,
+        kPsBatchEnumVarTwo, &values[i], &values[i], 1, -1, 0};
+  }
+  /* A struct_size shorter than the one of this version is refused. */
+  options.struct_size = sizeof(options) - 1;
+  EXPECT_EQ(kPsBatchInvalidArgument, PsBatchContextCreate(&options,
+      &context));
+  EXPECT_EQ(nullptr, context);
+
+  options.struct_size = sizeof(options);
+  options.thread_count = 2;
+  options.max_in_flight = kBatchCount;
+  options.callback = &CountCompletion;
+  options.user_data = counts;
+  ASSERT_EQ(kPsBatchOk, PsBatchContextCreate(&options, &context));
+  for (std::size_t i = 0; i < kBatchCount; ++i)
+  {
+    ASSERT_EQ(kPsBatchOk, PsBatchSubmit(context, &requests[i * kBatchSize],
+        kBatchSize, i));
+  }
+  PsBatchWait(context);
+  EXPECT_EQ(kBatchCount, counts[0].load());
+  EXPECT_EQ(values.size(), counts[1].load());
+  EXPECT_EQ(0u, counts[2].load());
+  EXPECT_EQ(expected, values);
+  PsBatchContextDestroy(context);
+
+  /* Without a callback completions wait to be polled, and hold their slot. */
+  options.max_in_flight = 2;
+  options.callback = nullptr;
+  options.user_data = nullptr;
+  ASSERT_EQ(kPsBatchOk, PsBatchContextCreate(&options, &context));
+  EXPECT_EQ(kPsBatchOk, PsBatchSubmit(context, requests.data(), 3, 7));
+  EXPECT_EQ(kPsBatchOk, PsBatchSubmit(context, &requests[3], 0, 8));
+  EXPECT_EQ(kPsBatchQueueFull, PsBatchSubmit(context, requests.data(), 1, 9));
+  PsBatchWait(context);
+  EXPECT_EQ(kPsBatchQueueFull, PsBatchSubmit(context, requests.data(), 1, 9));
+  ASSERT_EQ(2u, PsBatchPoll(context, completions, 4));
+  EXPECT_EQ(0u, PsBatchPoll(context, completions + 2, 2));
+  /* One worker each, so either may complete first. */
+  if (completions[0].tag == 8)
+  {
+    std::swap(completions[0], completions[1]);
+  }
+  EXPECT_EQ(7u, completions[0].tag);
+  EXPECT_EQ(3u, completions[0].request_count);
+  EXPECT_EQ(8u, completions[1].tag);
+  EXPECT_EQ(0u, completions[1].request_count);
+  EXPECT_EQ(kPsBatchOk, PsBatchSubmit(context, requests.data(), 1, 9));
+  PsBatchContextDestroy(context);
+  EXPECT_EQ(kPsBatchEmptyHandle, PsBatchSubmit(nullptr, requests.data(), 1,
+      0));
+}
+
+TEST(BatchAbiTest, WarmSubmitAllocatesNothing)
+{
+  const std::size_t kBatchSize = 64;
+  std::vector<int> values(kBatchSize, 3);
+  std::vector<PsBatchRequest> requests(kBatchSize, PsBatchRequest{});
+  PsBatchCompletion completion = {};
+  PsBatchContextOptions options = {};
+  PsBatchContext *context = nullptr;
+  std::int32_t status = kPsBatchInvalidArgument;
+  std::uint64_t taken = 0;
+
+  for (std::size_t i = 0; i < kBatchSize; ++i)
+  {
+    requests[i] = PsBatchRequest{kPsBatchModuleADoSomethingElse,
+        kPsBatchEnumVarOne, &values[i], &values[i], 1, -1, 0};
+  }
+  options.struct_size = sizeof(options);
+  options.thread_count = 1;
+  options.max_in_flight = 2;
+  ASSERT_EQ(kPsBatchOk, PsBatchContextCreate(&options, &context));
+  /* The first batch starts the worker and warms the request path. */
+  ASSERT_EQ(kPsBatchOk, PsBatchSubmit(context, requests.data(), kBatchSize,
+      0));
+  PsBatchWait(context);
+  ASSERT_EQ(1u, PsBatchPoll(context, &completion, 1));
+
+  EXPECT_TRUE(test::AllocatesNothing([&]()
+  {
+    status = PsBatchSubmit(context, requests.data(), kBatchSize, 1);
+    PsBatchWait(context);
+    taken = PsBatchPoll(context, &completion, 1);
+  }));
+  EXPECT_EQ(kPsBatchOk, status);
+  ASSERT_EQ(1u, taken);
+  EXPECT_EQ(1u, completion.tag);
+  EXPECT_EQ(0u, completion.failed_count);
+  PsBatchContextDestroy(context);
+}
+
+} /* namespace module_a */
+} /* namespace project_structure */
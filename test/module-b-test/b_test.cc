@@ -2,13 +2,663 @@
  *==============================================================================
  * Author: Carl Larsson
  * Creation date: 2024-09-09
- * Last modified: 2024-10-08 by Carl Larsson
- * Description: Example .cc file used for example file structure and Google C++ 
- * style guide, it is only meant to be used as a template. All functions and 
- * variables are dummy and the contents of this file should in no way been seen 
- * as a reflection of a real file.
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Unit tests for module_b.
  * License: See LICENSE file for license details.
  *==============================================================================
  */
 
-/* Placeholder file used for showing structure, nothing else. */
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "common/lz4_block.h"
+#include "common/object_pool.h"
+#include "include/include.h"
+#include "module-b/b.h"
+#include "module-b/block_log.h"
+#include "module-b/record_stream.h"
+#include "test/alloc_assertions.h"
+
+
+namespace project_structure
+{
+namespace module_b
+{
+
+/* Builds count records of varying size, some of them larger than 127 bytes. */
+static std::vector<std::vector<std::byte>> MakeRecords(std::size_t count)
+{
+  std::vector<std::vector<std::byte>> records(count);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    records[i].resize((i * 37) % 300);
+    for (std::size_t j = 0; j < records[i].size(); ++j)
+    {
+      records[i][j] = static_cast<std::byte>((i + j) & 0xffu);
+    }
+  }
+  return records;
+}
+
+/* Returns a path for a temporary file which is removed by the caller. */
+static std::string TemporaryPath(const char *name)
+{
+  return testing::TempDir() + name + std::to_string(getpid());
+}
+
+TEST(VarintTest, RoundTripsBoundaryValues)
+{
+  const std::uint64_t kValues[] = {0, 1, 127, 128, 16383, 16384,
+      std::uint64_t{1} << 35, ~std::uint64_t{0}};
+  std::byte encoded[kMaxVarintSize] = {};
+  std::uint64_t decoded = 0;
+  std::size_t size = 0;
+
+  for (std::uint64_t value : kValues)
+  {
+    size = EncodeVarint(value, encoded);
+    ASSERT_EQ(size, DecodeVarint(std::span<const std::byte>(encoded, size),
+        decoded));
+    EXPECT_EQ(value, decoded);
+    EXPECT_EQ(0u, DecodeVarint(std::span<const std::byte>(encoded, size - 1),
+        decoded));
+  }
+}
+
+TEST(RecordStreamTest, FileRoundTripWithAndWithoutCrc)
+{
+  const std::vector<std::vector<std::byte>> kRecords = MakeRecords(1000);
+  const std::string kPath = TemporaryPath("record_stream_test");
+  std::span<const std::byte> record;
+  std::size_t count = 0;
+
+  for (bool use_crc : {true, false})
+  {
+    RecordWriter writer(RecordWriterOptions{4096, use_crc});
+    ASSERT_TRUE(writer.Open(kPath.c_str()));
+    for (const std::vector<std::byte> &payload : kRecords)
+    {
+      ASSERT_TRUE(writer.Write(payload));
+    }
+    ASSERT_TRUE(writer.Close());
+
+    RecordReader reader;
+    ASSERT_EQ(RecordStatus::kOk, reader.Open(kPath.c_str()));
+    EXPECT_EQ(use_crc, reader.HasCrc());
+    count = 0;
+    while (reader.Next(record) == RecordStatus::kOk)
+    {
+      ASSERT_LT(count, kRecords.size());
+      ASSERT_TRUE(std::equal(record.begin(), record.end(),
+          kRecords[count].begin(), kRecords[count].end()));
+      ++count;
+    }
+    EXPECT_EQ(kRecords.size(), count);
+    EXPECT_EQ(RecordStatus::kEnd, reader.Next(record));
+  }
+  std::remove(kPath.c_str());
+}
+
+TEST(RecordStreamTest, DescriptorReaderHandlesRecordsLargerThanBuffer)
+{
+  const std::vector<std::vector<std::byte>> kRecords = MakeRecords(200);
+  const std::string kPath = TemporaryPath("record_stream_fd_test");
+  std::vector<std::byte> large(100000, std::byte{7});
+  std::span<const std::byte> record;
+  std::size_t count = 0;
+
+  RecordWriter writer(RecordWriterOptions{1024, true});
+  ASSERT_TRUE(writer.Open(kPath.c_str()));
+  ASSERT_TRUE(writer.Write(large));
+  for (const std::vector<std::byte> &payload : kRecords)
+  {
+    ASSERT_TRUE(writer.Write(payload));
+  }
+  ASSERT_TRUE(writer.Close());
+
+  std::FILE *file = std::fopen(kPath.c_str(), "rb");
+  ASSERT_NE(nullptr, file);
+  RecordReader reader;
+  ASSERT_EQ(RecordStatus::kOk, reader.OpenDescriptor(fileno(file), 256));
+  ASSERT_EQ(RecordStatus::kOk, reader.Next(record));
+  EXPECT_EQ(large.size(), record.size());
+  while (reader.Next(record) == RecordStatus::kOk)
+  {
+    ASSERT_TRUE(std::equal(record.begin(), record.end(),
+        kRecords[count].begin(), kRecords[count].end()));
+    ++count;
+  }
+  EXPECT_EQ(kRecords.size(), count);
+  std::fclose(file);
+  std::remove(kPath.c_str());
+}
+
+TEST(RecordStreamTest, DescriptorReaderReturnsShortRecordsOfAnOpenPipe)
+{
+  const std::vector<std::byte> kPayload = {std::byte{1}, std::byte{2},
+      std::byte{3}};
+  int pipe_fds[2] = {-1, -1};
+  std::span<const std::byte> record;
+
+  ASSERT_EQ(0, pipe(pipe_fds));
+  RecordWriter writer(RecordWriterOptions{4096, false});
+  writer.OpenDescriptor(pipe_fds[1]);
+  ASSERT_TRUE(writer.Write(kPayload));
+  ASSERT_TRUE(writer.Close());
+
+  /* The write end stays open, the reader must not wait for more bytes. */
+  RecordReader reader;
+  ASSERT_EQ(RecordStatus::kOk, reader.OpenDescriptor(pipe_fds[0], 256));
+  ASSERT_EQ(RecordStatus::kOk, reader.Next(record));
+  EXPECT_TRUE(std::equal(record.begin(), record.end(), kPayload.begin(),
+      kPayload.end()));
+  close(pipe_fds[1]);
+  EXPECT_EQ(RecordStatus::kEnd, reader.Next(record));
+  close(pipe_fds[0]);
+}
+
+TEST(RecordStreamTest, DetectsCorruptionAndTruncation)
+{
+  const std::string kPath = TemporaryPath("record_stream_corrupt_test");
+  const std::vector<std::byte> kPayload(50, std::byte{1});
+  std::vector<std::byte> stream;
+  std::span<const std::byte> record;
+
+  RecordWriter writer(RecordWriterOptions{4096, true});
+  ASSERT_TRUE(writer.Open(kPath.c_str()));
+  ASSERT_TRUE(writer.Write(kPayload));
+  ASSERT_TRUE(writer.Close());
+  std::FILE *file = std::fopen(kPath.c_str(), "rb");
+  ASSERT_NE(nullptr, file);
+  stream.resize(kRecordStreamHeaderSize + 1 + 4 + kPayload.size());
+  ASSERT_EQ(stream.size(), std::fread(stream.data(), 1, stream.size(), file));
+  std::fclose(file);
+  std::remove(kPath.c_str());
+
+  stream.back() = std::byte{2};
+  RecordReader reader;
+  ASSERT_EQ(RecordStatus::kOk, reader.OpenBuffer(stream));
+  EXPECT_EQ(RecordStatus::kCorrupt, reader.Next(record));
+
+  ASSERT_EQ(RecordStatus::kOk, reader.OpenBuffer(
+      std::span<const std::byte>(stream).first(stream.size() - 1)));
+  EXPECT_EQ(RecordStatus::kTruncated, reader.Next(record));
+
+  stream[0] = std::byte{'X'};
+  EXPECT_EQ(RecordStatus::kCorrupt, reader.OpenBuffer(stream));
+}
+
+TEST(Lz4BlockTest, RoundTripsAndRejectsDamagedBlocks)
+{
+  std::vector<std::byte> input;
+  std::vector<std::byte> compressed;
+  std::vector<std::byte> output;
+  std::size_t size = 0;
+
+  /* Empty, too short to match, repeating, text like and incompressible. */
+  for (std::size_t length : {std::size_t{0}, std::size_t{11},
+      std::size_t{70000}})
+  {
+    for (int kind = 0; kind < 3; ++kind)
+    {
+      input.resize(length);
+      for (std::size_t i = 0; i < length; ++i)
+      {
+        input[i] = kind == 0 ? std::byte{'a'} : kind == 1 ?
+            static_cast<std::byte>("key=value;"[i % 10] + i / 4096 % 3) :
+            static_cast<std::byte>((i * 2654435761u) >> 13);
+      }
+      compressed.resize(common::Lz4CompressBound(length));
+      size = common::Lz4Compress(input, compressed);
+      ASSERT_GT(size, 0u);
+      ASSERT_LE(size, compressed.size());
+      output.assign(length, std::byte{0});
+      ASSERT_TRUE(common::Lz4Decompress(
+          std::span<const std::byte>(compressed).first(size), output));
+      EXPECT_EQ(input, output);
+      if (kind == 0 && length > 1000)
+      {
+        EXPECT_LT(size, length / 100);
+      }
+    }
+  }
+
+  /* Output of the wrong size, a cut block and a match before the start. */
+  output.resize(input.size() - 1);
+  EXPECT_FALSE(common::Lz4Decompress(
+      std::span<const std::byte>(compressed).first(size), output));
+  output.resize(input.size());
+  EXPECT_FALSE(common::Lz4Decompress(
+      std::span<const std::byte>(compressed).first(size - 1), output));
+  compressed.assign({std::byte{0x04}, std::byte{1}, std::byte{0}});
+  EXPECT_FALSE(common::Lz4Decompress(compressed, output));
+  compressed.resize(common::Lz4CompressBound(input.size()));
+  EXPECT_EQ(0u, common::Lz4Compress(input,
+      std::span<std::byte>(compressed).first(compressed.size() - 1)));
+}
+
+TEST(BlockLogTest, RoundTripsCompressedAndStoredBlocks)
+{
+  const std::vector<std::vector<std::byte>> kRecords = MakeRecords(3000);
+  const std::string kPath = TemporaryPath("block_log_test");
+  std::vector<std::byte> buffer;
+  std::span<const std::byte> records;
+  std::span<const std::byte> record;
+  std::uint64_t number = 0;
+  std::size_t block = 0;
+
+  for (bool compress : {true, false})
+  {
+    BlockLogWriter writer(BlockLogWriterOptions{4096, compress});
+    ASSERT_TRUE(writer.Open(kPath.c_str()));
+    for (const std::vector<std::byte> &payload : kRecords)
+    {
+      ASSERT_TRUE(writer.Write(payload));
+    }
+    ASSERT_TRUE(writer.Close());
+    EXPECT_EQ(kRecords.size(), writer.RecordsWritten());
+
+    BlockLogReader reader;
+    ASSERT_EQ(RecordStatus::kOk, reader.Open(kPath.c_str()));
+    EXPECT_EQ(kRecords.size(), reader.RecordCount());
+    ASSERT_EQ(writer.BlocksWritten(), reader.BlockCount());
+    ASSERT_GT(reader.BlockCount(), 10u);
+    number = 0;
+    for (block = 0; block < reader.BlockCount(); ++block)
+    {
+      ASSERT_EQ(number, reader.BlockFirstRecord(block));
+      ASSERT_EQ(RecordStatus::kOk, reader.ReadBlock(block, buffer, records));
+      while (NextBlockRecord(records, record) == RecordStatus::kOk)
+      {
+        ASSERT_TRUE(std::equal(record.begin(), record.end(),
+            kRecords[number].begin(), kRecords[number].end()));
+        ++number;
+      }
+    }
+    EXPECT_EQ(kRecords.size(), number);
+    EXPECT_EQ(RecordStatus::kEnd, reader.ReadBlock(block, buffer, records));
+
+    /* Any record is found through the index. */
+    for (std::uint64_t wanted : {std::uint64_t{0}, std::uint64_t{1234},
+        std::uint64_t{kRecords.size() - 1}})
+    {
+      block = reader.FindBlock(wanted);
+      ASSERT_LT(block, reader.BlockCount());
+      ASSERT_EQ(RecordStatus::kOk, reader.ReadBlock(block, buffer, records));
+      for (number = reader.BlockFirstRecord(block); number <= wanted;
+          ++number)
+      {
+        ASSERT_EQ(RecordStatus::kOk, NextBlockRecord(records, record));
+      }
+      EXPECT_TRUE(std::equal(record.begin(), record.end(),
+          kRecords[wanted].begin(), kRecords[wanted].end()));
+    }
+    EXPECT_EQ(reader.BlockCount(), reader.FindBlock(kRecords.size()));
+  }
+  std::remove(kPath.c_str());
+}
+
+/* Stands in for a generated message, for BlockLogWriter::WriteMessage. */
+struct FakeMessage
+{
+  std::vector<std::byte> bytes;
+  bool fails;
+
+  std::size_t ByteSizeLong() const
+  {
+    return bytes.size();
+  }
+
+  bool SerializeToArray(void *data, int size) const
+  {
+    if (fails || static_cast<std::size_t>(size) != bytes.size())
+    {
+      return false;
+    }
+    std::copy(bytes.begin(), bytes.end(), static_cast<std::byte *>(data));
+    return true;
+  }
+};
+
+TEST(BlockLogTest, FailedMessageLeavesNothingInTheLog)
+{
+  const std::vector<std::vector<std::byte>> kRecords = MakeRecords(4);
+  const std::string kPath = TemporaryPath("block_log_message_test");
+  std::vector<std::byte> buffer;
+  std::span<const std::byte> records;
+  std::span<const std::byte> record;
+  std::vector<std::vector<std::byte>> read;
+
+  /* The second message ends the first block before it fails. */
+  BlockLogWriter writer(BlockLogWriterOptions{kRecords[1].size() +
+      kRecords[2].size() / 2, false});
+  ASSERT_TRUE(writer.Open(kPath.c_str()));
+  ASSERT_TRUE(writer.WriteMessage(FakeMessage{kRecords[1], false}));
+  EXPECT_FALSE(writer.WriteMessage(FakeMessage{kRecords[2], true}));
+  EXPECT_FALSE(writer.WriteMessage(FakeMessage{kRecords[2], true}));
+  ASSERT_TRUE(writer.WriteMessage(FakeMessage{kRecords[3], false}));
+  ASSERT_TRUE(writer.Close());
+  EXPECT_EQ(2u, writer.RecordsWritten());
+
+  BlockLogReader reader;
+  ASSERT_EQ(RecordStatus::kOk, reader.Open(kPath.c_str()));
+  std::remove(kPath.c_str());
+  EXPECT_EQ(2u, reader.RecordCount());
+  for (std::size_t block = 0; block < reader.BlockCount(); ++block)
+  {
+    ASSERT_EQ(RecordStatus::kOk, reader.ReadBlock(block, buffer, records));
+    while (NextBlockRecord(records, record) == RecordStatus::kOk)
+    {
+      read.emplace_back(record.begin(), record.end());
+    }
+    EXPECT_EQ(RecordStatus::kEnd, NextBlockRecord(records, record));
+  }
+  ASSERT_EQ(2u, read.size());
+  EXPECT_EQ(kRecords[1], read[0]);
+  EXPECT_EQ(kRecords[3], read[1]);
+}
+
+TEST(BlockLogTest, DetectsCorruptionAndTruncation)
+{
+  const std::vector<std::vector<std::byte>> kRecords = MakeRecords(500);
+  const std::string kPath = TemporaryPath("block_log_corrupt_test");
+  std::vector<std::byte> log;
+  std::vector<std::byte> buffer;
+  std::span<const std::byte> records;
+  long size = 0;
+
+  BlockLogWriter writer(BlockLogWriterOptions{4096, true});
+  ASSERT_TRUE(writer.Open(kPath.c_str()));
+  for (const std::vector<std::byte> &payload : kRecords)
+  {
+    ASSERT_TRUE(writer.Write(payload));
+  }
+  ASSERT_TRUE(writer.Close());
+  std::FILE *file = std::fopen(kPath.c_str(), "rb");
+  ASSERT_NE(nullptr, file);
+  ASSERT_EQ(0, std::fseek(file, 0, SEEK_END));
+  size = std::ftell(file);
+  ASSERT_GT(size, 0);
+  std::rewind(file);
+  log.resize(static_cast<std::size_t>(size));
+  ASSERT_EQ(log.size(), std::fread(log.data(), 1, log.size(), file));
+  std::fclose(file);
+  std::remove(kPath.c_str());
+
+  /* A flipped byte in the first block fails only that block. */
+  log[kBlockLogHeaderSize + kBlockHeaderSize + 3] ^= std::byte{0x20};
+  BlockLogReader reader;
+  ASSERT_EQ(RecordStatus::kOk, reader.OpenBuffer(log));
+  EXPECT_EQ(RecordStatus::kCorrupt, reader.ReadBlock(0, buffer, records));
+  EXPECT_EQ(RecordStatus::kOk, reader.ReadBlock(1, buffer, records));
+  log[kBlockLogHeaderSize + kBlockHeaderSize + 3] ^= std::byte{0x20};
+
+  /* The index is covered by its own checksum. */
+  log[log.size() - kBlockLogFooterSize - 1] ^= std::byte{0x01};
+  EXPECT_EQ(RecordStatus::kCorrupt, reader.OpenBuffer(log));
+  log[log.size() - kBlockLogFooterSize - 1] ^= std::byte{0x01};
+
+  EXPECT_EQ(RecordStatus::kTruncated, reader.OpenBuffer(
+      std::span<const std::byte>(log).first(log.size() - 1)));
+  log[0] = std::byte{'X'};
+  EXPECT_EQ(RecordStatus::kCorrupt, reader.OpenBuffer(log));
+}
+
+TEST(RecordStreamDecoderTest, ChunkedInputMatchesRecords)
+{
+  const std::vector<std::vector<std::byte>> kRecords = MakeRecords(300);
+  const std::string kPath = TemporaryPath("record_stream_decoder_test");
+  const std::size_t kChunkSizes[] = {1, 3, 7, 64, 1000, 1 << 20};
+  std::vector<std::byte> stream(1 << 20);
+  std::span<const std::byte> chunk;
+  std::span<const std::byte> record;
+  std::size_t count = 0;
+  RecordStreamDecoder decoder;
+
+  RecordWriter writer(RecordWriterOptions{4096, true});
+  ASSERT_TRUE(writer.Open(kPath.c_str()));
+  for (const std::vector<std::byte> &payload : kRecords)
+  {
+    ASSERT_TRUE(writer.Write(payload));
+  }
+  ASSERT_TRUE(writer.Close());
+  std::FILE *file = std::fopen(kPath.c_str(), "rb");
+  ASSERT_NE(nullptr, file);
+  stream.resize(std::fread(stream.data(), 1, stream.size(), file));
+  std::fclose(file);
+  std::remove(kPath.c_str());
+
+  for (std::size_t chunk_size : kChunkSizes)
+  {
+    decoder.Reset();
+    count = 0;
+    for (std::size_t begin = 0; begin < stream.size(); begin += chunk_size)
+    {
+      chunk = std::span<const std::byte>(stream).subspan(begin,
+          std::min(chunk_size, stream.size() - begin));
+      while (decoder.Next(chunk, record) == RecordStatus::kOk)
+      {
+        ASSERT_LT(count, kRecords.size());
+        ASSERT_TRUE(std::equal(record.begin(), record.end(),
+            kRecords[count].begin(), kRecords[count].end()));
+        ++count;
+      }
+      ASSERT_TRUE(chunk.empty());
+    }
+    EXPECT_EQ(kRecords.size(), count);
+    EXPECT_EQ(RecordStatus::kEnd, decoder.Finish());
+  }
+
+  /* The buffer has grown to the largest split record, it is kept on Reset. */
+  decoder.Reset();
+  count = 0;
+  EXPECT_TRUE(test::AllocatesNothing([&]()
+  {
+    for (std::size_t begin = 0; begin < stream.size(); begin += 7)
+    {
+      chunk = std::span<const std::byte>(stream).subspan(begin,
+          std::min(std::size_t{7}, stream.size() - begin));
+      while (decoder.Next(chunk, record) == RecordStatus::kOk)
+      {
+        ++count;
+      }
+    }
+  }));
+  EXPECT_EQ(kRecords.size(), count);
+
+  decoder.Reset();
+  chunk = std::span<const std::byte>(stream).first(stream.size() - 1);
+  while (decoder.Next(chunk, record) == RecordStatus::kOk)
+  {
+  }
+  EXPECT_EQ(RecordStatus::kTruncated, decoder.Finish());
+
+  decoder.Reset();
+  stream[kRecordStreamHeaderSize + 12] ^= std::byte{0xff};
+  chunk = stream;
+  while (decoder.Next(chunk, record) == RecordStatus::kOk)
+  {
+  }
+  EXPECT_EQ(RecordStatus::kCorrupt, decoder.Finish());
+}
+
+/* Pooled object which keeps its buffer on Clear, like generated messages. */
+struct PooledValues
+{
+  void Clear()
+  {
+    values.clear();
+    ++clear_count;
+  }
+
+  std::vector<int> values;
+  int clear_count = 0;
+};
+
+TEST(ObjectPoolTest, ReusesClearedObjectsWithTheirBuffers)
+{
+  common::ObjectPool<PooledValues> pool;
+  common::ObjectPool<PooledValues>::Handle handle = pool.Acquire();
+  PooledValues *first = handle.Get();
+  common::ObjectPoolStats stats = {};
+
+  ASSERT_TRUE(handle);
+  handle->values.assign(100, 7);
+  handle.Reset();
+  EXPECT_FALSE(handle);
+
+  handle = pool.Acquire();
+  EXPECT_EQ(first, handle.Get());
+  EXPECT_TRUE(handle->values.empty());
+  EXPECT_GE(handle->values.capacity(), 100u);
+  EXPECT_EQ(1, handle->clear_count);
+
+  stats = pool.Stats();
+  EXPECT_EQ(2u, stats.acquires);
+  EXPECT_EQ(1u, stats.hits);
+  EXPECT_EQ(1u, stats.releases);
+  EXPECT_EQ(1u, stats.in_use);
+  EXPECT_EQ(0u, stats.retained);
+  EXPECT_DOUBLE_EQ(0.5, common::ObjectPoolHitRate(stats));
+
+  /* Warm, refilling within the kept capacity allocates nothing. */
+  handle.Reset();
+  EXPECT_TRUE(test::AllocatesNothing([&]()
+  {
+    handle = pool.Acquire();
+    handle->values.assign(100, 8);
+    handle.Reset();
+  }));
+}
+
+TEST(ObjectPoolTest, KeepsAtMostMaxRetainedObjects)
+{
+  common::ObjectPool<PooledValues> pool(common::ObjectPoolOptions{2});
+  std::vector<common::ObjectPool<PooledValues>::Handle> handles;
+  common::ObjectPoolStats stats = {};
+
+  for (int i = 0; i < 5; ++i)
+  {
+    handles.push_back(pool.Acquire());
+  }
+  handles.clear();
+  stats = pool.Stats();
+  EXPECT_EQ(5u, stats.releases);
+  EXPECT_EQ(3u, stats.discards);
+  EXPECT_EQ(2u, stats.retained);
+  EXPECT_EQ(2u, stats.peak_retained);
+  EXPECT_EQ(0u, stats.in_use);
+  EXPECT_EQ(5u, stats.peak_in_use);
+
+  /* A moved handle returns its object once. */
+  handles.push_back(pool.Acquire());
+  handles.push_back(std::move(handles[0]));
+  handles.clear();
+  EXPECT_EQ(6u, pool.Stats().releases);
+
+  pool.Trim();
+  EXPECT_EQ(0u, pool.Stats().retained);
+}
+
+TEST(PublicApiTest, RecordDecoderReturnsViewsIntoTheChunk)
+{
+  const std::vector<std::vector<std::byte>> kRecords = MakeRecords(50);
+  const std::string kPath = TemporaryPath("public_api_decoder_test");
+  std::vector<std::byte> stream(1 << 20);
+  std::span<const std::byte> chunk;
+  std::span<const std::byte> record;
+  std::size_t count = 0;
+  api::RecordDecoder decoder;
+  api::RecordDecoder moved;
+
+  RecordWriter writer(RecordWriterOptions{4096, false});
+  ASSERT_TRUE(writer.Open(kPath.c_str()));
+  for (const std::vector<std::byte> &payload : kRecords)
+  {
+    ASSERT_TRUE(writer.Write(payload));
+  }
+  ASSERT_TRUE(writer.Close());
+  std::FILE *file = std::fopen(kPath.c_str(), "rb");
+  ASSERT_NE(nullptr, file);
+  stream.resize(std::fread(stream.data(), 1, stream.size(), file));
+  std::fclose(file);
+  std::remove(kPath.c_str());
+
+  chunk = stream;
+  EXPECT_EQ(api::Status::kEmptyHandle, decoder.Next(chunk, record));
+  ASSERT_EQ(api::Status::kOk, decoder.Create());
+  moved = std::move(decoder);
+  EXPECT_EQ(api::Status::kEmptyHandle, decoder.Finish());
+  while (moved.Next(chunk, record) == api::Status::kOk)
+  {
+    ASSERT_LT(count, kRecords.size());
+    EXPECT_TRUE(record.empty() || (record.data() >= stream.data() &&
+        record.data() + record.size() <= stream.data() + stream.size()));
+    ASSERT_TRUE(std::equal(record.begin(), record.end(),
+        kRecords[count].begin(), kRecords[count].end()));
+    ++count;
+  }
+  EXPECT_EQ(kRecords.size(), count);
+  EXPECT_EQ(api::Status::kEnd, moved.Finish());
+
+  ASSERT_EQ(api::Status::kOk, moved.Create());
+  chunk = std::span<const std::byte>(stream).first(stream.size() - 1);
+  while (moved.Next(chunk, record) == api::Status::kOk)
+  {
+    ++count;
+  }
+  EXPECT_EQ(api::Status::kTruncated, moved.Finish());
+}
+
+TEST(PublicApiTest, ModuleBDoSomethingElseMatchesTheModule)
+{
+  const std::vector<int> kStructVars = {-3, 0, 4, 1 << 29};
+  std::vector<int> results(kStructVars.size(), 0);
+
+  ASSERT_EQ(api::Status::kOk, api::ModuleBDoSomethingElse(
+      api::SomeEnum::kEnumVarOne, kStructVars, results));
+  for (std::size_t i = 0; i < kStructVars.size(); ++i)
+  {
+    EXPECT_EQ(DoSomethingElse(SomeEnum::kEnumVarOne,
+        SomeStruct{kStructVars[i]}), results[i]);
+  }
+  results.push_back(0);
+  EXPECT_EQ(api::Status::kSizeMismatch, api::ModuleBDoSomethingElse(
+      api::SomeEnum::kEnumVarOne, kStructVars, results));
+}
+
+TEST(TempFuncMemoTest, TempFuncConsultsTheMemoOnlyWhileEnabled)
+{
+  const int kSomeInput = kTempVar;
+  const int kSomeOtherInput = 3;
+  const std::uint32_t kComputed = TempFuncUnrolled(0,
+      std::uint32_t{kSomeOtherInput}, std::uint32_t{kSomeInput});
+  const common::TempFuncKey kKey{std::uint32_t{kSomeOtherInput},
+      std::uint32_t{kSomeInput}, 0};
+  int some_input_output = 0;
+
+  /* A planted result TempFunc itself would never compute. */
+  temp_func_memo.Enable(common::MemoCacheOptions{1024, 4});
+  temp_func_memo.Store(kKey, kComputed + 1);
+  TempFunc(kSomeOtherInput, &kSomeInput, &some_input_output, nullptr);
+  EXPECT_EQ(static_cast<int>(kComputed + 1), some_input_output);
+  EXPECT_GE(temp_func_memo.Stats().hits, 1);
+
+  temp_func_memo.Disable();
+  some_input_output = 0;
+  TempFunc(kSomeOtherInput, &kSomeInput, &some_input_output, nullptr);
+  EXPECT_EQ(static_cast<int>(kComputed), some_input_output);
+}
+
+} /* namespace module_b */
+} /* namespace project_structure */
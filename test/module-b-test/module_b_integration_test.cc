@@ -2,13 +2,613 @@
  *==============================================================================
  * Author: Carl Larsson
  * Creation date: 2024-09-09
- * Last modified: 2024-10-08 by Carl Larsson
- * Description: Example .cc file used for example file structure and Google C++ 
- * style guide, it is only meant to be used as a template. All functions and 
- * variables are dummy and the contents of this file should in no way been seen 
- * as a reflection of a real file.
+ * Last modified: 2026-10-18 by Carl Larsson
+ * Description: Integration tests for module_b, covering the ring queues which
+ * connect the module_a and module_b pipeline stages, the ingest loop and
+ * block log replay.
  * License: See LICENSE file for license details.
  *==============================================================================
  */
 
-/* Placeholder file used for showing structure, nothing else. */
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "common/ring_queue.h"
+#include "common/unix_server.h"
+#include "lib/library.h"
+#include "module-b/block_log.h"
+#include "module-b/ingest.h"
+#include "module-b/record_stream.h"
+#include "test/alloc_assertions.h"
+
+
+namespace project_structure
+{
+namespace module_b
+{
+
+/* Elements pushed by every producer in the concurrent tests. */
+constexpr int kElementsPerProducer = 100000;
+
+/*
+ * Runs producer_count producers and consumer_count consumers over queue with
+ * batches of varying size and checks that every element arrives exactly once.
+ */
+template <typename Queue>
+static void RunProducersAndConsumers(Queue &queue, int producer_count,
+    int consumer_count)
+{
+  std::vector<std::atomic<int>> seen(producer_count * kElementsPerProducer);
+  std::vector<std::thread> producers;
+  std::vector<std::thread> consumers;
+  for (int p = 0; p < producer_count; ++p)
+  {
+    producers.emplace_back([&queue, p]()
+    {
+      std::vector<int> batch;
+      for (int i = 0; i < kElementsPerProducer; i += 1 + i % 17)
+      {
+        batch.clear();
+        for (int j = i; j < i + 1 + i % 17 && j < kElementsPerProducer; ++j)
+        {
+          batch.push_back(p * kElementsPerProducer + j);
+        }
+        EXPECT_TRUE(queue.PushBatch(std::span<const int>(batch)));
+      }
+    });
+  }
+  for (int c = 0; c < consumer_count; ++c)
+  {
+    consumers.emplace_back([&queue, &seen, c]()
+    {
+      std::vector<int> batch(static_cast<std::size_t>(1 + c * 7), 0);
+      std::size_t count = queue.PopBatch(batch);
+      for (; count > 0; count = queue.PopBatch(batch))
+      {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+          seen[static_cast<std::size_t>(batch[i])].fetch_add(1,
+              std::memory_order_relaxed);
+        }
+      }
+    });
+  }
+  for (std::thread &producer : producers)
+  {
+    producer.join();
+  }
+  queue.Close();
+  for (std::thread &consumer : consumers)
+  {
+    consumer.join();
+  }
+  for (std::size_t i = 0; i < seen.size(); ++i)
+  {
+    ASSERT_EQ(seen[i].load(), 1) << "element " << i;
+  }
+}
+
+TEST(SpscRingQueueTest, BatchesKeepOrderAcrossWrapAround)
+{
+  common::SpscRingQueue<int> queue(6);
+  std::vector<int> values(5, 0);
+  std::vector<int> popped(3, 0);
+  int next_push = 0;
+  int next_pop = 0;
+  std::size_t count = 0;
+  ASSERT_EQ(queue.Capacity(), 8u);
+  /* Elements only ever move through the ring, never through the heap. */
+  EXPECT_TRUE(test::AllocatesNothing([&]()
+  {
+    for (int round = 0; round < 100; ++round)
+    {
+      for (std::size_t i = 0; i < values.size(); ++i)
+      {
+        values[i] = next_push + static_cast<int>(i);
+      }
+      next_push += static_cast<int>(queue.TryPushBatch(
+          std::span<const int>(values)));
+      while (next_push - next_pop > 2)
+      {
+        count = queue.TryPopBatch(popped);
+        ASSERT_GT(count, 0u);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+          ASSERT_EQ(popped[i], next_pop++);
+        }
+      }
+    }
+  }));
+  EXPECT_GT(next_push, 100);
+}
+
+TEST(SpscRingQueueTest, TryPushFailsWhenFullAndTryPopWhenEmpty)
+{
+  common::SpscRingQueue<int> queue(4);
+  int value = 0;
+  EXPECT_FALSE(queue.TryPop(value));
+  for (int i = 0; i < 4; ++i)
+  {
+    EXPECT_TRUE(queue.TryPush(i));
+  }
+  EXPECT_FALSE(queue.TryPush(4));
+  EXPECT_TRUE(queue.TryPop(value));
+  EXPECT_EQ(value, 0);
+  EXPECT_TRUE(queue.TryPush(4));
+}
+
+TEST(SpscRingQueueTest, BlockingProducerAndConsumerSeeEveryElement)
+{
+  common::SpscRingQueue<int, common::BlockingWait> queue(64);
+  RunProducersAndConsumers(queue, 1, 1);
+}
+
+TEST(MpmcRingQueueTest, SpinningProducersAndConsumersSeeEveryElementOnce)
+{
+  common::MpmcRingQueue<int, common::SpinWait> queue(128);
+  RunProducersAndConsumers(queue, 3, 3);
+}
+
+TEST(MpmcRingQueueTest, BlockingProducersAndConsumersSeeEveryElementOnce)
+{
+  common::MpmcRingQueue<int, common::BlockingWait> queue(128);
+  RunProducersAndConsumers(queue, 3, 3);
+}
+
+TEST(MpmcRingQueueTest, CloseWakesBlockedConsumerAndKeepsElements)
+{
+  common::MpmcRingQueue<int, common::BlockingWait> queue(16);
+  std::vector<int> popped(16, 0);
+  std::atomic<std::size_t> total{0};
+  std::thread consumer([&]()
+  {
+    std::size_t count = queue.PopBatch(popped);
+    for (; count > 0; count = queue.PopBatch(popped))
+    {
+      total.fetch_add(count, std::memory_order_relaxed);
+    }
+  });
+  EXPECT_TRUE(queue.TryPush(1));
+  EXPECT_TRUE(queue.TryPush(2));
+  queue.Close();
+  consumer.join();
+  EXPECT_EQ(total.load(), 2u);
+  EXPECT_FALSE(queue.PushBatch(std::span<const int>(popped)));
+}
+
+/* Records every record and end it is given, per source. */
+class CollectingSink : public RecordSink
+{
+ public:
+  explicit CollectingSink(std::size_t source_count)
+      : records(source_count), ends(source_count, RecordStatus::kOk)
+  {
+  }
+
+  void OnRecord(std::size_t source, std::span<const std::byte> record)
+      override
+  {
+    records[source].emplace_back(record.begin(), record.end());
+  }
+
+  void OnSourceEnd(std::size_t source, RecordStatus status) override
+  {
+    ends[source] = status;
+  }
+
+  std::vector<std::vector<std::vector<std::byte>>> records;
+  std::vector<RecordStatus> ends;
+};
+
+/* Record i of a test stream, i bytes of value i. */
+static std::vector<std::byte> MakeIngestRecord(std::size_t i)
+{
+  return std::vector<std::byte>(i % 700, static_cast<std::byte>(i & 0xffu));
+}
+
+/* Writes a stream of count test records to fd and closes it. */
+static void WriteIngestStream(int fd, std::size_t count)
+{
+  RecordWriter writer(RecordWriterOptions{512, true});
+  writer.OpenDescriptor(fd);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    writer.Write(MakeIngestRecord(i));
+  }
+  writer.Close();
+  close(fd);
+}
+
+TEST(IngestLoopTest, EveryBackendReadsFilesPipesAndSockets)
+{
+  /*
+   * Small buffers, so that records span reads and buffers run out. io_uring
+   * also without multishot receives, as on kernels before 6.0.
+   */
+  const IngestOptions kOptions[] = {
+      IngestOptions{IngestBackend::kAuto, 1000, 8, 8, 3, true},
+      IngestOptions{IngestBackend::kIoUring, 1000, 8, 8, 3, true},
+      IngestOptions{IngestBackend::kIoUring, 1000, 8, 8, 3, false},
+      IngestOptions{IngestBackend::kEpoll, 1000, 8, 8, 3, true},
+      IngestOptions{IngestBackend::kBlocking, 1000, 8, 8, 3, true}};
+  const std::size_t kRecordCount = 2000;
+  const std::string kPath = testing::TempDir() + "ingest_test" +
+      std::to_string(getpid());
+  int pipe_fds[2] = {-1, -1};
+  int socket_fds[2] = {-1, -1};
+  int file_fd = -1;
+  std::thread pipe_writer;
+  std::thread socket_writer;
+
+  for (const IngestOptions &options : kOptions)
+  {
+    file_fd = open(kPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(file_fd, 0);
+    WriteIngestStream(file_fd, kRecordCount);
+    file_fd = open(kPath.c_str(), O_RDONLY);
+    ASSERT_GE(file_fd, 0);
+    ASSERT_EQ(0, pipe(pipe_fds));
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, socket_fds));
+    pipe_writer = std::thread(WriteIngestStream, pipe_fds[1], kRecordCount);
+    socket_writer = std::thread(WriteIngestStream, socket_fds[1],
+        kRecordCount);
+
+    IngestLoop loop(options);
+    CollectingSink sink(3);
+    EXPECT_EQ(0u, loop.AddSource(file_fd));
+    EXPECT_EQ(1u, loop.AddSource(pipe_fds[0]));
+    EXPECT_EQ(2u, loop.AddSource(socket_fds[0]));
+    ASSERT_TRUE(loop.Run(sink));
+    pipe_writer.join();
+    socket_writer.join();
+    close(file_fd);
+    close(pipe_fds[0]);
+    close(socket_fds[0]);
+
+    EXPECT_NE(IngestBackend::kAuto, loop.Backend());
+    for (std::size_t source = 0; source < 3; ++source)
+    {
+      EXPECT_EQ(RecordStatus::kEnd, sink.ends[source]);
+      ASSERT_EQ(kRecordCount, sink.records[source].size());
+      for (std::size_t i = 0; i < kRecordCount; ++i)
+      {
+        ASSERT_EQ(MakeIngestRecord(i), sink.records[source][i]);
+      }
+    }
+    EXPECT_EQ(3 * kRecordCount, loop.Stats().records);
+    EXPECT_GT(loop.Stats().syscalls, 0u);
+  }
+  std::remove(kPath.c_str());
+}
+
+TEST(IngestLoopTest, ReportsCorruptAndTruncatedStreams)
+{
+  const std::byte kGarbage[] = {std::byte{'X'}, std::byte{'Y'},
+      std::byte{'Z'}, std::byte{0}, std::byte{0}, std::byte{0},
+      std::byte{0}, std::byte{0}};
+  const std::byte kTruncated[] = {std::byte{'P'}, std::byte{'S'},
+      std::byte{'R'}, std::byte{'S'}, std::byte{kRecordStreamVersion},
+      std::byte{0}, std::byte{0}, std::byte{0}, std::byte{5}, std::byte{1}};
+  int socket_fds[2] = {-1, -1};
+  int pipe_fds[2] = {-1, -1};
+
+  for (IngestBackend backend : {IngestBackend::kIoUring,
+      IngestBackend::kEpoll})
+  {
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, socket_fds));
+    ASSERT_EQ(0, pipe(pipe_fds));
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(kGarbage)),
+        write(socket_fds[1], kGarbage, sizeof(kGarbage)));
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(kTruncated)),
+        write(pipe_fds[1], kTruncated, sizeof(kTruncated)));
+    close(pipe_fds[1]);
+
+    IngestLoop loop(IngestOptions{backend, 4096, 8, 8, 1});
+    CollectingSink sink(2);
+    loop.AddSource(socket_fds[0]);
+    loop.AddSource(pipe_fds[0]);
+    /* The socket stays open, the loop has to give up on it by itself. */
+    ASSERT_TRUE(loop.Run(sink));
+    EXPECT_EQ(RecordStatus::kCorrupt, sink.ends[0]);
+    EXPECT_EQ(RecordStatus::kTruncated, sink.ends[1]);
+    close(socket_fds[0]);
+    close(socket_fds[1]);
+    close(pipe_fds[0]);
+  }
+}
+
+TEST(BlockLogReplayTest, ParallelReplayDeliversInOrderLikeSerialReplay)
+{
+  const std::size_t kRecordCount = 5000;
+  const std::string kPath = testing::TempDir() + "block_log_replay_test" +
+      std::to_string(getpid());
+  const std::uint64_t kFirstRecords[] = {0, 1777, kRecordCount - 1,
+      kRecordCount};
+  std::vector<std::byte> log;
+  long size = 0;
+
+  BlockLogWriter writer(BlockLogWriterOptions{2048, true});
+  ASSERT_TRUE(writer.Open(kPath.c_str()));
+  for (std::size_t i = 0; i < kRecordCount; ++i)
+  {
+    ASSERT_TRUE(writer.Write(MakeIngestRecord(i)));
+  }
+  ASSERT_TRUE(writer.Close());
+  BlockLogReader reader;
+  ASSERT_EQ(RecordStatus::kOk, reader.Open(kPath.c_str()));
+
+  lib::ThreadPool pool(lib::ThreadPoolOptions{3, false, 64, {}});
+  for (std::uint64_t first_record : kFirstRecords)
+  {
+    /* Serial, one block ahead and the default read ahead. */
+    CollectingSink sink(3);
+    EXPECT_EQ(RecordStatus::kEnd, ReplayBlockLog(reader, nullptr,
+        BlockLogReplayOptions{0, first_record}, sink, 0));
+    EXPECT_EQ(RecordStatus::kEnd, ReplayBlockLog(reader, &pool,
+        BlockLogReplayOptions{1, first_record}, sink, 1));
+    EXPECT_EQ(RecordStatus::kEnd, ReplayBlockLog(reader, &pool,
+        BlockLogReplayOptions{0, first_record}, sink, 2));
+    for (std::size_t source = 0; source < 3; ++source)
+    {
+      EXPECT_EQ(RecordStatus::kEnd, sink.ends[source]);
+      ASSERT_EQ(kRecordCount - first_record, sink.records[source].size());
+      for (std::size_t i = 0; i < sink.records[source].size(); ++i)
+      {
+        ASSERT_EQ(MakeIngestRecord(first_record + i),
+            sink.records[source][i]);
+      }
+    }
+  }
+
+  /* Replay stops at a damaged block, after the records before it. */
+  std::FILE *file = std::fopen(kPath.c_str(), "rb");
+  ASSERT_NE(nullptr, file);
+  ASSERT_EQ(0, std::fseek(file, 0, SEEK_END));
+  size = std::ftell(file);
+  std::rewind(file);
+  log.resize(static_cast<std::size_t>(size));
+  ASSERT_EQ(log.size(), std::fread(log.data(), 1, log.size(), file));
+  std::fclose(file);
+  std::remove(kPath.c_str());
+  ASSERT_EQ(RecordStatus::kOk, reader.OpenBuffer(log));
+  ASSERT_GT(reader.BlockCount(), 8u);
+  log[log.size() - kBlockLogFooterSize - reader.BlockCount() *
+      kBlockIndexEntrySize - 20] ^= std::byte{0x40};
+  CollectingSink sink(1);
+  EXPECT_EQ(RecordStatus::kCorrupt, ReplayBlockLog(reader, &pool,
+      BlockLogReplayOptions{}, sink));
+  EXPECT_EQ(RecordStatus::kCorrupt, sink.ends[0]);
+  EXPECT_EQ(reader.BlockFirstRecord(reader.BlockCount() - 1),
+      sink.records[0].size());
+}
+
+/* Replays a log from inside a task, for the block log replay tests. */
+struct ReplayTask : public lib::Task
+{
+  const BlockLogReader *reader;
+  lib::ThreadPool *pool;
+  CollectingSink *sink;
+  RecordStatus status;
+  std::size_t worker;
+  std::atomic<bool> done;
+};
+
+static void RunReplayTask(lib::Task &task)
+{
+  ReplayTask &replay = static_cast<ReplayTask &>(task);
+  replay.worker = replay.pool->CurrentWorkerIndex();
+  replay.status = ReplayBlockLog(*replay.reader, replay.pool,
+      BlockLogReplayOptions{}, *replay.sink);
+  replay.done.store(true, std::memory_order_release);
+  replay.done.notify_one();
+}
+
+TEST(BlockLogReplayTest, ReplayFromTheOnlyWorkerOfThePoolFinishes)
+{
+  const std::size_t kRecordCount = 2000;
+  const std::string kPath = testing::TempDir() + "block_log_worker_test" +
+      std::to_string(getpid());
+  ReplayTask replay;
+
+  BlockLogWriter writer(BlockLogWriterOptions{2048, true});
+  ASSERT_TRUE(writer.Open(kPath.c_str()));
+  for (std::size_t i = 0; i < kRecordCount; ++i)
+  {
+    ASSERT_TRUE(writer.Write(MakeIngestRecord(i)));
+  }
+  ASSERT_TRUE(writer.Close());
+  BlockLogReader reader;
+  ASSERT_EQ(RecordStatus::kOk, reader.Open(kPath.c_str()));
+  std::remove(kPath.c_str());
+  ASSERT_GT(reader.BlockCount(), 2u);
+
+  /* The blocks are queued behind the replay, on the one worker. */
+  lib::ThreadPool pool(lib::ThreadPoolOptions{1, false, 64, {}});
+  CollectingSink sink(1);
+  replay.function = &RunReplayTask;
+  replay.reader = &reader;
+  replay.pool = &pool;
+  replay.sink = &sink;
+  replay.status = RecordStatus::kOk;
+  replay.done.store(false, std::memory_order_relaxed);
+  lib::TaskGroup group(pool);
+  group.Spawn(replay);
+  /* Not Wait, which could run the replay on this thread instead. */
+  replay.done.wait(false, std::memory_order_acquire);
+  group.Wait();
+  EXPECT_EQ(0u, replay.worker);
+  EXPECT_EQ(RecordStatus::kEnd, replay.status);
+  ASSERT_EQ(kRecordCount, sink.records[0].size());
+  for (std::size_t i = 0; i < kRecordCount; ++i)
+  {
+    ASSERT_EQ(MakeIngestRecord(i), sink.records[0][i]);
+  }
+}
+
+/* Answers every request with its bytes reversed, closes on empty ones. */
+class ReversingHandler : public common::FrameHandler
+{
+ public:
+  bool HandleFrame(std::span<const std::byte> request,
+      std::vector<std::byte> &response) override
+  {
+    response.assign(request.rbegin(), request.rend());
+    return !request.empty();
+  }
+};
+
+/* A blocking client connection to the server at path, -1 on failure. */
+static int ConnectToServer(const std::string &path)
+{
+  sockaddr_un address = {};
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, path.c_str(), path.size());
+  if (fd >= 0 && connect(fd, reinterpret_cast<const sockaddr *>(&address),
+      sizeof(address)) != 0)
+  {
+    close(fd);
+    fd = -1;
+  }
+  return fd;
+}
+
+/* Reads exactly size bytes from fd, false if it ends before. */
+static bool ReadExactly(int fd, std::byte *data, std::size_t size)
+{
+  ssize_t result = 0;
+  for (std::size_t done = 0; done < size; done += static_cast<std::size_t>(
+      result))
+  {
+    result = read(fd, data + done, size - done);
+    if (result <= 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+TEST(UnixServerTest, PipelinedRequestsAreAnsweredInOrderAndCoalesced)
+{
+  const std::string kPath = "/tmp/module_b_server_test_" +
+      std::to_string(getpid());
+  const std::size_t kRequestCount = 200;
+  common::UnixServer server;
+  ReversingHandler handler;
+  std::vector<std::byte> requests;
+  std::vector<std::byte> header(common::kFrameHeaderSize);
+  std::vector<std::byte> response;
+  std::vector<std::byte> expected;
+  int fd = -1;
+  ASSERT_TRUE(server.Listen(kPath.c_str()));
+  std::thread server_thread([&server, &handler]()
+  {
+    EXPECT_TRUE(server.Run(handler));
+  });
+
+  /* Every request is written before the first response is read. */
+  for (std::size_t i = 0; i < kRequestCount; ++i)
+  {
+    common::AppendFrameHeader(requests, static_cast<std::uint32_t>(
+        1 + i % 300));
+    for (std::size_t j = 0; j < 1 + i % 300; ++j)
+    {
+      requests.push_back(static_cast<std::byte>(i + j));
+    }
+  }
+  fd = ConnectToServer(kPath);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(static_cast<ssize_t>(requests.size()),
+      write(fd, requests.data(), requests.size()));
+  for (std::size_t i = 0; i < kRequestCount; ++i)
+  {
+    ASSERT_TRUE(ReadExactly(fd, header.data(), header.size()));
+    response.resize(common::ReadFrameHeader(header.data()));
+    ASSERT_TRUE(ReadExactly(fd, response.data(), response.size()));
+    expected.clear();
+    for (std::size_t j = 1 + i % 300; j > 0; --j)
+    {
+      expected.push_back(static_cast<std::byte>(i + j - 1));
+    }
+    ASSERT_EQ(expected, response) << "response " << i;
+  }
+  close(fd);
+
+  server.Stop();
+  server_thread.join();
+  EXPECT_EQ(kRequestCount, server.Stats().requests);
+  /* The responses to one read go out together. */
+  EXPECT_LT(server.Stats().writes, kRequestCount);
+  EXPECT_NE(0, access(kPath.c_str(), F_OK));
+}
+
+TEST(UnixServerTest, BadRequestsCloseOnlyTheirConnection)
+{
+  const std::string kPath = "/tmp/module_b_server_test_" +
+      std::to_string(getpid());
+  common::UnixServer server(common::UnixServerOptions{16, 64, 1024, 8});
+  ReversingHandler handler;
+  std::vector<std::byte> oversized;
+  std::vector<std::byte> empty;
+  std::vector<std::byte> good;
+  std::byte response[common::kFrameHeaderSize + 2] = {};
+  int oversized_fd = -1;
+  int empty_fd = -1;
+  int good_fd = -1;
+  ASSERT_TRUE(server.Listen(kPath.c_str()));
+  std::thread server_thread([&server, &handler]()
+  {
+    EXPECT_TRUE(server.Run(handler));
+  });
+
+  common::AppendFrameHeader(oversized, 17);
+  oversized.resize(oversized.size() + 17);
+  common::AppendFrameHeader(empty, 0);
+  common::AppendFrameHeader(good, 2);
+  good.push_back(std::byte{1});
+  good.push_back(std::byte{2});
+  oversized_fd = ConnectToServer(kPath);
+  empty_fd = ConnectToServer(kPath);
+  good_fd = ConnectToServer(kPath);
+  ASSERT_GE(oversized_fd, 0);
+  ASSERT_GE(empty_fd, 0);
+  ASSERT_GE(good_fd, 0);
+  ASSERT_EQ(static_cast<ssize_t>(oversized.size()),
+      write(oversized_fd, oversized.data(), oversized.size()));
+  ASSERT_EQ(static_cast<ssize_t>(empty.size()),
+      write(empty_fd, empty.data(), empty.size()));
+  ASSERT_EQ(static_cast<ssize_t>(good.size()),
+      write(good_fd, good.data(), good.size()));
+  EXPECT_EQ(0, read(oversized_fd, response, sizeof(response)));
+  EXPECT_EQ(0, read(empty_fd, response, sizeof(response)));
+  ASSERT_TRUE(ReadExactly(good_fd, response, sizeof(response)));
+  EXPECT_EQ(2u, common::ReadFrameHeader(response));
+  EXPECT_EQ(std::byte{2}, response[common::kFrameHeaderSize]);
+  EXPECT_EQ(std::byte{1}, response[common::kFrameHeaderSize + 1]);
+  close(oversized_fd);
+  close(empty_fd);
+  close(good_fd);
+
+  server.Stop();
+  server_thread.join();
+  EXPECT_EQ(3u, server.Stats().connections);
+}
+
+} /* namespace module_b */
+} /* namespace project_structure */